@@ -27,11 +27,13 @@
 #include "cube_hardware.h"
 #include "cube_debug.h"
 #include "cube_cpu_callbacks.h"
+#include "sessionlog.h"
+#include "prng.h"
 
 namespace Cube {
 
-bool Hardware::init(VirtualTime *masterTimer, const char *firmwareFile,
-    FlashStorage::CubeRecord *flashStorage)
+bool Hardware::init(unsigned id, VirtualTime *masterTimer, const char *firmwareFile,
+    FlashStorage::CubeRecord *flashStorage, bool useHLE)
 {
     time = masterTimer;
     hwDeadline.init(time);
@@ -43,6 +45,7 @@ bool Hardware::init(VirtualTime *masterTimer, const char *firmwareFile,
     exceptionCount = 0;
     
     memset(&cpu, 0, sizeof cpu);
+    cpu.id = id;
     cpu.callbackData = this;
     cpu.vtime = masterTimer;
     
@@ -64,13 +67,16 @@ bool Hardware::init(VirtualTime *masterTimer, const char *firmwareFile,
     mdu.init();
     i2c.init();
     lcd.init();
-    rng.init();
+    rng.init(id);
     neighbors.init();
     
+    SessionLog::seedPRNG(&noisePRNG, SessionLog::PRNG_CUBE_ACCEL_NOISE, id);
     setTouch(false);
     
     // XXX: Simulated battery level
     i2c.accel.setADC1(0x8760);
+
+    hle.init(this, useHLE);
     
     return true;
 }
@@ -90,6 +96,7 @@ uint64_t Hardware::getHWID() const
 void Hardware::reset()
 {
     CPU::em8051_reset(&cpu, false);
+    hle.reset();
 }
 
 void Hardware::fullReset()
@@ -241,7 +248,12 @@ void Hardware::setAcceleration(float xG, float yG, float zG)
      * the firmware has it configured for a full scale of +/- 2g).
      */
 
-    i2c.accel.setVector(scaleAccelAxis(xG), scaleAccelAxis(yG), scaleAccelAxis(zG));
+    int16_t x = scaleAccelAxis(xG);
+    int16_t y = scaleAccelAxis(yG);
+    int16_t z = scaleAccelAxis(zG);
+
+    i2c.accel.setVector(x, y, z);
+    hle.setAcceleration(x, y, z);
 }
 
 int16_t Hardware::scaleAccelAxis(float g)
@@ -258,7 +270,7 @@ int16_t Hardware::scaleAccelAxis(float g)
     const float fullScale = 2.0f;
     const int noiseAmount = 0x60;  // A little less than 1 LSB after truncation
 
-    unsigned randomBits = rand();
+    unsigned randomBits = PRNG::value(&noisePRNG);
     int noise = ((randomBits & 0xFFFF) * noiseAmount) >> 16;
     if ((randomBits >> 16) & 1)
         noise = -noise;
@@ -293,6 +305,22 @@ void Hardware::setTouch(bool touching)
         cpu.mSFR[MISC_PORT] |= MISC_TOUCH;
     else
         cpu.mSFR[MISC_PORT] &= ~MISC_TOUCH;
+
+    hle.setTouch(touching);
+}
+
+uint64_t Hardware::getPackedRXAddr()
+{
+    if (hle.isEnabled())
+        return hle.getPackedRXAddr();
+    return spi.radio.getPackedRXAddr();
+}
+
+bool Hardware::handleRadioPacket(Radio::Packet &incoming, Radio::Packet &ack)
+{
+    if (hle.isEnabled())
+        return hle.handlePacket(incoming, ack);
+    return spi.radio.handlePacket(incoming, ack);
 }
 
 bool Hardware::isDebugging()
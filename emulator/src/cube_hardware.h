@@ -42,6 +42,7 @@
 #include "cube_flash.h"
 #include "cube_neighbors.h"
 #include "cube_cpu_core.h"
+#include "cube_hle.h"
 #include "cube_debug.h"
 #include "vtime.h"
 #include "tracer.h"
@@ -95,9 +96,10 @@ class Hardware {
     Flash flash;
     Neighbors neighbors;
     RNG rng;
+    HLE hle;
 
-    bool init(VirtualTime *masterTimer, const char *firmwareFile,
-        FlashStorage::CubeRecord *flashStorage);
+    bool init(unsigned id, VirtualTime *masterTimer, const char *firmwareFile,
+        FlashStorage::CubeRecord *flashStorage, bool useHLE=false);
 
     void reset();
     void fullReset();
@@ -110,6 +112,8 @@ class Hardware {
 
     ALWAYS_INLINE unsigned getNeighborID() const {
         // This is assigned by the cube firmware, and stored for our perusal in an unused SFR.
+        if (hle.isEnabled())
+            return hle.getNeighborID();
         return cpu.mSFR[0xA1 - 0x80];
     }
 
@@ -162,9 +166,15 @@ class Hardware {
     }
 
     ALWAYS_INLINE bool isRadioClockRunning() {
+        if (hle.isEnabled())
+            return hle.isRadioOn();
         return rfcken && !cpu.powerDown;
     }
 
+    // Radio entry points, routed to either the nRF model or HLE
+    uint64_t getPackedRXAddr();
+    bool handleRadioPacket(Radio::Packet &incoming, Radio::Packet &ack);
+
     uint32_t getExceptionCount();
     void incExceptionCount();
     void logWatchdogReset();
@@ -202,6 +212,7 @@ class Hardware {
             CPU::wake_from_sleep(&cpu, 0x80);
     }
 
+    _SYSPseudoRandomState noisePRNG;
     int16_t scaleAccelAxis(float g);
     void hwDeadlineWork();
     TickDeadline hwDeadline;
@@ -0,0 +1,864 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+#include "cube_hle.h"
+#include "cube_hardware.h"
+#include "radio.h"
+#include "radioaddrfactory.h"
+#include "sessionlog.h"
+#include "prng.h"
+
+namespace Cube {
+
+
+HLE::HLE()
+    : hw(NULL), time(NULL), lsdec(NULL, 0), enabled(false), vram(NULL), touching(false)
+{
+    memset(accel, 0, sizeof accel);
+}
+
+void HLE::init(Hardware *hw, bool enable)
+{
+    this->hw = hw;
+    time = hw->time;
+    enabled = enable;
+    SessionLog::seedPRNG(&prng, SessionLog::PRNG_CUBE_HWID, hw->id());
+
+    // The 8051 isn't running, so we keep VRAM where scripts can see it
+    STATIC_ASSERT(sizeof *vram <= sizeof hw->cpu.mExtData);
+    vram = reinterpret_cast<_SYSVideoRAM*>(hw->cpu.mExtData);
+
+    if (enabled) {
+        FlashStorage::CubeRecord *storage = hw->flash.getStorage();
+        lsdec = LoadstreamDecoder(storage->ext, sizeof storage->ext);
+        reset();
+    }
+}
+
+void HLE::reset()
+{
+    /*
+     * Equivalent to the cube firmware booting up: everything but the
+     * contents of flash and NVM starts over.
+     */
+
+    if (!enabled)
+        return;
+
+    FlashStorage::CubeRecord *storage = hw->flash.getStorage();
+
+    if (hw->getHWID() == ~(uint64_t)0) {
+        /*
+         * The firmware generates its own HWID on first boot, and the
+         * master reads it back from NVM when pairing. First byte is the
+         * cube version, the rest are random.
+         */
+
+        storage->nvm[0] = CUBE_VERSION_LATEST;
+        for (unsigned i = 1; i < HWID_LEN; i++)
+            storage->nvm[i] = PRNG::value(&prng) % 0xFF;
+    }
+
+    memset(vram, 0, sizeof *vram);
+    memset(&ack, 0, sizeof ack);
+    memcpy(ack.hwid, storage->nvm, HWID_LEN);
+    ack.battery_v = SIMULATED_BATTERY_V;
+
+    lsdec.reset();
+
+    connected = false;
+    asleep = false;
+    codecResetPending = true;
+    nbTxID = 0;
+    napUntil = 0;
+    disconnectDeadline = 0;
+    txCount = 0;
+
+    ptr = 0;
+    codecState = C_DEFAULT;
+    sampleS = 0;
+    diffD = RF_VRAM_DIFF_BASE;
+
+    ackBits = 0;
+    nextAck = 0;
+    renderFlags = 0;
+    pixelCount = 0;
+    frameDeadline = time->clocks;
+
+    setIdleAddress();
+    lcdOff();
+}
+
+void HLE::setIdleAddress()
+{
+    // Idle hopping isn't modeled; the master tries our primary channel too.
+    RadioAddress addr;
+    RadioAddrFactory::fromHardwareID(addr, hw->getHWID());
+    rxAddr = addr.pack();
+}
+
+bool HLE::isRadioOn() const
+{
+    return enabled && !asleep && time->clocks >= napUntil;
+}
+
+uint64_t HLE::getPackedRXAddr() const
+{
+    return rxAddr;
+}
+
+void HLE::setAcceleration(int16_t x, int16_t y, int16_t z)
+{
+    accel[0] = x;
+    accel[1] = y;
+    accel[2] = z;
+}
+
+void HLE::setTouch(bool touching)
+{
+    this->touching = touching;
+}
+
+bool HLE::handlePacket(const Radio::Packet &incoming, Radio::Packet &reply)
+{
+    /*
+     * Like the nRF, we reply with whichever ACK payload was queued
+     * before this packet arrived. Anything this packet produces goes
+     * out with the next one.
+     */
+
+    if (!isRadioOn())
+        return false;
+
+    if (txCount) {
+        reply = txFIFO[0];
+        txCount--;
+        memmove(txFIFO, txFIFO + 1, txCount * sizeof txFIFO[0]);
+    } else {
+        reply.len = 0;
+    }
+
+    // The protocol is stateless while disconnected, and after short packets
+    if (!connected || codecResetPending) {
+        codecResetPending = false;
+        codecState = C_DEFAULT;
+        ptr = 0;
+    }
+    if (incoming.len != Radio::PAYLOAD_MAX)
+        codecResetPending = true;
+
+    decodePacket(incoming);
+
+    disconnectDeadline = time->clocks + VirtualTime::msec(3500);
+
+    // Query responses are queued by the flash decoder, ahead of our ACK
+    uint8_t response[LoadstreamDecoder::QUERY_LEN];
+    if (lsdec.popQueryResponse(response))
+        pushReply(response, sizeof response);
+
+    sendACK();
+
+    // Touch was stretched until it made it into an ACK. Now follow the pin.
+    uint8_t touchFlag = touching ? NB0_FLAG_TOUCH : 0;
+    if ((ack.neighbors[0] ^ touchFlag) & NB0_FLAG_TOUCH) {
+        ack.neighbors[0] ^= NB0_FLAG_TOUCH;
+        ackBits |= ACK_BIT_NEIGHBOR;
+    }
+
+    return true;
+}
+
+void HLE::pushReply(const uint8_t *bytes, unsigned len)
+{
+    // Like W_ACK_PAYLD on a full FIFO, extra replies are lost
+    if (txCount < TX_FIFO_SIZE) {
+        Radio::Packet &p = txFIFO[txCount++];
+        p.pid = 0;
+        p.len = len;
+        memcpy(p.payload, bytes, len);
+    }
+}
+
+void HLE::sendACK()
+{
+    // Disconnected cubes always send a full ACK
+    uint8_t bits = connected ? ackBits : 0xFF;
+    if (!bits)
+        return;
+    ackBits = 0;
+
+    unsigned len;
+    if (bits & ACK_BIT_HWID)
+        len = RF_ACK_LEN_HWID;
+    else if (bits & ACK_BIT_BATTERY_V)
+        len = RF_ACK_LEN_BATTERY_V;
+    else if (bits & ACK_BIT_FLASH_FIFO)
+        len = RF_ACK_LEN_FLASH_FIFO;
+    else if (bits & ACK_BIT_NEIGHBOR)
+        len = RF_ACK_LEN_NEIGHBOR;
+    else if (bits & ACK_BIT_ACCEL)
+        len = RF_ACK_LEN_ACCEL;
+    else
+        len = RF_ACK_LEN_FRAME;
+
+    pushReply(ack.bytes, len);
+}
+
+void HLE::decodePacket(const Radio::Packet &incoming)
+{
+    // Nybbles are least significant first. Escapes consume the rest of
+    // the packet, starting at the next byte boundary.
+
+    for (unsigned i = 0; i < incoming.len; i++) {
+        uint8_t byte = incoming.payload[i];
+        Escape esc = decodeNybble(byte & 0xF);
+        if (esc == ESC_NONE)
+            esc = decodeNybble(byte >> 4);
+
+        if (esc != ESC_NONE) {
+            codecState = C_DEFAULT;
+            handleEscape(esc, incoming.payload + i + 1, incoming.len - i - 1);
+            return;
+        }
+    }
+}
+
+HLE::Escape HLE::decodeNybble(uint8_t nybble)
+{
+    // See the "Master -> Cube (RF) packet format" notes in protocol.h
+
+    switch (codecState) {
+
+    case C_DEFAULT:
+        switch (nybble >> 2) {
+
+        case 0:     // 00nn, a run or an RLE special code
+            savedNybble = nybble;
+            codecState = C_RLE;
+            return ESC_NONE;
+
+        case 1:     // 01ss, copy sample
+            sampleS = nybble & 3;
+            diffD = RF_VRAM_DIFF_BASE;
+            writeDeltas(1);
+            return ESC_NONE;
+
+        case 2:     // 10ss dddd, diff against sample
+            savedNybble = nybble;
+            codecState = C_DIFF;
+            return ESC_NONE;
+
+        default:    // 11xx xxxx xxxx xxxx, literal 14-bit index
+            partialHigh = (nybble & 3) << 6;
+            codecState = C_LITERAL_1;
+            return ESC_NONE;
+        }
+
+    case C_DIFF:
+        codecState = C_DEFAULT;
+        if (nybble == RF_VRAM_DIFF_BASE)
+            return Escape(ESC_SENSOR_SYNC + (savedNybble & 3));
+        sampleS = savedNybble & 3;
+        diffD = nybble;
+        writeDeltas(1);
+        return ESC_NONE;
+
+    case C_RLE:
+        if (nybble & 0xC) {
+            // Plain run. Emit it, then this nybble starts a new code.
+            codecState = C_DEFAULT;
+            writeDeltas((savedNybble & 3) + 1);
+            return decodeNybble(nybble);
+        }
+
+        switch (savedNybble) {
+
+        case 0:
+        case 1:     // 000n 00nn, skip n+1 words
+            codecState = C_DEFAULT;
+            ptr += 2 * ((((nybble & 3) << 1) | (savedNybble & 1)) + 1);
+            ptr &= _SYS_VRAM_BYTE_MASK;
+            return ESC_NONE;
+
+        case 2:     // 0010 00nn nnnn, write n+5 delta-words
+            partialLow = (nybble & 3) << 4;
+            codecState = C_RLE_LONG;
+            return ESC_NONE;
+
+        default:
+            switch (nybble) {
+            case 0:
+            case 1: // 0011 000x xxxx xxxx, set write address
+                partialHigh = nybble;
+                codecState = C_ADDR_LOW;
+                return ESC_NONE;
+            case 2: // 0011 0010, literal 16-bit word
+                codecState = C_WORD_1;
+                return ESC_NONE;
+            default:
+                codecState = C_DEFAULT;
+                return ESC_FLASH;
+            }
+        }
+
+    case C_RLE_LONG:
+        codecState = C_DEFAULT;
+        writeDeltas((partialLow | nybble) + 5);
+        return ESC_NONE;
+
+    case C_ADDR_LOW:
+        partialLow = nybble;
+        codecState = C_ADDR_HIGH;
+        return ESC_NONE;
+
+    case C_ADDR_HIGH:
+        codecState = C_DEFAULT;
+        ptr = ((partialHigh << 9) | ((partialLow | (nybble << 4)) << 1)) & _SYS_VRAM_BYTE_MASK;
+        return ESC_NONE;
+
+    case C_LITERAL_1:
+        partialLow = nybble;
+        codecState = C_LITERAL_2;
+        return ESC_NONE;
+
+    case C_LITERAL_2:
+        partialLow |= nybble << 4;
+        codecState = C_LITERAL_3;
+        return ESC_NONE;
+
+    case C_LITERAL_3:
+        codecState = C_DEFAULT;
+        writeWord(partialLow << 1,
+            (((nybble << 2) | ((partialLow >> 7) << 1)) & 0x3E) | partialHigh);
+        sampleS = 0;
+        diffD = RF_VRAM_DIFF_BASE;
+        return ESC_NONE;
+
+    case C_WORD_1:
+        partialLow = nybble;
+        codecState = C_WORD_2;
+        return ESC_NONE;
+
+    case C_WORD_2:
+        partialLow |= nybble << 4;
+        codecState = C_WORD_3;
+        return ESC_NONE;
+
+    case C_WORD_3:
+        partialHigh = nybble;
+        codecState = C_WORD_4;
+        return ESC_NONE;
+
+    case C_WORD_4:
+        codecState = C_DEFAULT;
+        writeWord(partialLow, partialHigh | (nybble << 4));
+        sampleS = 0;
+        diffD = RF_VRAM_DIFF_BASE;
+        return ESC_NONE;
+    }
+
+    return ESC_NONE;
+}
+
+void HLE::writeWord(uint8_t low, uint8_t high)
+{
+    vram->bytes[ptr] = low;
+    vram->bytes[ptr + 1] = high;
+    ptr = (ptr + 2) & _SYS_VRAM_BYTE_MASK;
+}
+
+void HLE::writeDeltas(unsigned count)
+{
+    /*
+     * Copy from sample point S, adding (D-7) as a 7:7 tile index.
+     * Like the firmware, we add twice the diff to the low byte and
+     * propagate its carry (or borrow) into the high byte.
+     */
+
+    static const uint8_t samples[] = {
+        RF_VRAM_SAMPLE_0, RF_VRAM_SAMPLE_1, RF_VRAM_SAMPLE_2, RF_VRAM_SAMPLE_3
+    };
+
+    int diff = 2 * (int(diffD) - RF_VRAM_DIFF_BASE);
+    unsigned offset = 2 * samples[sampleS];
+
+    while (count--) {
+        unsigned src = (ptr - offset) & _SYS_VRAM_BYTE_MASK;
+        unsigned low = vram->bytes[src] + uint8_t(diff);
+        uint8_t high = vram->bytes[src + 1];
+
+        if (diff >= 0 && low > 0xFF)
+            high += 2;
+        else if (diff < 0 && low <= 0xFF)
+            high -= 2;
+
+        writeWord(low, high);
+    }
+}
+
+void HLE::handleEscape(Escape esc, const uint8_t *args, unsigned len)
+{
+    switch (esc) {
+
+    case ESC_NONE:
+        break;
+
+    case ESC_FLASH:
+        if (len == 0) {
+            // Decoder reset, acknowledged by toggling NB1_FLAG_FLS_RESET
+            lsdec.reset();
+            ack.neighbors[1] ^= NB1_FLAG_FLS_RESET;
+            ackBits |= ACK_BIT_HWID;
+        } else {
+            // A hung decoder stops consuming bytes, which the master will notice
+            while (len-- && !lsdec.isHung()) {
+                lsdec.handleByte(*(args++));
+                ack.flash_fifo_bytes++;
+                ackBits |= ACK_BIT_FLASH_FIFO;
+            }
+        }
+        break;
+
+    case ESC_SENSOR_SYNC:
+        // Our sensors aren't driven by a free-running timer
+        break;
+
+    case ESC_FULL_ACK:
+        ackBits = 0xFF;
+        break;
+
+    case ESC_HOP:
+        // Channel, optional 5-byte address, optional neighbor ID
+        connected = true;
+        codecResetPending = true;
+        len = std::min(len, 7u);
+        if (len) {
+            uint64_t id = rxAddr & 0xFFFFFFFFFFULL;
+            if (len >= 6) {
+                id = 0;
+                for (int i = 5; i >= 1; i--)
+                    id = (id << 8) | args[i];
+            }
+            rxAddr = id | ((uint64_t)(args[0] & 0x7F) << 56);
+            if (len == 7)
+                nbTxID = args[6];
+        }
+        break;
+
+    case ESC_NAP:
+        // Duration is in 32.768 kHz ticks, counted from this packet
+        if (len >= 2)
+            napUntil = time->clocks + (args[0] | (args[1] << 8)) * VirtualTime::HZ / 32768;
+        break;
+    }
+}
+
+unsigned HLE::tick()
+{
+    uint64_t now = time->clocks;
+
+    if (asleep) {
+        // Only a touch wakes us up, and waking up is a full restart
+        if (!touching)
+            return VirtualTime::hz(FRAME_HZ);
+        reset();
+    }
+
+    if (connected && now >= disconnectDeadline) {
+        connected = false;
+        nbTxID = 0;
+        setIdleAddress();
+    }
+
+    if (now >= frameDeadline) {
+        frameDeadline = now + VirtualTime::hz(FRAME_HZ);
+        updateSensors();
+        paint();
+    }
+
+    uint64_t next = frameDeadline;
+    if (connected)
+        next = std::min(next, disconnectDeadline);
+    return next - now;
+}
+
+void HLE::updateSensors()
+{
+    // Accelerometer: only the high byte of each axis is reported
+    for (unsigned i = 0; i < 3; i++) {
+        int8_t value = accel[i] >> 8;
+        if (ack.accel[i] != value) {
+            ack.accel[i] = value;
+            ackBits |= ACK_BIT_ACCEL;
+        }
+    }
+
+    // Neighbors: report the ID that a connected neighbor is transmitting
+    for (unsigned side = 0; side < Neighbors::NUM_SIDES; side++) {
+        const uint8_t mask = NB_ID_MASK | NB_FLAG_SIDE_ACTIVE;
+        Hardware *other = hw->neighbors.getContact(side);
+        uint8_t value = other ? (other->hle.getNeighborID() & mask) : 0;
+
+        if ((ack.neighbors[side] ^ value) & mask) {
+            ack.neighbors[side] = (ack.neighbors[side] & ~mask) | value;
+            ackBits |= ACK_BIT_NEIGHBOR;
+        }
+    }
+
+    // Touch is stretched until the next ACK goes out
+    if (touching) {
+        ack.neighbors[0] |= NB0_FLAG_TOUCH;
+        ackBits |= ACK_BIT_NEIGHBOR;
+    }
+}
+
+void HLE::paint()
+{
+    /*
+     * Mirrors graphics_render() in the cube firmware, except that we
+     * check for new frames at a fixed rate rather than as fast as the
+     * LCD allows.
+     */
+
+    uint8_t flags = vram->flags;
+    uint8_t mode = vram->mode & _SYS_VM_MASK;
+
+    if (flags & _SYS_VF_CONTINUOUS) {
+        nextAck |= FRAME_ACK_CONTINUOUS;
+    } else {
+        nextAck &= ~FRAME_ACK_CONTINUOUS;
+    }
+
+    if ((flags & _SYS_VF_CONTINUOUS) || (((flags >> 1) ^ nextAck) & FRAME_ACK_TOGGLE)) {
+        nextAck = (nextAck & ~FRAME_ACK_COUNT) | ((nextAck + 1) & FRAME_ACK_COUNT);
+
+        if (mode == _SYS_VM_SLEEP) {
+            // The firmware powers down without ever acknowledging this frame
+            lcdOff();
+            asleep = true;
+            return;
+        }
+
+        renderFlags = flags;
+        renderFrame(mode);
+    }
+
+    if (nextAck != ack.frame_count) {
+        ack.frame_count = nextAck;
+        ackBits |= ACK_BIT_FRAME;
+    }
+}
+
+void HLE::lcdOff()
+{
+    hw->lcd.hleSleep();
+    hw->backlight.cycle(false, time->clocks);
+}
+
+void HLE::renderFrame(uint8_t mode)
+{
+    switch (mode) {
+    case _SYS_VM_BG0_ROM:
+    case _SYS_VM_SOLID:
+    case _SYS_VM_FB32:
+    case _SYS_VM_FB64:
+    case _SYS_VM_FB128:
+    case _SYS_VM_BG0:
+    case _SYS_VM_BG0_BG1:
+    case _SYS_VM_BG0_SPR_BG1:
+    case _SYS_VM_BG2:
+    case _SYS_VM_STAMP:
+        break;
+    default:
+        lcdOff();
+        return;
+    }
+
+    // Zero lines means 256, as in the firmware's do/while loops
+    unsigned numLines = vram->num_lines ? vram->num_lines : 256;
+    uint32_t startCount = pixelCount;
+
+    if (mode == _SYS_VM_STAMP) {
+        renderStamp(numLines);
+    } else {
+        uint16_t out[LCD::WIDTH];
+        for (unsigned line = 0; line < numLines; line++) {
+            renderLine(mode, line, out);
+            for (unsigned x = 0; x < LCD::WIDTH; x++)
+                plot(line, x, out[x]);
+        }
+    }
+
+    hw->lcd.hleFrame(pixelCount - startCount);
+    hw->backlight.cycle(true, time->clocks);
+}
+
+uint32_t HLE::tileIndex(uint16_t tile77)
+{
+    return ((tile77 & 0xFE00) >> 2) | ((tile77 & 0xFE) >> 1);
+}
+
+uint16_t HLE::flashPixel(uint32_t tile, unsigned pixel) const
+{
+    // Tiles are 8x8 big-endian RGB565 pixels, in the A21 bank from our flags
+    uint32_t addr = ((tile & 0x3FFF) << 7) | (pixel << 1);
+    if (renderFlags & _SYS_VF_A21)
+        addr |= 1 << 21;
+
+    const uint8_t *ext = hw->flash.getStorage()->ext;
+    return (ext[addr] << 8) | ext[addr + 1];
+}
+
+void HLE::plot(unsigned line, unsigned x, uint16_t color)
+{
+    // Same addressing the firmware sets up with MADCTR
+    unsigned row = (vram->first_line + line) & (LCD::HEIGHT - 1);
+    unsigned col = x & (LCD::WIDTH - 1);
+
+    if (renderFlags & _SYS_VF_XY_SWAP)
+        std::swap(row, col);
+    if (renderFlags & _SYS_VF_Y_FLIP)
+        row = LCD::HEIGHT - 1 - row;
+    if (renderFlags & _SYS_VF_X_FLIP)
+        col = LCD::WIDTH - 1 - col;
+
+    hw->lcd.fb_mem[col + (row << LCD::FB_ROW_SHIFT)] = color;
+    pixelCount++;
+}
+
+void HLE::renderLine(uint8_t mode, unsigned line, uint16_t *out)
+{
+    switch (mode) {
+
+    case _SYS_VM_BG0_ROM:
+        // The ROM tileset lives in cube firmware; we have no copy of it
+        memset(out, 0, LCD::WIDTH * sizeof out[0]);
+        break;
+
+    case _SYS_VM_SOLID:
+        for (unsigned x = 0; x < LCD::WIDTH; x++)
+            out[x] = vram->colormap[0];
+        break;
+
+    case _SYS_VM_FB32: {
+        // 32x32, 16 colors, 4x scale
+        unsigned rowAddr = (line >> 2) * 16;
+        for (unsigned x = 0; x < LCD::WIDTH; x++) {
+            uint8_t byte = vram->bytes[(rowAddr + (x >> 3)) & 0x1FF];
+            out[x] = vram->colormap[((x >> 2) & 1) ? (byte >> 4) : (byte & 0xF)];
+        }
+        break;
+    }
+
+    case _SYS_VM_FB64: {
+        // 64x64, 2 colors, 2x scale
+        unsigned rowAddr = (line >> 1) * 8;
+        for (unsigned x = 0; x < LCD::WIDTH; x++) {
+            uint8_t byte = vram->bytes[(rowAddr + (x >> 4)) & 0x1FF];
+            out[x] = vram->colormap[(byte >> ((x >> 1) & 7)) & 1];
+        }
+        break;
+    }
+
+    case _SYS_VM_FB128: {
+        // 128x48, 2 colors, repeating vertically
+        unsigned rowAddr = (line % 48) * 16;
+        for (unsigned x = 0; x < LCD::WIDTH; x++) {
+            uint8_t byte = vram->bytes[rowAddr + (x >> 3)];
+            out[x] = vram->colormap[(byte >> (x & 7)) & 1];
+        }
+        break;
+    }
+
+    case _SYS_VM_BG0:
+        renderBG0(line, out);
+        break;
+
+    case _SYS_VM_BG0_BG1:
+        renderBG0(line, out);
+        renderBG1(line, out);
+        break;
+
+    case _SYS_VM_BG0_SPR_BG1:
+        renderBG0(line, out);
+        renderSprites(line, out);
+        renderBG1(line, out);
+        break;
+
+    case _SYS_VM_BG2:
+        renderBG2(line, out);
+        break;
+    }
+}
+
+void HLE::renderBG0(unsigned line, uint16_t *out)
+{
+    const unsigned size = _SYS_VRAM_BG0_WIDTH * 8;
+    unsigned y = (vram->bg0_y + line) % size;
+
+    for (unsigned sx = 0; sx < LCD::WIDTH; sx++) {
+        unsigned x = (vram->bg0_x + sx) % size;
+        uint16_t tile = vram->bg0_tiles[(y >> 3) * _SYS_VRAM_BG0_WIDTH + (x >> 3)];
+        out[sx] = flashPixel(tileIndex(tile), ((y & 7) << 3) | (x & 7));
+    }
+}
+
+void HLE::renderBG1(unsigned line, uint16_t *out)
+{
+    /*
+     * BG1 tiles are packed in raster order, one for each set bit in the
+     * 16x16 bitmap. Pixels with the chroma key are transparent.
+     */
+
+    uint8_t y = vram->bg1_y + line;
+    unsigned ty = y >> 3;
+    if (ty >= 16)
+        return;
+
+    unsigned base = 0;
+    for (unsigned i = 0; i < ty; i++)
+        base += __builtin_popcount(vram->bg1_bitmap[i]);
+    uint16_t bits = vram->bg1_bitmap[ty];
+
+    for (unsigned sx = 0; sx < LCD::WIDTH; sx++) {
+        uint8_t x = vram->bg1_x + sx;
+        unsigned tx = x >> 3;
+        if (tx >= 16 || !((bits >> tx) & 1))
+            continue;
+
+        unsigned index = base + __builtin_popcount(bits & ((1 << tx) - 1));
+        if (index >= _SYS_VRAM_BG1_TILES)
+            continue;
+
+        uint16_t color = flashPixel(tileIndex(vram->bg1_tiles[index]), ((y & 7) << 3) | (x & 7));
+        if ((color >> 8) != _SYS_CHROMA_KEY)
+            out[sx] = color;
+    }
+}
+
+void HLE::renderSprites(unsigned line, uint16_t *out)
+{
+    /*
+     * Like vm_spr_next(), pick the first few sprites that are visible
+     * on this line. Lower-numbered sprites are drawn on top.
+     */
+
+    const _SYSSpriteInfo *active[_SYS_SPRITES_PER_LINE];
+    unsigned numActive = 0;
+
+    for (unsigned i = 0; i < _SYS_VRAM_SPRITES && numActive < _SYS_SPRITES_PER_LINE; i++) {
+        const _SYSSpriteInfo &spr = vram->spr[i];
+        uint8_t posX = spr.pos_x;
+
+        if (!spr.mask_y || (uint8_t(spr.pos_y + line) & spr.mask_y))
+            continue;
+        if ((posX & spr.mask_x) && posX + LCD::WIDTH - 1 < 0x100)
+            continue;
+
+        active[numActive++] = &spr;
+    }
+
+    while (numActive--) {
+        const _SYSSpriteInfo &spr = *active[numActive];
+        uint8_t y = spr.pos_y + line;
+        unsigned tilesWide = std::max(1, (uint8_t(-spr.mask_x) + 7) >> 3);
+        uint32_t rowTile = tileIndex(spr.tile) + (y >> 3) * tilesWide;
+
+        for (unsigned sx = 0; sx < LCD::WIDTH; sx++) {
+            uint8_t x = spr.pos_x + sx;
+            if (x & spr.mask_x)
+                continue;
+
+            uint16_t color = flashPixel(rowTile + (x >> 3), ((y & 7) << 3) | (x & 7));
+            if ((color >> 8) != _SYS_CHROMA_KEY)
+                out[sx] = color;
+        }
+    }
+}
+
+void HLE::renderBG2(unsigned line, uint16_t *out)
+{
+    /*
+     * A 16x16 tile grid, sampled through an 8.8 fixed-point affine
+     * transform. Anything outside the grid shows the border color.
+     */
+
+    const _SYSAffine &m = vram->bg2_affine;
+    int16_t x = m.cx + line * m.yx;
+    int16_t y = m.cy + line * m.yy;
+
+    for (unsigned sx = 0; sx < LCD::WIDTH; sx++) {
+        uint8_t tx = uint16_t(x) >> 8;
+        uint8_t ty = uint16_t(y) >> 8;
+
+        if ((tx | ty) & 0x80) {
+            out[sx] = vram->bg2_border;
+        } else {
+            uint16_t tile = vram->bg2_tiles[((ty >> 3) << 4) | (tx >> 3)];
+            out[sx] = flashPixel(tileIndex(tile), ((ty & 7) << 3) | (tx & 7));
+        }
+
+        x += m.xx;
+        y += m.xy;
+    }
+}
+
+void HLE::renderStamp(unsigned numLines)
+{
+    /*
+     * Reconfigurable 16-color framebuffer. Only columns inside the
+     * stamp are touched, and pixels matching the key are skipped.
+     */
+
+    unsigned pitch = vram->stamp_pitch ? vram->stamp_pitch : 256;
+    unsigned height = vram->stamp_height ? vram->stamp_height : 256;
+    unsigned width = vram->stamp_width ? vram->stamp_width : 256;
+    unsigned heightCounter = height;
+    unsigned src = 0;
+
+    for (unsigned line = 0; line < numLines; line++) {
+        for (unsigned i = 0; i < width; i++) {
+            uint8_t byte = vram->bytes[(src + ((i >> 1) % pitch)) & _SYS_VRAM_BYTE_MASK];
+            uint8_t index = (i & 1) ? (byte >> 4) : (byte & 0xF);
+            uint8_t x = vram->stamp_x + i;
+
+            if (index != vram->stamp_key && x < LCD::WIDTH)
+                plot(line, x, vram->colormap[index]);
+        }
+
+        if (!--heightCounter) {
+            heightCounter = height;
+            src = 0;
+        } else {
+            src += pitch;
+        }
+    }
+}
+
+
+};  // namespace Cube
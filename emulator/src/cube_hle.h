@@ -0,0 +1,199 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _CUBE_HLE_H
+#define _CUBE_HLE_H
+
+#include <stdint.h>
+#include <protocol.h>
+#include <sifteo/abi/vram.h>
+#include "cube_radio.h"
+#include "lsdec.h"
+#include "vtime.h"
+
+namespace Cube {
+
+class Hardware;
+
+
+/*
+ * High-level emulation of a cube.
+ *
+ * Instead of running the cube firmware on our 8051 core, this model
+ * implements the radio protocol and the graphics engine natively. VRAM
+ * is decoded straight out of incoming radio packets, loadstreams are
+ * installed by LoadstreamDecoder, and each frame is rendered in one pass
+ * directly into the LCD framebuffer.
+ *
+ * VRAM is kept in the otherwise unused 8051 XDATA, so scripts can read
+ * and modify it exactly as they would with the real firmware.
+ *
+ * This is far cheaper than cycle-accurate emulation, and it's meant for
+ * testing game logic rather than firmware. Anything that only exists in
+ * the cube firmware itself (the disconnected idle screen, the BG0_ROM
+ * tile set, neighbor pairing, LCD timing) is not modeled.
+ *
+ * Threading: handlePacket() runs on the MC thread while the cube thread
+ * is blocked by deadlineSync, tick() runs on the cube thread, and the
+ * sensor setters may be called from any thread.
+ */
+
+class HLE {
+ public:
+    static const unsigned FRAME_HZ = 60;
+
+    HLE();
+
+    void init(Hardware *hw, bool enable);
+    void reset();
+
+    ALWAYS_INLINE bool isEnabled() const {
+        return enabled;
+    }
+
+    ALWAYS_INLINE uint8_t getNeighborID() const {
+        return nbTxID;
+    }
+
+    bool isRadioOn() const;
+    uint64_t getPackedRXAddr() const;
+    bool handlePacket(const Radio::Packet &incoming, Radio::Packet &reply);
+
+    // Run any work that is due. Returns ticks until we need to run again.
+    unsigned tick();
+
+    void setAcceleration(int16_t x, int16_t y, int16_t z);
+    void setTouch(bool touching);
+
+ private:
+    enum CodecState {
+        C_DEFAULT = 0,
+        C_DIFF,
+        C_RLE,
+        C_RLE_LONG,
+        C_ADDR_LOW,
+        C_ADDR_HIGH,
+        C_LITERAL_1,
+        C_LITERAL_2,
+        C_LITERAL_3,
+        C_WORD_1,
+        C_WORD_2,
+        C_WORD_3,
+        C_WORD_4,
+    };
+
+    enum Escape {
+        ESC_NONE = 0,
+        ESC_FLASH,
+        ESC_SENSOR_SYNC,
+        ESC_FULL_ACK,
+        ESC_HOP,
+        ESC_NAP,
+    };
+
+    // ACK bits, as in the cube firmware's ack_bits
+    static const uint8_t ACK_BIT_FRAME      = 0x01;
+    static const uint8_t ACK_BIT_ACCEL      = 0x02;
+    static const uint8_t ACK_BIT_NEIGHBOR   = 0x04;
+    static const uint8_t ACK_BIT_FLASH_FIFO = 0x08;
+    static const uint8_t ACK_BIT_BATTERY_V  = 0x10;
+    static const uint8_t ACK_BIT_HWID       = 0x20;
+
+    static const unsigned TX_FIFO_SIZE = 3;
+    static const uint8_t SIMULATED_BATTERY_V = 0xF8;
+
+    void setIdleAddress();
+    void pushReply(const uint8_t *bytes, unsigned len);
+    void sendACK();
+
+    void decodePacket(const Radio::Packet &incoming);
+    Escape decodeNybble(uint8_t nybble);
+    void handleEscape(Escape esc, const uint8_t *args, unsigned len);
+    void writeDeltas(unsigned count);
+    void writeWord(uint8_t low, uint8_t high);
+
+    void updateSensors();
+    void paint();
+    void renderFrame(uint8_t mode);
+    void lcdOff();
+
+    static uint32_t tileIndex(uint16_t tile77);
+    uint16_t flashPixel(uint32_t tile, unsigned pixel) const;
+    void plot(unsigned line, unsigned x, uint16_t color);
+
+    void renderLine(uint8_t mode, unsigned line, uint16_t *out);
+    void renderBG0(unsigned line, uint16_t *out);
+    void renderBG1(unsigned line, uint16_t *out);
+    void renderSprites(unsigned line, uint16_t *out);
+    void renderBG2(unsigned line, uint16_t *out);
+    void renderStamp(unsigned numLines);
+
+    Hardware *hw;
+    const VirtualTime *time;
+    LoadstreamDecoder lsdec;
+    _SYSPseudoRandomState prng;     // For the HWID on first boot
+    bool enabled;
+
+    // Radio state
+    uint64_t rxAddr;
+    uint64_t napUntil;
+    uint64_t disconnectDeadline;
+    uint8_t nbTxID;
+    bool connected;
+    bool asleep;
+    bool codecResetPending;
+
+    Radio::Packet txFIFO[TX_FIFO_SIZE];
+    unsigned txCount;
+
+    // VRAM codec state. VRAM itself lives in the CPU's XDATA.
+    _SYSVideoRAM *vram;
+    uint16_t ptr;
+    uint8_t codecState;
+    uint8_t sampleS;
+    uint8_t diffD;
+    uint8_t savedNybble;
+    uint8_t partialLow;
+    uint8_t partialHigh;
+
+    // ACK state
+    RF_ACKType ack;
+    uint8_t ackBits;
+    uint8_t nextAck;
+
+    // Rendering state
+    uint64_t frameDeadline;
+    uint8_t renderFlags;
+    uint32_t pixelCount;
+
+    // Sensor inputs, written by other threads
+    int16_t accel[3];
+    bool touching;
+};
+
+
+};  // namespace Cube
+
+#endif
@@ -132,6 +132,24 @@ class LCD {
         return mode_awake && mode_display_on;
     }
 
+    /*
+     * Entry points for the high-level cube model (cube_hle.h), which
+     * renders straight into fb_mem instead of driving our pins.
+     */
+
+    void hleFrame(uint32_t pixels) {
+        mode_power_on = 1;
+        mode_awake = 1;
+        mode_display_on = 1;
+        frame_count++;
+        pixel_count += pixels;
+    }
+
+    void hleSleep() {
+        mode_awake = 0;
+        mode_display_on = 0;
+    }
+
     void pulseTE(TickDeadline &deadline) {
         if (mode_te) {
             // This runs on the GUI thread, use a lock-free timer.
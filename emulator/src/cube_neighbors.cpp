@@ -116,6 +116,20 @@ void Neighbors::ioTick(CPU::em8051 &cpu)
     }
 }
 
+Hardware *Neighbors::getContact(unsigned mySide) const
+{
+    if (!otherCubes)
+        return NULL;
+
+    for (unsigned otherSide = 0; otherSide < NUM_SIDES; otherSide++) {
+        uint32_t sideMask = mySides[mySide].otherSides[otherSide];
+        if (sideMask)
+            return &otherCubes[__builtin_ffs(sideMask) - 1];
+    }
+
+    return NULL;
+}
+
 void Neighbors::transmitPulse(CPU::em8051 &cpu, unsigned otherCube, uint8_t otherSide)
 {
     Hardware &dest = otherCubes[otherCube];
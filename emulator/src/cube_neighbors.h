@@ -103,6 +103,9 @@ class Neighbors {
         cpu.needTimerEdgeCheck = true;
     }
 
+    // First cube in contact with one of our sides, or NULL
+    Hardware *getContact(unsigned mySide) const;
+
     bool isSideReceiving(unsigned side) {
         return 1 & (inputMask >> side);
     }
@@ -33,6 +33,8 @@
 
 #include "vtime.h"
 #include "cube_cpu_reg.h"
+#include "prng.h"
+#include "sessionlog.h"
 
 namespace Cube {
 
@@ -40,8 +42,9 @@ namespace Cube {
 class RNG {
  public:
 
-    void init() {
+    void init(unsigned cubeID) {
         timer = 0;
+        SessionLog::seedPRNG(&prng, SessionLog::PRNG_CUBE_RNG, cubeID);
     }
 
     uint8_t controlRead(VirtualTime &vtime, CPU::em8051 &cpu) {
@@ -52,7 +55,7 @@ class RNG {
     uint8_t dataRead(VirtualTime &vtime, CPU::em8051 &cpu) {
         if ((cpu.mSFR[REG_RNGCTL] & RNGCTL_PWRUP) && timer <= vtime.clocks) {
             setTimer(vtime);
-            return rand();
+            return PRNG::value(&prng);
         }
         
         CPU::except(&cpu, CPU::EXCEPTION_RNG);
@@ -65,7 +68,8 @@ class RNG {
     }
     
  private:
-    uint64_t timer;        
+    uint64_t timer;
+    _SYSPseudoRandomState prng;
     
     void setTimer(VirtualTime &vtime) {
         timer = vtime.clocks + vtime.usec(400);
@@ -38,18 +38,43 @@
  * synchronization events, both threads run synchronously. As soon as the
  * event ends, both threads may resume running. The VirtualTime-based thread
  * can run up until the next deadline.
+ *
+ * The handoff itself is a single flag, owned by whichever side is
+ * currently allowed to run. When the optional 'spinFlag' is set (turbo
+ * mode) each side busy-waits briefly for the other before falling back
+ * to the condition variable. Neither thread is pacing itself against
+ * the wall clock then, so the other side almost always answers within
+ * the spin window, and we skip a pair of kernel wakeups per event.
+ *
+ * Spinning only helps if the two threads really run in parallel. With a
+ * single CPU, the spinner just burns the other thread's timeslice; a
+ * two-thread handoff test ran about 100x slower that way (roughly 1,000
+ * vs 120,000 events per second). So we never spin on a single-CPU host.
+ *
+ * Events can also be posted ahead of time with runEventAt(). If the
+ * simulation thread hasn't reached the deadline yet, it runs the event
+ * itself when it gets there, and carries straight on to the next
+ * deadline. Only the posting side waits, and only for the event to
+ * finish. The handoff state is one word, changed with compare-and-swap:
+ *
+ *   S_RUNNING:  The simulation thread may run up to the deadline.
+ *   S_WAITING:  It's halted at the deadline, waiting for an event.
+ *   S_POSTED:   An event is queued for it to run at the deadline.
  */
 class DeadlineSynchronizer {
 public:
-    
+    typedef void (*EventFn)(void *context);
+
     /**
      * Initialize the simulation thread, and bind this synchronizer to a clock.
      */
-    void init(const VirtualTime *vtime, bool *tickRunFlag)
+    void init(const VirtualTime *vtime, bool *tickRunFlag, const bool *spinFlag = 0)
     {
-        mThreadWaiting = false;
+        mState = S_RUNNING;
         mInEvent = false;
+        mSleepers = 0;
         mTickRunFlag = tickRunFlag;
+        mSpinFlag = tthread::thread::hardware_concurrency() > 1 ? spinFlag : 0;
 
         /*
          * Note 1: Must reset to 0 so that we don't run at all until the
@@ -77,6 +102,7 @@ public:
     void wake()
     {
         DEBUG_LOG(("SYNC: wake\n"));
+        tthread::lock_guard<tthread::mutex> guard(mMutex);
         mCond.notify_all();
     }
 
@@ -92,14 +118,10 @@ public:
         DEBUG_LOG(("SYNC: +beginEvent(%"PRIu64") run=%d\n", deadline, runFlag));
 
         ASSERT(!mInEvent);
-        mMutex.lock();
         mDeadline.resetTo(deadline);
         mInEvent = true;
 
-        while (!mThreadWaiting && runFlag) {
-            wake();
-            mCond.wait(mMutex);
-        }
+        waitWhile(S_RUNNING, runFlag);
 
         DEBUG_LOG(("SYNC: -beginEvent(%"PRIu64") run=%d\n", deadline, runFlag));
     }
@@ -139,20 +161,57 @@ public:
     {
         DEBUG_LOG(("SYNC: +endEvent(%"PRIu64")\n", nextDeadline));
 
-        // Can almost ASSERT(mThreadWaiting) here too, but that breaks down
+        // Can almost ASSERT(mState == S_WAITING) here too, but that breaks down
         // when one thread is exiting, and there's no good way to detect that here.
 
         ASSERT(mInEvent);
         mDeadline.resetTo(nextDeadline);
-
-        mThreadWaiting = false;
-        mCond.notify_all();
         mInEvent = false;
-        mMutex.unlock();
+
+        // Deadline must be visible before the thread sees it may run
+        __sync_synchronize();
+        mState = S_RUNNING;
+        signal();
 
         DEBUG_LOG(("SYNC: -endEvent(%"PRIu64")\n", nextDeadline));
     }
 
+    /**
+     * Run fn(context) as a synchronized event at exactly 'deadline', then
+     * let the thread run on to 'nextDeadline'. Returns once the event has
+     * run. As with beginEventAt(), the previous deadline must not have
+     * been greater than 'deadline'.
+     *
+     * If the thread is still running, it picks up the event when it
+     * reaches the deadline and calls 'fn' itself, without waiting for
+     * us. Otherwise we call 'fn' here, just like beginEventAt() and
+     * endEvent(). Either way, nothing else touches the thread's state
+     * while 'fn' runs.
+     */
+    void runEventAt(uint64_t deadline, uint64_t nextDeadline,
+        EventFn fn, void *context, bool &runFlag)
+    {
+        DEBUG_LOG(("SYNC: +runEventAt(%"PRIu64")\n", deadline));
+
+        ASSERT(!mInEvent);
+        mPostDeadline = deadline;
+        mPostNextDeadline = nextDeadline;
+        mPostFn = fn;
+        mPostContext = context;
+
+        if (__sync_bool_compare_and_swap(&mState, S_RUNNING, S_POSTED)) {
+            waitWhile(S_POSTED, runFlag);
+        } else {
+            beginEventAt(deadline, runFlag);
+            if (runFlag) {
+                fn(context);
+                endEvent(nextDeadline);
+            }
+        }
+
+        DEBUG_LOG(("SYNC: -runEventAt(%"PRIu64")\n", deadline));
+    }
+
     /**
      * Tick handler for the simulation thread
      */
@@ -171,20 +230,106 @@ public:
     }
     
 private:
+    // Busy-wait iterations before blocking, when spinning is enabled
+    static const unsigned SPIN_LIMIT = 20000;
+
     NEVER_INLINE void deadlineWork()
     {
         DEBUG_LOG(("SYNC: +deadlineWork (run=%d)\n", *mTickRunFlag));
 
-        tthread::lock_guard<tthread::mutex> guard(mMutex);
-        mThreadWaiting = true;
-        while (mThreadWaiting && *mTickRunFlag) {
-            wake();
-            mCond.wait(mMutex);
+        if (__sync_bool_compare_and_swap(&mState, S_RUNNING, S_WAITING)) {
+            signal();
+            waitWhile(S_WAITING, *mTickRunFlag);
+        } else {
+            runPostedEvent();
         }
 
         DEBUG_LOG(("SYNC: -deadlineWork (run=%d)\n", *mTickRunFlag));
     }
 
+    /**
+     * Simulation thread: we reached our deadline and found an event from
+     * runEventAt() waiting. Our deadline may be earlier than the event's,
+     * in which case we only move the deadline up and keep running.
+     */
+    void runPostedEvent()
+    {
+        ASSERT(mState == S_POSTED);
+
+        // Order our reads after the poster's writes
+        __sync_synchronize();
+
+        uint64_t now = mDeadline.clock();
+        ASSERT(now <= mPostDeadline);
+        if (now < mPostDeadline) {
+            mDeadline.resetTo(mPostDeadline);
+            return;
+        }
+
+        mPostFn(mPostContext);
+        mDeadline.resetTo(mPostNextDeadline);
+
+        // The event's effects must be visible before the poster returns
+        __sync_synchronize();
+        mState = S_RUNNING;
+        signal();
+    }
+
+    /**
+     * Wait until mState no longer equals 'state', or 'runFlag' is cleared.
+     *
+     * The sleeper count is incremented before re-checking the state, and
+     * signal() re-reads the count after writing the state. Both sides use
+     * full barriers, so at least one of them sees the other and a wakeup
+     * can't be lost between our last check and mCond.wait().
+     */
+    void waitWhile(int state, const bool &runFlag)
+    {
+        if (mSpinFlag && *mSpinFlag) {
+            for (unsigned i = 0; i < SPIN_LIMIT; ++i) {
+                if (mState != state || !runFlag) {
+                    // Order our later reads after the other side's writes
+                    __sync_synchronize();
+                    return;
+                }
+                spinPause();
+            }
+        }
+
+        tthread::lock_guard<tthread::mutex> guard(mMutex);
+        __sync_fetch_and_add(&mSleepers, 1);
+        while (mState == state && runFlag)
+            mCond.wait(mMutex);
+        __sync_fetch_and_sub(&mSleepers, 1);
+
+        __sync_synchronize();
+    }
+
+    /// Tell the CPU we're in a spin-wait loop; also a compiler barrier.
+    static ALWAYS_INLINE void spinPause()
+    {
+#if defined(__i386__) || defined(__x86_64__)
+        __asm__ __volatile__ ("pause" : : : "memory");
+#elif defined(__arm__) || defined(__aarch64__)
+        __asm__ __volatile__ ("yield" : : : "memory");
+#else
+        __asm__ __volatile__ ("" : : : "memory");
+#endif
+    }
+
+    /**
+     * Wake the other side after changing mState, but only pay
+     * for the mutex and notification if it actually went to sleep.
+     */
+    void signal()
+    {
+        __sync_synchronize();
+        if (mSleepers) {
+            tthread::lock_guard<tthread::mutex> guard(mMutex);
+            mCond.notify_all();
+        }
+    }
+
     TickDeadline mDeadline;
     tthread::mutex mMutex;
     tthread::condition_variable mCond;
@@ -192,8 +337,25 @@ private:
     // Run flag for the tick thread.
     bool *mTickRunFlag;
 
-    // Set to 'true' by tick thread, 'false' by external thread
-    bool mThreadWaiting;
+    // Optional flag, busy-wait before blocking while it's set.
+    const bool *mSpinFlag;
+
+    // Handoff state. See the class comment.
+    enum State {
+        S_RUNNING,
+        S_WAITING,
+        S_POSTED
+    };
+    volatile int mState;
+
+    // Event queued by runEventAt(). Written before mState becomes S_POSTED.
+    uint64_t mPostDeadline;
+    uint64_t mPostNextDeadline;
+    EventFn mPostFn;
+    void *mPostContext;
+
+    // Number of threads blocked on mCond
+    volatile unsigned mSleepers;
     
     // Between begin and end? For ASSERTs only.
     bool mInEvent;
@@ -44,7 +44,7 @@
 #include "flash_volume.h"
 #include "flash_recycler.h"
 #include "ostime.h"
-#include "lodepng.h"
+#include "mappedfile.h"
 
 
 // Compiled launcher ELF binary, installed in new volumes.
@@ -171,25 +171,26 @@ bool FlashStorage::installLauncher(const char *filename)
     uint32_t launcherSize = *reinterpret_cast<const uint32_t*>(launcher);
     const uint8_t *launcherData = launcher + 4;
     
-    std::vector<uint8_t> data;
+    MappedFile file;
     if (filename) {
-        LodePNG::loadFile(data, filename);
-        if (data.empty()) {
+        if (!file.map(filename)) {
             LOG(("FLASH: Launcher binary '%s' cannot be read\n", filename));
             return false;
         }
-        launcherSize = data.size();
-        launcherData = &data[0];
+        launcherSize = file.size();
+        launcherData = file.data();
     }
 
     FlashVolumeWriter writer;
     if (!writer.beginLauncher(launcherSize)) {
         LOG(("FLASH: Insufficient space for launcher binary\n"));
+        file.unmap();
         return false;
     }
 
     writer.appendPayload(launcherData, launcherSize);
     writer.commit();
+    file.unmap();
     return true;
 }
 
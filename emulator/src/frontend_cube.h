@@ -29,6 +29,7 @@
 
 #include <Box2D/Box2D.h>
 #include "system.h"
+#include "sessionlog.h"
 #include "frontend_fixture.h"
 
 class FrontendCube;
@@ -123,7 +124,7 @@ class FrontendCube {
     void toggleFlip();
     
     void setTouch(float amount) {
-        hw->setTouch(amount);
+        SessionLog::setTouch(*hw, amount);
     }
     
     bool isHovering() {
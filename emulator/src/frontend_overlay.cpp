@@ -26,6 +26,7 @@
 
 #include "frontend.h"
 #include "mc_audiovisdata.h"
+#include "audiomixer.h"
 
 static const Color msgColor(1, 1, 0.2);
 static const Color helpTextColor(1, 1, 1);
@@ -289,4 +290,19 @@ void FrontendOverlay::drawRealTimeInfo()
 
     if (sys->tracer.isEnabled())
         text(debugColor, "Trace Enabled");
+
+    /*
+     * Mixer buffering, shown alongside the audio visualizer. Latency
+     * here is only the mixer's own ring; the host audio buffer adds more.
+     */
+
+    if (visualizerVisible) {
+        const _SYSAudioCounters *c = AudioMixer::instance.getCounters();
+        const float msPerSample = 1000.0f / AudioMixer::SAMPLE_HZ;
+        char buf[96];
+
+        snprintf(buf, sizeof buf, "Audio: %u underruns, target %.1f ms, max %.1f ms",
+            c->underruns, c->fillTarget * msPerSample, c->maxLatency * msPerSample);
+        text(c->underruns ? debugColor : realTimeColor, buf);
+    }
 }
@@ -32,9 +32,11 @@
  */
 
 #include <string.h>
+#include <protocol.h>
 #include "macros.h"
 #include "lsdec.h"
 #include "cube_flash_model.h"
+#include "cube_ccp.h"
 
 
 LoadstreamDecoder::LoadstreamDecoder(uint8_t *buffer, uint32_t bufferSize)
@@ -49,6 +51,17 @@ void LoadstreamDecoder::reset()
     memset(lut, 0, sizeof lut);
     state = S_OPCODE;
     flashAddr = 0;
+    queryPending = false;
+}
+
+bool LoadstreamDecoder::popQueryResponse(uint8_t *response)
+{
+    if (!queryPending)
+        return false;
+
+    memcpy(response, query, QUERY_LEN);
+    queryPending = false;
+    return true;
 }
 
 void LoadstreamDecoder::setAddress(uint32_t addr)
@@ -78,6 +91,56 @@ void LoadstreamDecoder::write16(uint16_t value)
     write8(value >> 8);
 }
 
+void LoadstreamDecoder::copyTiles(uint32_t srcAddr, unsigned count)
+{
+    // Like the cube, copy byte-by-byte from flash we've already written.
+    // Both addresses are in the same endian-swapped format, so no swap here.
+
+    for (unsigned i = 0; i < count * TILE_SIZE; i++) {
+        uint32_t src = (srcAddr + i) % bufferSize;
+        write8(buffer[src ^ 1]);
+    }
+}
+
+void LoadstreamDecoder::queryCRC(unsigned numBlocks)
+{
+    /*
+     * Same algorithm as flash_query_crc() in the cube firmware. Each
+     * 16-tile block folds into the 16-byte result, one byte per tile.
+     * Every tile gets four rounds of GF multiply-and-XOR, and the
+     * intermediate CRC value picks the next byte we sample. Reads
+     * are raw flash bytes, so there's no endian swap here.
+     */
+
+    static const uint8_t GENERATOR = 0x84;  // See tools/gfm.py
+    static const unsigned TILES_PER_BANK = 1 << 14;
+
+    uint32_t bank = flashAddr & (1 << 21);
+    unsigned tile = (flashAddr / TILE_SIZE) % TILES_PER_BANK;
+
+    memset(query + 1, 0, QUERY_LEN - 1);
+
+    while (numBlocks--) {
+        uint8_t crc = 0xFF;
+        uint8_t sample = 0;
+
+        for (unsigned i = 1; i < QUERY_LEN; i++) {
+            const uint8_t *tileData = buffer + ((bank | tile * TILE_SIZE) % bufferSize);
+
+            for (unsigned round = 0; round < 4; round++) {
+                crc = tileData[sample >> 1] ^ Cube::CCP::galoisFieldMultiply(crc, GENERATOR);
+                sample = crc;
+            }
+
+            query[i] ^= crc;
+            tile = (tile + 1) % TILES_PER_BANK;
+        }
+    }
+
+    setAddress(bank | tile * TILE_SIZE);
+    queryPending = true;
+}
+
 void LoadstreamDecoder::handleByte(uint8_t byte)
 {
     switch (state) {
@@ -127,6 +190,18 @@ void LoadstreamDecoder::handleByte(uint8_t byte)
                 state = S_ADDR_LOW;
                 return;
 
+            case OP_COPY_TILES:
+                state = S_COPY_LAT1;
+                return;
+
+            case OP_QUERY_CRC:
+                state = S_QUERY_ID;
+                return;
+
+            case OP_CHECK_QUERY:
+                state = S_CHECK_COUNT;
+                return;
+
             default:
                 ASSERT(0);
                 return;
@@ -149,6 +224,60 @@ void LoadstreamDecoder::handleByte(uint8_t byte)
         return;
     }
 
+    case S_COPY_LAT1: {
+        partial = byte;
+        state = S_COPY_LAT2;
+        return;
+    }
+
+    case S_COPY_LAT2: {
+        // Source is always in the same A21 bank as the write address
+        uint32_t lat1_part = (partial >> 1) << 7;
+        uint32_t lat2_part = (byte >> 1) << 14;
+        uint32_t a21_part = flashAddr & (1 << 21);
+        copyAddr = lat1_part | lat2_part | a21_part;
+        state = S_COPY_COUNT;
+        return;
+    }
+
+    case S_COPY_COUNT: {
+        copyTiles(copyAddr, byte ? byte : 256);
+        state = S_OPCODE;
+        return;
+    }
+
+    case S_QUERY_ID: {
+        query[0] = byte | QUERY_ACK_BIT;
+        state = S_QUERY_COUNT;
+        return;
+    }
+
+    case S_QUERY_COUNT: {
+        queryCRC(byte ? byte : 256);
+        state = S_OPCODE;
+        return;
+    }
+
+    case S_CHECK_COUNT: {
+        counter = byte;
+        partial = 0;
+        queryMismatch = 0;
+        state = S_CHECK_BYTES;
+        return;
+    }
+
+    case S_CHECK_BYTES: {
+        // Anything past the end of the query buffer can never match
+        queryMismatch |= partial < QUERY_LEN ? (byte ^ query[partial]) : 1;
+        partial++;
+        if (!--counter)
+            state = queryMismatch ? S_HANG : S_OPCODE;
+        return;
+    }
+
+    case S_HANG:
+        return;
+
     case S_LUT1_COLOR1: {
         partial = byte;
         state = S_LUT1_COLOR2;
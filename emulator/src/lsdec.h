@@ -39,15 +39,28 @@
 
 class LoadstreamDecoder {
 public:
+    // Query responses: one ID byte, then a 16-byte CRC
+    static const unsigned QUERY_LEN = 17;
+
     LoadstreamDecoder(uint8_t *buffer, uint32_t bufferSize);
 
     void reset();
     void handleByte(uint8_t b);
     void setAddress(uint32_t addr);
 
+    // Copies out a finished query response, if one is waiting
+    bool popQueryResponse(uint8_t *response);
+
+    // A failed CHECK_QUERY stops the decoder until the next reset()
+    bool isHung() const {
+        return state == S_HANG;
+    }
+
 private:
     void write8(uint8_t value);
     void write16(uint16_t value);
+    void copyTiles(uint32_t srcAddr, unsigned count);
+    void queryCRC(unsigned numBlocks);
     
     uint8_t *buffer;
     uint32_t bufferSize;
@@ -67,6 +80,11 @@ private:
 
     static const uint8_t OP_NOP         = 0xe0;
     static const uint8_t OP_ADDRESS     = 0xe1;
+    static const uint8_t OP_QUERY_CRC   = 0xe2;
+    static const uint8_t OP_CHECK_QUERY = 0xe3;
+    static const uint8_t OP_COPY_TILES  = 0xe4;
+
+    static const uint32_t TILE_SIZE     = 128;
 
     // State machine states
     enum States {
@@ -83,10 +101,19 @@ private:
         S_TILE_P16_MASK,
         S_TILE_P16_LOW,
         S_TILE_P16_HIGH,
+        S_COPY_LAT1,
+        S_COPY_LAT2,
+        S_COPY_COUNT,
+        S_QUERY_ID,
+        S_QUERY_COUNT,
+        S_CHECK_COUNT,
+        S_CHECK_BYTES,
+        S_HANG,
     };
 
     // Codec state
     uint32_t flashAddr;
+    uint32_t copyAddr;
     uint16_t lut[LUT_SIZE];
     uint16_t lutVector;
     uint8_t opcode;
@@ -95,6 +122,11 @@ private:
     uint8_t counter;
     uint8_t rle1;
     uint8_t rle2;
+
+    // Query state
+    uint8_t query[QUERY_LEN];
+    uint8_t queryMismatch;
+    bool queryPending;
 };
 
 
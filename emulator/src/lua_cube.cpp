@@ -33,6 +33,7 @@
 #include "svmmemory.h"
 #include "cubeslots.h"
 #include "ostime.h"
+#include "sessionlog.h"
 
 const char LuaCube::className[] = "Cube";
 
@@ -47,6 +48,8 @@ Lunar<LuaCube>::RegType LuaCube::methods[] = {
     LUNAR_DECLARE_METHOD(LuaCube, handleRadioPacket),
     LUNAR_DECLARE_METHOD(LuaCube, saveScreenshot),
     LUNAR_DECLARE_METHOD(LuaCube, testScreenshot),
+    LUNAR_DECLARE_METHOD(LuaCube, setTouch),
+    LUNAR_DECLARE_METHOD(LuaCube, setAcceleration),
     LUNAR_DECLARE_METHOD(LuaCube, testSetEnabled),
     LUNAR_DECLARE_METHOD(LuaCube, testGetACK),
     LUNAR_DECLARE_METHOD(LuaCube, testWrite),
@@ -62,6 +65,18 @@ Lunar<LuaCube>::RegType LuaCube::methods[] = {
     LUNAR_DECLARE_METHOD(LuaCube, fbPeek),
     LUNAR_DECLARE_METHOD(LuaCube, nbPoke),
     LUNAR_DECLARE_METHOD(LuaCube, nbPeek),
+    LUNAR_DECLARE_METHOD(LuaCube, xRead),
+    LUNAR_DECLARE_METHOD(LuaCube, xWrite),
+    LUNAR_DECLARE_METHOD(LuaCube, xCRC),
+    LUNAR_DECLARE_METHOD(LuaCube, iRead),
+    LUNAR_DECLARE_METHOD(LuaCube, iWrite),
+    LUNAR_DECLARE_METHOD(LuaCube, iCRC),
+    LUNAR_DECLARE_METHOD(LuaCube, fRead),
+    LUNAR_DECLARE_METHOD(LuaCube, fWrite),
+    LUNAR_DECLARE_METHOD(LuaCube, fCRC),
+    LUNAR_DECLARE_METHOD(LuaCube, nRead),
+    LUNAR_DECLARE_METHOD(LuaCube, nWrite),
+    LUNAR_DECLARE_METHOD(LuaCube, nCRC),
     {0,0}
 };
 
@@ -200,6 +215,125 @@ int LuaCube::nbPoke(lua_State *L)
     return 0;
 }
 
+bool LuaCube::checkRange(lua_State *L, uint32_t memSize, uint32_t addr, size_t count)
+{
+    if (addr > memSize || count > memSize || addr + count > memSize) {
+        lua_pushfstring(L, "memory address and/or size out of range");
+        lua_error(L);
+        return false;
+    }
+    return true;
+}
+
+int LuaCube::readRange(lua_State *L, const uint8_t *mem, uint32_t memSize)
+{
+    // (address, count) -> (data)
+    uint32_t addr = luaL_checkinteger(L, 1);
+    uint32_t count = luaL_checkinteger(L, 2);
+
+    if (!checkRange(L, memSize, addr, count))
+        return 0;
+
+    lua_pushlstring(L, (const char *) mem + addr, count);
+    return 1;
+}
+
+int LuaCube::writeRange(lua_State *L, uint8_t *mem, uint32_t memSize)
+{
+    // (address, data)
+    size_t count = 0;
+    uint32_t addr = luaL_checkinteger(L, 1);
+    const char *data = luaL_checklstring(L, 2, &count);
+
+    if (!checkRange(L, memSize, addr, count))
+        return 0;
+
+    memcpy(mem + addr, data, count);
+    return 0;
+}
+
+int LuaCube::crcRange(lua_State *L, const uint8_t *mem, uint32_t memSize)
+{
+    // (address, count) -> (crc32)
+    uint32_t addr = luaL_checkinteger(L, 1);
+    uint32_t count = luaL_checkinteger(L, 2);
+
+    if (!checkRange(L, memSize, addr, count))
+        return 0;
+
+    lua_pushinteger(L, LuaScript::crc32(mem + addr, count));
+    return 1;
+}
+
+int LuaCube::xRead(lua_State *L)
+{
+    return readRange(L, LuaSystem::sys->cubes[id].cpu.mExtData, XDATA_SIZE);
+}
+
+int LuaCube::xWrite(lua_State *L)
+{
+    return writeRange(L, LuaSystem::sys->cubes[id].cpu.mExtData, XDATA_SIZE);
+}
+
+int LuaCube::xCRC(lua_State *L)
+{
+    return crcRange(L, LuaSystem::sys->cubes[id].cpu.mExtData, XDATA_SIZE);
+}
+
+int LuaCube::iRead(lua_State *L)
+{
+    Cube::CPU::em8051 &cpu = LuaSystem::sys->cubes[id].cpu;
+    return readRange(L, cpu.mData, sizeof cpu.mData);
+}
+
+int LuaCube::iWrite(lua_State *L)
+{
+    Cube::CPU::em8051 &cpu = LuaSystem::sys->cubes[id].cpu;
+    return writeRange(L, cpu.mData, sizeof cpu.mData);
+}
+
+int LuaCube::iCRC(lua_State *L)
+{
+    Cube::CPU::em8051 &cpu = LuaSystem::sys->cubes[id].cpu;
+    return crcRange(L, cpu.mData, sizeof cpu.mData);
+}
+
+int LuaCube::fRead(lua_State *L)
+{
+    FlashStorage::CubeRecord *storage = LuaSystem::sys->cubes[id].flash.getStorage();
+    return readRange(L, storage->ext, sizeof storage->ext);
+}
+
+int LuaCube::fWrite(lua_State *L)
+{
+    FlashStorage::CubeRecord *storage = LuaSystem::sys->cubes[id].flash.getStorage();
+    return writeRange(L, storage->ext, sizeof storage->ext);
+}
+
+int LuaCube::fCRC(lua_State *L)
+{
+    FlashStorage::CubeRecord *storage = LuaSystem::sys->cubes[id].flash.getStorage();
+    return crcRange(L, storage->ext, sizeof storage->ext);
+}
+
+int LuaCube::nRead(lua_State *L)
+{
+    FlashStorage::CubeRecord *storage = LuaSystem::sys->cubes[id].flash.getStorage();
+    return readRange(L, storage->nvm, sizeof storage->nvm);
+}
+
+int LuaCube::nWrite(lua_State *L)
+{
+    FlashStorage::CubeRecord *storage = LuaSystem::sys->cubes[id].flash.getStorage();
+    return writeRange(L, storage->nvm, sizeof storage->nvm);
+}
+
+int LuaCube::nCRC(lua_State *L)
+{
+    FlashStorage::CubeRecord *storage = LuaSystem::sys->cubes[id].flash.getStorage();
+    return crcRange(L, storage->nvm, sizeof storage->nvm);
+}
+
 int LuaCube::saveScreenshot(lua_State *L)
 {    
     const char *filename = luaL_checkstring(L, 1);
@@ -273,7 +407,7 @@ int LuaCube::handleRadioPacket(lua_State *L)
      * if the packet failed to acknowledge.
      */
      
-    Cube::Radio &radio = LuaSystem::sys->cubes[id].spi.radio;    
+    Cube::Hardware &cube = LuaSystem::sys->cubes[id];
     
     Cube::Radio::Packet packet, reply;
     memset(&packet, 0, sizeof packet);
@@ -291,7 +425,7 @@ int LuaCube::handleRadioPacket(lua_State *L)
     packet.len = packetStrLen;
     memcpy(packet.payload, packetStr, packetStrLen);
     
-    if (radio.handlePacket(packet, reply)) {
+    if (cube.handleRadioPacket(packet, reply)) {
         lua_pushlstring(L, (const char *) reply.payload, reply.len);
         return 1;
     }
@@ -308,9 +442,8 @@ int LuaCube::getRadioAddress(lua_State *L)
      *    <channel> / <byte0> <byte1> <byte2> <byte3> <byte4>
      */
 
-    Cube::Radio &radio = LuaSystem::sys->cubes[id].spi.radio;   
     char buf[20];
-    uint64_t addr = radio.getPackedRXAddr();
+    uint64_t addr = LuaSystem::sys->cubes[id].getPackedRXAddr();
 
     snprintf(buf, sizeof buf, "%02x/%02x%02x%02x%02x%02x",
         (uint8_t)(addr >> 56),
@@ -324,6 +457,19 @@ int LuaCube::getRadioAddress(lua_State *L)
     return 1;
 }
 
+int LuaCube::setTouch(lua_State *L)
+{
+    SessionLog::setTouch(LuaSystem::sys->cubes[id], lua_toboolean(L, 1));
+    return 0;
+}
+
+int LuaCube::setAcceleration(lua_State *L)
+{
+    SessionLog::setAcceleration(LuaSystem::sys->cubes[id],
+        luaL_checknumber(L, 1), luaL_checknumber(L, 2), luaL_checknumber(L, 3));
+    return 0;
+}
+
 int LuaCube::testSetEnabled(lua_State *L)
 {
     Cube::I2CTestJig &test = LuaSystem::sys->cubes[id].i2c.testjig;
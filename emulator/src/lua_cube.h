@@ -65,6 +65,15 @@ private:
     int saveScreenshot(lua_State *L);
     int testScreenshot(lua_State *L);
 
+    /*
+     * Simulated input, exactly as if it came from the UI. These go
+     * through the session log, so they're recorded with --record and
+     * ignored (in favor of the log) with --replay.
+     */
+
+    int setTouch(lua_State *L);
+    int setAcceleration(lua_State *L);
+
     /*
      * Factory test interface
      */
@@ -101,6 +110,34 @@ private:
     // nvm
     int nbPoke(lua_State *L);
     int nbPeek(lua_State *L);
+
+    /*
+     * Bulk versions of the above. Read returns a string, Write
+     * accepts one, and CRC returns the CRC-32 of a range. All of
+     * these take byte addresses, and raise an error rather than
+     * wrapping around at the end of a memory.
+     */
+
+    int xRead(lua_State *L);
+    int xWrite(lua_State *L);
+    int xCRC(lua_State *L);
+
+    int iRead(lua_State *L);
+    int iWrite(lua_State *L);
+    int iCRC(lua_State *L);
+
+    int fRead(lua_State *L);
+    int fWrite(lua_State *L);
+    int fCRC(lua_State *L);
+
+    int nRead(lua_State *L);
+    int nWrite(lua_State *L);
+    int nCRC(lua_State *L);
+
+    static bool checkRange(lua_State *L, uint32_t memSize, uint32_t addr, size_t count);
+    static int readRange(lua_State *L, const uint8_t *mem, uint32_t memSize);
+    static int writeRange(lua_State *L, uint8_t *mem, uint32_t memSize);
+    static int crcRange(lua_State *L, const uint8_t *mem, uint32_t memSize);
 };
 
 #endif
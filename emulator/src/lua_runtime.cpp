@@ -40,6 +40,9 @@ Lunar<LuaRuntime>::RegType LuaRuntime::methods[] = {
     LUNAR_DECLARE_METHOD(LuaRuntime, formatAddress),
     LUNAR_DECLARE_METHOD(LuaRuntime, poke),
     LUNAR_DECLARE_METHOD(LuaRuntime, peek),
+    LUNAR_DECLARE_METHOD(LuaRuntime, read),
+    LUNAR_DECLARE_METHOD(LuaRuntime, write),
+    LUNAR_DECLARE_METHOD(LuaRuntime, crc),
     LUNAR_DECLARE_METHOD(LuaRuntime, getPC),
     LUNAR_DECLARE_METHOD(LuaRuntime, getSP),
     LUNAR_DECLARE_METHOD(LuaRuntime, getFP),
@@ -50,6 +53,9 @@ Lunar<LuaRuntime>::RegType LuaRuntime::methods[] = {
     LUNAR_DECLARE_METHOD(LuaRuntime, previousVolume),
     LUNAR_DECLARE_METHOD(LuaRuntime, flashToVirtAddr),
     LUNAR_DECLARE_METHOD(LuaRuntime, virtToFlashAddr),
+    LUNAR_DECLARE_METHOD(LuaRuntime, syscallStats),
+    LUNAR_DECLARE_METHOD(LuaRuntime, resetSyscallStats),
+    LUNAR_DECLARE_METHOD(LuaRuntime, dumpSyscallStats),
     {0,0}
 };
 
@@ -156,6 +162,58 @@ int LuaRuntime::peek(lua_State *L)
     return 1;
 }
 
+int LuaRuntime::read(lua_State *L)
+{
+    // (address, count) -> (data)
+    SvmMemory::VirtAddr va = luaL_checkinteger(L, 1);
+    uint32_t count = luaL_checkinteger(L, 2);
+    SvmMemory::PhysAddr pa;
+
+    if (!SvmMemory::mapRAM(va, count, pa)) {
+        lua_pushfstring(L, "invalid RAM address");
+        lua_error(L);
+        return 0;
+    }
+
+    lua_pushlstring(L, (const char *) pa, count);
+    return 1;
+}
+
+int LuaRuntime::write(lua_State *L)
+{
+    // (address, data)
+    size_t count = 0;
+    SvmMemory::VirtAddr va = luaL_checkinteger(L, 1);
+    const char *data = luaL_checklstring(L, 2, &count);
+    SvmMemory::PhysAddr pa;
+
+    if (!SvmMemory::mapRAM(va, count, pa)) {
+        lua_pushfstring(L, "invalid RAM address");
+        lua_error(L);
+        return 0;
+    }
+
+    memcpy(pa, data, count);
+    return 0;
+}
+
+int LuaRuntime::crc(lua_State *L)
+{
+    // (address, count) -> (crc32)
+    SvmMemory::VirtAddr va = luaL_checkinteger(L, 1);
+    uint32_t count = luaL_checkinteger(L, 2);
+    SvmMemory::PhysAddr pa;
+
+    if (!SvmMemory::mapRAM(va, count, pa)) {
+        lua_pushfstring(L, "invalid RAM address");
+        lua_error(L);
+        return 0;
+    }
+
+    lua_pushinteger(L, LuaScript::crc32(pa, count));
+    return 1;
+}
+
 int LuaRuntime::getPC(lua_State *L)
 {
     lua_pushinteger(L, SvmRuntime::reconstructCodeAddr(SvmCpu::reg(REG_PC)));
@@ -217,3 +275,56 @@ int LuaRuntime::flashToVirtAddr(lua_State *L)
     lua_pushinteger(L, SvmMemory::flashToVirtAddr(fa));
     return 1;
 }
+
+int LuaRuntime::syscallStats(lua_State *L)
+{
+    /*
+     * Returns a table, keyed by syscall name, of every syscall that has
+     * been made at least once. Each entry has 'num', 'calls', 'cycles',
+     * 'hostNanoseconds', and a 'histogram' array of log2-binned per-call
+     * host times.
+     */
+
+    lua_newtable(L);
+
+    for (unsigned num = 0; num < SvmRuntime::MAX_SYSCALL_STATS; ++num) {
+        const SvmRuntime::SyscallStats &s = SvmRuntime::getSyscallStats(num);
+        const char *name = SvmRuntime::getSyscallName(num);
+        if (!s.calls || !name)
+            continue;
+
+        lua_newtable(L);
+
+        lua_pushinteger(L, num);
+        lua_setfield(L, -2, "num");
+        lua_pushnumber(L, s.calls);
+        lua_setfield(L, -2, "calls");
+        lua_pushnumber(L, s.cycles);
+        lua_setfield(L, -2, "cycles");
+        lua_pushnumber(L, s.hostNanoseconds);
+        lua_setfield(L, -2, "hostNanoseconds");
+
+        lua_newtable(L);
+        for (unsigned b = 0; b < SvmRuntime::NUM_SYSCALL_HISTOGRAM_BUCKETS; ++b) {
+            lua_pushnumber(L, s.histogram[b]);
+            lua_rawseti(L, -2, b + 1);
+        }
+        lua_setfield(L, -2, "histogram");
+
+        lua_setfield(L, -2, name);
+    }
+
+    return 1;
+}
+
+int LuaRuntime::resetSyscallStats(lua_State *L)
+{
+    SvmRuntime::resetSyscallStats();
+    return 0;
+}
+
+int LuaRuntime::dumpSyscallStats(lua_State *L)
+{
+    SvmRuntime::dumpSyscallStats();
+    return 0;
+}
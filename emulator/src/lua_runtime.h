@@ -50,6 +50,9 @@ private:
 
     int poke(lua_State *L);
     int peek(lua_State *L);
+    int read(lua_State *L);
+    int write(lua_State *L);
+    int crc(lua_State *L);
 
     int getPC(lua_State *L);
     int getSP(lua_State *L);
@@ -64,6 +67,10 @@ private:
 
     int virtToFlashAddr(lua_State *L);
     int flashToVirtAddr(lua_State *L);
+
+    int syscallStats(lua_State *L);
+    int resetSyscallStats(lua_State *L);
+    int dumpSyscallStats(lua_State *L);
 };
 
 #endif
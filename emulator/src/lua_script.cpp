@@ -55,6 +55,25 @@ LuaScript::~LuaScript()
     lua_close(L);
 }
 
+uint32_t LuaScript::crc32(const uint8_t *bytes, size_t count, uint32_t crc)
+{
+    static uint32_t table[256];
+
+    if (!table[1]) {
+        for (unsigned i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (unsigned j = 0; j < 8; ++j)
+                c = (c & 1) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1);
+            table[i] = c;
+        }
+    }
+
+    crc = ~crc;
+    while (count--)
+        crc = table[(crc ^ *(bytes++)) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
 void LuaScript::handleError(lua_State *L, const char *context)
 {
     // Handle errors from callback invocations
@@ -62,6 +62,9 @@ public:
 
     static void handleError(lua_State *L, const char *context);
 
+    // Standard (zlib-compatible) CRC-32, for verifying bulk memory reads
+    static uint32_t crc32(const uint8_t *bytes, size_t count, uint32_t crc = 0);
+
     lua_State *L;
 
  private:
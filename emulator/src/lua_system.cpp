@@ -28,6 +28,7 @@
 #include "lua_system.h"
 #include "ostime.h"
 #include "assetloader.h"
+#include "radio.h"
 
 System *LuaSystem::sys = NULL;
 const char LuaSystem::className[] = "System";
@@ -42,8 +43,11 @@ Lunar<LuaSystem>::RegType LuaSystem::methods[] = {
     LUNAR_DECLARE_METHOD(LuaSystem, setAssetLoaderBypass),
     LUNAR_DECLARE_METHOD(LuaSystem, vclock),
     LUNAR_DECLARE_METHOD(LuaSystem, vsleep),
+    LUNAR_DECLARE_METHOD(LuaSystem, clock),
     LUNAR_DECLARE_METHOD(LuaSystem, sleep),
     LUNAR_DECLARE_METHOD(LuaSystem, numCubes),
+    LUNAR_DECLARE_METHOD(LuaSystem, radioStats),
+    LUNAR_DECLARE_METHOD(LuaSystem, resetRadioStats),
     {0,0}
 };
 
@@ -64,6 +68,9 @@ int LuaSystem::setOptions(lua_State *L)
     if (LuaScript::argMatch(L, "cubeFirmware"))
         sys->opt_cubeFirmware = lua_tostring(L, -1);
 
+    if (LuaScript::argMatch(L, "hleCubes"))
+        sys->opt_hleCubes = lua_toboolean(L, -1);
+
     if (LuaScript::argMatch(L, "turbo"))
         sys->opt_turbo = lua_toboolean(L, -1);
 
@@ -88,9 +95,24 @@ int LuaSystem::setOptions(lua_State *L)
     if (LuaScript::argMatch(L, "svmFlashStats"))
         sys->opt_svmFlashStats = lua_toboolean(L, -1);
 
+    if (LuaScript::argMatch(L, "svmSyscallStats"))
+        sys->opt_svmSyscallStats = lua_toboolean(L, -1);
+
+    if (LuaScript::argMatch(L, "svmFlashProfile"))
+        sys->opt_svmFlashProfile = lua_tostring(L, -1);
+
+    if (LuaScript::argMatch(L, "svmSampleProfile"))
+        sys->opt_svmSampleProfile = lua_tostring(L, -1);
+
+    if (LuaScript::argMatch(L, "svmSampleInterval"))
+        sys->opt_svmSampleInterval = lua_tointeger(L, -1);
+
     if (LuaScript::argMatch(L, "svmStackMonitor"))
         sys->opt_svmStackMonitor = lua_toboolean(L, -1);
 
+    if (LuaScript::argMatch(L, "usbServerPort"))
+        sys->opt_usbServerPort = lua_tointeger(L, -1);
+
     if (LuaScript::argMatch(L, "noCubeReconnect"))
         sys->opt_noCubeReconnect = lua_toboolean(L, -1);
 
@@ -106,6 +128,60 @@ int LuaSystem::numCubes(lua_State *L)
     return 1;
 }
 
+int LuaSystem::radioStats(lua_State *L)
+{
+    /*
+     * Returns a table of per-producer radio statistics, indexed by
+     * cube ID. The CubeConnector is under the 'connector' key.
+     * Latencies are in milliseconds.
+     */
+
+    const double msTicks = SysTime::msTicks(1);
+
+    lua_newtable(L);
+
+    for (unsigned id = 0; id < RadioManager::NUM_STATS; ++id) {
+        const RadioManager::ProducerStats &s = RadioManager::getStats(id);
+        if (!s.packets && !s.yields)
+            continue;
+
+        lua_newtable(L);
+
+        lua_pushnumber(L, s.packets);
+        lua_setfield(L, -2, "packets");
+        lua_pushnumber(L, s.bytes);
+        lua_setfield(L, -2, "bytes");
+        lua_pushnumber(L, s.retries);
+        lua_setfield(L, -2, "retries");
+        lua_pushnumber(L, s.urgentPackets);
+        lua_setfield(L, -2, "urgentPackets");
+        lua_pushnumber(L, s.yields);
+        lua_setfield(L, -2, "yields");
+        lua_pushnumber(L, s.frames);
+        lua_setfield(L, -2, "frames");
+        lua_pushnumber(L, s.frames ? s.frameLatency / msTicks / s.frames : 0);
+        lua_setfield(L, -2, "avgFrameLatency");
+        lua_pushnumber(L, s.maxFrameLatency / msTicks);
+        lua_setfield(L, -2, "maxFrameLatency");
+
+        if (id < _SYS_NUM_CUBE_SLOTS)
+            lua_rawseti(L, -2, id);
+        else
+            lua_setfield(L, -2, "connector");
+    }
+
+    lua_pushnumber(L, RadioManager::getDummyPackets());
+    lua_setfield(L, -2, "dummyPackets");
+
+    return 1;
+}
+
+int LuaSystem::resetRadioStats(lua_State *L)
+{
+    RadioManager::resetStats();
+    return 0;
+}
+
 int LuaSystem::setTraceMode(lua_State *L)
 {
     sys->tracer.setEnabled(lua_toboolean(L, 1));
@@ -127,6 +203,15 @@ int LuaSystem::vclock(lua_State *L)
     return 1;
 }
 
+int LuaSystem::clock(lua_State *L)
+{
+    /*
+     * Read the real wall-clock time, in seconds
+     */
+    lua_pushnumber(L, OSTime::clock());
+    return 1;
+}
+
 int LuaSystem::sleep(lua_State *L)
 {
     OSTime::sleep(luaL_checknumber(L, 1));
@@ -49,8 +49,12 @@ private:
 
     int numCubes(lua_State *L);
 
+    int radioStats(lua_State *L);
+    int resetRadioStats(lua_State *L);
+
     int vclock(lua_State *L);
     int vsleep(lua_State *L);
+    int clock(lua_State *L);
     int sleep(lua_State *L);
 };
 
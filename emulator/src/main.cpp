@@ -74,10 +74,12 @@ static void usage()
             "  -T                    Turbo mode; run faster than real-time if we can\n"
             "  -F FLASH.bin          Persistently keep all flash memory in a file on disk\n"
             "  -P PORT               Run a GDB debug server on the specified TCP port number\n"
+            "  -U PORT               Accept swiss connections over simulated USB on a TCP port\n"
             "  -e SCRIPT.lua         Execute a Lua script instead of the default frontend\n"
             "  -l LAUNCHER.elf       Start the supplied binary as the system launcher\n"
             "\n"
             "  --headless            Run without graphics or sound output\n"
+            "  --hle-cubes           Emulate cubes at a high level, without cube firmware\n"
             "  --lock-rotation       Lock rotation by default\n"
             "  --mute                Mute the Base's volume control by default\n"
             "  --paint-trace         Trace the state of the repaint controller\n"
@@ -87,7 +89,23 @@ static void usage()
             "  --svm-trace           Trace SVM instruction execution\n"
             "  --svm-stack           Monitor SVM stack usage\n"
             "  --svm-flash-stats     Dump statistics about flash memory usage\n"
+            "  --svm-syscall-stats   Dump per-syscall call counts and costs on exit\n"
+            "  --svm-flash-profile FILE\n"
+            "                        Write flash cache misses and call counts as JSON on exit\n"
+            "  --svm-sample-profile FILE\n"
+            "                        Sample SVM call stacks, write flame graph or callgrind data\n"
+            "  --svm-sample-interval CYCLES\n"
+            "                        Simulated CPU cycles between profile samples\n"
             "  --waveout FILE.wav    Log all audio output to LOG.wav\n"
+            "  --render-audio FILE.wav\n"
+            "                        Render audio offline as fast as possible, without\n"
+            "                        simulating cubes or radio, and report mixer cost\n"
+            "  --render-seconds SEC  Length of audio for --render-audio (default 60)\n"
+            "  --audio-resampler MODE\n"
+            "                        Sample interpolation: linear (default), cubic, or sinc\n"
+            "  --audio-benchmark     Time each audio resampler mode, then exit\n"
+            "  --record FILE         Record all input to FILE, for --replay\n"
+            "  --replay FILE         Replay a recorded session headless, as fast as possible\n"
             "  --white-bg            Force the UI to use a plain white background\n"
             "  --window WxH          Initial window size (default 800x600)\n"
             "  --flush-logs          fflush stdout individual game logs to use them like a tail\n"
@@ -210,6 +228,7 @@ int main(int argc, char **argv)
 {
     System& sys = System::getInstance();
     const char *scriptFile = NULL;
+    bool audioBenchmark = false;
 
     // Attach an existing console, if it's already handy
     getConsole();
@@ -269,6 +288,33 @@ int main(int argc, char **argv)
             continue;
         }
 
+        if (!strcmp(arg, "--svm-syscall-stats")) {
+            sys.opt_svmSyscallStats = true;
+            continue;
+        }
+
+        if (!strcmp(arg, "--svm-flash-profile") && argv[c+1]) {
+            sys.opt_svmFlashProfile = argv[c+1];
+            c++;
+            continue;
+        }
+
+        if (!strcmp(arg, "--svm-sample-profile") && argv[c+1]) {
+            sys.opt_svmSampleProfile = argv[c+1];
+            c++;
+            continue;
+        }
+
+        if (!strcmp(arg, "--svm-sample-interval") && argv[c+1]) {
+            sys.opt_svmSampleInterval = atoi(argv[c+1]);
+            if (!sys.opt_svmSampleInterval) {
+                message("Error: invalid sample interval \"%s\"", argv[c+1]);
+                return 1;
+            }
+            c++;
+            continue;
+        }
+
         if (!strcmp(arg, "--radio-trace")) {
             sys.opt_radioTrace = true;
             continue;
@@ -284,6 +330,11 @@ int main(int argc, char **argv)
             continue;
         }
 
+        if (!strcmp(arg, "--hle-cubes")) {
+            sys.opt_hleCubes = true;
+            continue;
+        }
+
         if (!strcmp(arg, "--white-bg")) {
             sys.opt_whiteBackground = true;
             continue;
@@ -330,6 +381,50 @@ int main(int argc, char **argv)
             continue;
         }
 
+        if (!strcmp(arg, "--render-audio") && argv[c+1]) {
+            sys.opt_renderAudioFilename = argv[c+1];
+            c++;
+            continue;
+        }
+
+        if (!strcmp(arg, "--render-seconds") && argv[c+1]) {
+            sys.opt_renderAudioSeconds = atof(argv[c+1]);
+            if (!(sys.opt_renderAudioSeconds > 0)) {
+                message("Error: invalid render length \"%s\"", argv[c+1]);
+                return 1;
+            }
+            c++;
+            continue;
+        }
+
+        if (!strcmp(arg, "--audio-resampler") && argv[c+1]) {
+            if (!AudioResampler::parseMode(argv[c+1], sys.opt_audioResampler)) {
+                message("Error: unknown audio resampler \"%s\"", argv[c+1]);
+                return 1;
+            }
+            c++;
+            continue;
+        }
+
+        if (!strcmp(arg, "--audio-benchmark")) {
+            audioBenchmark = true;
+            continue;
+        }
+
+        if (!strcmp(arg, "--record") && argv[c+1]) {
+            sys.opt_recordFilename = argv[c+1];
+            c++;
+            continue;
+        }
+
+        if (!strcmp(arg, "--replay") && argv[c+1]) {
+            sys.opt_replayFilename = argv[c+1];
+            sys.opt_headless = true;
+            sys.opt_turbo = true;
+            c++;
+            continue;
+        }
+
         if (!strcmp(arg, "-f") && argv[c+1]) {
             sys.opt_cubeFirmware = argv[c+1];
             c++;
@@ -376,6 +471,12 @@ int main(int argc, char **argv)
             continue;
         }
 
+        if (!strcmp(arg, "-U") && argv[c+1]) {
+            sys.opt_usbServerPort = atoi(argv[c+1]);
+            c++;
+            continue;
+        }
+
         if (!strncmp(arg, "-psn_", 5)) {
             // Used by Mac OS app bundles; ignore it.
             continue;
@@ -391,6 +492,31 @@ int main(int argc, char **argv)
         SystemMC::installGame(arg);
     }
 
+    if (audioBenchmark) {
+        AudioResampler::benchmark();
+        return 0;
+    }
+
+    if (!sys.opt_recordFilename.empty() && !sys.opt_replayFilename.empty()) {
+        message("Error: Can't --record and --replay at the same time");
+        return 1;
+    }
+
+    if (!sys.opt_renderAudioFilename.empty()) {
+        if (!sys.opt_waveoutFilename.empty() || !sys.opt_recordFilename.empty()
+            || !sys.opt_replayFilename.empty()) {
+            message("Error: Can't combine --render-audio with --waveout, --record, or --replay");
+            return 1;
+        }
+
+        // Offline rendering: only the MC runs, unthrottled, and the
+        // mixer output is logged through the usual --waveout path.
+        sys.opt_waveoutFilename = sys.opt_renderAudioFilename;
+        sys.opt_headless = true;
+        sys.opt_turbo = true;
+        sys.opt_numCubes = 0;
+    }
+
     return scriptFile ? runScript(sys, scriptFile) : run(sys);
 }
 
@@ -85,7 +85,7 @@ bool AssetLoader::loaderBypass(_SYSCubeID id, AssetGroupInfo &group)
     memset(&buffer, 0, sizeof buffer);
 
     while (offset != group.dataSize) {
-        offset += AssetFIFO::fetchFromGroup(buffer, group, offset);
+        offset += AssetFIFO::fetchFromGroup(buffer, group, offset, group.dataSize);
 
         AssetFIFO fifo(buffer);
         while (fifo.readAvailable())
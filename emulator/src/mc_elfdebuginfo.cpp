@@ -24,7 +24,6 @@
  * THE SOFTWARE.
  */
 
-#include <cxxabi.h>
 #include "mc_elfdebuginfo.h"
 #include <string.h>
 #include <stdlib.h>
@@ -34,6 +33,7 @@ void ELFDebugInfo::clear()
 {
     sections.clear();
     sectionMap.clear();
+    symbols.clear();
 }
 
 bool ELFDebugInfo::copyProgramBytes(FlashMapSpan::ByteOffset byteOffset,
@@ -81,6 +81,43 @@ void ELFDebugInfo::init(const Elf::Program &program)
             sectionMap[readString(strTab, pHdr->sh_name)] = pHdr;
         }
     }
+
+    /*
+     * Index the symbols up front, rather than on first use. Addresses
+     * are formatted from both the MC thread and the Lua/UI side, and the
+     * index is read-only once built.
+     */
+    indexSymbols();
+}
+
+void ELFDebugInfo::indexSymbols()
+{
+    /*
+     * Copy out the whole symbol and string tables in one piece each,
+     * and build a sorted lookup index from them.
+     */
+
+    const Elf::SectionHeader *symtab = findSection(".symtab");
+    const Elf::SectionHeader *strtab = findSection(".strtab");
+    const uint32_t limit = program.getProgramSpan().sizeInBytes();
+
+    if (!symtab || symtab->sh_size > limit)
+        return;
+
+    std::vector<Elf::Symbol> syms(symtab->sh_size / sizeof(Elf::Symbol));
+    if (syms.empty() || !copyProgramBytes(symtab->sh_offset,
+            (uint8_t*) &syms[0], syms.size() * sizeof syms[0]))
+        return;
+
+    // Symbols without names are still worth finding
+    std::vector<char> strs;
+    if (strtab && strtab->sh_size && strtab->sh_size <= limit) {
+        strs.resize(strtab->sh_size);
+        if (!copyProgramBytes(strtab->sh_offset, (uint8_t*) &strs[0], strs.size()))
+            strs.clear();
+    }
+
+    symbols.build(&syms[0], syms.size(), strs.empty() ? 0 : &strs[0], strs.size());
 }
 
 const Elf::SectionHeader *ELFDebugInfo::findSection(const std::string &name) const
@@ -121,36 +158,10 @@ bool ELFDebugInfo::findNearestSymbol(uint32_t address,
     // If nothing is found, we still fill in the output buffer and name
     // with "(unknown)" and zeroes, but 'false' is returned.
 
-    const Elf::SectionHeader *SI = findSection(".symtab");
-    if (SI) {
-        Elf::Symbol currentSym;
-        const uint32_t worstOffset = (uint32_t) -1;
-        uint32_t bestOffset = worstOffset;
-
-        for (unsigned index = 0;; index++) {
-            uint32_t tableOffset = index * sizeof currentSym;
-
-            if (tableOffset + sizeof currentSym > SI->sh_size ||
-                !copyProgramBytes(
-                    SI->sh_offset + tableOffset,
-                    (uint8_t*) &currentSym, sizeof currentSym))
-                break;
-
-            // Strip the Thumb bit from function symbols.
-            if ((currentSym.st_info & 0xF) == Elf::STT_FUNC)
-                currentSym.st_value &= ~1;
-
-            uint32_t addrOffset = address - currentSym.st_value;
-            if (addrOffset < currentSym.st_size && addrOffset < bestOffset) {
-                symbol = currentSym;
-                bestOffset = addrOffset;
-            }
-        }
-
-        if (bestOffset != worstOffset) {
-            name = readString(".strtab", symbol.st_name);
-            return true;
-        }
+    const std::string *mangledName, *demangledName;
+    if (symbols.find(address, symbol, mangledName, demangledName)) {
+        name = *mangledName;
+        return true;
     }
 
     memset(&symbol, 0, sizeof symbol);
@@ -161,10 +172,16 @@ bool ELFDebugInfo::findNearestSymbol(uint32_t address,
 std::string ELFDebugInfo::formatAddress(uint32_t address) const
 {
     Elf::Symbol symbol;
+    const std::string *mangledName, *demangledName;
     std::string name;
 
-    findNearestSymbol(address, symbol, name);
-    demangle(name);
+    if (symbols.find(address, symbol, mangledName, demangledName)) {
+        name = *demangledName;
+    } else {
+        symbol.st_value = 0;
+        name = "(unknown)";
+    }
+
     uint32_t offset = address - symbol.st_value;
 
     if (offset != 0) {
@@ -176,17 +193,16 @@ std::string ELFDebugInfo::formatAddress(uint32_t address) const
     return name;
 }
 
-void ELFDebugInfo::demangle(std::string &name)
+std::string ELFDebugInfo::formatFunction(uint32_t address) const
 {
-    // This uses the demangler built into GCC's libstdc++.
-    // It uses the same name mangling style as clang.
-
-    int status;
-    char *result = abi::__cxa_demangle(name.c_str(), 0, 0, &status);
-    if (status == 0) {
-        name = result;
-        free(result);
-    }
+    // Like formatAddress(), but without the offset within the symbol
+
+    Elf::Symbol symbol;
+    const std::string *mangledName, *demangledName;
+
+    if (symbols.find(address, symbol, mangledName, demangledName))
+        return *demangledName;
+    return "(unknown)";
 }
 
 bool ELFDebugInfo::readROM(uint32_t address, uint8_t *buffer, uint32_t bytes) const
@@ -28,6 +28,7 @@
 #define ELF_DEBUG_INFO_H
 
 #include "elfprogram.h"
+#include "elfsymbolindex.h"
 #include <vector>
 #include <map>
 #include <string>
@@ -40,6 +41,7 @@ public:
     std::string readString(const std::string &section, uint32_t offset) const;
     bool findNearestSymbol(uint32_t address, Elf::Symbol &symbol, std::string &name) const;
     std::string formatAddress(uint32_t address) const;
+    std::string formatFunction(uint32_t address) const;
     bool readROM(uint32_t address, uint8_t *buffer, uint32_t bytes) const;
 
 private:
@@ -49,8 +51,9 @@ private:
     Elf::Program program;
     sections_t sections;
     sectionMap_t sectionMap;
+    ELFSymbolIndex symbols;
 
-    static void demangle(std::string &name);
+    void indexSymbols();
     std::string readString(const Elf::SectionHeader *SI, uint32_t offset) const;
     const Elf::SectionHeader *findSection(const std::string &name) const;
 
@@ -26,6 +26,7 @@
 
 #include "flash_blockcache.h"
 #include "svmdebugpipe.h"
+#include "mc_flashprofile.h"
 #include "svmmemory.h"
 #include "system.h"
 #include "system_mc.h"
@@ -60,6 +61,9 @@ void FlashBlock::countBlockMiss(uint32_t blockAddr)
     unsigned blockNumber = blockAddr / BLOCK_SIZE;
     ASSERT(blockNumber < arraysize(stats.periodic.blockMissCounts));
     stats.periodic.blockMissCounts[blockNumber]++;
+
+    if (FlashProfile::isEnabled())
+        FlashProfile::countBlockMiss(blockAddr);
 }
 
 bool FlashBlock::hotBlockSort(unsigned i, unsigned j) {
@@ -27,6 +27,7 @@
 #include "system.h"
 #include "system_mc.h"
 #include "mc_timing.h"
+#include "mc_sampleprofile.h"
 #include "svmmemory.h"
 #include "flash_device.h"
 #include "flash_storage.h"
@@ -34,6 +35,14 @@
 
 static int gStealthIOCounter;
 
+static void elapseFlashTicks(unsigned n)
+{
+    // Time spent waiting on the flash chip shows up separately in sample profiles
+    SampleProfile::State s = SampleProfile::enter(SampleProfile::FlashIO);
+    SystemMC::elapseTicks(n);
+    SampleProfile::restore(s);
+}
+
 
 void FlashDevice::setStealthIO(int counter)
 {
@@ -67,7 +76,7 @@ void FlashDevice::read(uint32_t address, uint8_t *buf, unsigned len)
 
     if (!gStealthIOCounter) {
         LuaFilesystem::onRawRead(address, buf, len);
-        SystemMC::elapseTicks(MCTiming::TICKS_PER_PAGE_MISS);
+        elapseFlashTicks(MCTiming::TICKS_PER_PAGE_MISS);
     }
 }
 
@@ -92,7 +101,7 @@ void FlashDevice::write(uint32_t address, const uint8_t *buf, unsigned len)
 
         if (!gStealthIOCounter) {
             LuaFilesystem::onRawWrite(address, buf, len);
-            SystemMC::elapseTicks(MCTiming::TICKS_PER_PAGE_WRITE);
+            elapseFlashTicks(MCTiming::TICKS_PER_PAGE_WRITE);
         }
 
         // Program bits from 1 to 0 only.
@@ -121,7 +130,7 @@ void FlashDevice::eraseBlock(uint32_t address)
             LOG(("FLASH: Erasing block %08x\n", address));
 
             LuaFilesystem::onRawErase(address);
-            SystemMC::elapseTicks(MCTiming::TICKS_PER_BLOCK_ERASE);
+            elapseFlashTicks(MCTiming::TICKS_PER_BLOCK_ERASE);
         }
 
         memset(storage.bytes + sector, 0xFF, FlashDevice::ERASE_BLOCK_SIZE);
@@ -0,0 +1,176 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "mc_flashprofile.h"
+#include "svmdebugpipe.h"
+#include "svmmemory.h"
+#include "system.h"
+#include "system_mc.h"
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+namespace {
+
+    typedef std::pair<uint32_t, uint32_t> AddrPair;
+    typedef std::pair<std::string, std::string> NamePair;
+    typedef std::pair<uint32_t, std::string> Block;
+
+    // Raw addresses for the program that's running now
+    std::map<uint32_t, uint64_t> programMisses;
+    std::map<AddrPair, uint64_t> programCalls;
+
+    // Symbolized totals over the whole run
+    std::map<std::string, uint64_t> functionMisses;
+    std::map<Block, uint64_t> blockMisses;
+    std::map<NamePair, uint64_t> edgeCounts;
+
+    void writeString(FILE *f, const std::string &s)
+    {
+        fputc('"', f);
+        for (unsigned i = 0; i < s.size(); ++i) {
+            unsigned char c = s[i];
+            if (c == '"' || c == '\\')
+                fprintf(f, "\\%c", c);
+            else if (c < 0x20)
+                fprintf(f, "\\u%04x", c);
+            else
+                fputc(c, f);
+        }
+        fputc('"', f);
+    }
+
+    template <typename T>
+    bool countSort(const std::pair<T, uint64_t> &a, const std::pair<T, uint64_t> &b)
+    {
+        // Descending count, then by key so the output is stable
+        if (a.second != b.second)
+            return a.second > b.second;
+        return a.first < b.first;
+    }
+
+    template <typename T>
+    void sortedCounts(const std::map<T, uint64_t> &map,
+        std::vector< std::pair<T, uint64_t> > &out)
+    {
+        out.assign(map.begin(), map.end());
+        std::sort(out.begin(), out.end(), countSort<T>);
+    }
+}
+
+bool FlashProfile::isEnabled()
+{
+    return !SystemMC::getSystem()->opt_svmFlashProfile.empty();
+}
+
+void FlashProfile::countBlockMiss(uint32_t blockAddr)
+{
+    // Only blocks mapped into the current program's address space
+    SvmMemory::VirtAddr va = SvmMemory::flashToVirtAddr(blockAddr);
+    if (va)
+        programMisses[va]++;
+}
+
+void FlashProfile::countCall(uint32_t callerVA, uint32_t calleeVA)
+{
+    programCalls[AddrPair(callerVA, calleeVA)]++;
+}
+
+void FlashProfile::flushProgram()
+{
+    for (std::map<uint32_t, uint64_t>::iterator i = programMisses.begin();
+        i != programMisses.end(); ++i) {
+        std::string name = SvmDebugPipe::formatAddress(i->first);
+        blockMisses[Block(i->first, name)] += i->second;
+        functionMisses[SvmDebugPipe::formatFunction(i->first)] += i->second;
+    }
+
+    for (std::map<AddrPair, uint64_t>::iterator i = programCalls.begin();
+        i != programCalls.end(); ++i) {
+        NamePair edge(SvmDebugPipe::formatFunction(i->first.first),
+                      SvmDebugPipe::formatFunction(i->first.second));
+        edgeCounts[edge] += i->second;
+    }
+
+    programMisses.clear();
+    programCalls.clear();
+}
+
+void FlashProfile::write()
+{
+    const char *filename = SystemMC::getSystem()->opt_svmFlashProfile.c_str();
+
+    flushProgram();
+
+    FILE *f = fopen(filename, "w");
+    if (!f) {
+        perror("Error opening flash profile output file");
+        return;
+    }
+
+    fprintf(f, "{\n\"version\": 1,\n\"functions\": [\n");
+
+    std::vector< std::pair<std::string, uint64_t> > functions;
+    sortedCounts(functionMisses, functions);
+    for (unsigned i = 0; i < functions.size(); ++i) {
+        fprintf(f, "{\"name\": ");
+        writeString(f, functions[i].first);
+        fprintf(f, ", \"misses\": %" PRIu64 "}%s\n", functions[i].second,
+            i + 1 < functions.size() ? "," : "");
+    }
+
+    fprintf(f, "],\n\"blocks\": [\n");
+
+    std::vector< std::pair<Block, uint64_t> > blocks;
+    sortedCounts(blockMisses, blocks);
+    for (unsigned i = 0; i < blocks.size(); ++i) {
+        fprintf(f, "{\"va\": \"%08x\", \"misses\": %" PRIu64 ", \"name\": ",
+            (unsigned) blocks[i].first.first, blocks[i].second);
+        writeString(f, blocks[i].first.second);
+        fprintf(f, "}%s\n", i + 1 < blocks.size() ? "," : "");
+    }
+
+    fprintf(f, "],\n\"edges\": [\n");
+
+    std::vector< std::pair<NamePair, uint64_t> > edges;
+    sortedCounts(edgeCounts, edges);
+    for (unsigned i = 0; i < edges.size(); ++i) {
+        fprintf(f, "{\"caller\": ");
+        writeString(f, edges[i].first.first);
+        fprintf(f, ", \"callee\": ");
+        writeString(f, edges[i].first.second);
+        fprintf(f, ", \"count\": %" PRIu64 "}%s\n", edges[i].second,
+            i + 1 < edges.size() ? "," : "");
+    }
+
+    fprintf(f, "]\n}\n");
+    fclose(f);
+
+    LOG(("FLASH: Wrote profile of %u functions, %u blocks, %u call edges to \"%s\"\n",
+        (unsigned) functions.size(), (unsigned) blocks.size(),
+        (unsigned) edges.size(), filename));
+}
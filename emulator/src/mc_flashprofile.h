@@ -0,0 +1,61 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MC_FLASHPROFILE_H_
+#define MC_FLASHPROFILE_H_
+
+#include <stdint.h>
+
+/**
+ * Simulator-only flash cache profile, enabled with --svm-flash-profile.
+ *
+ * Unlike the periodic --svm-flash-stats log, this accumulates over the
+ * whole run: cache misses per code/data block, and call counts for every
+ * caller/callee pair seen by SvmRuntime. Addresses are symbolized each
+ * time the running program changes, while its debug info is still loaded.
+ *
+ * The profile is written as JSON on exit, one record per line, so it's
+ * easy to merge (tools/svm-profile-merge.py) and easy for slinky's
+ * -profile option to read back.
+ */
+
+namespace FlashProfile
+{
+    bool isEnabled();
+
+    // Record a cache miss on the flash block at this physical address
+    void countBlockMiss(uint32_t blockAddr);
+
+    // Record one call or tail call between two code VAs
+    void countCall(uint32_t callerVA, uint32_t calleeVA);
+
+    // Symbolize everything we've seen from the program that's running now.
+    void flushProgram();
+
+    // Flush, and write the accumulated profile to opt_svmFlashProfile
+    void write();
+}
+
+#endif // MC_FLASHPROFILE_H_
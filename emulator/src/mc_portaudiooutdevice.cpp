@@ -116,6 +116,7 @@ int PortAudioOutDevice::portAudioCallback(const void *inputBuffer, void *outputB
                     self->bufferFilling = true;
                     if (!self->endOfStream) {
                         self->bufferThreshold = MIN(ring.capacity(), self->bufferThreshold << 1);
+                        AudioMixer::instance.outputStarved();
                     }
                     break;
                 }
@@ -37,6 +37,8 @@
 #include "mc_timing.h"
 #include "bits.h"
 #include "noise.h"
+#include "sessionlog.h"
+#include "prng.h"
 
 namespace RadioMC {
 
@@ -53,6 +55,7 @@ namespace RadioMC {
     static Buffer buf;
     static double bitErrorRates[MAX_RF_CHANNEL + 1];
     static SysTime::Ticks lastNoiseUpdate;
+    static _SYSPseudoRandomState lossPRNG;
 
     void trace();
     unsigned retryCount();
@@ -87,8 +90,8 @@ bool RadioMC::testPacketLoss(unsigned bytes, unsigned channel)
     ASSERT(channel <= MAX_RF_CHANNEL);
     double ber = RadioMC::bitErrorRates[buf.ptx.dest->channel];
     double successProbability = pow(1.0 - ber, bytes * 8);
-    int threshold = successProbability * RAND_MAX;
-    return rand() > threshold;
+    uint32_t threshold = successProbability * 0xFFFFFFFF;
+    return PRNG::value(&lossPRNG) > threshold;
 }
 
 void RadioMC::updateRadioNoise(double noiseAmount)
@@ -234,40 +237,25 @@ void SystemMC::doRadioPacket()
     }
 
     /*
-     * Deliver it to the proper cube.
-     *
-     * Interaction with the cube simulation must take place
-     * between beginEvent() and endEvent() only.
+     * Deliver it to the proper cube, in a sync event at radioPacketDeadline.
+     * See radioPacketEvent().
      *
      * Note that this causes us to sync the Cube thread's clock with
      * radioPacketDeadline, which slightly lags our 'ticks' counter,
      * which slightly lags the internal SvmCpu cycle count.
      *
-     * The timestamp we give to endEvent() is the farthest we allow
-     * the Cube thread to run asynchronously before waiting for us again.
-     *
-     * XXX: We don't yet model ACK loss separately, just dropping the
-     *      original packet. To model ACK loss properly, we'd need to
-     *      also take into account the nRF's packet ID counters.
+     * The next deadline is the farthest we allow the Cube thread to run
+     * asynchronously before waiting for us again. If the Cube thread
+     * hasn't reached this deadline yet, it delivers the packet itself and
+     * keeps going, and we only wait for the result.
      */
 
     RadioMC::updateRadioNoise(sys->opt_radioNoise);
 
-    sys->getCubeSync().beginEventAt(radioPacketDeadline, mThreadRunning);
-
-    if (RadioManager::isRadioEnabled()) {
-        bool dropped = sys->opt_radioNoise &&
-            RadioMC::testPacketLoss(buf.packet.len, buf.ptx.dest->channel);
-
-        Cube::Hardware *cube = getCubeForAddress(buf.ptx.dest);
-
-        buf.ack = cube && cube->isRadioClockRunning()
-            && !dropped && cube->spi.radio.handlePacket(buf.packet, buf.reply);
-        buf.ackCube = cube ? cube->id() : -1;
-    }
-
+    uint64_t deadline = radioPacketDeadline;
     radioPacketDeadline += MCTiming::TICKS_PER_PACKET;
-    sys->getCubeSync().endEvent(radioPacketDeadline);
+    sys->getCubeSync().runEventAt(deadline, radioPacketDeadline,
+        radioPacketEvent, this, mThreadRunning);
 
     if (RadioManager::isRadioEnabled()) {
 
@@ -299,6 +287,7 @@ void SystemMC::doRadioPacket()
 
 void Radio::init()
 {
+    SessionLog::seedPRNG(&RadioMC::lossPRNG, SessionLog::PRNG_MC_RADIO);
     RadioManager::enableRadio();
 }
 
@@ -307,13 +296,45 @@ void Radio::heartbeat()
     // Nothing to do here in simulation yet
 }
 
+void SystemMC::radioPacketEvent(void *context)
+{
+    /*
+     * Sync event for one radio packet. This runs on either thread, while
+     * the cubes are halted at the packet's deadline and the MC thread is
+     * waiting for us, so it's the only code touching either side.
+     *
+     * Interaction with the cube simulation must take place in sync
+     * events only.
+     *
+     * XXX: We don't yet model ACK loss separately, just dropping the
+     *      original packet. To model ACK loss properly, we'd need to
+     *      also take into account the nRF's packet ID counters.
+     */
+
+    SystemMC *self = static_cast<SystemMC*>(context);
+    RadioMC::Buffer &buf = RadioMC::buf;
+
+    SessionLog::cubeSyncEvent();
+
+    if (RadioManager::isRadioEnabled()) {
+        bool dropped = self->sys->opt_radioNoise &&
+            RadioMC::testPacketLoss(buf.packet.len, buf.ptx.dest->channel);
+
+        Cube::Hardware *cube = self->getCubeForAddress(buf.ptx.dest);
+
+        buf.ack = cube && cube->isRadioClockRunning()
+            && !dropped && cube->handleRadioPacket(buf.packet, buf.reply);
+        buf.ackCube = cube ? cube->id() : -1;
+    }
+}
+
 Cube::Hardware *SystemMC::getCubeForAddress(const RadioAddress *addr)
 {
     uint64_t packed = addr->pack();
 
     for (unsigned i = 0; i < sys->opt_numCubes; i++) {
         Cube::Hardware &cube = sys->cubes[i];
-        if (cube.spi.radio.getPackedRXAddr() == packed)
+        if (cube.getPackedRXAddr() == packed)
             return &cube;
     }
 
@@ -0,0 +1,272 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "mc_sampleprofile.h"
+#include "mc_timing.h"
+#include "svm.h"
+#include "svmcpu.h"
+#include "svmdebugpipe.h"
+#include "svmmemory.h"
+#include "svmruntime.h"
+#include "system.h"
+#include "system_mc.h"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace Svm;
+
+namespace {
+
+    // Raw stacks are a State followed by code VAs, leaf first
+    typedef std::vector<uint32_t> RawStack;
+
+    // Symbolized stacks are root first, with the subsystem as the leaf
+    typedef std::vector<std::string> Stack;
+    typedef std::pair<std::string, std::string> NamePair;
+
+    // Guard against corrupted or circular frame chains
+    const unsigned MAX_DEPTH = 64;
+
+    SampleProfile::State currentState;
+    uint64_t lastTicks;
+    uint64_t pendingTicks;
+
+    std::map<RawStack, uint64_t> programStacks;
+    std::map<Stack, uint64_t> stackCounts;
+
+    uint64_t intervalTicks()
+    {
+        // Sample interval is in CPU cycles, but we count in MC ticks
+        uint64_t cycles = SystemMC::getSystem()->opt_svmSampleInterval;
+        uint64_t ticks = cycles * MCTiming::CPU_RATE_DENOMINATOR / MCTiming::CPU_RATE_NUMERATOR;
+        return ticks ? ticks : 1;
+    }
+
+    std::string subsystemName(SampleProfile::State state)
+    {
+        unsigned detail = state >> 8;
+
+        switch (state & 0xFF) {
+        case SampleProfile::Syscall: {
+            const char *name = SvmRuntime::getSyscallName(detail);
+            char buf[64];
+            if (name)
+                snprintf(buf, sizeof buf, "[syscall %s]", name);
+            else
+                snprintf(buf, sizeof buf, "[syscall %u]", detail);
+            return buf;
+        }
+        case SampleProfile::FlashIO:    return "[flash]";
+        case SampleProfile::Idle:       return "[idle]";
+        default:                        return "";
+        }
+    }
+
+    void sample(uint64_t weight)
+    {
+        RawStack stack;
+        stack.push_back(currentState);
+
+        // Leaf is the current PC. Zero if no program is running.
+        uint32_t pc = SvmRuntime::reconstructCodeAddr(SvmCpu::reg(REG_PC));
+        if (pc) {
+            stack.push_back(pc);
+
+            // Each frame holds the return address into its caller
+            SvmMemory::VirtAddr fpVA = SvmCpu::reg(REG_FP);
+            SvmMemory::PhysAddr fpPA;
+            while (stack.size() < MAX_DEPTH &&
+                   SvmMemory::mapRAM(fpVA, sizeof(CallFrame), fpPA)) {
+                CallFrame *frame = reinterpret_cast<CallFrame*>(fpPA);
+                stack.push_back(frame->pc);
+                fpVA = frame->fp;
+            }
+        }
+
+        programStacks[stack] += weight;
+    }
+
+    void writeCollapsed(FILE *f)
+    {
+        // One line per unique stack, in the format flamegraph.pl expects
+        for (std::map<Stack, uint64_t>::iterator i = stackCounts.begin();
+            i != stackCounts.end(); ++i) {
+            for (unsigned j = 0; j < i->first.size(); ++j)
+                fprintf(f, "%s%s", j ? ";" : "", i->first[j].c_str());
+            fprintf(f, " %" PRIu64 "\n", i->second);
+        }
+    }
+
+    void writeCallgrind(FILE *f, uint64_t cyclesPerSample)
+    {
+        /*
+         * Self cost goes to the leaf of each stack, inclusive cost to every
+         * distinct caller/callee pair on it. Call counts aren't known to a
+         * sampling profiler, so we report the number of samples instead.
+         */
+
+        std::map<std::string, uint64_t> selfCost;
+        std::map<NamePair, uint64_t> inclusiveCost;
+        uint64_t total = 0;
+
+        for (std::map<Stack, uint64_t>::iterator i = stackCounts.begin();
+            i != stackCounts.end(); ++i) {
+            const Stack &stack = i->first;
+            std::set<NamePair> edges;
+
+            selfCost[stack.back()] += i->second;
+            total += i->second;
+
+            for (unsigned j = 1; j < stack.size(); ++j)
+                edges.insert(NamePair(stack[j-1], stack[j]));
+            for (std::set<NamePair>::iterator e = edges.begin(); e != edges.end(); ++e)
+                inclusiveCost[*e] += i->second;
+        }
+
+        fprintf(f, "# callgrind format\n"
+            "version: 1\n"
+            "creator: siftulator\n"
+            "positions: line\n"
+            "events: Cycles\n"
+            "summary: %" PRIu64 "\n", total * cyclesPerSample);
+
+        // Both maps are sorted by caller name, so we can walk them together
+        std::map<NamePair, uint64_t>::iterator edge = inclusiveCost.begin();
+        std::set<std::string> functions;
+        for (std::map<std::string, uint64_t>::iterator i = selfCost.begin();
+            i != selfCost.end(); ++i)
+            functions.insert(i->first);
+        for (std::map<NamePair, uint64_t>::iterator i = inclusiveCost.begin();
+            i != inclusiveCost.end(); ++i)
+            functions.insert(i->first.first);
+
+        for (std::set<std::string>::iterator fn = functions.begin();
+            fn != functions.end(); ++fn) {
+            fprintf(f, "\nfn=%s\n0 %" PRIu64 "\n", fn->c_str(),
+                selfCost[*fn] * cyclesPerSample);
+
+            for (; edge != inclusiveCost.end() && edge->first.first == *fn; ++edge)
+                fprintf(f, "cfn=%s\ncalls=%" PRIu64 " 0\n0 %" PRIu64 "\n",
+                    edge->first.second.c_str(), edge->second,
+                    edge->second * cyclesPerSample);
+        }
+    }
+}
+
+bool SampleProfile::isEnabled()
+{
+    return !SystemMC::getSystem()->opt_svmSampleProfile.empty();
+}
+
+SampleProfile::State SampleProfile::enter(Subsystem s, unsigned detail)
+{
+    State prev = currentState;
+    currentState = s | (detail << 8);
+    return prev;
+}
+
+void SampleProfile::restore(State s)
+{
+    currentState = s;
+}
+
+void SampleProfile::tick(uint64_t mcTicks)
+{
+    /*
+     * Time can jump by any amount, for example while idle or erasing
+     * flash. Everything since the last call is attributed to the current
+     * state, so one long jump may count as many samples at once.
+     */
+
+    if (mcTicks <= lastTicks) {
+        lastTicks = mcTicks;
+        return;
+    }
+
+    uint64_t interval = intervalTicks();
+    pendingTicks += mcTicks - lastTicks;
+    lastTicks = mcTicks;
+
+    if (pendingTicks >= interval) {
+        sample(pendingTicks / interval);
+        pendingTicks %= interval;
+    }
+}
+
+void SampleProfile::flushProgram()
+{
+    for (std::map<RawStack, uint64_t>::iterator i = programStacks.begin();
+        i != programStacks.end(); ++i) {
+        const RawStack &raw = i->first;
+        Stack stack;
+
+        if (raw.size() == 1)
+            stack.push_back("[firmware]");
+        for (unsigned j = raw.size() - 1; j >= 1; --j)
+            stack.push_back(SvmDebugPipe::formatFunction(raw[j]));
+
+        std::string subsystem = subsystemName(raw[0]);
+        if (!subsystem.empty())
+            stack.push_back(subsystem);
+
+        stackCounts[stack] += i->second;
+    }
+
+    programStacks.clear();
+}
+
+void SampleProfile::write()
+{
+    const std::string &filename = SystemMC::getSystem()->opt_svmSampleProfile;
+    uint64_t cyclesPerSample = std::max(1u, SystemMC::getSystem()->opt_svmSampleInterval);
+
+    flushProgram();
+
+    FILE *f = fopen(filename.c_str(), "w");
+    if (!f) {
+        perror("Error opening sample profile output file");
+        return;
+    }
+
+    size_t slash = filename.find_last_of("/\\");
+    std::string base = filename.substr(slash == std::string::npos ? 0 : slash + 1);
+    bool callgrind = !base.compare(0, strlen("callgrind.out"), "callgrind.out");
+
+    if (callgrind)
+        writeCallgrind(f, cyclesPerSample);
+    else
+        writeCollapsed(f);
+
+    fclose(f);
+
+    LOG(("SAMPLE: Wrote %s profile of %u unique stacks to \"%s\"\n",
+        callgrind ? "callgrind" : "collapsed-stack",
+        (unsigned) stackCounts.size(), filename.c_str()));
+}
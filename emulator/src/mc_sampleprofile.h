@@ -0,0 +1,75 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MC_SAMPLEPROFILE_H_
+#define MC_SAMPLEPROFILE_H_
+
+#include <stdint.h>
+
+/**
+ * Simulator-only sampling profiler, enabled with --svm-sample-profile.
+ *
+ * This is the simulated counterpart to SampleProfiler and 'swiss profile'
+ * on hardware. Every opt_svmSampleInterval simulated CPU cycles, we record
+ * the SVM call stack by walking the chain of CallFrames from FP, along
+ * with what the master was doing at the time: running user code, inside
+ * a syscall, waiting on flash, or idle. Samples are taken in virtual time,
+ * so they're exactly repeatable and unaffected by the host's speed.
+ *
+ * Like FlashProfile, stacks are symbolized each time the running program
+ * changes. The output is written on exit, either in collapsed-stack form
+ * for flame graph tools, or in callgrind format if the file name starts
+ * with "callgrind.out".
+ */
+
+namespace SampleProfile
+{
+    enum Subsystem {
+        User = 0,
+        Syscall,
+        FlashIO,
+        Idle,
+    };
+
+    // Opaque saved state, for restore()
+    typedef uint32_t State;
+
+    bool isEnabled();
+
+    // Attribute time to a subsystem until restore(). Cheap when disabled.
+    State enter(Subsystem s, unsigned detail = 0);
+    void restore(State s);
+
+    // Take any samples that are due, given the current MC tick count
+    void tick(uint64_t mcTicks);
+
+    // Symbolize everything we've seen from the program that's running now.
+    void flushProgram();
+
+    // Flush, and write the accumulated profile to opt_svmSampleProfile
+    void write();
+}
+
+#endif // MC_SAMPLEPROFILE_H_
@@ -32,6 +32,8 @@
 #include "svmruntime.h"
 #include "elfdefs.h"
 #include "mc_elfdebuginfo.h"
+#include "mc_flashprofile.h"
+#include "mc_sampleprofile.h"
 #include "mc_gdbserver.h"
 #include "mc_logdecoder.h"
 #include "lua_runtime.h"
@@ -153,6 +155,11 @@ std::string SvmDebugPipe::formatAddress(void *address)
     return gELFDebugInfo.formatAddress(SvmMemory::physToVirtRAM((uint8_t*)address));
 }
 
+std::string SvmDebugPipe::formatFunction(uint32_t address)
+{
+    return gELFDebugInfo.formatFunction(address);
+}
+
 bool SvmDebugPipe::debuggerMsgAccept(SvmDebugPipe::DebuggerMsg &msg)
 {
     /*
@@ -238,6 +245,10 @@ static uint32_t debuggerMsgCallback(const uint32_t *cmd,
 
 void SvmDebugPipe::setSymbolSource(const Elf::Program &program)
 {
+    // Symbolize the outgoing program's profiles while we still can
+    FlashProfile::flushProgram();
+    SampleProfile::flushProgram();
+
     gELFDebugInfo.init(program);
     GDBServer::setDebugInfo(&gELFDebugInfo);
     GDBServer::setMessageCallback(debuggerMsgCallback);
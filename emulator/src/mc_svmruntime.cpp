@@ -29,11 +29,18 @@
 #include "svmmemory.h"
 #include "system.h"
 #include "system_mc.h"
+#include "mc_timing.h"
+#include "mc_flashprofile.h"
+#include "mc_sampleprofile.h"
+#include "ostime.h"
+#include <vector>
+#include <algorithm>
 
 using namespace Svm;
 
 SvmMemory::PhysAddr SvmRuntime::topOfStackPA;
 SvmMemory::PhysAddr SvmRuntime::stackLowWaterMark;
+SvmRuntime::SyscallStats SvmRuntime::syscallStats[SvmRuntime::MAX_SYSCALL_STATS];
 
 
 /*
@@ -48,3 +55,108 @@ void SvmRuntime::onStackModification(SvmMemory::PhysAddr sp)
              reinterpret_cast<void*>(stackLowWaterMark), int(topOfStackPA - stackLowWaterMark)));
     }
 }
+
+SvmRuntime::SyscallTimestamp SvmRuntime::syscallTimestamp()
+{
+    // Simulated CPU cycles are pre-multiplied by CPU_RATE_DENOMINATOR
+    SyscallTimestamp ts;
+    ts.cycles = SystemMC::getTicks() * MCTiming::CPU_RATE_NUMERATOR;
+    ts.hostSeconds = OSTime::clock();
+    return ts;
+}
+
+void SvmRuntime::countSyscall(unsigned num, const SyscallTimestamp &start)
+{
+    ASSERT(num < MAX_SYSCALL_STATS);
+    SyscallStats &s = syscallStats[num];
+    SyscallTimestamp now = syscallTimestamp();
+
+    uint64_t cycles = (now.cycles - start.cycles) / MCTiming::CPU_RATE_DENOMINATOR;
+    uint64_t ns = (now.hostSeconds - start.hostSeconds) * 1e9;
+
+    s.calls++;
+    s.cycles += cycles;
+    s.hostNanoseconds += ns;
+
+    unsigned bucket = 0;
+    while (ns && bucket < NUM_SYSCALL_HISTOGRAM_BUCKETS - 1) {
+        ns >>= 1;
+        bucket++;
+    }
+    s.histogram[bucket]++;
+}
+
+void SvmRuntime::countCall(reg_t addr)
+{
+    // PC still points into the caller, we haven't branched yet
+    if (FlashProfile::isEnabled())
+        FlashProfile::countCall(reconstructCodeAddr(SvmCpu::reg(REG_PC)),
+            SvmMemory::SEGMENT_0_VA + (addr & 0xfffffc));
+}
+
+uint32_t SvmRuntime::profileEnterSyscall(unsigned num)
+{
+    return SampleProfile::enter(SampleProfile::Syscall, num);
+}
+
+void SvmRuntime::profileLeaveSyscall(uint32_t state)
+{
+    SampleProfile::restore(state);
+}
+
+void SvmRuntime::resetSyscallStats()
+{
+    memset(syscallStats, 0, sizeof syscallStats);
+}
+
+static bool syscallStatsSort(unsigned i, unsigned j)
+{
+    return SvmRuntime::getSyscallStats(j).calls < SvmRuntime::getSyscallStats(i).calls;
+}
+
+void SvmRuntime::dumpSyscallStats()
+{
+    /*
+     * Print all syscalls that have been called at least once, most
+     * frequent first. Simulated cycles only count modeled costs like
+     * flash misses; host time counts the handler's own work. The
+     * histogram column lists nonzero buckets of host time as
+     * "log2(ns):count".
+     */
+
+    std::vector<unsigned> order;
+    uint64_t totalCalls = 0;
+    for (unsigned i = 0; i < MAX_SYSCALL_STATS; ++i)
+        if (syscallStats[i].calls) {
+            order.push_back(i);
+            totalCalls += syscallStats[i].calls;
+        }
+
+    std::sort(order.begin(), order.end(), syscallStatsSort);
+
+    LOG(("\nSYSCALL: %" PRIu64 " calls total, "
+        "%u cycles fixed SVC overhead per call (estimated)\n",
+        totalCalls, MCTiming::TICKS_PER_SVC * MCTiming::CPU_RATE_NUMERATOR
+            / MCTiming::CPU_RATE_DENOMINATOR));
+
+    for (unsigned i = 0; i < order.size(); ++i) {
+        unsigned num = order[i];
+        const SyscallStats &s = syscallStats[num];
+        const char *name = getSyscallName(num);
+
+        char histogram[256];
+        unsigned len = 0;
+        histogram[0] = '\0';
+        for (unsigned b = 0; b < NUM_SYSCALL_HISTOGRAM_BUCKETS; ++b)
+            if (s.histogram[b] && len < sizeof histogram)
+                len += snprintf(histogram + len, sizeof histogram - len,
+                    " %u:%u", b, s.histogram[b]);
+
+        LOG(("SYSCALL: [%10" PRIu64 " calls] %6.2f%% %-28s "
+            "%10.1f avg cycles %10.1f avg ns%s\n",
+            s.calls, s.calls * 100.0 / totalCalls,
+            name ? name : "(unknown)",
+            s.cycles / double(s.calls),
+            s.hostNanoseconds / double(s.calls), histogram));
+    }
+}
@@ -24,8 +24,8 @@
  */
 
 #include "sysinfo.h"
-#include <stdlib.h>
-#include "ostime.h"
+#include "prng.h"
+#include "sessionlog.h"
 
 namespace SysInfo {
 
@@ -34,12 +34,14 @@ namespace SysInfo {
     void init()
     {
         uint32_t *p = reinterpret_cast<uint32_t*>(&uidBytes[0]);
+        _SYSPseudoRandomState prng;
+        SessionLog::seedPRNG(&prng, SessionLog::PRNG_MC_UID);
 
         for (unsigned i = 0; i < UniqueIdNumBytes / sizeof(uint32_t); ++i) {
 
             // ultra cheeseball. will (obviously) not be constant between
-            // runs of the simulator
-            *p = rand() ^ rand() ^ uint32_t(OSTime::clock() * 1e6);
+            // runs of the simulator, unless we're recording or replaying
+            *p = PRNG::value(&prng);
             p++;
         }
     }
@@ -0,0 +1,342 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ * Micah Elizabeth Scott <micah@misc.name>
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Must be before other headers
+#ifdef _WIN32
+#   define WIN32_LEAN_AND_MEAN
+#   define WINVER WindowsXP
+#   define _WIN32_WINNT 0x502
+#   include <windows.h>
+#   include <winsock2.h>
+#   include <ws2tcpip.h>
+#else
+#   include <sys/types.h>
+#   include <sys/socket.h>
+#   include <sys/select.h>
+#   include <netinet/tcp.h>
+#   include <netinet/in.h>
+#   include <unistd.h>
+#   include <errno.h>
+#   define closesocket(_s) close(_s)
+#endif
+
+// Linux reports a closed peer with SIGPIPE unless we ask it not to
+#ifndef MSG_NOSIGNAL
+#   define MSG_NOSIGNAL 0
+#endif
+
+#include "mc_usbdevice.h"
+#include "usbprotocol.h"
+#include "tasks.h"
+#include "macros.h"
+#include <string.h>
+#include <stdio.h>
+
+#define LOG_PREFIX  "USB: "
+
+UsbDevice UsbDevice::instance;
+
+
+void UsbDevice::start(int port)
+{
+    /*
+     * Spawn a thread which listens for connections from swiss.
+     */
+
+    ASSERT(instance.running == false);
+    ASSERT(instance.thread == NULL);
+
+    instance.port = port;
+    instance.outHead = 0;
+    instance.outCount = 0;
+    instance.rxFill = 0;
+    instance.running = true;
+    instance.thread = new tthread::thread(threadEntry, (void*) &instance);
+}
+
+void UsbDevice::stop()
+{
+    /*
+     * Ask the background thread to stop, and wait for it. The thread
+     * polls 'running' at least every 20ms, even while blocked on a client.
+     */
+
+    if (!instance.thread)
+        return;
+
+    instance.running = false;
+    instance.thread->join();
+    delete instance.thread;
+    instance.thread = 0;
+}
+
+void UsbDevice::threadEntry(void *param)
+{
+    UsbDevice *self = (UsbDevice *) param;
+    self->threadMain();
+}
+
+void UsbDevice::threadMain()
+{
+    /*
+     * Accept one host connection at a time. Each connection is a
+     * separate "plug in" event from the firmware's point of view.
+     */
+
+    #ifdef _WIN32
+        WSADATA wsaData;
+        WSAStartup(MAKEWORD(2, 2), &wsaData);
+    #endif
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+
+    int listenFD = socket(AF_INET, SOCK_STREAM, 0);
+
+    unsigned long arg = 1;
+    setsockopt(listenFD, SOL_SOCKET, SO_REUSEADDR, (const char *)&arg, sizeof arg);
+
+    if (bind(listenFD, (struct sockaddr *)&addr, sizeof addr) < 0) {
+        fprintf(stderr, LOG_PREFIX "Can't bind to port!\n");
+        closesocket(listenFD);
+        return;
+    }
+
+    if (listen(listenFD, 1) < 0) {
+        fprintf(stderr, LOG_PREFIX "Can't listen on socket\n");
+        closesocket(listenFD);
+        return;
+    }
+
+    fprintf(stderr, LOG_PREFIX "Listening on port %d. Connect with "
+        "\"swiss --siftulator %d\"\n", port, port);
+
+    while (running) {
+        fd_set rfds;
+        struct timeval pollInterval = { 0, 20000 };  // 20ms
+
+        FD_ZERO(&rfds);
+        FD_SET(listenFD, &rfds);
+        if (select(listenFD + 1, &rfds, NULL, NULL, &pollInterval) < 1)
+            continue;
+
+        struct sockaddr_in addr;
+        socklen_t addrSize = sizeof addr;
+        int fd = accept(listenFD, (struct sockaddr *) &addr, &addrSize);
+        if (fd < 0)
+            break;
+
+        #ifdef SO_NOSIGPIPE
+            arg = 1;
+            setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, (const char *)&arg, sizeof arg);
+        #endif
+        arg = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const char *)&arg, sizeof arg);
+
+        clientFD = fd;
+        handleClient();
+
+        {
+            tthread::lock_guard<tthread::mutex> guard(txMutex);
+            clientFD = -1;
+            closesocket(fd);
+        }
+
+        // The next client must not see anything this one left behind
+        discardPackets();
+    }
+
+    closesocket(listenFD);
+}
+
+void UsbDevice::discardPackets()
+{
+    /*
+     * Empty both the receive buffer and the OUT FIFO. Packets which
+     * the UsbOUT task has already dequeued will still be dispatched.
+     */
+
+    tthread::lock_guard<tthread::mutex> guard(fifoMutex);
+    rxFill = 0;
+    outHead = 0;
+    outCount = 0;
+}
+
+bool UsbDevice::outFifoFull()
+{
+    tthread::lock_guard<tthread::mutex> guard(fifoMutex);
+    return outCount == OUT_FIFO_DEPTH;
+}
+
+void UsbDevice::handleClient()
+{
+    /*
+     * Per-client receive loop. We only read from the socket while there's
+     * FIFO space for at least one more packet; otherwise the host stalls,
+     * much like a NAK'ed OUT token on real hardware.
+     */
+
+    while (running) {
+        if (!rxFrames())
+            return;
+
+        fd_set rfds;
+        struct timeval pollInterval = { 0, 20000 };  // 20ms
+
+        FD_ZERO(&rfds);
+        if (!outFifoFull() && rxFill < sizeof rxBuffer)
+            FD_SET(clientFD, &rfds);
+
+        if (select(clientFD + 1, &rfds, NULL, NULL, &pollInterval) < 1
+            || !FD_ISSET(clientFD, &rfds))
+            continue;
+
+        int ret = recv(clientFD, (char*) rxBuffer + rxFill, sizeof rxBuffer - rxFill, 0);
+        if (ret <= 0)
+            return;
+        rxFill += ret;
+    }
+}
+
+bool UsbDevice::rxFrames()
+{
+    /*
+     * Move any complete frames from rxBuffer into the OUT FIFO.
+     * Returns false if the host sent something we can't parse.
+     */
+
+    using namespace UsbLoopback;
+    unsigned offset = 0;
+    bool received = false;
+
+    while (rxFill - offset >= HEADER_BYTES) {
+        const FrameHeader *hdr = reinterpret_cast<const FrameHeader*>(rxBuffer + offset);
+        if (hdr->type != OutData || hdr->len > MAX_PACKET) {
+            fprintf(stderr, LOG_PREFIX "Bad frame from host (type %d, len %d)\n",
+                hdr->type, hdr->len);
+            return false;
+        }
+        if (rxFill - offset < HEADER_BYTES + hdr->len)
+            break;
+
+        tthread::lock_guard<tthread::mutex> guard(fifoMutex);
+        if (outCount == OUT_FIFO_DEPTH)
+            break;
+
+        Packet &pkt = outFifo[(outHead + outCount) % OUT_FIFO_DEPTH];
+        pkt.len = hdr->len;
+        memcpy(pkt.bytes, rxBuffer + offset + HEADER_BYTES, hdr->len);
+        outCount++;
+
+        offset += HEADER_BYTES + hdr->len;
+        received = true;
+    }
+
+    if (offset) {
+        rxFill -= offset;
+        memmove(rxBuffer, rxBuffer + offset, rxFill);
+    }
+
+    if (received)
+        Tasks::trigger(Tasks::UsbOUT);
+
+    return true;
+}
+
+void UsbDevice::handleOUTData()
+{
+    /*
+     * Task handler: consume a single OUT packet, as the hardware does,
+     * and re-trigger ourselves if there are more waiting.
+     */
+
+    USBProtocolMsg m;
+    bool morePending;
+
+    {
+        tthread::lock_guard<tthread::mutex> guard(instance.fifoMutex);
+        if (!instance.outCount)
+            return;
+
+        Packet &pkt = instance.outFifo[instance.outHead];
+        m.len = MIN(pkt.len, m.bytesFree());
+        memcpy(m.bytes, pkt.bytes, m.len);
+
+        instance.outHead = (instance.outHead + 1) % OUT_FIFO_DEPTH;
+        instance.outCount--;
+        morePending = instance.outCount != 0;
+    }
+
+    if (morePending)
+        Tasks::trigger(Tasks::UsbOUT);
+
+    uint8_t count = 1;
+    instance.sendFrame(UsbLoopback::OutAck, &count, sizeof count);
+
+    if (m.len > 0)
+        USBProtocol::dispatch(m);
+}
+
+int UsbDevice::write(const uint8_t *buf, unsigned len, unsigned timeoutMillis)
+{
+    /*
+     * Send an IN packet to the host. The TCP stream does our buffering,
+     * so unlike the hardware there's no previous write to wait for.
+     */
+
+    return instance.sendFrame(UsbLoopback::InData, buf, len);
+}
+
+int UsbDevice::sendFrame(UsbLoopback::FrameType type, const uint8_t *buf, unsigned len)
+{
+    using namespace UsbLoopback;
+
+    uint8_t frame[MAX_FRAME];
+    FrameHeader *hdr = reinterpret_cast<FrameHeader*>(frame);
+
+    len = MIN(len, MAX_PACKET);
+    hdr->type = type;
+    hdr->len = len;
+    memcpy(frame + HEADER_BYTES, buf, len);
+
+    tthread::lock_guard<tthread::mutex> guard(txMutex);
+    if (clientFD < 0)
+        return 0;
+
+    unsigned sent = 0;
+    while (sent < HEADER_BYTES + len) {
+        int ret = send(clientFD, (const char*) frame + sent, HEADER_BYTES + len - sent,
+            MSG_NOSIGNAL);
+        if (ret <= 0)
+            return 0;
+        sent += ret;
+    }
+
+    return len;
+}
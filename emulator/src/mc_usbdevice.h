@@ -0,0 +1,100 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ * Micah Elizabeth Scott <micah@misc.name>
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef MC_USBDEVICE_H
+#define MC_USBDEVICE_H
+
+#include <stdint.h>
+#include "usbloopback.h"
+#include "tinythread.h"
+
+/*
+ * Simulated USB device endpoint.
+ *
+ * This stands in for the hardware UsbDevice class, with the same static
+ * interface used by the common firmware code. Instead of a USB peripheral,
+ * it accepts one host connection at a time from swiss over a local TCP
+ * socket, using the framing in usbloopback.h.
+ *
+ * OUT packets are received on a background thread and buffered in a
+ * bounded FIFO. The UsbOUT task drains one packet at a time, just like
+ * the hardware endpoint, and acknowledges it to the host. While the FIFO
+ * is full we stop reading from the socket, so the host sees back-pressure
+ * rather than dropped packets.
+ */
+
+class UsbDevice {
+public:
+    static const uint16_t VendorID = 0x22FA;
+    static const uint16_t ProductID = 0x0105;
+
+    static const unsigned OUT_FIFO_DEPTH = 64;
+
+    static void start(int port);
+    static void stop();
+
+    static bool isConfigured() {
+        return instance.clientFD >= 0;
+    }
+
+    static void handleOUTData();
+    static int write(const uint8_t *buf, unsigned len, unsigned timeoutMillis = 0xffffffff);
+
+private:
+    UsbDevice() : thread(0), port(0), clientFD(-1), running(false) {}
+    static UsbDevice instance;
+
+    struct Packet {
+        uint8_t len;
+        uint8_t bytes[UsbLoopback::MAX_PACKET];
+    };
+
+    tthread::thread *thread;
+    tthread::mutex fifoMutex;
+    tthread::mutex txMutex;
+
+    int port;
+    volatile int clientFD;
+    volatile bool running;
+
+    Packet outFifo[OUT_FIFO_DEPTH];
+    unsigned outHead;
+    unsigned outCount;
+
+    unsigned rxFill;
+    uint8_t rxBuffer[UsbLoopback::MAX_FRAME * 4];
+
+    static void threadEntry(void *param);
+    void threadMain();
+    void handleClient();
+    bool rxFrames();
+    bool outFifoFull();
+    void discardPackets();
+
+    int sendFrame(UsbLoopback::FrameType type, const uint8_t *buf, unsigned len);
+};
+
+#endif // MC_USBDEVICE_H
@@ -0,0 +1,367 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+#include "sessionlog.h"
+#include "system.h"
+#include "system_mc.h"
+#include "mc_neighbor.h"
+#include "mc_homebutton.h"
+#include "ostime.h"
+#include "prng.h"
+
+SessionLog::Mode SessionLog::mode;
+uint32_t SessionLog::seed;
+System *SessionLog::sys;
+FILE *SessionLog::file;
+TickDeadline SessionLog::cubeDeadline;
+uint64_t SessionLog::mcEventCount;
+uint64_t SessionLog::mcDeadline = (uint64_t) -1;
+tthread::mutex SessionLog::lock;
+volatile bool SessionLog::cubeInputPending;
+SessionLog::EventList SessionLog::pendingCube;
+SessionLog::EventList SessionLog::pendingMC;
+float SessionLog::lastAccel[_SYS_NUM_CUBE_SLOTS][3];
+SessionLog::EventList SessionLog::replayCube;
+SessionLog::EventList SessionLog::replayMC;
+unsigned SessionLog::replayCubeIndex;
+unsigned SessionLog::replayMCIndex;
+
+static const char kMagic[8] = "SIFTSES";
+static const uint32_t kVersion = 1;
+
+
+bool SessionLog::init(System *sys)
+{
+    SessionLog::sys = sys;
+    cubeDeadline.init(&sys->time);
+
+    if (!sys->opt_replayFilename.empty())
+        return openReplay(sys->opt_replayFilename.c_str());
+
+    if (!sys->opt_recordFilename.empty())
+        return openRecording(sys->opt_recordFilename.c_str());
+
+    return true;
+}
+
+void SessionLog::seedPRNG(_SYSPseudoRandomState *state, PRNGStream stream,
+    unsigned index)
+{
+    uint32_t base = isActive() ? seed : uint32_t(OSTime::clock() * 1e6);
+    PRNG::init(state, base ^ (((stream << 8) | index) * 0x9E3779B9));
+}
+
+bool SessionLog::openRecording(const char *filename)
+{
+    file = fopen(filename, "wb");
+    if (!file) {
+        fprintf(stderr, "Can't open session log '%s' for writing\n", filename);
+        return false;
+    }
+
+    seed = uint32_t(OSTime::clock() * 1e6);
+
+    Header hdr;
+    memset(&hdr, 0, sizeof hdr);
+    memcpy(hdr.magic, kMagic, sizeof hdr.magic);
+    hdr.version = kVersion;
+    hdr.seed = seed;
+    hdr.numCubes = sys->opt_numCubes;
+    fwrite(&hdr, sizeof hdr, 1, file);
+
+    // Make sure the first accelerometer update is always recorded
+    memset(lastAccel, 0xFF, sizeof lastAccel);
+
+    mode = M_RECORD;
+    return true;
+}
+
+bool SessionLog::openReplay(const char *filename)
+{
+    FILE *f = fopen(filename, "rb");
+    if (!f) {
+        fprintf(stderr, "Can't open session log '%s'\n", filename);
+        return false;
+    }
+
+    Header hdr;
+    if (fread(&hdr, sizeof hdr, 1, f) != 1
+        || memcmp(hdr.magic, kMagic, sizeof hdr.magic)
+        || hdr.version != kVersion
+        || hdr.numCubes > System::MAX_CUBES) {
+        fprintf(stderr, "'%s' is not a compatible session log\n", filename);
+        fclose(f);
+        return false;
+    }
+
+    Event e;
+    while (fread(&e, sizeof e, 1, f) == 1)
+        (isMCEvent(e) ? replayMC : replayCube).push_back(e);
+    fclose(f);
+
+    if (sys->opt_numCubes != hdr.numCubes) {
+        fprintf(stderr, "Session was recorded with %u cubes, using that instead of %u\n",
+            hdr.numCubes, sys->opt_numCubes);
+        sys->opt_numCubes = hdr.numCubes;
+    }
+
+    seed = hdr.seed;
+    replayCubeIndex = 0;
+    replayMCIndex = 0;
+    if (!replayCube.empty())
+        cubeDeadline.resetTo(replayCube[0].time);
+    if (!replayMC.empty())
+        mcDeadline = replayMC[0].time;
+
+    mode = M_REPLAY;
+    return true;
+}
+
+void SessionLog::finish()
+{
+    if (mode == M_RECORD && file) {
+        Event e;
+        memset(&e, 0, sizeof e);
+        e.time = mcEventCount;
+        e.type = E_END;
+
+        tthread::lock_guard<tthread::mutex> guard(lock);
+        write(e);
+        fclose(file);
+        file = 0;
+    }
+}
+
+void SessionLog::write(const Event &e)
+{
+    // Caller holds 'lock'
+    if (file)
+        fwrite(&e, sizeof e, 1, file);
+}
+
+void SessionLog::setAcceleration(Cube::Hardware &hw, float xG, float yG, float zG)
+{
+    Event e;
+    memset(&e, 0, sizeof e);
+    e.type = E_ACCEL;
+    e.cube = hw.cpu.id;
+    e.values[0] = xG;
+    e.values[1] = yG;
+    e.values[2] = zG;
+
+    /*
+     * The frontend reports acceleration every frame, whether it changed or
+     * not. Only log changes. This does skip a little accelerometer noise
+     * while recording, but replay skips the same updates.
+     */
+    if (mode == M_RECORD && e.cube < arraysize(lastAccel)) {
+        tthread::lock_guard<tthread::mutex> guard(lock);
+        if (!memcmp(lastAccel[e.cube], e.values, sizeof e.values))
+            return;
+        memcpy(lastAccel[e.cube], e.values, sizeof e.values);
+    }
+
+    post(e);
+}
+
+void SessionLog::setTouch(Cube::Hardware &hw, bool touching)
+{
+    Event e;
+    memset(&e, 0, sizeof e);
+    e.type = E_TOUCH;
+    e.cube = hw.cpu.id;
+    e.args[0] = touching;
+    post(e);
+}
+
+void SessionLog::setCubeNeighbor(Cube::Hardware &hw, bool touching, unsigned mySide,
+    unsigned otherSide, unsigned otherCube)
+{
+    Event e;
+    memset(&e, 0, sizeof e);
+    e.type = E_CUBE_NEIGHBOR;
+    e.cube = hw.cpu.id;
+    e.args[0] = touching;
+    e.args[1] = mySide;
+    e.args[2] = otherSide;
+    e.args[3] = otherCube;
+    post(e);
+}
+
+void SessionLog::setMCNeighbor(bool touching, unsigned mcSide, unsigned cube, unsigned cubeSide)
+{
+    Event e;
+    memset(&e, 0, sizeof e);
+    e.type = E_MC_NEIGHBOR;
+    e.cube = cube;
+    e.args[0] = touching;
+    e.args[1] = mcSide;
+    e.args[2] = cubeSide;
+    post(e);
+}
+
+void SessionLog::setHomeButton(bool pressed)
+{
+    Event e;
+    memset(&e, 0, sizeof e);
+    e.type = E_HOME_BUTTON;
+    e.args[0] = pressed;
+    post(e);
+}
+
+void SessionLog::post(const Event &e)
+{
+    switch (mode) {
+
+    case M_OFF:
+        // Business as usual
+        apply(e);
+        break;
+
+    case M_RECORD: {
+        // Hand it to the thread that owns this hardware
+        tthread::lock_guard<tthread::mutex> guard(lock);
+        if (isMCEvent(e)) {
+            pendingMC.push_back(e);
+            mcDeadline = 0;
+        } else {
+            // The cube clock belongs to the cube thread; wait for a sync
+            pendingCube.push_back(e);
+            cubeInputPending = true;
+        }
+        break;
+    }
+
+    case M_REPLAY:
+        // Live input would diverge from the log
+        break;
+    }
+}
+
+void SessionLog::apply(const Event &e)
+{
+    if (e.type != E_HOME_BUTTON && e.type != E_END && e.cube >= System::MAX_CUBES)
+        return;
+
+    switch (e.type) {
+
+    case E_ACCEL:
+        sys->cubes[e.cube].setAcceleration(e.values[0], e.values[1], e.values[2]);
+        break;
+
+    case E_TOUCH:
+        sys->cubes[e.cube].setTouch(e.args[0]);
+        break;
+
+    case E_CUBE_NEIGHBOR:
+        if (e.args[0])
+            sys->cubes[e.cube].neighbors.setContact(e.args[1], e.args[2], e.args[3]);
+        else
+            sys->cubes[e.cube].neighbors.clearContact(e.args[1], e.args[2], e.args[3]);
+        break;
+
+    case E_MC_NEIGHBOR:
+        MCNeighbor::updateNeighbor(e.args[0], e.args[1], e.cube, e.args[2]);
+        break;
+
+    case E_HOME_BUTTON:
+        HomeButton::setPressed(e.args[0]);
+        break;
+
+    case E_END:
+        LOG(("SESSION: Replay finished at %.3f seconds of virtual time\n",
+            sys->time.elapsedSeconds()));
+        SystemMC::exit(0);
+        break;
+    }
+}
+
+void SessionLog::cubeDeadlineWork()
+{
+    /*
+     * Cube thread, replay only. Apply everything that's due, then stop
+     * again exactly at the next recorded input.
+     */
+
+    uint64_t now = sys->time.clocks;
+    cubeDeadline.reset();
+
+    if (mode == M_REPLAY) {
+        while (replayCubeIndex < replayCube.size() && replayCube[replayCubeIndex].time <= now)
+            apply(replayCube[replayCubeIndex++]);
+        if (replayCubeIndex < replayCube.size())
+            cubeDeadline.resetTo(replayCube[replayCubeIndex].time);
+    }
+}
+
+void SessionLog::cubeSyncEventWork()
+{
+    /*
+     * Recording only. The cubes are halted in a sync event, and the MC
+     * thread is waiting on it, so we can safely apply and log everything
+     * that's pending at the current cube clock. On replay, the cube thread
+     * applies these in cubeTick(), which runs just before it would halt
+     * here.
+     */
+
+    tthread::lock_guard<tthread::mutex> guard(lock);
+    uint64_t now = sys->time.clocks;
+
+    cubeInputPending = false;
+    for (EventList::iterator i = pendingCube.begin(); i != pendingCube.end(); ++i) {
+        i->time = now;
+        apply(*i);
+        write(*i);
+    }
+    pendingCube.clear();
+}
+
+void SessionLog::mcDeadlineWork()
+{
+    /*
+     * MC thread. For inputs that only the MC firmware reads, we can apply
+     * pending inputs directly when recording, or replay them at the same
+     * count of elapseTicks() calls.
+     */
+
+    mcDeadline = (uint64_t) -1;
+
+    if (mode == M_RECORD) {
+        tthread::lock_guard<tthread::mutex> guard(lock);
+        for (EventList::iterator i = pendingMC.begin(); i != pendingMC.end(); ++i) {
+            i->time = mcEventCount;
+            apply(*i);
+            write(*i);
+        }
+        pendingMC.clear();
+
+    } else if (mode == M_REPLAY) {
+        while (replayMCIndex < replayMC.size() && replayMC[replayMCIndex].time <= mcEventCount)
+            apply(replayMC[replayMCIndex++]);
+        if (replayMCIndex < replayMC.size())
+            mcDeadline = replayMC[replayMCIndex].time;
+    }
+}
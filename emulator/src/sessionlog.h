@@ -0,0 +1,205 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo Thundercracker simulator
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _SESSIONLOG_H
+#define _SESSIONLOG_H
+
+/*
+ * Record and replay of every nondeterministic input to the simulation.
+ *
+ * With --record, inputs from the UI (accelerometer, touch, neighbors, and
+ * the home button) are no longer applied directly. They're queued, applied
+ * by the simulation thread that owns that piece of hardware, and logged
+ * along with the exact point in time where they took effect. Cube inputs
+ * are applied during the next cube sync event, while the cubes are
+ * halted, and stamped with the cube clock. Home button
+ * presses are read by the MC thread, so they're stamped with a count of
+ * SystemMC::elapseTicks() calls, which is deterministic even though the
+ * MC runs ahead of the cube clock. That count depends on how often
+ * Tasks::work() runs, so recording also paces the audio mixer with
+ * virtual time, exactly as a headless replay does.
+ *
+ * With --replay, live input is ignored and the log is played back at the
+ * same points, so a headless run can reproduce the recorded session.
+ * The log also pins the seeds that would otherwise come from the wall clock.
+ * Each consumer of simulated randomness keeps its own PRNG state, seeded by
+ * seedPRNG(), since threads sharing the C library's rand() would interleave
+ * their draws differently on every run.
+ *
+ * Virtual time is already deterministic, and the SVM's time and PRNG
+ * syscalls are derived from it or from game-supplied seeds, so syscall
+ * results don't need to be logged.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+#include "macros.h"
+#include "vtime.h"
+#include "tinythread.h"
+#include <sifteo/abi.h>
+
+class System;
+namespace Cube { class Hardware; }
+
+class SessionLog {
+public:
+
+    // Call once during System::init(), before any cubes are created
+    static bool init(System *sys);
+
+    // Write the end-of-session marker and close the log. Idempotent.
+    static void finish();
+
+    static ALWAYS_INLINE bool isActive() {
+        return mode != M_OFF;
+    }
+
+    static ALWAYS_INLINE bool isReplaying() {
+        return mode == M_REPLAY;
+    }
+
+    // Seed for any simulation state that would otherwise be random.
+    // Only meaningful if isActive().
+    static uint32_t getSeed() {
+        return seed;
+    }
+
+    enum PRNGStream {
+        PRNG_CUBE_RNG,
+        PRNG_CUBE_ACCEL_NOISE,
+        PRNG_CUBE_HWID,
+        PRNG_MC_RADIO,
+        PRNG_MC_UID,
+    };
+
+    // Seed a private PRNG from getSeed(), or from the clock if inactive.
+    // 'index' separates per-cube streams.
+    static void seedPRNG(_SYSPseudoRandomState *state, PRNGStream stream,
+        unsigned index = 0);
+
+    // Inputs. Callable from any thread.
+    static void setAcceleration(Cube::Hardware &hw, float xG, float yG, float zG);
+    static void setTouch(Cube::Hardware &hw, bool touching);
+    static void setCubeNeighbor(Cube::Hardware &hw, bool touching, unsigned mySide,
+        unsigned otherSide, unsigned otherCube);
+    static void setMCNeighbor(bool touching, unsigned mcSide, unsigned cube, unsigned cubeSide);
+    static void setHomeButton(bool pressed);
+
+    // Cube thread, called from SystemCubes::tick()
+    static ALWAYS_INLINE void cubeTick() {
+        if (cubeDeadline.hasPassed())
+            cubeDeadlineWork();
+    }
+
+    // Called during a cube sync event while the cubes are halted. This may
+    // run on either thread; see DeadlineSynchronizer::runEventAt().
+    static ALWAYS_INLINE void cubeSyncEvent() {
+        if (cubeInputPending)
+            cubeSyncEventWork();
+    }
+
+    static ALWAYS_INLINE uint64_t cubeDeadlineRemaining() {
+        return cubeDeadline.remaining();
+    }
+
+    // MC thread, called from SystemMC::elapseTicks()
+    static ALWAYS_INLINE void mcTick() {
+        mcEventCount++;
+        if (mcEventCount >= mcDeadline)
+            mcDeadlineWork();
+    }
+
+private:
+    enum Mode {
+        M_OFF,
+        M_RECORD,
+        M_REPLAY,
+    };
+
+    enum EventType {
+        E_ACCEL = 1,
+        E_TOUCH,
+        E_CUBE_NEIGHBOR,
+        E_MC_NEIGHBOR,
+        E_HOME_BUTTON,
+        E_END,
+    };
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t seed;
+        uint32_t numCubes;
+        uint32_t reserved;
+    };
+
+    struct Event {
+        uint64_t time;          // Cube clock, or MC event count
+        uint8_t type;           // EventType
+        uint8_t cube;
+        uint8_t args[6];
+        float values[3];
+    };
+
+    typedef std::vector<Event> EventList;
+
+    static Mode mode;
+    static uint32_t seed;
+    static System *sys;
+    static FILE *file;
+
+    static TickDeadline cubeDeadline;
+    static uint64_t mcEventCount;
+    static uint64_t mcDeadline;
+
+    // Recording: inputs waiting to be applied, protected by 'lock'
+    static tthread::mutex lock;
+    static volatile bool cubeInputPending;
+    static EventList pendingCube;
+    static EventList pendingMC;
+    static float lastAccel[_SYS_NUM_CUBE_SLOTS][3];
+
+    // Replaying: the whole log, split by thread
+    static EventList replayCube;
+    static EventList replayMC;
+    static unsigned replayCubeIndex;
+    static unsigned replayMCIndex;
+
+    static bool isMCEvent(const Event &e) {
+        return e.type == E_HOME_BUTTON || e.type == E_END;
+    }
+
+    static void post(const Event &e);
+    static void apply(const Event &e);
+    static void write(const Event &e);
+    static bool openRecording(const char *filename);
+    static bool openReplay(const char *filename);
+    static void cubeDeadlineWork();
+    static void cubeSyncEventWork();
+    static void mcDeadlineWork();
+};
+
+#endif
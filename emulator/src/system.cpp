@@ -29,11 +29,16 @@
 #include "system.h"
 #include "cube_debug.h"
 #include "mc_gdbserver.h"
+#include "mc_usbdevice.h"
+#include "sessionlog.h"
 
 
 System::System()
         : opt_headless(false),
         opt_numCubes(DEFAULT_CUBES),
+        opt_hleCubes(false),
+        opt_renderAudioSeconds(DEFAULT_RENDER_SECONDS),
+        opt_audioResampler(AudioResampler::LINEAR),
         opt_whiteBackground(false),
         opt_windowWidth(800),
         opt_windowHeight(600),
@@ -45,7 +50,10 @@ System::System()
         opt_paintTrace(false),
         opt_svmTrace(false),
         opt_svmFlashStats(false),
+        opt_svmSyscallStats(false),
+        opt_svmSampleInterval(DEFAULT_SAMPLE_INTERVAL),
         opt_gdbServerPort(0),
+        opt_usbServerPort(0),
         opt_cube0Debug(false),
         opt_mute(false),
         opt_radioNoise(0),
@@ -62,6 +70,10 @@ bool System::init()
     if (!flash.init(opt_flashFilename.empty() ? NULL : opt_flashFilename.c_str()))
         return false;
 
+    // May override opt_numCubes, so this comes before any cubes exist
+    if (!SessionLog::init(this))
+        return false;
+
     if (!sc.init(this))
         return false;
 
@@ -76,6 +88,12 @@ bool System::init()
 
 void System::setNumCubes(unsigned n)
 {
+    if (SessionLog::isActive() && n != opt_numCubes) {
+        // The session log has no way to replay this
+        LOG(("SESSION: Can't change the number of cubes while recording or replaying\n"));
+        return;
+    }
+
     sc.setNumCubes(n);
 }
 
@@ -121,6 +139,8 @@ void System::start()
 
     if (opt_gdbServerPort)
         GDBServer::start(opt_gdbServerPort);
+    if (opt_usbServerPort)
+        UsbDevice::start(opt_usbServerPort);
 }
 
 void System::exit()
@@ -132,6 +152,8 @@ void System::exit()
     if (mIsStarted) {
         if (opt_gdbServerPort)
             GDBServer::stop();
+        if (opt_usbServerPort)
+            UsbDevice::stop();
 
         smc.stop();
         sc.stop();
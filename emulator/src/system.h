@@ -42,6 +42,7 @@
 #include "tracer.h"
 #include "tinythread.h"
 #include "flash_storage.h"
+#include "audioresampler.h"
 
 
 class System {
@@ -51,6 +52,8 @@ class System {
 
     static const unsigned DEFAULT_CUBES = 3;
     static const unsigned MAX_CUBES = _SYS_NUM_CUBE_SLOTS;
+    static const unsigned DEFAULT_SAMPLE_INTERVAL = 7200;   // 10 kHz at 72 MHz
+    static const unsigned DEFAULT_RENDER_SECONDS = 60;
 
     Cube::Hardware cubes[MAX_CUBES];
     Tracer tracer;
@@ -60,9 +63,15 @@ class System {
     bool opt_headless;
     unsigned opt_numCubes;
     std::string opt_cubeFirmware;
+    bool opt_hleCubes;
     std::string opt_flashFilename;
     std::string opt_launcherFilename;
     std::string opt_waveoutFilename;
+    std::string opt_renderAudioFilename;
+    double opt_renderAudioSeconds;
+    AudioResampler::Mode opt_audioResampler;
+    std::string opt_recordFilename;
+    std::string opt_replayFilename;
 
     // UI options
     bool opt_whiteBackground;
@@ -84,9 +93,16 @@ class System {
     // SVM options
     bool opt_svmTrace;
     bool opt_svmFlashStats;
+    bool opt_svmSyscallStats;
+    std::string opt_svmFlashProfile;
+    std::string opt_svmSampleProfile;
+    unsigned opt_svmSampleInterval;
     bool opt_svmStackMonitor;
     unsigned opt_gdbServerPort;
 
+    // Simulated USB options
+    unsigned opt_usbServerPort;
+
     // Debug options, applicable to cube 0 only
     bool opt_cube0Debug;
     std::string opt_cube0Profile;
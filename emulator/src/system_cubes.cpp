@@ -29,12 +29,13 @@
 #include "ostime.h"
 #include "system_cubes.h"
 #include "mc_neighbor.h"
+#include "sessionlog.h"
 
 
 bool SystemCubes::init(System *sys)
 {
     this->sys = sys;
-    deadlineSync.init(&sys->time, &mThreadRunning);
+    deadlineSync.init(&sys->time, &mThreadRunning, &sys->opt_turbo);
 
     MCNeighbor::cubeInit(&sys->time);
 
@@ -52,6 +53,12 @@ bool SystemCubes::init(System *sys)
         return false;
     }
 
+    if (sys->opt_hleCubes && (!sys->opt_cube0Profile.empty() || sys->opt_cube0Debug)) {
+        // There's no cube firmware running to debug or profile
+        fprintf(stderr, "Cube debug features are not available with high-level cube emulation.\n");
+        return false;
+    }
+
     /*
      * To save on clutter in the trace file, we intentionally only set up tracing
      * for the initial number of cubes, not the maximum number of cubes. Additional cubes
@@ -116,12 +123,10 @@ bool SystemCubes::initCube(unsigned id)
         ? NULL : sys->opt_cubeFirmware.c_str();
 
     ASSERT(sys->flash.data);
-    if (!sys->cubes[id].init(&sys->time, firmware,
-        &sys->flash.data->cubes[id]))
+    if (!sys->cubes[id].init(id, &sys->time, firmware,
+        &sys->flash.data->cubes[id], sys->opt_hleCubes))
         return false;
 
-    sys->cubes[id].cpu.id = id;
-    
     if (id == 0 && !sys->opt_cube0Profile.empty()) {
         Cube::CPU::profile_data *pd;
         size_t s = CODE_SIZE * sizeof pd[0];
@@ -189,9 +194,6 @@ void SystemCubes::threadFn(void *param)
     if (sys->opt_cube0Debug && sys->opt_numCubes)
         Cube::Debug::attach(&sys->cubes[0]);
 
-    // Seed PRNG per-thread
-    srand(OSTime::clock() * 1e6);
-
     while (self->mThreadRunning) {
         /*
          * Pick one of several specific tick batch loops. This keeps the loop tight by
@@ -204,6 +206,8 @@ void SystemCubes::threadFn(void *param)
         self->mBigCubeLock.lock();
         if (sys->opt_numCubes == 0) {
             self->tickLoopEmpty();
+        } else if (sys->opt_hleCubes) {
+            self->tickLoopHLE();
         } else if (sys->opt_cube0Debug) {
             self->tickLoopDebug();
         } else if (!sys->cubes[0].cpu.sbt || sys->cubes[0].cpu.mProfileData || Tracer::isEnabled()) {
@@ -229,6 +233,7 @@ ALWAYS_INLINE void SystemCubes::tick(unsigned count)
 {
     sys->time.tick(count);
     MCNeighbor::cubeTick();
+    SessionLog::cubeTick();
     deadlineSync.tick();
 }
 
@@ -319,6 +324,7 @@ NEVER_INLINE void SystemCubes::tickLoopFastSBT()
 
         stepSize = std::min(nextStep, (unsigned)deadlineSync.remaining());
         stepSize = std::min(stepSize, (unsigned)MCNeighbor::cubeDeadlineRemaining());
+        stepSize = std::min(stepSize, (unsigned)SessionLog::cubeDeadlineRemaining());
     }
 }
 
@@ -341,5 +347,34 @@ NEVER_INLINE void SystemCubes::tickLoopEmpty()
 
         stepSize = std::min(nextStep, (unsigned)deadlineSync.remaining());
         stepSize = std::min(stepSize, (unsigned)MCNeighbor::cubeDeadlineRemaining());
+        stepSize = std::min(stepSize, (unsigned)SessionLog::cubeDeadlineRemaining());
+    }
+}
+
+NEVER_INLINE void SystemCubes::tickLoopHLE()
+{
+    /*
+     * High-level cube emulation. No CPUs to run, so like tickLoopEmpty()
+     * we only advance the clock, but we also give each cube's HLE model
+     * a chance to do any work that has come due.
+     */
+
+    System *sys = this->sys;
+    unsigned batch = sys->time.timestepTicks();
+    unsigned nCubes = sys->opt_numCubes;
+    unsigned stepSize = 1;
+
+    while (batch && stepSize) {
+        unsigned nextStep;
+        batch -= stepSize;
+        nextStep = batch;
+        tick(stepSize);
+
+        for (unsigned i = 0; i < nCubes; i++)
+            nextStep = std::min(nextStep, sys->cubes[i].hle.tick());
+
+        stepSize = std::min(nextStep, (unsigned)deadlineSync.remaining());
+        stepSize = std::min(stepSize, (unsigned)MCNeighbor::cubeDeadlineRemaining());
+        stepSize = std::min(stepSize, (unsigned)SessionLog::cubeDeadlineRemaining());
     }
 }
@@ -62,6 +62,7 @@ class SystemCubes {
     NEVER_INLINE void tickLoopGeneral();
     NEVER_INLINE void tickLoopFastSBT();
     NEVER_INLINE void tickLoopEmpty();
+    NEVER_INLINE void tickLoopHLE();
 
     System *sys;
     tthread::thread *mThread;
@@ -49,7 +49,9 @@
 #include "protocol.h"
 #include "tasks.h"
 #include "mc_timing.h"
-#include "lodepng.h"
+#include "mc_flashprofile.h"
+#include "mc_sampleprofile.h"
+#include "sessionlog.h"
 #include "sysinfo.h"
 #include "crc.h"
 #include "volume.h"
@@ -57,9 +59,10 @@
 #include "cubeconnector.h"
 #include "neighbor_tx.h"
 #include "led.h"
+#include "ostime.h"
 
 SystemMC *SystemMC::instance;
-std::vector< std::vector<uint8_t> > SystemMC::pendingGameInstalls;
+std::vector<MappedFile*> SystemMC::pendingGameInstalls;
 tthread::mutex SystemMC::pendingGameInstallLock;
 
 
@@ -74,17 +77,31 @@ bool SystemMC::init(System *sys)
             sys->opt_waveoutFilename.c_str()));
     }
 
+    renderingAudio = !sys->opt_renderAudioFilename.empty();
+    renderSampleCount = sys->opt_renderAudioSeconds * AudioMixer::SAMPLE_HZ;
+    renderStartTime = OSTime::clock();
+    renderMixTime = 0;
+
+    AudioResampler::mode = sys->opt_audioResampler;
+
+    virtualAudioClock = sys->opt_headless || SessionLog::isActive();
+    audioSampleCount = 0;
+
+    if (renderingAudio && !waveOut.isOpen())
+        return false;
+
     FlashStack::init();
     SysInfo::init();
     Crc32::init();
 
-    if (instance->sys->opt_headless) {
-        Tasks::trigger(Tasks::AudioPull);
-    } else {
+    if (!sys->opt_headless) {
         AudioOutDevice::init();
         AudioOutDevice::start();
     }
 
+    if (virtualAudioClock)
+        Tasks::trigger(Tasks::AudioPull);
+
     return true;
 }
 
@@ -107,6 +124,14 @@ void SystemMC::stop()
 
 void SystemMC::exit()
 {
+    if (sys->opt_svmSyscallStats)
+        SvmRuntime::dumpSyscallStats();
+    if (FlashProfile::isEnabled())
+        FlashProfile::write();
+    if (SampleProfile::isEnabled())
+        SampleProfile::write();
+    SessionLog::finish();
+
     if (!instance->sys->opt_headless)
         AudioOutDevice::stop();
 
@@ -131,19 +156,22 @@ void SystemMC::autoInstall()
     if (sys->flash.installLauncher(launcher)) {
 
         /*
-         * Install any ELF data that we've previously queued.
+         * Install any ELF data that we've previously queued. The files are
+         * still mapped, so this copies straight from the host's page cache
+         * into flash, and the mapping is released as soon as we're done.
          *
          * XXX: Use writer.beginGame(), so we can remove previous copies of the same game.
          */
 
         tthread::lock_guard<tthread::mutex> guard(pendingGameInstallLock);
         while (!pendingGameInstalls.empty()) {
-            std::vector<uint8_t> &data = pendingGameInstalls.back();
+            MappedFile *file = pendingGameInstalls.back();
             FlashVolumeWriter writer;
             FlashBlockRecycler recycler;
-            writer.begin(recycler, FlashVolume::T_GAME, data.size());
-            writer.appendPayload(&data[0], data.size());
+            writer.begin(recycler, FlashVolume::T_GAME, file->size());
+            writer.appendPayload(file->data(), file->size());
             writer.commit();
+            delete file;
             pendingGameInstalls.pop_back();
         }
     }
@@ -245,8 +273,10 @@ void Tasks::waitForInterrupt()
     // important to run all async events (including exit) from halt().
 
     SystemMC *self = SystemMC::instance;
+    SampleProfile::State s = SampleProfile::enter(SampleProfile::Idle);
     self->ticks = self->radioPacketDeadline;
     self->elapseTicks(0);
+    SampleProfile::restore(s);
 }
 
 Cube::Hardware *SystemMC::getCubeForSlot(CubeSlot *slot)
@@ -264,14 +294,15 @@ bool SystemMC::installGame(const char *path)
 
     tthread::lock_guard<tthread::mutex> guard(pendingGameInstallLock);
 
-    pendingGameInstalls.push_back(std::vector<uint8_t>());
-    LodePNG::loadFile(pendingGameInstalls.back(), path);
-    
-    if (pendingGameInstalls.back().empty()) {
-        pendingGameInstalls.pop_back();
+    // Map the ELF now, so we can report errors; it's copied into flash by autoInstall()
+    MappedFile *file = new MappedFile();
+    if (file->map(path)) {
+        pendingGameInstalls.push_back(file);
+    } else {
         success = false;
         LOG(("FLASH: Error, couldn't open ELF file '%s' (%s)\n",
             path, strerror(errno)));
+        delete file;
     }
 
     if (restartThread)
@@ -290,9 +321,28 @@ void SystemMC::elapseTicks(unsigned n)
     if (!self->mThreadRunning)
         longjmp(self->mThreadExitJmp, 1);
 
-    // Asynchronous radio packets
-    while (self->ticks >= self->radioPacketDeadline)
-        self->doRadioPacket();
+    // Virtual-time sampling profiler
+    if (SampleProfile::isEnabled())
+        SampleProfile::tick(self->ticks);
+
+    // Recorded or replayed input for the MC
+    SessionLog::mcTick();
+
+    if (self->renderingAudio) {
+        /*
+         * Offline audio rendering has no radio or cubes to simulate. Keep
+         * the packet clock running, since it paces waitForInterrupt(),
+         * and stop once we've logged enough audio.
+         */
+        while (self->ticks >= self->radioPacketDeadline)
+            self->radioPacketDeadline += MCTiming::TICKS_PER_PACKET;
+        if (self->waveOut.getSampleCount() >= self->renderSampleCount)
+            self->finishAudioRender();
+    } else {
+        // Asynchronous radio packets
+        while (self->ticks >= self->radioPacketDeadline)
+            self->doRadioPacket();
+    }
 
     // Asynchronous task heartbeat
     while (self->ticks >= self->heartbeatDeadline) {
@@ -304,18 +354,48 @@ void SystemMC::elapseTicks(unsigned n)
 unsigned SystemMC::suggestAudioSamplesToMix()
 {
     /*
-     * SysTime-based clock for audio logging in --headless mode.
+     * SysTime-based clock for the mixer, when it isn't paced by a device.
+     *
+     * Plain --headless runs only need to mix if the audio is being logged.
+     * With a session log, the mixer's side effects (tracker callbacks,
+     * channels finishing) are visible to the game, so we always mix.
      */
 
-    if (instance->waveOut.isOpen()) {
-        unsigned currentSample = SysTime::ticks() / SysTime::hzTicks(AudioMixer::SAMPLE_HZ);
-        unsigned prevSamples = instance->waveOut.getSampleCount();
+    if (instance->waveOut.isOpen() || SessionLog::isActive()) {
+        uint64_t currentSample = SysTime::ticks() / SysTime::hzTicks(AudioMixer::SAMPLE_HZ);
+        uint64_t prevSamples = instance->audioSampleCount;
         if (currentSample > prevSamples)
             return currentSample - prevSamples;
     }
     return 0;
 }
 
+SystemMC::MixTimer::MixTimer()
+    : startTime(instance->renderingAudio ? OSTime::clock() : 0)
+{}
+
+SystemMC::MixTimer::~MixTimer()
+{
+    if (startTime)
+        instance->renderMixTime += OSTime::clock() - startTime;
+}
+
+void SystemMC::finishAudioRender()
+{
+    double audioSeconds = waveOut.getSampleCount() / double(AudioMixer::SAMPLE_HZ);
+    double wallSeconds = OSTime::clock() - renderStartTime;
+
+    LOG(("AUDIO: Rendered %.2f seconds of audio to '%s' in %.2f seconds (%.1fx real-time)\n",
+        audioSeconds, sys->opt_renderAudioFilename.c_str(), wallSeconds,
+        audioSeconds / wallSeconds));
+    LOG(("AUDIO: Mixer took %.3f seconds, %.0f us per second of audio (%.2f%% of real-time)\n",
+        renderMixTime, renderMixTime * 1e6 / audioSeconds,
+        renderMixTime * 100.0 / audioSeconds));
+
+    waveOut.close();
+    exit(0);
+}
+
 void SystemMC::exit(int result)
 {
     /*
@@ -334,5 +414,14 @@ void SystemMC::exit(int result)
      */
 
     getSystem()->stopCubesOnly();
+
+    if (getSystem()->opt_svmSyscallStats)
+        SvmRuntime::dumpSyscallStats();
+    if (FlashProfile::isEnabled())
+        FlashProfile::write();
+    if (SampleProfile::isEnabled())
+        SampleProfile::write();
+    SessionLog::finish();
+
     ::exit(result);
 }
@@ -31,6 +31,7 @@
 #include <vector>
 #include "tinythread.h"
 #include "wavefile.h"
+#include "mappedfile.h"
 
 class System;
 class Radio;
@@ -72,24 +73,56 @@ class SystemMC {
      */
     static void elapseTicks(unsigned n);
 
+    /// Current simulated time, in MCTiming::TICK_HZ units
+    static uint64_t getTicks() {
+        return instance->ticks;
+    }
+
     /**
-     * Log some audio data. Has no effect unless --waveout was
+     * Log some audio data. Only written to a file if --waveout was
      * specified on the command line, and the file opened successfully.
      */
     static void logAudioSamples(const int16_t *samples, unsigned count) {
+        instance->audioSampleCount += count;
         instance->waveOut.write(samples, count);
     }
 
+    /**
+     * Is the audio mixer paced by virtual time, rather than by an
+     * audio device? True in headless mode, which has no device, and
+     * while a session log is active: pulls paced by the host's audio
+     * callback would change how often the MC runs Tasks::work(), and
+     * the log counts time on the MC in those terms.
+     */
+    static bool hasVirtualAudioClock() {
+        return instance->virtualAudioClock;
+    }
+
     /**
      * How many audio samples should we mix?
-     * Used in headless mode, where we have no natural timebase to use.
+     * Used with a virtual audio clock, where we have no natural timebase.
      * This fabricates an audio clock based on SysTime.
      */
     static unsigned suggestAudioSamplesToMix();
 
+    /**
+     * Scoped timer for the audio mixer. When rendering with --render-audio,
+     * this accumulates the host time spent mixing, so we can report the
+     * mixer's cost per second of rendered audio. Otherwise it does nothing.
+     */
+    class MixTimer {
+    public:
+        MixTimer();
+        ~MixTimer();
+    private:
+        double startTime;
+    };
+
  private:
     static void threadFn(void *);
     void doRadioPacket();
+    static void radioPacketEvent(void *context);
+    void finishAudioRender();
     void autoInstall();
     void pairCube(unsigned cubeID, unsigned pairingID);
 
@@ -100,7 +133,7 @@ class SystemMC {
     friend class Tasks;
 
     static SystemMC *instance;
-    static std::vector< std::vector<uint8_t> > pendingGameInstalls;
+    static std::vector<MappedFile*> pendingGameInstalls;
     static tthread::mutex pendingGameInstallLock;
 
     uint64_t ticks;
@@ -109,6 +142,14 @@ class SystemMC {
 
     System *sys;
     WaveWriter waveOut;
+    bool virtualAudioClock;
+    uint64_t audioSampleCount;
+
+    // Offline audio rendering state, for --render-audio
+    bool renderingAudio;
+    unsigned renderSampleCount;
+    double renderStartTime;
+    double renderMixTime;
     
     tthread::thread *mThread;
     bool mThreadRunning;
@@ -52,4 +52,6 @@ void flash_buffer_begin(void);
 void flash_buffer_word(void) __naked;   // Assembly-callable only
 void flash_buffer_commit(void);
 
+void flash_copy_tile(void) __naked;     // Assembly-callable only
+
 #endif
@@ -546,6 +546,17 @@ flst_E: ajmp    _flash_check_query
 
 op_check_query_end:
 
+        ;---------------------------------
+        ; Special symbol: COPY_TILES
+        ;---------------------------------
+
+        cjne    a, #FLS_OP_COPY_TILES, op_copy_tiles_end
+
+        NEXT(flst_F)
+flst_F: ajmp    _flash_copy_tiles
+
+op_copy_tiles_end:
+
         ;---------------------------------
 
         ; Unrecognized special symbol. Ignore it...
@@ -734,6 +745,62 @@ static void flash_check_query() __naked
 }
 
 
+/*
+ * flash_copy_tiles --
+ *
+ *    Implements the FLS_OP_COPY_TILES special opcode.
+ *
+ *    This op takes three byte-long arguments:
+ *
+ *     - Source tile address, as lat1 and lat2:a21. The A21 bit
+ *       is ignored; sources are always in the current bank.
+ *
+ *     - Count of tiles to copy. Zero is interpreted as 256 tiles,
+ *       but the master never sends more than FLS_MAX_COPY_TILES.
+ *
+ *    We wait for all three arguments before starting, then copy
+ *    the whole run without coming up for air. Each tile is
+ *    programmed by flash_copy_tile() in the flash HAL.
+ */
+
+static void flash_copy_tiles() __naked
+{
+    __asm
+
+        mov     a, R_BYTE_COUNT         ; Wait until we have the whole command
+        clr     c
+        subb    a, #3
+        jnc     1$
+        AGAIN()
+1$:
+
+        acall   _flash_dequeue          ; Source lat1
+        anl     a, #0xfe
+        mov     R_COUNT1, a
+
+        acall   _flash_dequeue          ; Source lat2, with A21 cleared
+        anl     a, #0xfe
+        mov     R_COUNT2, a
+
+        acall   _flash_dequeue          ; Tile count, left in R_BYTE
+2$:
+        lcall   _flash_copy_tile        ; Clobbers R_TMP0
+
+        mov     a, R_COUNT1             ; Advance source address
+        add     a, #2
+        mov     R_COUNT1, a
+        jnz     3$
+        inc     R_COUNT2
+        inc     R_COUNT2
+3$:
+        djnz    R_BYTE, 2$
+
+        ajmp    flst_opcode_n           ; Done, next opcode.
+
+    __endasm ;
+}
+
+
 /*
  * flash_tile_p0 --
  *
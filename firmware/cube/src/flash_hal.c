@@ -52,6 +52,9 @@
  * Because this delay is so long, any useful work we'd have to do between
  * buffers would be short compared to the time we spend waiting, so it's
  * not worth the code size and complexity.
+ *
+ * The one exception is flash_copy_tile(), which duplicates a tile that's
+ * already in flash using single-byte programming.
  */
 
 #include "flash.h"
@@ -149,10 +152,12 @@ static void flash_wait()
     CTRL_PORT = CTRL_IDLE;
 }
 
-void flash_buffer_begin(void)
+static void flash_program_setup()
 {
     /*
-     * Set up pre-erase addressing.
+     * Set up pre-erase addressing, and erase the sector if our address
+     * is at the beginning of one. Shared by buffered programming and by
+     * flash_copy_tile().
      *
      * If we do need to do an erase, that will require changing LAT1 and the
      * low byte, but we can go ahead and set up LAT2 and A21 now.
@@ -189,6 +194,15 @@ void flash_buffer_begin(void)
         flash_wait();
         BUS_DIR = 0;
     }
+}
+
+void flash_buffer_begin(void)
+{
+    /*
+     * Callers expect us not to clobber any of R0-R7 or DPTR!
+     */
+
+    flash_program_setup();
 
     flash_prefix_aa_55();       // Unlock
     BUS_PORT = 0x25;            // Buffer program
@@ -247,3 +261,84 @@ void flash_buffer_commit(void)
     // Wait for the program to finish, and release the bus.
     flash_wait();
 }
+
+void flash_copy_tile(void) __naked
+{
+    /*
+     * This is assembly-callable only. Copies one tile (128 bytes) from the
+     * tile-aligned flash address in r2 (lat1) and r3 (lat2), to the current
+     * flash address, which must also be tile-aligned. The source must be in
+     * the same A21 bank. Afterwards, the address has been incremented by
+     * one tile. Trashes 'a' and r0.
+     *
+     * flash_program_setup() is compiled C, so we don't rely on it leaving
+     * our source address or the caller's loop counter (r5) alone.
+     *
+     * The programming buffer would need a RAM copy of each 32-byte page,
+     * and we don't have that to spare. So this reads and programs one byte
+     * at a time, skipping bytes that are already in the erased state. It's
+     * slower than buffered programming, but still much faster than sending
+     * the tile over the radio.
+     */
+
+    __asm
+        push    ar2
+        push    ar3
+        push    ar5
+        lcall   _flash_program_setup    ; A21, LAT2, auto-erase
+        pop     ar5
+        pop     ar3
+        pop     ar2
+        mov     r0, #0                  ; Low address, same for source and dest
+
+1$:
+        ; Read one byte from the source tile
+
+        mov     BUS_DIR, #0xFF
+        mov     ADDR_PORT, r3
+        mov     CTRL_PORT, #(CTRL_IDLE | CTRL_FLASH_LAT2)
+        mov     ADDR_PORT, r2
+        mov     CTRL_PORT, #(CTRL_IDLE | CTRL_FLASH_LAT1)
+        mov     ADDR_PORT, r0
+        mov     CTRL_PORT, #CTRL_FLASH_OUT
+        mov     a, BUS_PORT
+        mov     CTRL_PORT, #CTRL_IDLE
+
+        cjne    a, #0xFF, 2$            ; Nothing to program for erased bytes
+        sjmp    3$
+2$:
+
+        ; Program it at the same offset in the destination tile
+
+        push    acc
+        mov     BUS_DIR, #0
+        mov     ADDR_PORT, _flash_addr_lat2
+        mov     CTRL_PORT, #(CTRL_IDLE | CTRL_FLASH_LAT2)
+        lcall   _flash_prefix_aa_55     ; Unlock
+        mov     ADDR_PORT, #0x2A        ; Byte program, at 0xAAA
+        mov     CTRL_PORT, #(CTRL_IDLE | CTRL_FLASH_LAT1)
+        mov     ADDR_PORT, #0x54
+        mov     BUS_PORT, #0xA0
+        lcall   _flash_strobe
+        mov     ADDR_PORT, _flash_addr_lat1
+        mov     CTRL_PORT, #(CTRL_IDLE | CTRL_FLASH_LAT1)
+        mov     ADDR_PORT, r0
+        pop     acc
+        mov     BUS_PORT, a
+        lcall   _flash_strobe
+        lcall   _flash_wait
+3$:
+        inc     r0                      ; Next byte, until the low address wraps
+        inc     r0
+        cjne    r0, #0, 1$
+
+        mov     a, _flash_addr_lat1     ; Next tile
+        add     a, #2
+        mov     _flash_addr_lat1, a
+        jnz     4$
+        inc     _flash_addr_lat2
+        inc     _flash_addr_lat2
+4$:
+        ret
+    __endasm ;
+}
@@ -38,11 +38,13 @@
  *    3 - Rev 3 PCB
  *    4 - Rev 4 PCB (New accelerometer address)
  *    5 - Rev 5 PCB (Shake to wake)
+ *    6 - Rev 6 PCB (LIS3DE accelerometer, ST7735R LCD)
+ *    7 - Rev 6 PCB, firmware with FLS_OP_COPY_TILES
  */
 
 #define HWREV_MINIMUM   2
-#define HWREV_LATEST    6
-#define HWREV_DEFAULT   6
+#define HWREV_LATEST    7
+#define HWREV_DEFAULT   7
 
 #ifndef HWREV
 #  define HWREV HWREV_DEFAULT
@@ -56,7 +58,7 @@
  * Hardware feature selection
  */
 
-#if HWREV == 6
+#if HWREV >= 6
 #   define USE_LIS3DE
 #   define LCD_MODEL_SANTEK_ST7735R
 #elif (HWREV >= 0) && (HWREV <= 5)
@@ -58,8 +58,9 @@
 #define CUBE_FEATURE_ACCEL_XY_FLIP      0x02
 #define CUBE_FEATURE_ASSET_CRC          0x03
 #define CUBE_FEATURE_RF_COMPLIANT       0x04
+#define CUBE_FEATURE_TILE_COPY          0x07
 
-#define CUBE_VERSION_LATEST             0x06
+#define CUBE_VERSION_LATEST             0x07
 
 
 /**************************************************************************
@@ -589,6 +590,18 @@ typedef struct {
  * be able to stitch together multiple AssetGroups without sending resets
  * before each group. So, stir always makes sure to define a LUT entry
  * before using it.
+ *
+ * FLS_OP_COPY_TILES duplicates tiles which are already in the cube's
+ * flash, instead of decoding them from the stream. The source and the
+ * current write address must be in the same A21 bank, and both must be
+ * tile-aligned. This op leaves the LUT alone. Stir marks the runs of tile
+ * opcodes that can be swapped for a copy without changing how the rest
+ * of the stream decodes, and the AssetLoader does the swapping. Copies
+ * are slow compared to buffered programming, so senders should keep
+ * each one to FLS_MAX_COPY_TILES or fewer. A copy is shorter than the
+ * opcodes it replaces, which can break the minimum operand size padding
+ * below, so a group that used any copies is followed by FLS_MIN_TILE_P16
+ * bytes of NOPs.
  */
 
 #define FLS_BLOCK_SIZE          (64*1024)   // Size of flash erase blocks
@@ -614,8 +627,11 @@ typedef struct {
 #define FLS_OP_ADDRESS          0xe1    // Followed by a 2-byte (lat1:lat2) tile address. A21 in LSB of lat2.
 #define FLS_OP_QUERY_CRC        0xe2    // Args: (queryID, numBlocks)
 #define FLS_OP_CHECK_QUERY      0xe3    // Args: (numBytes, bytes...)
+#define FLS_OP_COPY_TILES       0xe4    // Args: (lat1, lat2:a21, numTiles) source tile address and count
+
+// From 0xe5 to 0xff are all reserved codes currently
 
-// From 0xe4 to 0xff are all reserved codes currently
+#define FLS_MAX_COPY_TILES      8       // Largest numTiles we send in one FLS_OP_COPY_TILES
 
 /*
  * Minimum operand sizes for various opcodes:
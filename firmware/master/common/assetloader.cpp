@@ -29,6 +29,7 @@
 #include "assetslot.h"
 #include "radio.h"
 #include "cubeslots.h"
+#include "cube.h"
 #include "tasks.h"
 
 _SYSAssetLoader *AssetLoader::userLoader;
@@ -37,6 +38,13 @@ uint8_t AssetLoader::userConfigSize[_SYS_NUM_CUBE_SLOTS];
 uint8_t AssetLoader::cubeTaskState[_SYS_NUM_CUBE_SLOTS];
 uint8_t AssetLoader::cubeBufferAvail[_SYS_NUM_CUBE_SLOTS];
 uint8_t AssetLoader::cubeLastQuery[_SYS_NUM_CUBE_SLOTS];
+uint32_t AssetLoader::cubeCopySources[_SYS_NUM_CUBE_SLOTS];
+uint16_t AssetLoader::cubeNextRef[_SYS_NUM_CUBE_SLOTS];
+uint32_t AssetLoader::cubeNextRefOffset[_SYS_NUM_CUBE_SLOTS];
+uint32_t AssetLoader::cubeStreamEnd[_SYS_NUM_CUBE_SLOTS];
+uint32_t AssetLoader::cubeStreamOffset[_SYS_NUM_CUBE_SLOTS];
+AssetStreamBuffer AssetLoader::stream;
+AssetGroupInfo AssetLoader::streamGroup;
 SysTime::Ticks AssetLoader::cubeDeadline[_SYS_NUM_CUBE_SLOTS];
 AssetLoader::SubState AssetLoader::cubeTaskSubstate[_SYS_NUM_CUBE_SLOTS];
 _SYSCubeIDVector AssetLoader::activeCubes;
@@ -46,6 +54,8 @@ _SYSCubeIDVector AssetLoader::resetPendingCubes;
 _SYSCubeIDVector AssetLoader::resetAckCubes;
 _SYSCubeIDVector AssetLoader::queryPendingCubes;
 _SYSCubeIDVector AssetLoader::queryErrorCubes;
+_SYSCubeIDVector AssetLoader::copyPaddingCubes;
+_SYSCubeIDVector AssetLoader::streamCubes;
 DEBUG_ONLY(SysTime::Ticks AssetLoader::groupBeginTimestamp[_SYS_NUM_CUBE_SLOTS];)
 
 
@@ -59,6 +69,7 @@ void AssetLoader::init()
     // This is sufficient to invalidate all other state
     userLoader = NULL;
     activeCubes = 0;
+    streamCubes = 0;
 }
 
 void AssetLoader::finish()
@@ -76,6 +87,7 @@ void AssetLoader::cancel(_SYSCubeIDVector cv)
     // Undo the effects of 'start'. Make this cube inactive, and don't auto-restart it.
     Atomic::And(startedCubes, ~cv);
     Atomic::And(activeCubes, ~cv);
+    Atomic::And(streamCubes, ~cv);
     updateActiveCubes();
 }
 
@@ -116,6 +128,7 @@ void AssetLoader::cubeDisconnect(_SYSCubeID id)
     Atomic::And(cacheCoherentCubes, ~bit);
     Atomic::And(queryErrorCubes, ~bit);
     Atomic::And(queryPendingCubes, ~bit);
+    Atomic::And(streamCubes, ~bit);
     updateActiveCubes();
 }
 
@@ -221,6 +234,8 @@ bool AssetLoader::needFlashPacket(_SYSCubeID id)
             AssetFIFO fifo(*lc);
             if (fifo.readAvailable())
                 return true;
+            if ((bit & streamCubes) && cubeStreamOffset[id] < MIN(cubeStreamEnd[id], stream.getEnd()))
+                return true;
         }
     }
 
@@ -268,6 +283,8 @@ void AssetLoader::produceFlashPacket(_SYSCubeID id, PacketBuffer &buf)
 
     /*
      * Send data that was generated by our task, and stored in the AssetFIFO.
+     * Commands in the FIFO always go ahead of shared stream data; our task
+     * only queues them once this cube has caught up with the stream.
      */
 
     _SYSAssetLoaderCube *lc = AssetUtil::mapLoaderCube(userLoader, id);
@@ -277,7 +294,6 @@ void AssetLoader::produceFlashPacket(_SYSCubeID id, PacketBuffer &buf)
         unsigned count = MIN(fifo.readAvailable(), buf.bytesFree());
         count = MIN(count, avail);
         avail -= count;
-        ASSERT(count);
 
         while (count) {
             buf.append(fifo.read());
@@ -285,6 +301,26 @@ void AssetLoader::produceFlashPacket(_SYSCubeID id, PacketBuffer &buf)
         }
 
         fifo.commitReads();
+
+        if ((bit & streamCubes) && !fifo.readAvailable()) {
+            unsigned offset = cubeStreamOffset[id];
+            unsigned end = MIN(cubeStreamEnd[id], stream.getEnd());
+
+            if (offset < end) {
+                count = MIN(end - offset, buf.bytesFree());
+                count = MIN(count, avail);
+                avail -= count;
+
+                while (count) {
+                    buf.append(stream.at(offset++));
+                    count--;
+                }
+
+                cubeStreamOffset[id] = offset;
+            }
+        }
+
+        ASSERT(avail < cubeBufferAvail[id]);
         cubeBufferAvail[id] = avail;
     }
 }
@@ -461,6 +497,230 @@ void AssetLoader::prepareCubeForLoading(_SYSCubeID id)
     }
 }
 
+void AssetLoader::beginTileRefs(_SYSCubeID id, const AssetGroupInfo &group)
+{
+    /*
+     * Get ready to walk this group's tile reference table, if it has one
+     * and the cube is new enough to use it. The table is sorted by data
+     * offset, so we only ever need to look at the next entry.
+     */
+
+    ASSERT(id < _SYS_NUM_CUBE_SLOTS);
+    cubeNextRef[id] = 0;
+    cubeNextRefOffset[id] = ~0U;
+
+    if (CubeSlots::instances[id].getVersion() < CUBE_FEATURE_TILE_COPY)
+        return;
+
+    if (group.numTileRefs()) {
+        _SYSAssetGroupTileRef ref;
+        group.copyTileRef(0, ref);
+        cubeNextRefOffset[id] = ref.offset;
+    }
+}
+
+bool AssetLoader::resolveTileRef(_SYSCubeID id, const AssetGroupInfo &group,
+    unsigned offset, const _SYSAssetGroupTileRef &ref, unsigned &srcAddr)
+{
+    /*
+     * Validate a tile reference, and find the cube flash address it copies
+     * from. The source must be an earlier group in this configuration which
+     * we know is already on the cube.
+     */
+
+    if (ref.offset != offset
+        || ref.numTiles == 0
+        || ref.numTiles > FLS_MAX_COPY_TILES
+        || unsigned(ref.tile) + ref.numTiles > group.numTiles
+        || ref.length <= AssetFIFO::COPY_TILES_SIZE
+        || unsigned(ref.offset) + ref.length > group.dataSize)
+        return false;
+
+    unsigned configIndex = cubeTaskSubstate[id].config.index;
+    uint32_t sources = cubeCopySources[id];
+    if (configIndex < 32)
+        sources &= ~(0xFFFFFFFF >> configIndex);
+
+    while (sources) {
+        unsigned srcIndex = Intrinsic::CLZ(sources);
+        sources ^= Intrinsic::LZ(srcIndex);
+
+        AssetGroupInfo src;
+        if (!src.fromAssetConfiguration(userConfig[id] + srcIndex))
+            continue;
+        if (src.ordinal != ref.srcOrdinal || src.volume.block.code != group.volume.block.code)
+            continue;
+        if (unsigned(ref.srcTile) + ref.numTiles > src.numTiles)
+            continue;
+
+        // The cube can only copy within one A21 bank
+        srcAddr = AssetUtil::loadedBaseAddr(src.va, id) + ref.srcTile;
+        unsigned destAddr = AssetUtil::loadedBaseAddr(group.va, id) + ref.tile;
+        unsigned lastSrc = srcAddr + ref.numTiles - 1;
+        unsigned lastDest = destAddr + ref.numTiles - 1;
+        if (lastSrc >= 0x8000 || lastDest >= 0x8000)
+            return false;
+        if (((srcAddr ^ destAddr) | (srcAddr ^ lastSrc) | (destAddr ^ lastDest)) & 0x4000)
+            return false;
+
+        return true;
+    }
+
+    return false;
+}
+
+unsigned AssetLoader::sendTileCopy(_SYSCubeID id, _SYSAssetLoaderCube &lc,
+    const AssetGroupInfo &group, unsigned offset, unsigned &end)
+{
+    /*
+     * If the next tile reference begins at 'offset', try to replace its
+     * span of loadstream with a single FLS_OP_COPY_TILES. Returns the number
+     * of loadstream bytes we skipped, or zero if the caller should send
+     * normal data. In that case, 'end' is narrowed so the caller stops
+     * right before the next reference.
+     *
+     * The reference table lives in flash, where userspace can't modify it,
+     * but we still check everything before letting it near the cube's flash.
+     * A reference we can't use is just skipped, and its data gets sent
+     * like any other.
+     */
+
+    ASSERT(id < _SYS_NUM_CUBE_SLOTS);
+    uint32_t refOffset = cubeNextRefOffset[id];
+
+    if (offset < refOffset) {
+        end = MIN(end, refOffset);
+        return 0;
+    }
+
+    // Read this reference, and queue up the next one
+    _SYSAssetGroupTileRef ref;
+    unsigned index = cubeNextRef[id];
+    group.copyTileRef(index, ref);
+
+    cubeNextRef[id] = ++index;
+    cubeNextRefOffset[id] = ~0U;
+    if (index < group.numTileRefs()) {
+        _SYSAssetGroupTileRef next;
+        group.copyTileRef(index, next);
+        if (next.offset > ref.offset)
+            cubeNextRefOffset[id] = next.offset;
+    }
+
+    unsigned srcAddr;
+    if (!resolveTileRef(id, group, offset, ref, srcAddr)) {
+        // Can't use it. Send the data normally, up to the next reference.
+        end = MIN(end, cubeNextRefOffset[id]);
+        return 0;
+    }
+
+    AssetFIFO fifo(lc);
+    if (fifo.writeAvailable() < fifo.COPY_TILES_SIZE) {
+        // Try again once there's room; don't send anything past the reference
+        cubeNextRef[id] = index - 1;
+        cubeNextRefOffset[id] = offset;
+        end = offset;
+        return 0;
+    }
+
+    fifo.writeCopyTiles(srcAddr, ref.numTiles);
+    fifo.commitWrites();
+    Atomic::SetLZ(copyPaddingCubes, id);
+
+    return ref.length;
+}
+
+bool AssetLoader::joinStream(_SYSCubeID id, const AssetGroupInfo &group, unsigned offset)
+{
+    /*
+     * Start reading this cube's group data from the shared stream, if we
+     * can. An idle stream is ours to restart on any group. A busy one can
+     * take us if it's streaming the same group, and still holds 'offset'.
+     * Otherwise the cube loads through its own FIFO, as usual.
+     */
+
+    ASSERT(id < _SYS_NUM_CUBE_SLOTS);
+    ASSERT(!(streamCubes & Intrinsic::LZ(id)));
+
+    if (!streamCubes) {
+        streamGroup = group;
+        stream.reset(offset);
+    } else if (!streamGroup.sameData(group) || !stream.contains(offset)) {
+        return false;
+    }
+
+    cubeStreamOffset[id] = offset;
+    cubeStreamEnd[id] = offset;
+    Atomic::SetLZ(streamCubes, id);
+    return true;
+}
+
+bool AssetLoader::leaveStream(_SYSCubeID id)
+{
+    /*
+     * Stop reading from the stream, once the ISR has sent everything we
+     * queued for this cube. Until then, anything we put in the cube's FIFO
+     * would jump ahead of that data, so the caller has to wait.
+     */
+
+    ASSERT(id < _SYS_NUM_CUBE_SLOTS);
+
+    if (cubeStreamOffset[id] != cubeStreamEnd[id])
+        return false;
+
+    Atomic::ClearLZ(streamCubes, id);
+    return true;
+}
+
+unsigned AssetLoader::sendFromStream(_SYSCubeID id, unsigned offset, unsigned end)
+{
+    /*
+     * Queue stream data for this cube, from 'offset' up to 'end' or as far
+     * as the stream has read. Returns the number of bytes queued.
+     */
+
+    ASSERT(id < _SYS_NUM_CUBE_SLOTS);
+    ASSERT(cubeStreamEnd[id] == offset);
+
+    refillStream();
+
+    end = MIN(end, stream.getEnd());
+    if (end <= offset)
+        return 0;
+
+    cubeStreamEnd[id] = end;
+    return end - offset;
+}
+
+void AssetLoader::refillStream()
+{
+    /*
+     * Read more group data, if the leading cube needs it. The slowest
+     * cube limits how far ahead the others can get.
+     */
+
+    STATIC_ASSERT(AssetStreamBuffer::READ_AHEAD > FLS_FIFO_USABLE);
+
+    _SYSCubeIDVector cv = streamCubes;
+    if (!cv)
+        return;
+
+    unsigned slowest = ~0U;
+    unsigned fastest = 0;
+    while (cv) {
+        _SYSCubeID id = Intrinsic::CLZ(cv);
+        cv ^= Intrinsic::LZ(id);
+        unsigned offset = cubeStreamOffset[id];
+        slowest = MIN(slowest, offset);
+        fastest = MAX(fastest, offset);
+    }
+
+    while (unsigned count = stream.prepareWrite(slowest, fastest, streamGroup.dataSize)) {
+        streamGroup.copyData(stream.getEnd(), stream.writePointer(), count);
+        stream.commitWrite(count);
+    }
+}
+
 void AssetLoader::queryResponse(_SYSCubeID id, const PacketBuffer &packet)
 {
     /*
@@ -30,6 +30,7 @@
 #include "macros.h"
 #include "systime.h"
 #include "flash_syslfs.h"
+#include "assetstream.h"
 
 struct PacketBuffer;
 struct AssetGroupInfo;
@@ -49,6 +50,10 @@ struct AssetGroupInfo;
  * userspace _SYSAssetLoader. We orchestrate the loading process and
  * access flash memory from a Task which fills the FIFO with commands
  * and data.
+ *
+ * Cubes loading the same AssetGroup at the same time get its data from
+ * one shared AssetStreamBuffer instead. We read each byte from flash
+ * once, and the radio ISR sends it to each cube at that cube's own pace.
  */
 
 class AssetLoader
@@ -145,6 +150,19 @@ private:
     // Synchronous preparations (Happens while we're waiting for reset)
     static void prepareCubeForLoading(_SYSCubeID id);
 
+    // Tile references: copy tiles from groups the cube already has, instead of resending them
+    static void beginTileRefs(_SYSCubeID id, const AssetGroupInfo &group);
+    static unsigned sendTileCopy(_SYSCubeID id, _SYSAssetLoaderCube &lc,
+        const AssetGroupInfo &group, unsigned offset, unsigned &end);
+    static bool resolveTileRef(_SYSCubeID id, const AssetGroupInfo &group,
+        unsigned offset, const _SYSAssetGroupTileRef &ref, unsigned &srcAddr);
+
+    // Shared stream: cubes loading the same group read one copy of its data
+    static bool joinStream(_SYSCubeID id, const AssetGroupInfo &group, unsigned offset);
+    static bool leaveStream(_SYSCubeID id);
+    static unsigned sendFromStream(_SYSCubeID id, unsigned offset, unsigned end);
+    static void refillStream();
+
     // Simulation-only asset loader bypass hook
     #ifdef SIFTEO_SIMULATOR
     static bool loaderBypass(_SYSCubeID id, AssetGroupInfo &group);
@@ -192,15 +210,26 @@ private:
     static SubState cubeTaskSubstate[_SYS_NUM_CUBE_SLOTS];
     static SysTime::Ticks cubeDeadline[_SYS_NUM_CUBE_SLOTS];
     static uint8_t cubeLastQuery[_SYS_NUM_CUBE_SLOTS];
+    static uint32_t cubeCopySources[_SYS_NUM_CUBE_SLOTS];      // Config indices known to be on the cube
+    static uint16_t cubeNextRef[_SYS_NUM_CUBE_SLOTS];          // Index of the next tile reference
+    static uint32_t cubeNextRefOffset[_SYS_NUM_CUBE_SLOTS];    // Its data offset, ~0 if none
+    static uint32_t cubeStreamEnd[_SYS_NUM_CUBE_SLOTS];        // Stream data queued for this cube
+
+    // Task-owned shared stream. The ISR reads published data only.
+    static AssetStreamBuffer stream;
+    static AssetGroupInfo streamGroup;
 
     // ISR-owned cube state. Read-only from tasks.
     static uint8_t cubeBufferAvail[_SYS_NUM_CUBE_SLOTS];
+    static uint32_t cubeStreamOffset[_SYS_NUM_CUBE_SLOTS];     // Next stream byte to send
 
     // Atomic shared state
     static _SYSCubeIDVector resetPendingCubes;
     static _SYSCubeIDVector resetAckCubes;
     static _SYSCubeIDVector queryPendingCubes;
     static _SYSCubeIDVector queryErrorCubes;
+    static _SYSCubeIDVector copyPaddingCubes;       // Owe the cube some NOPs after a copy
+    static _SYSCubeIDVector streamCubes;            // Reading group data from the shared stream
 
     DEBUG_ONLY(static SysTime::Ticks groupBeginTimestamp[_SYS_NUM_CUBE_SLOTS];)
 };
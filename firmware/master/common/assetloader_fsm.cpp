@@ -54,6 +54,7 @@ void AssetLoader::fsmEnterState(_SYSCubeID id, TaskState s)
          */
         case S_RESET1:
         case S_RESET2:
+            Atomic::ClearLZ(streamCubes, id);
             Atomic::ClearLZ(resetAckCubes, id);
             Atomic::SetLZ(resetPendingCubes, id);
             return;
@@ -133,6 +134,7 @@ void AssetLoader::fsmTaskState(_SYSCubeID id, TaskState s)
 
                 // Otherwise, begin allocating the first configuration
                 cubeTaskSubstate[id].value = 0;
+                cubeCopySources[id] = 0;
                 fsmEnterState(id, S_CONFIG_INIT);
             }
             return;
@@ -155,6 +157,7 @@ void AssetLoader::fsmTaskState(_SYSCubeID id, TaskState s)
                     // Done! Start allocating the first configuration.
                     Atomic::Or(cacheCoherentCubes, bit);
                     cubeTaskSubstate[id].value = 0;
+                    cubeCopySources[id] = 0;
                     return fsmEnterState(id, S_CONFIG_INIT);
                 }
 
@@ -336,6 +339,8 @@ void AssetLoader::fsmTaskState(_SYSCubeID id, TaskState s)
                 // Was it already installed? Skip to the next.
                 if (foundCV) {
                     ASSERT(foundCV == bit);
+                    if (index < 32)
+                        cubeCopySources[id] |= Intrinsic::LZ(index);
                     cubeTaskSubstate[id].config.index = index + 1;
                     continue;
                 }
@@ -344,6 +349,8 @@ void AssetLoader::fsmTaskState(_SYSCubeID id, TaskState s)
                 #ifdef SIFTEO_SIMULATOR
                     if (loaderBypass(id, group)) {
                         VirtAssetSlots::finalizeSlot(id, vSlot, group);
+                        if (index < 32)
+                            cubeCopySources[id] |= Intrinsic::LZ(index);
                         cubeTaskSubstate[id].config.index = index + 1;
                         continue;
                     }
@@ -384,6 +391,7 @@ void AssetLoader::fsmTaskState(_SYSCubeID id, TaskState s)
 
             resetDeadline(id);
             cubeTaskSubstate[id].config.offset = 0;
+            beginTileRefs(id, group);
             return fsmEnterState(id, S_CONFIG_DATA);
         }
 
@@ -401,8 +409,46 @@ void AssetLoader::fsmTaskState(_SYSCubeID id, TaskState s)
             if (!group.fromAssetConfiguration(userConfig[id] + index))
                 return fsmEnterState(id, S_ERROR);
 
+            /*
+             * Group data comes from the shared stream when this cube can
+             * join it, or through the cube's own FIFO otherwise. If
+             * userspace changed the configuration under us, we finish
+             * what's queued on the stream and carry on without it.
+             */
+
             unsigned offset = cubeTaskSubstate[id].config.offset;
-            unsigned bytes = AssetFIFO::fetchFromGroup(*lc, group, offset);
+            unsigned end = group.dataSize;
+            bool streaming = (streamCubes & bit) != 0;
+
+            if (streaming && !streamGroup.sameData(group)) {
+                if (!leaveStream(id))
+                    return;
+                streaming = false;
+            }
+            if (!streaming)
+                streaming = joinStream(id, group, offset);
+
+            /*
+             * Tiles that stir found in an earlier group become a short
+             * copy command. Everything else is sent as-is, stopping
+             * short of the next tile reference.
+             *
+             * Copy commands go through the FIFO, so a streaming cube must
+             * send everything it has queued on the stream first. The
+             * stream then skips over the copied data.
+             */
+
+            if (streaming && offset >= cubeNextRefOffset[id] && cubeStreamOffset[id] != offset)
+                return;
+
+            unsigned bytes = sendTileCopy(id, *lc, group, offset, end);
+            if (bytes && streaming) {
+                cubeStreamOffset[id] = offset + bytes;
+                cubeStreamEnd[id] = offset + bytes;
+            }
+            if (!bytes)
+                bytes = streaming ? sendFromStream(id, offset, end)
+                                  : AssetFIFO::fetchFromGroup(*lc, group, offset, end);
             if (!bytes) {
                 // No progress was made. Wait for more FIFO space.
                 return;
@@ -433,8 +479,26 @@ void AssetLoader::fsmTaskState(_SYSCubeID id, TaskState s)
             if (!lc)
                 return fsmEnterState(id, S_ERROR);
 
-            // Still waiting for FIFO to drain?
+            // The stream data we queued has to go out before anything else
+            if ((streamCubes & bit) && !leaveStream(id))
+                return;
+
             AssetFIFO fifo(*lc);
+
+            /*
+             * After any copies, the cube's decoder needs some padding
+             * before it will flush its final tile. See FLS_OP_COPY_TILES.
+             */
+            if (copyPaddingCubes & bit) {
+                if (fifo.writeAvailable() < FLS_MIN_TILE_P16)
+                    return;
+                for (unsigned i = 0; i < FLS_MIN_TILE_P16; ++i)
+                    fifo.write(FLS_OP_NOP);
+                fifo.commitWrites();
+                Atomic::ClearLZ(copyPaddingCubes, id);
+            }
+
+            // Still waiting for FIFO to drain?
             if (fifo.readAvailable())
                 return;
 
@@ -457,6 +521,8 @@ void AssetLoader::fsmTaskState(_SYSCubeID id, TaskState s)
 
             // Now we're actually done! Commit this to SysLFS.
             VirtAssetSlots::finalizeSlot(id, vSlot, group);
+            if (index < 32)
+                cubeCopySources[id] |= Intrinsic::LZ(index);
 
             // Announce our triumphant advancement
             LOG(("ASSET[%d]: Group [%d/%d] finished in %f seconds\n",
@@ -0,0 +1,143 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Thundercracker firmware
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _ASSETSTREAM_H
+#define _ASSETSTREAM_H
+
+#include <sifteo/abi.h>
+#include "macros.h"
+#include "machine.h"
+
+
+/**
+ * A window of AssetGroup data which several cubes can read from at once.
+ *
+ * Bytes are addressed by their offset within the group. The window holds
+ * offsets [begin, end), and each reader keeps its own cursor somewhere in
+ * that range. Our Task is the only writer: it discards data below the
+ * slowest cursor, and reads more from flash at 'end'. The radio ISR reads
+ * at each cube's cursor, as far as that cube's ACKs allow.
+ *
+ * Data is published by advancing 'end' after it's written, so the ISR
+ * never sees a byte before it's valid. Readers only move forward, and we
+ * only overwrite bytes below the slowest cursor, so nothing the ISR can
+ * still reach is ever overwritten.
+ *
+ * We read at most READ_AHEAD bytes past the leading cursor, and keep old
+ * data until its space is needed. Cubes that start a little behind the
+ * others can join as long as their first byte is still in the window.
+ */
+
+class AssetStreamBuffer {
+public:
+    static const unsigned SIZE = 256;
+    static const unsigned READ_AHEAD = 128;
+
+    ALWAYS_INLINE void reset(unsigned offset) {
+        STATIC_ASSERT((SIZE & MASK) == 0);
+        begin = offset;
+        end = offset;
+    }
+
+    ALWAYS_INLINE unsigned getBegin() const {
+        return begin;
+    }
+
+    ALWAYS_INLINE unsigned getEnd() const {
+        return end;
+    }
+
+    ALWAYS_INLINE bool contains(unsigned offset) const {
+        return offset >= begin && offset <= end;
+    }
+
+    ALWAYS_INLINE uint8_t at(unsigned offset) const {
+        ASSERT(offset >= begin && offset < end);
+        return buffer[offset & MASK];
+    }
+
+    /// Drop everything before 'offset', which no reader needs anymore.
+    void discard(unsigned offset)
+    {
+        // Readers may have skipped past our data entirely
+        if (offset > end)
+            end = offset;
+        if (offset > begin)
+            begin = offset;
+    }
+
+    /// Contiguous free space at 'end', stopping at offset 'limit'.
+    unsigned writeAvailable(unsigned limit) const
+    {
+        if (limit <= end)
+            return 0;
+        unsigned space = SIZE - (end - begin);
+        space = MIN(space, SIZE - (end & MASK));
+        return MIN(space, limit - end);
+    }
+
+    /**
+     * Make room for more data, given the slowest and fastest cursors.
+     * Returns the number of bytes to write at writePointer(), or zero if
+     * we're far enough ahead already.
+     */
+    unsigned prepareWrite(unsigned slowest, unsigned fastest, unsigned dataSize)
+    {
+        if (slowest > end)
+            discard(slowest);
+
+        unsigned limit = MIN(dataSize, fastest + READ_AHEAD);
+        unsigned count = writeAvailable(limit);
+
+        if (!count && end < limit) {
+            // Full. Drop only as much as we need.
+            discard(MIN(slowest, limit - SIZE));
+            count = writeAvailable(limit);
+        }
+
+        return count;
+    }
+
+    ALWAYS_INLINE uint8_t *writePointer() {
+        return &buffer[end & MASK];
+    }
+
+    /// Publish 'count' bytes written at writePointer().
+    ALWAYS_INLINE void commitWrite(unsigned count) {
+        ASSERT(count <= writeAvailable(end + count));
+        Atomic::Barrier();
+        end += count;
+    }
+
+private:
+    static const unsigned MASK = SIZE - 1;
+
+    unsigned begin;
+    unsigned end;
+    uint8_t buffer[SIZE];
+};
+
+
+#endif
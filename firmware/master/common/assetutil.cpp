@@ -267,7 +267,8 @@ bool AssetGroupInfo::fromAssetConfiguration(const _SYSAssetConfiguration *config
     return true;
 }
 
-unsigned AssetFIFO::fetchFromGroup(_SYSAssetLoaderCube &sys, AssetGroupInfo &group, unsigned offset)
+unsigned AssetFIFO::fetchFromGroup(_SYSAssetLoaderCube &sys, AssetGroupInfo &group,
+    unsigned offset, unsigned end)
 {
     /*
      * Fetch asset data from an AssetGroupInfo. If 'remapToVolume' is set,
@@ -278,9 +279,9 @@ unsigned AssetFIFO::fetchFromGroup(_SYSAssetLoaderCube &sys, AssetGroupInfo &gro
      * If 'remapToVolume' is not set, we treat headerVA as a normal SVM
      * virtual address.
      *
-     * Starts reading from the group at 'offset'. Returns the actual number
-     * of bytes transferred into the FIFO, which may be limited either by
-     * available FIFO space or by running out of asset data.
+     * Starts reading from the group at 'offset', and stops before 'end'.
+     * Returns the actual number of bytes transferred into the FIFO, which
+     * may be limited either by available FIFO space or by reaching 'end'.
      */
 
     /*
@@ -289,11 +290,11 @@ unsigned AssetFIFO::fetchFromGroup(_SYSAssetLoaderCube &sys, AssetGroupInfo &gro
      */
     AssetFIFO fifo(sys);
 
-    unsigned dataSize = group.dataSize;
-    if (offset >= dataSize)
+    end = MIN(end, group.dataSize);
+    if (offset >= end)
         return 0;
 
-    unsigned actualSize = MIN(dataSize - offset, fifo.writeAvailable());
+    unsigned actualSize = MIN(end - offset, fifo.writeAvailable());
     if (!actualSize)
         return 0;
 
@@ -340,23 +341,67 @@ unsigned AssetFIFO::fetchFromGroup(_SYSAssetLoaderCube &sys, AssetGroupInfo &gro
     return actualSize;
 }
 
-void AssetGroupInfo::copyCRC(uint8_t *buffer) const
+void AssetGroupInfo::copyBytes(unsigned offset, uint8_t *buffer, unsigned length) const
 {
     /*
-     * Read the CRC from an AssetGroup, as computed by stir.
+     * Read 'length' bytes starting 'offset' bytes past the group header's VA.
      */
 
-    SvmMemory::VirtAddr va = headerVA + offsetof(_SYSAssetGroupHeader, crc);
+    SvmMemory::VirtAddr va = headerVA + offset;
 
     if (remapToVolume) {
         // Low-level volume mapping
         FlashBlockRef mapRef, dataRef;
-        FlashMapSpan span = volume.getPayload(mapRef);        
+        FlashMapSpan span = volume.getPayload(mapRef);
         va -= SvmMemory::SEGMENT_1_VA;
-        span.copyBytes(dataRef, va, buffer, _SYS_ASSET_GROUP_CRC_SIZE);
+        span.copyBytes(dataRef, va, buffer, length);
     } else {
         // Normal SVM virtual address
         FlashBlockRef dataRef;
-        SvmMemory::copyROData(dataRef, buffer, va, _SYS_ASSET_GROUP_CRC_SIZE);
+        SvmMemory::copyROData(dataRef, buffer, va, length);
     }
 }
+
+void AssetGroupInfo::copyCRC(uint8_t *buffer) const
+{
+    /*
+     * Read the CRC from an AssetGroup, as computed by stir.
+     */
+
+    copyBytes(offsetof(_SYSAssetGroupHeader, crc), buffer, _SYS_ASSET_GROUP_CRC_SIZE);
+}
+
+unsigned AssetGroupInfo::tileRefsOffset() const
+{
+    // The tile reference table follows the data, at the next 4-byte boundary
+    return roundup<4>(sizeof(_SYSAssetGroupHeader) + dataSize);
+}
+
+unsigned AssetGroupInfo::numTileRefs() const
+{
+    /*
+     * How many _SYSAssetGroupTileRef entries does this group have?
+     * Older groups, and groups stir found nothing to share with,
+     * have no table at all.
+     */
+
+    uint8_t flags;
+    copyBytes(offsetof(_SYSAssetGroupHeader, flags), &flags, sizeof flags);
+    if (!(flags & _SYS_AGF_TILE_REFS))
+        return 0;
+
+    _SYSAssetGroupTileRefs hdr;
+    copyBytes(tileRefsOffset(), (uint8_t*) &hdr, sizeof hdr);
+    return hdr.numRefs;
+}
+
+void AssetGroupInfo::copyTileRef(unsigned index, _SYSAssetGroupTileRef &ref) const
+{
+    /*
+     * Read one tile reference. None of its contents are trusted yet,
+     * the AssetLoader validates each reference before acting on it.
+     */
+
+    copyBytes(tileRefsOffset() + sizeof(_SYSAssetGroupTileRefs) + index * sizeof ref,
+        (uint8_t*) &ref, sizeof ref);
+}
@@ -84,6 +84,22 @@ struct AssetGroupInfo {
 
     void copyCRC(uint8_t *buffer) const;
 
+    // Read group data, starting 'offset' bytes past the header
+    void copyData(unsigned offset, uint8_t *buffer, unsigned length) const {
+        copyBytes(sizeof(_SYSAssetGroupHeader) + offset, buffer, length);
+    }
+
+    // Does 'other' read the same data from the same place in flash?
+    bool sameData(const AssetGroupInfo &other) const {
+        return headerVA == other.headerVA
+            && dataSize == other.dataSize
+            && remapToVolume == other.remapToVolume
+            && volume.block.code == other.volume.block.code;
+    }
+
+    unsigned numTileRefs() const;
+    void copyTileRef(unsigned index, _SYSAssetGroupTileRef &ref) const;
+
     SysLFS::AssetGroupIdentity identity() const
     {
         SysLFS::AssetGroupIdentity result;
@@ -91,6 +107,10 @@ struct AssetGroupInfo {
         result.volume = volume.block.code;
         return result;
     }
+
+private:
+    void copyBytes(unsigned offset, uint8_t *buffer, unsigned length) const;
+    unsigned tileRefsOffset() const;
 };
 
 
@@ -104,6 +124,7 @@ class AssetFIFO {
 public:
     static const unsigned ADDRESS_SIZE = 3;
     static const unsigned CRC_QUERY_SIZE = 3;
+    static const unsigned COPY_TILES_SIZE = 4;
 
     ALWAYS_INLINE AssetFIFO(_SYSAssetLoaderCube &sys)
         : sys(sys), head(sys.head), tail(sys.tail)
@@ -117,7 +138,8 @@ public:
         ASSERT(count < _SYS_ASSETLOAD_BUF_SIZE);
     }
 
-    static unsigned fetchFromGroup(_SYSAssetLoaderCube &sys, AssetGroupInfo &group, unsigned offset);
+    static unsigned fetchFromGroup(_SYSAssetLoaderCube &sys, AssetGroupInfo &group,
+        unsigned offset, unsigned end);
 
     ALWAYS_INLINE unsigned readAvailable() const {
         return count;
@@ -166,6 +188,17 @@ public:
         write(ceildiv<unsigned>(numTiles, _SYS_ASSET_GROUP_SIZE_UNIT));
     }
 
+    ALWAYS_INLINE void writeCopyTiles(unsigned addr, unsigned numTiles)
+    {
+        // Opcode, lat1, lat2:a21, count. Source address is in tiles.
+        ASSERT(addr < 0x8000);
+        ASSERT(numTiles > 0 && numTiles <= FLS_MAX_COPY_TILES);
+        write(FLS_OP_COPY_TILES);
+        write(addr << 1);
+        write(((addr >> 6) & 0xfe) | ((addr >> 14) & 1));
+        write(numTiles);
+    }
+
     ALWAYS_INLINE void commitReads() const {
         sys.head = head;
     }
@@ -43,6 +43,7 @@ void AudioChannelSlot::play(const struct _SYSAudioModule *module, _SYSAudioLoopT
     mod = *module;
     samples.init(mod);
     offset = 0;
+    historyIndex = NO_HISTORY;
 
     // Let the module decide
     if (loopMode == _SYS_LOOP_UNDEF)
@@ -61,101 +62,215 @@ void AudioChannelSlot::play(const struct _SYSAudioModule *module, _SYSAudioLoopT
     state &= ~STATE_STOPPED;
 }
 
-bool AudioChannelSlot::mixAudio(int *buffer, uint32_t numFrames)
+ALWAYS_INLINE bool AudioChannelSlot::wrapOffset(uint64_t &localOffset, unsigned &index)
 {
     /*
-     * Add this channel's contribution to 'buffer' for
-     * 'numFrames' audio frames. If the buffer is NULL,
-     * update state without outputting any audio.
+     * Apply the loop to an offset that has reached loopEnd. Returns false
+     * if the channel has instead played to the end and stopped.
      */
 
-    // Early out if this channel is in the process of being stopped by the main thread.
-    if (state & STATE_STOPPED) {
-        #ifdef SIFTEO_SIMULATOR
-            MCAudioVisData::clearChannel(AudioMixer::instance.channelID(this));
-        #endif
-        return false;
+    const unsigned loopEnd = mod.loopEnd;           // Before first sample
+    const unsigned loopStart = mod.loopStart;       // After last sample
+
+    if (state & STATE_LOOP) {
+        localOffset -= (loopEnd - loopStart) << SAMPLE_FRAC_SIZE;
+        index = localOffset >> SAMPLE_FRAC_SIZE;
+        return true;
     }
 
-    ASSERT(numFrames > 0);
+    #ifdef SIFTEO_SIMULATOR
+        MCAudioVisData::clearChannel(AudioMixer::instance.channelID(this));
+    #endif
+
+    stop();
+    return false;
+}
+
+ALWAYS_INLINE int AudioChannelSlot::nextHistorySample(unsigned loopStart, unsigned loopEnd)
+{
+    /*
+     * Fetch the sample at historyNext and move historyNext forward, in
+     * playback order. Past the end of a one-shot sample, the input is an
+     * implied run of zeroes.
+     */
+
+    unsigned index = historyNext;
+
+    if (UNLIKELY(index >= loopEnd)) {
+        if (!(state & STATE_LOOP) || loopEnd <= loopStart)
+            return 0;
+        index = loopStart + (index - loopEnd) % (loopEnd - loopStart);
+    }
+
+    historyNext = index + 1;
+    return samples.getSample(index, mod);
+}
+
+void AudioChannelSlot::refillHistory(unsigned index, unsigned loopStart, unsigned loopEnd)
+{
+    /*
+     * Rebuild the whole window after a discontinuity: start of playback,
+     * a seek, a gap while muted, or a step larger than the window. Taps
+     * before the first sample are silent. After a jump to the loop point,
+     * the taps before loopStart come from the sample itself rather than
+     * from the end of the loop; this only happens when a whole window was
+     * skipped, where it isn't audible.
+     */
+
+    unsigned zeroes = index < AudioResampler::CENTER_TAP ? AudioResampler::CENTER_TAP - index : 0;
+    for (unsigned i = 0; i < zeroes; ++i)
+        history.push(0);
+
+    historyNext = index + zeroes - AudioResampler::CENTER_TAP;
+    for (unsigned i = zeroes; i < AudioResampler::NUM_TAPS; ++i)
+        history.push(nextHistorySample(loopStart, loopEnd));
+
+    historyIndex = index;
+}
+
+ALWAYS_INLINE void AudioChannelSlot::advanceHistory(unsigned index, unsigned loopStart, unsigned loopEnd)
+{
+    // Slide the window forward so that 'index' is at CENTER_TAP
+
+    unsigned steps = index - historyIndex;
+    if (index < historyIndex)
+        steps += loopEnd - loopStart;   // Wrapped around the loop
+
+    if (UNLIKELY(historyIndex == NO_HISTORY || steps > AudioResampler::NUM_TAPS))
+        return refillHistory(index, loopStart, loopEnd);
+
+    historyIndex = index;
+    do {
+        history.push(nextHistorySample(loopStart, loopEnd));
+    } while (--steps);
+}
+
+template <typename Filter>
+ALWAYS_INLINE unsigned AudioChannelSlot::resample(int *block, unsigned numFrames)
+{
+    /*
+     * Generate up to 'numFrames' resampled, unscaled samples into 'block'.
+     * Returns the number of samples generated, which is only short of
+     * 'numFrames' if the channel stopped.
+     */
 
     // Read from slot only once
-    const int latchedVolume = volume;
     const int latchedIncrement = increment;
-    const unsigned loopEnd = mod.loopEnd;           // Before first sample
-    const unsigned loopStart = mod.loopStart;       // After last sample
+    const unsigned loopEnd = mod.loopEnd;
+    const unsigned loopStart = mod.loopStart;
 
     // Local copy of offset, to avoid writing back to RAM every time
     uint64_t localOffset = offset;
+    unsigned count = 0;
 
     do {
         unsigned index = localOffset >> SAMPLE_FRAC_SIZE;
-        unsigned fractional = localOffset & SAMPLE_FRAC_MASK;
-
-        // Looping logic
-        if (UNLIKELY(index >= loopEnd)) {
-            if (state & STATE_LOOP) {
-                localOffset -= (loopEnd - loopStart) << SAMPLE_FRAC_SIZE;
-                index = localOffset >> SAMPLE_FRAC_SIZE;
-            } else {
-                #ifdef SIFTEO_SIMULATOR
-                    MCAudioVisData::clearChannel(AudioMixer::instance.channelID(this));
-                #endif
-
-                stop();
-                break;
-            }
-        }
-
-        // Compute the next sample
-        if (buffer) {
-            int sample;
 
-            if (!fractional) {
-                // Offset is aligned with an asset sample
-                sample = samples.getSample(index, mod);
+        if (UNLIKELY(index >= loopEnd) && !wrapOffset(localOffset, index))
+            break;
 
-            } else {
-                // At all other times, we use linear interpolation between two samples.
+        if (index != historyIndex)
+            advanceHistory(index, loopStart, loopEnd);
 
-                int next;
-
-                if (LIKELY(index + 1 < loopEnd)) {
-                    // Fast path for linear interpolation between two adjacent samples
-                    next = samples.getSamplePair(index, mod, sample);
+        block[count] = Filter::filter(history.window(), localOffset & SAMPLE_FRAC_MASK);
+        localOffset += latchedIncrement;
 
-                } else if (state & STATE_LOOP) {
-                    // Next sample is on the other side of the loop
-                    sample = samples.getSample(index, mod);
-                    next = samples.getSample(loopStart, mod);
+    } while (++count != numFrames);
 
-                } else {
-                    // Not looping. Next sample is an implied zero.
-                    sample = samples.getSample(index, mod);
-                    next = 0;
-                }
+    offset = localOffset;
+    return count;
+}
 
-                sample += ((next - sample) * int(fractional)) >> SAMPLE_FRAC_SIZE;
-            }
+void AudioChannelSlot::skip(uint32_t numFrames)
+{
+    /*
+     * Update playback position without decoding anything. The window
+     * no longer matches, so it's rebuilt when we next produce audio.
+     */
 
-            // Mix volume
-            sample = (sample * latchedVolume) >> _SYS_AUDIO_MAX_VOLUME_LOG2;
+    const int latchedIncrement = increment;
+    const unsigned loopEnd = mod.loopEnd;
+    uint64_t localOffset = offset;
 
-            #ifdef SIFTEO_SIMULATOR
-                MCAudioVisData::writeChannelSample(AudioMixer::instance.channelID(this), sample);
-            #endif
+    do {
+        unsigned index = localOffset >> SAMPLE_FRAC_SIZE;
 
-            // Mix into buffer (No need to clamp yet)
-            *buffer += sample;
-            buffer++;
-        }
+        if (UNLIKELY(index >= loopEnd) && !wrapOffset(localOffset, index))
+            break;
 
-        // Advance to the next output sample
         localOffset += latchedIncrement;
 
     } while (--numFrames);
 
     offset = localOffset;
+    historyIndex = NO_HISTORY;
+}
+
+bool AudioChannelSlot::mixAudio(int *buffer, uint32_t numFrames)
+{
+    /*
+     * Add this channel's contribution to 'buffer' for
+     * 'numFrames' audio frames. If the buffer is NULL,
+     * update state without outputting any audio.
+     *
+     * Audio is produced a block at a time: the selected resampling
+     * kernel fills a block, then a separate loop applies volume and
+     * mixes it into 'buffer'. The kernel is chosen once per block.
+     */
+
+    // Early out if this channel is in the process of being stopped by the main thread.
+    if (state & STATE_STOPPED) {
+        #ifdef SIFTEO_SIMULATOR
+            MCAudioVisData::clearChannel(AudioMixer::instance.channelID(this));
+        #endif
+        return false;
+    }
+
+    ASSERT(numFrames > 0);
+
+    if (!buffer) {
+        skip(numFrames);
+        return true;
+    }
+
+    const int latchedVolume = volume;
+    int block[BLOCK_SIZE];
+
+    do {
+        unsigned blockSize = MIN(numFrames, arraysize(block));
+        unsigned count;
+
+        switch (AudioResampler::mode) {
+            default:
+            case AudioResampler::LINEAR:
+                count = resample<AudioResampler::Linear>(block, blockSize);
+                break;
+            case AudioResampler::CUBIC:
+                count = resample<AudioResampler::Cubic>(block, blockSize);
+                break;
+            case AudioResampler::SINC:
+                count = resample<AudioResampler::Sinc>(block, blockSize);
+                break;
+        }
+
+        // Mix volume, and mix into buffer (No need to clamp yet)
+        for (unsigned i = 0; i < count; ++i) {
+            block[i] = (block[i] * latchedVolume) >> _SYS_AUDIO_MAX_VOLUME_LOG2;
+            buffer[i] += block[i];
+        }
+
+        #ifdef SIFTEO_SIMULATOR
+            for (unsigned i = 0; i < count; ++i)
+                MCAudioVisData::writeChannelSample(AudioMixer::instance.channelID(this), block[i]);
+        #endif
+
+        if (count != blockSize)
+            break;
+
+        buffer += blockSize;
+        numFrames -= blockSize;
+
+    } while (numFrames);
 
     return true;
 }
@@ -172,4 +287,5 @@ void AudioChannelSlot::setPos(uint32_t ofs)
     }
 
     offset = ofs << SAMPLE_FRAC_SIZE;
+    historyIndex = NO_HISTORY;
 }
@@ -30,14 +30,12 @@
 #include <stdint.h>
 #include "machine.h"
 #include "audiosampledata.h"
-
-// Fixed-point math offsets
-#define SAMPLE_FRAC_SIZE 12
-#define SAMPLE_FRAC_MASK ((1 << SAMPLE_FRAC_SIZE) - 1)
+#include "audioresampler.h"
 
 class AudioChannelSlot {
 public:
     AudioChannelSlot() :
+        historyIndex(NO_HISTORY),
         state(STATE_STOPPED)
     {}
 
@@ -85,11 +83,26 @@ protected:
     friend class AudioMixer;    // mixer can tell us to mixAudio()
 
 private:
+    template <typename Filter>
+    unsigned resample(int *block, unsigned numFrames);
+    void skip(uint32_t numFrames);
+
+    bool wrapOffset(uint64_t &localOffset, unsigned &index);
+    int nextHistorySample(unsigned loopStart, unsigned loopEnd);
+    void advanceHistory(unsigned index, unsigned loopStart, unsigned loopEnd);
+    void refillHistory(unsigned index, unsigned loopStart, unsigned loopEnd);
+
     static const int STATE_PAUSED   = (1 << 0);
     static const int STATE_LOOP     = (1 << 1);
     static const int STATE_STOPPED  = (1 << 2);
 
+    static const unsigned BLOCK_SIZE = 32;
+    static const uint32_t NO_HISTORY = 0xFFFFFFFF;
+
     uint64_t offset;
+    uint32_t historyIndex;      // Sample index at the window's CENTER_TAP, or NO_HISTORY
+    uint32_t historyNext;       // Sample index of the next sample to push
+    AudioResampler::History history;
     int32_t increment;
     int16_t volume;
     uint8_t state;
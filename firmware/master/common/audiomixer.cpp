@@ -56,11 +56,18 @@ AudioMixer::AudioMixer() :
     trackerCallbackInterval(0),
     trackerCallbackCountdown(0),
     playingChannelMask(0),
-    numSilentSamples(output.capacity() + 1)
+    numSilentSamples(output.capacity() + 1),
+    lastUnderruns(0),
+    starved(false)
 {
     // Fill the buffer with silence
     output.fill(AudioOutDevice::getSampleBias());
 
+    memset(&counters, 0, sizeof counters);
+    counters.fillTarget = output.capacity();
+    counters.minFill = output.capacity();
+    resetWaterMark();
+
     ASSERT(outputBufferIsSilent());
 }
 
@@ -72,6 +79,10 @@ void AudioMixer::init()
 
     output.init();
 
+    // Fill level extremes are per-game; the running totals are not.
+    counters.minFill = output.capacity();
+    counters.maxLatency = 0;
+
     uint32_t mask = playingChannelMask;
     while (mask) {
         unsigned idx = Intrinsic::CLZ(mask);
@@ -90,6 +101,50 @@ void AudioMixer::init()
     XmTrackerPlayer::instance.init();
 }
 
+void AudioMixer::resetWaterMark()
+{
+    lowWaterMark = output.capacity();
+    lowWaterStart = counters.mixedSamples;
+}
+
+void AudioMixer::adaptFillTarget(unsigned fillLevel)
+{
+    /*
+     * Called just before each mix, with the number of samples still
+     * waiting to be played. This is the slack we had left: if the
+     * AudioPull task had been delayed by that many more samples, the
+     * output would have run dry.
+     *
+     * Any underrun since last time means our target was too optimistic,
+     * so we back off quickly. Otherwise, once per FILL_ADAPT_SAMPLES,
+     * we give back half of whatever slack we never needed.
+     */
+
+    if (fillLevel < counters.minFill)
+        counters.minFill = fillLevel;
+    if (fillLevel < lowWaterMark)
+        lowWaterMark = fillLevel;
+
+    uint32_t underruns = counters.underruns;
+    if (underruns != lastUnderruns) {
+        lastUnderruns = underruns;
+        counters.fillTarget = MIN(counters.fillTarget * 2, output.capacity());
+        resetWaterMark();
+        return;
+    }
+
+    if (counters.mixedSamples - lowWaterStart < FILL_ADAPT_SAMPLES)
+        return;
+
+    if (lowWaterMark > FILL_MARGIN) {
+        unsigned excess = (lowWaterMark - FILL_MARGIN) / 2;
+        unsigned target = counters.fillTarget;
+        counters.fillTarget = target > excess + MIN_FILL_TARGET
+            ? target - excess : MIN_FILL_TARGET;
+    }
+    resetWaterMark();
+}
+
 ALWAYS_INLINE bool AudioMixer::mixAudio(int *buffer, uint32_t numFrames)
 {
     /*
@@ -196,12 +251,18 @@ void AudioMixer::pullAudio()
      * there's no buffer attached or no space in that buffer. We'll
      * either discard the mixed data, or if a waveout file is set we'll
      * end up logging the mixed audio data.
+     *
+     * Session recording also paces the mixer with a virtual clock, so
+     * it runs exactly as it will on replay. If there's an audio device,
+     * it gets whatever fits in its buffer.
      */
 
     #ifdef SIFTEO_SIMULATOR
         const bool headless = SystemMC::getSystem()->opt_headless;
+        const bool virtualClock = SystemMC::hasVirtualAudioClock();
     #else
         const bool headless = false;
+        const bool virtualClock = false;
     #endif
 
     AudioMixer &mixer = AudioMixer::instance;
@@ -210,14 +271,14 @@ void AudioMixer::pullAudio()
      * Early out when we can quickly determine that no channels are playing
      * and the tracker is idle.
      *
-     * Note that in headless mode, we have no audio driver to wake up our
-     * task, we're polling based on wallclock time: so we constantly re-trigger
+     * Note that with a virtual clock, we aren't woken by the audio driver,
+     * we're polling based on virtual time: so we constantly re-trigger
      * our own task. In other modes, we do NOT do this. We only wake up when
      * the audio driver has dequeued some samples.
      */
 
     #ifdef SIFTEO_SIMULATOR
-        if (headless) {
+        if (virtualClock) {
             Tasks::trigger(Tasks::AudioPull);
         }
     #endif
@@ -255,10 +316,12 @@ void AudioMixer::pullAudio()
      */
 
     int blockBuffer[32];
-    unsigned samplesLeft = output.writeAvailable();
+    unsigned fillLevel = output.readAvailable();
+    unsigned fillTarget = mixer.counters.fillTarget;
+    unsigned samplesLeft = fillLevel < fillTarget ? fillTarget - fillLevel : 0;
 
     #ifdef SIFTEO_SIMULATOR
-        if (headless) {
+        if (virtualClock) {
             samplesLeft = SystemMC::suggestAudioSamplesToMix();
         }
     #endif
@@ -273,8 +336,14 @@ void AudioMixer::pullAudio()
     #ifndef SIFTEO_SIMULATOR
         SampleProfiler::SubSystem s = SampleProfiler::subsystem();
         SampleProfiler::setSubsystem(SampleProfiler::AudioPull);
+    #else
+        // Measures mixer cost for --render-audio
+        SystemMC::MixTimer mixTimer;
     #endif
 
+    if (!virtualClock)
+        mixer.adaptFillTarget(fillLevel);
+
     const uint32_t trackerInterval = mixer.trackerCallbackInterval;
     uint32_t trackerCountdown;
 
@@ -382,7 +451,7 @@ void AudioMixer::pullAudio()
              */
 
             #ifdef SIFTEO_SIMULATOR
-            if (!headless) {
+            if (!headless && !(virtualClock && output.full())) {
                 if (!endOfStreamSet) {
                     output.enqueue(AudioOutDevice::END_OF_STREAM);
                     endOfStreamSet = true;
@@ -398,6 +467,7 @@ void AudioMixer::pullAudio()
 
         trackerCountdown -= blockSize;
         samplesLeft -= blockSize;
+        mixer.counters.mixedSamples += blockSize;
         if (!mixed) {
             mixer.numSilentSamples += blockSize;
         }
@@ -428,7 +498,7 @@ void AudioMixer::pullAudio()
                 SystemMC::logAudioSamples(&sample16, 1);
             #endif
 
-            if (!headless) {
+            if (!headless && !(virtualClock && output.full())) {
                 output.enqueue(sample16 + sampleBias);
             }
 
@@ -447,6 +517,15 @@ void AudioMixer::pullAudio()
         mixer.trackerCallbackCountdown = trackerCountdown;
     }
 
+    if (!headless) {
+        // Anything we queued after an underrun has ended that episode
+        mixer.starved = false;
+
+        unsigned latency = output.readAvailable();
+        if (latency > mixer.counters.maxLatency)
+            mixer.counters.maxLatency = latency;
+    }
+
     // Give the output a chance to dequeue data immediately (Only used on Siftulator)
     if (!headless)
         AudioOutDevice::pullFromMixer();
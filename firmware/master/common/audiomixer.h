@@ -101,6 +101,23 @@ public:
         return slot - &channelSlots[0];
     }
 
+    ALWAYS_INLINE const _SYSAudioCounters *getCounters() const {
+        return &counters;
+    }
+
+    /*
+     * Called by the output device's consumer when it finds no data to
+     * play. Counts one underrun per episode, and only while the mixer
+     * is producing audio; draining the buffer after the last sound has
+     * finished is expected. Safe to call from an ISR.
+     */
+    ALWAYS_INLINE void outputStarved() {
+        if (!starved && !outputBufferIsSilent()) {
+            starved = true;
+            Atomic::Add(counters.underruns, 1);
+        }
+    }
+
 protected:
     friend class XmTrackerPlayer; // can call setTrackerCallbackInterval()
     void setTrackerCallbackInterval(uint32_t usec);
@@ -110,6 +127,17 @@ private:
     static const int FADE_MASK = 0xfffffff8;
     static const int FADE_TEST = 0x7;
 
+    /*
+     * Adaptive output buffering. We try to keep only enough audio queued
+     * to cover the longest gap we've seen between AudioPull tasks, plus
+     * FILL_MARGIN. If the lowest fill level stays above the margin for
+     * FILL_ADAPT_SAMPLES, the target shrinks by half the excess. Each
+     * underrun doubles it, up to the full buffer.
+     */
+    static const unsigned FILL_MARGIN = SAMPLE_HZ / 125;            // 8 ms
+    static const unsigned FILL_ADAPT_SAMPLES = SAMPLE_HZ * 4;
+    static const unsigned MIN_FILL_TARGET = 64;
+
     int lastSample;
     int fadeStep;
 
@@ -120,11 +148,20 @@ private:
     uint32_t playingChannelMask;    // channels that are actively playing
     uint32_t numSilentSamples;      // Number of samples in 'output' guaranteed to be silent
 
+    _SYSAudioCounters counters;
+    uint32_t lastUnderruns;         // counters.underruns, as of the last fill target update
+    uint32_t lowWaterMark;          // Lowest fill level since lowWaterStart
+    uint32_t lowWaterStart;         // counters.mixedSamples when lowWaterMark was reset
+    bool starved;                   // Output has underrun since we last mixed
+
     AudioChannelSlot channelSlots[_SYS_AUDIO_MAX_CHANNELS];
 
     bool mixAudio(int *buffer, uint32_t numFrames);
 
     static int softLimiter(int32_t sample);
+
+    void adaptFillTarget(unsigned fillLevel);
+    void resetWaterMark();
 };
 
 #endif /* AUDIOMIXER_H_ */
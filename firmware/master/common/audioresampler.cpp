@@ -0,0 +1,175 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Thundercracker firmware
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "audioresampler.h"
+#include "audiomixer.h"
+#include <string.h>
+
+#ifdef SIFTEO_SIMULATOR
+#   include "ostime.h"
+#else
+#   include "systime.h"
+#endif
+
+#define LGPFX "AudioResampler: "
+
+// Lookup tables generated by tools/firmware-resampler-table.py
+#include "resampler-table.def"
+
+
+AudioResampler::Mode AudioResampler::mode = AudioResampler::LINEAR;
+
+static const char * const modeNames[] = { "linear", "cubic", "sinc" };
+
+
+const char *AudioResampler::modeName(Mode m)
+{
+    STATIC_ASSERT(arraysize(modeNames) == NUM_MODES);
+    ASSERT(unsigned(m) < NUM_MODES);
+    return modeNames[m];
+}
+
+bool AudioResampler::parseMode(const char *name, Mode &m)
+{
+    for (unsigned i = 0; i < NUM_MODES; ++i)
+        if (!strcmp(name, modeNames[i])) {
+            m = Mode(i);
+            return true;
+        }
+    return false;
+}
+
+namespace {
+
+    /*
+     * Benchmark parameters. The input is a power of two so it can loop
+     * with a mask, and small enough to live on the stack. The pitch ratio
+     * is a typical tracker note a fifth above the sample's base pitch.
+     */
+    const unsigned kBenchInputSize = 256;
+    const unsigned kBenchOutputSize = AudioMixer::SAMPLE_HZ;
+    const unsigned kBenchBlockSize = 32;
+    const uint32_t kBenchIncrement = (3 << SAMPLE_FRAC_SIZE) / 2;
+
+    #ifdef SIFTEO_SIMULATOR
+        typedef double BenchTime;
+        ALWAYS_INLINE BenchTime benchNow() { return OSTime::clock(); }
+        ALWAYS_INLINE double benchNanoseconds(BenchTime t) { return t * 1e9; }
+    #else
+        typedef SysTime::Ticks BenchTime;
+        ALWAYS_INLINE BenchTime benchNow() { return SysTime::ticks(); }
+        ALWAYS_INLINE uint32_t benchNanoseconds(BenchTime t) { return t / SysTime::nsTicks(1); }
+    #endif
+
+    /*
+     * Same inner loop as AudioChannelSlot::resample(), minus the sample
+     * cache and loop handling.
+     */
+    template <typename Filter>
+    BenchTime benchmarkFilter(const int16_t *input, int &checksum)
+    {
+        AudioResampler::History history;
+        int block[kBenchBlockSize];
+        unsigned historyIndex = 0;
+        unsigned next = 0;
+        uint32_t offset = 0;
+
+        for (unsigned i = 0; i < AudioResampler::NUM_TAPS; ++i)
+            history.push(input[next++]);
+
+        BenchTime start = benchNow();
+
+        for (unsigned n = 0; n < kBenchOutputSize; n += kBenchBlockSize) {
+            for (unsigned i = 0; i < kBenchBlockSize; ++i) {
+                unsigned index = offset >> SAMPLE_FRAC_SIZE;
+                while (historyIndex != index) {
+                    history.push(input[next++ & (kBenchInputSize - 1)]);
+                    historyIndex++;
+                }
+                block[i] = Filter::filter(history.window(), offset & SAMPLE_FRAC_MASK);
+                offset += kBenchIncrement;
+            }
+
+            for (unsigned i = 0; i < kBenchBlockSize; ++i)
+                checksum += block[i];
+        }
+
+        return benchNow() - start;
+    }
+
+    #ifndef SIFTEO_SIMULATOR
+    void uartDecimal(uint32_t value)
+    {
+        char buf[11];
+        char *p = &buf[sizeof buf - 1];
+        *p = '\0';
+        do {
+            *--p = '0' + value % 10;
+            value /= 10;
+        } while (value);
+        UART(p);
+    }
+    #endif
+
+}
+
+void AudioResampler::benchmark()
+{
+    STATIC_ASSERT((kBenchInputSize & (kBenchInputSize - 1)) == 0);
+    STATIC_ASSERT((kBenchOutputSize % kBenchBlockSize) == 0);
+
+    // Noise is as good as anything; the kernels have no data-dependent branches
+    int16_t input[kBenchInputSize];
+    uint32_t seed = 0x12345678;
+    for (unsigned i = 0; i < kBenchInputSize; ++i) {
+        seed = seed * 1664525 + 1013904223;
+        input[i] = int16_t((seed >> 16) - 0x8000);
+    }
+
+    int checksum = 0;
+    BenchTime times[NUM_MODES];
+    times[LINEAR] = benchmarkFilter<Linear>(input, checksum);
+    times[CUBIC] = benchmarkFilter<Cubic>(input, checksum);
+    times[SINC] = benchmarkFilter<Sinc>(input, checksum);
+
+    for (unsigned m = 0; m < NUM_MODES; ++m) {
+        #ifdef SIFTEO_SIMULATOR
+            LOG((LGPFX "%-6s %7.2f ns per sample (host)\n", modeName(Mode(m)),
+                benchNanoseconds(times[m]) / kBenchOutputSize));
+        #else
+            // The Cortex-M3 runs at 72 MHz; report whole cycles per sample
+            uint32_t cycles = uint64_t(benchNanoseconds(times[m])) * 72 / 1000;
+            UART(LGPFX);
+            UART(modeName(Mode(m)));
+            UART(": ");
+            uartDecimal((cycles + kBenchOutputSize / 2) / kBenchOutputSize);
+            UART(" cycles per sample\r\n");
+        #endif
+    }
+
+    // Keep the compiler from discarding the work
+    static volatile int sink;
+    sink = checksum;
+}
@@ -0,0 +1,140 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Thundercracker firmware
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef AUDIORESAMPLER_H_
+#define AUDIORESAMPLER_H_
+
+#include <stdint.h>
+#include "macros.h"
+
+// Fixed-point math offsets
+#define SAMPLE_FRAC_SIZE 12
+#define SAMPLE_FRAC_MASK ((1 << SAMPLE_FRAC_SIZE) - 1)
+
+
+/*
+ * Interpolation kernels for AudioChannelSlot.
+ *
+ * Each channel keeps a short window of input samples around its current
+ * position, in playback order (so a loop point is already unrolled by
+ * the time a kernel sees it). A kernel turns that window plus the
+ * fractional part of the channel's offset into one output sample.
+ *
+ * The cubic and sinc kernels are polyphase: the fractional position is
+ * quantized to one of NUM_PHASES rows in a precomputed table of Q14
+ * coefficients, and the output is a plain dot product. On the Cortex-M3
+ * that is a chain of MLA instructions; on the simulator the fixed-length
+ * loops are left for the compiler to unroll and vectorize.
+ *
+ * The tables are generated by tools/firmware-resampler-table.py.
+ */
+
+class AudioResampler {
+public:
+    enum Mode {
+        LINEAR,         // 2 taps, the cheapest; matches the original mixer exactly
+        CUBIC,          // 4-tap Catmull-Rom spline
+        SINC,           // 8-tap Kaiser-windowed sinc, lowpass at 0.85 Nyquist
+        NUM_MODES
+    };
+
+    static const unsigned NUM_TAPS = 8;         // Window size; enough for the widest kernel
+    static const unsigned CENTER_TAP = 3;       // Window index of the sample at the current offset
+    static const unsigned CUBIC_TAPS = 4;
+    static const unsigned PHASE_BITS = 6;
+    static const unsigned NUM_PHASES = 1 << PHASE_BITS;
+    static const unsigned COEFF_BITS = 14;
+
+    // Kernel used by all channels. Read once per mixed block.
+    static Mode mode;
+
+    static const char *modeName(Mode m);
+    static bool parseMode(const char *name, Mode &m);
+
+    /*
+     * Time each kernel over a synthetic signal in RAM, and report the
+     * cost per output sample. Flash and ADPCM costs are deliberately
+     * left out; those don't depend on the mode.
+     */
+    static void benchmark();
+
+    /*
+     * The input window, as a ring buffer that is always readable as one
+     * contiguous array. Every sample is stored twice, NUM_TAPS apart, so
+     * window() can hand out oldest-to-newest without wrapping.
+     */
+    class History {
+    public:
+        History() : pos(0) {}
+
+        ALWAYS_INLINE void push(int sample) {
+            buffer[pos] = buffer[pos + NUM_TAPS] = sample;
+            pos = (pos + 1) & (NUM_TAPS - 1);
+        }
+
+        ALWAYS_INLINE const int16_t *window() const {
+            return &buffer[pos];
+        }
+
+    private:
+        int16_t buffer[NUM_TAPS * 2];
+        uint8_t pos;
+    };
+
+    struct Linear {
+        static ALWAYS_INLINE int filter(const int16_t *window, unsigned fractional) {
+            const int16_t *s = window + CENTER_TAP;
+            int sample = s[0];
+            return sample + (((s[1] - sample) * int(fractional)) >> SAMPLE_FRAC_SIZE);
+        }
+    };
+
+    struct Cubic {
+        static ALWAYS_INLINE int filter(const int16_t *window, unsigned fractional) {
+            const int16_t *s = window + CENTER_TAP - 1;
+            const int16_t *c = cubicTable[fractional >> (SAMPLE_FRAC_SIZE - PHASE_BITS)];
+            int acc = 1 << (COEFF_BITS - 1);
+            for (unsigned i = 0; i < CUBIC_TAPS; ++i)
+                acc += s[i] * c[i];
+            return acc >> COEFF_BITS;
+        }
+    };
+
+    struct Sinc {
+        static ALWAYS_INLINE int filter(const int16_t *window, unsigned fractional) {
+            const int16_t *c = sincTable[fractional >> (SAMPLE_FRAC_SIZE - PHASE_BITS)];
+            int acc = 1 << (COEFF_BITS - 1);
+            for (unsigned i = 0; i < NUM_TAPS; ++i)
+                acc += window[i] * c[i];
+            return acc >> COEFF_BITS;
+        }
+    };
+
+    // Generated tables, in resampler-table.def
+    static const int16_t cubicTable[NUM_PHASES][CUBIC_TAPS];
+    static const int16_t sincTable[NUM_PHASES][NUM_TAPS];
+};
+
+#endif /* AUDIORESAMPLER_H_ */
@@ -73,6 +73,13 @@ public:
 
     static void unpair(_SYSCubeID cid);
 
+    // Radio scheduling hint: Are we partway through connecting a cube?
+    static ALWAYS_INLINE bool isHandshaking() {
+        return txState != PairingFirstContact &&
+               txState != ReconnectFirstContact &&
+               txState != ReconnectAltFirstContact;
+    }
+
     // Callback for Tasks::CubeConnector
     static void task();
 
@@ -0,0 +1,143 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Thundercracker firmware
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "elfsymbolindex.h"
+#include <cxxabi.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+
+
+void ELFSymbolIndex::clear()
+{
+    entries.clear();
+    names.clear();
+    demangledNames.clear();
+}
+
+void ELFSymbolIndex::build(const Elf::Symbol *symbols, unsigned numSymbols,
+    const char *strtab, unsigned strtabSize)
+{
+    clear();
+
+    // Symbols usually share names with other symbols; store each string once.
+    std::map<uint32_t, uint32_t> nameIndex;
+
+    for (unsigned i = 0; i < numSymbols; ++i) {
+        Entry e;
+        e.symbol = symbols[i];
+        e.order = i;
+
+        // Zero-sized symbols can never contain an address
+        if (e.symbol.st_size == 0)
+            continue;
+
+        // Strip the Thumb bit from function symbols.
+        if ((e.symbol.st_info & 0xF) == Elf::STT_FUNC)
+            e.symbol.st_value &= ~1;
+
+        std::map<uint32_t, uint32_t>::iterator I = nameIndex.find(e.symbol.st_name);
+        if (I == nameIndex.end()) {
+            std::string name;
+            uint32_t offset = e.symbol.st_name;
+            if (offset < strtabSize) {
+                const char *str = strtab + offset;
+                const char *end = (const char*) memchr(str, 0, strtabSize - offset);
+                name.assign(str, end ? end : strtab + strtabSize);
+            }
+
+            I = nameIndex.insert(std::make_pair(offset, uint32_t(names.size()))).first;
+            names.push_back(name);
+            demangle(name);
+            demangledNames.push_back(name);
+        }
+        e.name = I->second;
+
+        entries.push_back(e);
+    }
+
+    std::sort(entries.begin(), entries.end());
+
+    // Running maximum of end addresses, so lookups know when to stop.
+    uint32_t maxEnd = 0;
+    for (unsigned i = 0, e = entries.size(); i != e; ++i) {
+        const Elf::Symbol &sym = entries[i].symbol;
+        uint32_t end = sym.st_value + sym.st_size;
+        if (end < sym.st_value)
+            end = 0xFFFFFFFF;
+        maxEnd = std::max(maxEnd, end);
+        entries[i].maxEnd = maxEnd;
+    }
+}
+
+bool ELFSymbolIndex::find(uint32_t address, Elf::Symbol &symbol,
+    const std::string *&name, const std::string *&demangledName) const
+{
+    /*
+     * The best match is the enclosing symbol that starts closest to
+     * 'address', with ties going to whichever came first in .symtab.
+     * Walk backwards from the last entry starting at or before the
+     * address, until no earlier entry could reach it.
+     */
+
+    Entry key;
+    key.symbol.st_value = address;
+    key.order = 0xFFFFFFFF;
+
+    std::vector<Entry>::const_iterator I = std::upper_bound(entries.begin(), entries.end(), key);
+    const Entry *best = 0;
+
+    while (I != entries.begin()) {
+        --I;
+        if (I->maxEnd <= address)
+            break;
+        if (best && I->symbol.st_value != best->symbol.st_value)
+            break;
+        if (I->contains(address))
+            best = &*I;
+    }
+
+    if (!best)
+        return false;
+
+    symbol = best->symbol;
+    name = &names[best->name];
+    demangledName = &demangledNames[best->name];
+    return true;
+}
+
+void ELFSymbolIndex::demangle(std::string &name)
+{
+    // This uses the demangler built into GCC's libstdc++.
+    // It uses the same name mangling style as clang.
+
+    int status;
+    char *result = abi::__cxa_demangle(name.c_str(), 0, 0, &status);
+    if (status == 0) {
+        name = result;
+        free(result);
+    }
+}
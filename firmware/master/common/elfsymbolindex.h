@@ -0,0 +1,85 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Thundercracker firmware
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef ELF_SYMBOL_INDEX_H
+#define ELF_SYMBOL_INDEX_H
+
+#include "elfdefs.h"
+#include <vector>
+#include <string>
+
+/**
+ * Address-to-symbol lookup table for host-side debug tools.
+ *
+ * Built in one pass over an ELF's .symtab and .strtab, this keeps the
+ * symbols with a nonzero size sorted by start address. A lookup is a
+ * binary search followed by a short backwards walk, which finds the
+ * same symbol that a linear scan for the nearest enclosing symbol would.
+ *
+ * Names are interned by their .strtab offset, and demangled once when
+ * the index is built, so formatting an address never touches the ELF.
+ *
+ * Not part of the firmware build.
+ */
+
+class ELFSymbolIndex {
+public:
+    void clear();
+    void build(const Elf::Symbol *symbols, unsigned numSymbols,
+        const char *strtab, unsigned strtabSize);
+
+    bool empty() const {
+        return entries.empty();
+    }
+
+    bool find(uint32_t address, Elf::Symbol &symbol,
+        const std::string *&name, const std::string *&demangledName) const;
+
+    static void demangle(std::string &name);
+
+private:
+    struct Entry {
+        Elf::Symbol symbol;     // With the Thumb bit already removed
+        uint32_t order;         // Position in .symtab, to break ties
+        uint32_t maxEnd;        // Highest end address of this or any earlier entry
+        uint32_t name;          // Index into 'names' and 'demangledNames'
+
+        bool operator< (const Entry &other) const {
+            if (symbol.st_value != other.symbol.st_value)
+                return symbol.st_value < other.symbol.st_value;
+            return order < other.order;
+        }
+
+        bool contains(uint32_t address) const {
+            return address - symbol.st_value < symbol.st_size;
+        }
+    };
+
+    std::vector<Entry> entries;
+    std::vector<std::string> names;
+    std::vector<std::string> demangledNames;
+};
+
+#endif // ELF_SYMBOL_INDEX_H
@@ -34,6 +34,8 @@ uint8_t FlashBlock::mem[NUM_CACHE_BLOCKS][BLOCK_SIZE] BLOCK_ALIGN;
 FlashBlock FlashBlock::instances[NUM_CACHE_BLOCKS];
 uint8_t FlashBlock::validCodeBundles[NUM_CACHE_BLOCKS];
 unsigned FlashBlock::latestStamp;
+uint32_t FlashBlock::preloadQueue[PRELOAD_QUEUE_SIZE];
+unsigned FlashBlock::preloadCount;
 
 
 void FlashBlock::init()
@@ -47,6 +49,8 @@ void FlashBlock::init()
         instances[i].idByte = i;
     }
 
+    preloadCount = 0;
+
     FLASHLAYER_STATS_ONLY(resetStats());
 }
 
@@ -150,6 +154,30 @@ ALWAYS_INLINE FlashBlock *FlashBlock::lookupBlock(uint32_t blockAddr)
     return 0;
 }
 
+FlashBlock *FlashBlock::findStaleBlock(uint32_t blockAddr)
+{
+    /*
+     * Look for a block that is both unreferenced and stale, starting at
+     * the block which is directly mapped to the requested address.
+     * Returns 0 if every unreferenced block was used recently.
+     */
+
+    FlashBlock *ptr = &instances[(blockAddr >> BLOCK_SIZE_LOG2) % NUM_CACHE_BLOCKS];
+    unsigned count = NUM_CACHE_BLOCKS;
+    const unsigned ageThreshold = NUM_CACHE_BLOCKS * 2;
+    unsigned localLatestStamp = latestStamp;
+
+    do {
+        if (ptr->refCount == 0 && (ptr->address == INVALID_ADDRESS
+                || ptr->getAge(localLatestStamp) >= ageThreshold))
+            return ptr;
+        if (++ptr == &instances[NUM_CACHE_BLOCKS])
+            ptr = &instances[0];
+    } while (--count);
+
+    return 0;
+}
+
 FlashBlock *FlashBlock::recycleBlock(uint32_t blockAddr)
 {
     /*
@@ -162,20 +190,8 @@ FlashBlock *FlashBlock::recycleBlock(uint32_t blockAddr)
      */
 
     // First pass: Look for something both unreferenced and stale
-    {
-        FlashBlock *ptr = &instances[(blockAddr >> BLOCK_SIZE_LOG2) % NUM_CACHE_BLOCKS];
-        unsigned count = NUM_CACHE_BLOCKS;
-        const unsigned ageThreshold = NUM_CACHE_BLOCKS * 2;
-        unsigned localLatestStamp = latestStamp;
-
-        do {
-            if (ptr->refCount == 0 && (ptr->address == INVALID_ADDRESS
-                    || ptr->getAge(localLatestStamp) >= ageThreshold))
-                return ptr;
-            if (++ptr == &instances[NUM_CACHE_BLOCKS])
-                ptr = &instances[0];
-        } while (--count);
-    }
+    if (FlashBlock *stale = findStaleBlock(blockAddr))
+        return stale;
 
     // Second pass: Give up on finding a stale block, just look for anything unreferenced
     {
@@ -412,5 +428,59 @@ void FlashBlockWriter::relocate(uint32_t blockAddr)
 
 void FlashBlock::preload(uint32_t blockAddr)
 {
-    // XXX: Implement me
+    /*
+     * Queue a block to be read into the cache the next time the main
+     * thread is idle. Flash reads are synchronous, so this is only a win
+     * if we can do the read while we'd otherwise be waiting for an
+     * interrupt. If the queue is full, the oldest request is dropped;
+     * newer hints are more likely to still be relevant.
+     */
+
+    blockAddr &= ~BLOCK_MASK;
+
+    for (unsigned i = 0; i < preloadCount; ++i)
+        if (preloadQueue[i] == blockAddr)
+            return;
+
+    if (lookupBlock(blockAddr))
+        return;
+
+    if (preloadCount == PRELOAD_QUEUE_SIZE) {
+        memmove(&preloadQueue[0], &preloadQueue[1],
+            sizeof preloadQueue[0] * (PRELOAD_QUEUE_SIZE - 1));
+        preloadCount--;
+    }
+
+    preloadQueue[preloadCount++] = blockAddr;
+}
+
+bool FlashBlock::servicePreload()
+{
+    /*
+     * Called from Tasks::idle(). Load at most one queued block, newest
+     * first. Returns 'true' if we did a flash read.
+     *
+     * A preload is purely speculative, so it may only replace a stale
+     * block. We never evict anything from the working set, and we never
+     * wait on a flash device that's busy with an erase or write.
+     */
+
+    while (preloadCount) {
+        if (FlashDevice::busy())
+            return false;
+
+        uint32_t blockAddr = preloadQueue[--preloadCount];
+        if (lookupBlock(blockAddr))
+            continue;
+
+        FlashBlock *recycled = findStaleBlock(blockAddr);
+        if (!recycled)
+            return false;
+
+        recycled->load(blockAddr);
+        recycled->stamp = ++latestStamp;
+        return true;
+    }
+
+    return false;
 }
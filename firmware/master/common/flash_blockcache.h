@@ -71,6 +71,9 @@ public:
     // Special address for anonymous blocks
     static const uint32_t INVALID_ADDRESS = (uint32_t)-1;
 
+    // Outstanding preload() requests, serviced while idle
+    static const unsigned PRELOAD_QUEUE_SIZE = 4;
+
     /// Flags
     enum {
         F_KNOWN_ERASED  = (1 << 0),      // Contents known to be erased
@@ -112,6 +115,9 @@ private:
     // Stored out-of-line, to keep the main FlashBlock length a power-of-two
     static uint8_t validCodeBundles[NUM_CACHE_BLOCKS];
 
+    static uint32_t preloadQueue[PRELOAD_QUEUE_SIZE];
+    static unsigned preloadCount;
+
 public:
     ALWAYS_INLINE unsigned id() const {
         return idByte;
@@ -167,6 +173,7 @@ public:
 
     // Cached block accessors
     static void preload(uint32_t blockAddr);
+    static bool servicePreload();
     static void get(FlashBlockRef &ref, uint32_t blockAddr, unsigned flags = 0);
 
     // Support for anonymous memory
@@ -205,6 +212,7 @@ private:
     }
 
     static FlashBlock *lookupBlock(uint32_t blockAddr);
+    static FlashBlock *findStaleBlock(uint32_t blockAddr);
     static FlashBlock *recycleBlock(uint32_t blockAddr);
     void load(uint32_t blockAddr, unsigned flags = 0);
 };
@@ -566,7 +566,7 @@ uint32_t FlashVolume::signHandle(uint32_t h)
     return b.code | (Crc32::get() & 0xFFFFFF00);
 }
 
-bool FlashVolumeWriter::beginGame(unsigned payloadBytes, const char *package)
+bool FlashVolumeWriter::beginGame(unsigned payloadBytes, const char *package, FlashVolume keep)
 {
     /**
      * Start writing a game, after deleting any existing game volumes with
@@ -580,7 +580,7 @@ bool FlashVolumeWriter::beginGame(unsigned payloadBytes, const char *package)
 
     vi.begin();
     while (vi.next(vol)) {
-        if (vol.getType() != FlashVolume::T_GAME)
+        if (vol.getType() != FlashVolume::T_GAME || vol.block.code == keep.block.code)
             continue;
 
         FlashBlockRef ref;
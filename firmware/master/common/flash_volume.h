@@ -221,9 +221,12 @@ public:
 
     /**
      * Start writing a game, after deleting any existing game volumes with
-     * the same package name.
+     * the same package name. If 'keep' is a valid volume, it is left alone
+     * so that its payload can be reused; the caller is responsible for
+     * deleting it after commit().
      */
-    bool beginGame(unsigned payloadBytes, const char *package);
+    bool beginGame(unsigned payloadBytes, const char *package,
+        FlashVolume keep = FlashMapBlock::invalid());
 
     /**
      * Start writing the launcher, after deleting any existing launcher.
@@ -1,6 +1,6 @@
 /* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
  *
- * swiss - your Sifteo utility knife
+ * Thundercracker firmware
  *
  * Copyright <c> 2012 Sifteo, Inc.
  *
@@ -41,25 +41,35 @@
 #include <string.h>
 #include "macros.h"
 
-int MappedFile::map(const char *path)
+bool MappedFile::map(const char *path)
 {
+    /*
+     * Map an existing file, read-only. Returns false if the file can't
+     * be opened, or if it's empty (there's nothing to map).
+     */
+
+    unmap();
+
 #ifdef WIN32
 
-    HANDLE fh = CreateFile(path, GENERIC_READ | GENERIC_WRITE,
-        FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_ALWAYS,
-        FILE_ATTRIBUTE_NORMAL, NULL);
+    HANDLE fh = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
     if (fh == INVALID_HANDLE_VALUE)
         return false;
 
     unsigned sz = GetFileSize(fh, NULL);
+    if (sz == 0 || sz == INVALID_FILE_SIZE) {
+        CloseHandle(fh);
+        return false;
+    }
 
-    HANDLE mh = CreateFileMapping(fh, NULL, PAGE_READWRITE, 0, sz, NULL);
+    HANDLE mh = CreateFileMapping(fh, NULL, PAGE_READONLY, 0, sz, NULL);
     if (mh == NULL) {
         CloseHandle(fh);
         return false;
     }
 
-    LPVOID mapping = MapViewOfFile(mh, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, sz);
+    LPVOID mapping = MapViewOfFile(mh, FILE_MAP_READ, 0, 0, sz);
     if (mapping == NULL) {
         CloseHandle(mh);
         CloseHandle(fh);
@@ -73,10 +83,10 @@ int MappedFile::map(const char *path)
 
 #else
 
-    int fh = open(path, O_RDWR | O_CREAT, 0777);
+    int fh = open(path, O_RDONLY);
     struct stat st;
 
-    if (fh < 0 || fstat(fh, &st)) {
+    if (fh < 0 || fstat(fh, &st) || st.st_size == 0) {
         if (fh >= 0)
             close(fh);
         return false;
@@ -84,7 +94,7 @@ int MappedFile::map(const char *path)
 
     unsigned sz = (unsigned)st.st_size;
 
-    void *mapping = mmap(NULL, sz, PROT_READ | PROT_WRITE, MAP_SHARED, fh, 0);
+    void *mapping = mmap(NULL, sz, PROT_READ, MAP_SHARED, fh, 0);
     if (mapping == MAP_FAILED) {
         close(fh);
         return false;
@@ -92,7 +102,7 @@ int MappedFile::map(const char *path)
 
     pData = reinterpret_cast<uint8_t*>(mapping);
     fileHandle = fh;
-    filesz = st.st_size;
+    filesz = sz;
 
 #endif
 
@@ -106,14 +116,12 @@ void MappedFile::unmap()
 
 #ifdef WIN32
 
-    FlushViewOfFile(pData, filesz);
     UnmapViewOfFile(pData);
     CloseHandle((HANDLE) mappingHandle);
     CloseHandle((HANDLE) fileHandle);
 
 #else
 
-    fsync(fileHandle);
     munmap(pData, filesz);
     close(fileHandle);
 
@@ -128,7 +136,7 @@ bool MappedFile::isMapped() const
     return filesz > 0;
 }
 
-uint8_t* MappedFile::getData(unsigned offset, unsigned &available) const
+const uint8_t *MappedFile::getData(unsigned offset, unsigned &available) const
 {
     if (!isMapped() || offset > filesz)
         return 0;
@@ -1,6 +1,6 @@
 /* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
  *
- * swiss - your Sifteo utility knife
+ * Thundercracker firmware
  *
  * Copyright <c> 2012 Sifteo, Inc.
  *
@@ -28,6 +28,19 @@
 
 #include <stdint.h>
 
+/**
+ * A read-only memory mapping of an entire file, for host-side tools.
+ *
+ * This lets swiss and Siftulator parse ELF headers and metadata in place,
+ * and stream payload bytes straight out of the page cache. Several
+ * processes mapping the same game share one copy of it in memory.
+ *
+ * Each instance owns its mapping, which is released on destruction, so
+ * MappedFile can't be copied. Keep containers of them by pointer.
+ *
+ * Not part of the firmware build.
+ */
+
 class MappedFile
 {
 public:
@@ -38,13 +51,29 @@ public:
         filesz(0)
     {}
 
-    int map(const char *path);
+    ~MappedFile() {
+        unmap();
+    }
+
+    bool map(const char *path);
     void unmap();
     bool isMapped() const;
 
-    uint8_t* getData(unsigned offset, unsigned &available) const;
+    const uint8_t *getData(unsigned offset, unsigned &available) const;
+
+    const uint8_t *data() const {
+        return pData;
+    }
+
+    unsigned size() const {
+        return filesz;
+    }
 
 private:
+    // Not copyable
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+
     uintptr_t fileHandle;
     uintptr_t mappingHandle;
     uint8_t *pData;
@@ -433,6 +433,7 @@ bool PaintControl::vramFlushed(CubeSlot *cube)
         SysTime::Ticks now = SysTime::ticks();
 
         PAINT_LOG((LOG_PREFIX "TRIGGERING\n", LOG_PARAMS));
+        RADIO_STATS_ONLY(RadioManager::recordFrameLatency(cube->id(), now - asyncTimestamp));
 
         if (vbuf->flags & _SYS_VBF_SYNC_ACK) {
             // We're sync'ed up. Trigger a one-shot render
@@ -465,6 +466,11 @@ bool PaintControl::vramFlushed(CubeSlot *cube)
     return false;
 }
 
+bool PaintControl::isFramePending(const _SYSVideoBuffer *vbuf)
+{
+    return vbuf && (vbuf->flags & _SYS_VBF_TRIGGER_ON_FLUSH);
+}
+
 bool PaintControl::allowContinuous(CubeSlot *cube)
 {
     // Conserve cube CPU time during asset loading; don't use continuous rendering.
@@ -85,6 +85,9 @@ class PaintControl {
     void ackFrames(CubeSlot *cube, int32_t count);
     bool vramFlushed(CubeSlot *cube);
 
+    // Radio scheduling hint: Is a paint trigger waiting on a VRAM flush?
+    static bool isFramePending(const _SYSVideoBuffer *vbuf);
+
  private:
     SysTime::Ticks paintTimestamp;      // Last user call to _SYS_paint()
     SysTime::Ticks asyncTimestamp;      // TOGGLE, TRIGGER_ON_FLUSH, entering CONTINUOUS mode
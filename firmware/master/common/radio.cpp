@@ -27,6 +27,7 @@
 #include "radio.h"
 #include "cube.h"
 #include "cubeconnector.h"
+#include "assetloader.h"
 
 #ifdef RADIO_UART_TRACE
 #   define RADIO_UART_STR(_x)   UART(_x)
@@ -41,9 +42,17 @@ bool RadioManager::enabled;
 uint8_t RadioManager::nextPID;
 uint32_t RadioManager::schedule[RadioManager::PID_COUNT];
 uint32_t RadioManager::nextSchedule[RadioManager::PID_COUNT];
+uint32_t RadioManager::urgentMask;
+uint8_t RadioManager::roundCounter;
+uint8_t RadioManager::credits[RadioManager::NUM_PRODUCERS];
 _SYSPseudoRandomState RadioManager::prngISR;
 RFSpectrumModel RadioManager::rfSpectrumModel;
 
+#ifdef SIFTEO_SIMULATOR
+RadioManager::ProducerStats RadioManager::stats[RadioManager::NUM_STATS];
+uint64_t RadioManager::dummyPackets;
+#endif
+
 
 void RadioManager::produce(PacketTransmission &tx)
 {
@@ -97,6 +106,15 @@ void RadioManager::produce(PacketTransmission &tx)
      * This is clearly not a globally optimal algorithm, but it should
      * yield an optimal-enough solution in all cases, and it needs
      * to be efficient enough to run on every radio ISR :)
+     *
+     * Producers are not all equal, though. A cube with a frame waiting
+     * on its VRAM flush will miss its deadline if it has to share the
+     * radio evenly with a cube that's streaming assets. So each round
+     * is weighted, deficit-round-robin style: see beginRound(). A
+     * producer with credit left after transmitting goes right back into
+     * the current round, in the queue for the PID it just used, so the
+     * collision avoidance above still holds. Within a queue, urgent
+     * producers are picked first.
      */
 
     const uint32_t activeMask = CubeSlots::sysConnected | Intrinsic::LZ(CONNECTOR_ID);
@@ -162,6 +180,8 @@ void RadioManager::produce(PacketTransmission &tx)
                     added &= ~s;
                 }
                 schedule[0] |= added;
+
+                beginRound(activeMask);
                 continue;
             }
 
@@ -180,6 +200,7 @@ void RadioManager::produce(PacketTransmission &tx)
 
             nextPID = (thisPID + 1) & PID_MASK;
             currentProducer = DUMMY_ID;
+            RADIO_STATS_ONLY(dummyPackets++);
             return;
         }
 
@@ -189,7 +210,10 @@ void RadioManager::produce(PacketTransmission &tx)
          */
 
         ASSERT(schedule[foundPID]);
-        unsigned producer = Intrinsic::CLZ(schedule[foundPID]);
+        uint32_t candidates = schedule[foundPID] & urgentMask;
+        if (!candidates)
+            candidates = schedule[foundPID];
+        unsigned producer = Intrinsic::CLZ(candidates);
         ASSERT(producer < NUM_PRODUCERS);
         uint32_t producerBit = Intrinsic::LZ(producer);
 
@@ -198,14 +222,96 @@ void RadioManager::produce(PacketTransmission &tx)
 
         // Does this producer even want to transmit right now?
         if (dispatchProduce(producer, tx, now)) {
-            nextSchedule[thisPID] |= producerBit;
+            // Stay in this round if there's quantum left
+            ASSERT(credits[producer] > 0);
+            if (--credits[producer])
+                schedule[thisPID] |= producerBit;
+            else
+                nextSchedule[thisPID] |= producerBit;
+
             nextPID = (thisPID + 1) & PID_MASK;
             currentProducer = producer;
+
+            #ifdef SIFTEO_SIMULATOR
+            ProducerStats &s = stats[producer];
+            s.packets++;
+            s.bytes += tx.packet.len;
+            if (urgentMask & producerBit)
+                s.urgentPackets++;
+            #endif
             return;
         }
 
-        // If not, put it back with its existing PID but in the new schedule
+        // If not, put it back with its existing PID but in the new schedule.
+        // Like any deficit counter, unused quantum is lost when we go idle.
+        credits[producer] = 0;
         nextSchedule[foundPID] |= producerBit;
+        RADIO_STATS_ONLY(stats[producer].yields++);
+    }
+}
+
+void RadioManager::beginRound(uint32_t activeMask)
+{
+    /*
+     * Hand out transmit quanta for the next scheduling round, based on
+     * hints from the subsystems that own each producer:
+     *
+     *   - PaintControl: A cube with a paint trigger waiting on its VRAM
+     *     flush is urgent. Every packet we delay it by pushes the frame
+     *     back, possibly past the next vsync.
+     *
+     *   - CubeConnector: Urgent while it's in the middle of a pairing or
+     *     reconnect handshake, since stalling there can cost us the whole
+     *     connection attempt. Idle beacons get the normal share.
+     *
+     *   - AssetLoader: A cube with asset data sitting in its FIFO is a bulk
+     *     producer. While anyone else is urgent, bulk producers only get a
+     *     turn on every other round. They sit out by moving directly to
+     *     the next schedule, keeping their last PID.
+     *
+     * Urgent producers get URGENT_QUANTUM transmit opportunities per round,
+     * everyone else gets one.
+     */
+
+    uint32_t urgent = 0;
+    uint32_t bulk = 0;
+    uint32_t vec = activeMask;
+
+    while (vec) {
+        unsigned id = Intrinsic::CLZ(vec);
+        uint32_t bit = Intrinsic::LZ(id);
+        vec ^= bit;
+
+        if (id == CONNECTOR_ID) {
+            if (CubeConnector::isHandshaking())
+                urgent |= bit;
+            continue;
+        }
+
+        CubeSlot &slot = CubeSlot::getInstance(id);
+        if (PaintControl::isFramePending(slot.getVBuf()))
+            urgent |= bit;
+        else if ((AssetLoader::getActiveCubes() & bit) && AssetLoader::needFlashPacket(id))
+            bulk |= bit;
+    }
+
+    urgentMask = urgent;
+    roundCounter++;
+
+    vec = activeMask;
+    while (vec) {
+        unsigned id = Intrinsic::CLZ(vec);
+        uint32_t bit = Intrinsic::LZ(id);
+        vec ^= bit;
+        credits[id] = (urgent & bit) ? URGENT_QUANTUM : 1;
+    }
+
+    if (urgent && (roundCounter & 1)) {
+        for (unsigned i = 0; i < PID_COUNT; ++i) {
+            uint32_t deferred = schedule[i] & bulk;
+            schedule[i] ^= deferred;
+            nextSchedule[i] |= deferred;
+        }
     }
 }
 
@@ -281,6 +387,7 @@ void RadioManager::processRetries(const CubeSlot &slot, unsigned retries)
 
     unsigned channel = slot.getRadioAddress()->channel;
     rfSpectrumModel.update(channel, retries);
+    RADIO_STATS_ONLY(stats[slot.id()].retries += retries);
 
     unsigned energy = rfSpectrumModel.energry(channel);
     if (energy > CHANNEL_HOP_THRESHOLD) {
@@ -304,3 +411,22 @@ ALWAYS_INLINE bool RadioManager::dispatchProduce(unsigned id, PacketTransmission
     CubeSlot &slot = CubeSlot::getInstance(id);
     return slot.isSysConnected() && slot.radioProduce(tx, now);
 }
+
+#ifdef SIFTEO_SIMULATOR
+
+void RadioManager::resetStats()
+{
+    memset(stats, 0, sizeof stats);
+    dummyPackets = 0;
+}
+
+void RadioManager::recordFrameLatency(_SYSCubeID id, SysTime::Ticks latency)
+{
+    ASSERT(id < _SYS_NUM_CUBE_SLOTS);
+    ProducerStats &s = stats[id];
+    s.frames++;
+    s.frameLatency += latency;
+    s.maxFrameLatency = MAX(s.maxFrameLatency, uint64_t(latency));
+}
+
+#endif // SIFTEO_SIMULATOR
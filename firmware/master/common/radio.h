@@ -34,6 +34,12 @@
 #include "systime.h"
 #include "rfspectrum.h"
 
+#ifdef SIFTEO_SIMULATOR
+#  define RADIO_STATS_ONLY(x)  x
+#else
+#  define RADIO_STATS_ONLY(x)
+#endif
+
 class CubeSlot;
 class RadioManager;
 
@@ -254,6 +260,38 @@ class RadioManager {
      */
     static _SYSPseudoRandomState prngISR;
 
+#ifdef SIFTEO_SIMULATOR
+    /*
+     * Per-producer airtime and latency statistics, exported by Siftulator.
+     * Indexed by cube ID, with the CubeConnector at _SYS_NUM_CUBE_SLOTS.
+     * All times are in SysTime ticks.
+     */
+    static const unsigned NUM_STATS = _SYS_NUM_CUBE_SLOTS + 1;
+
+    struct ProducerStats {
+        uint64_t packets;           // Transmit slots used
+        uint64_t bytes;             // Packet bytes, not including radio overhead
+        uint64_t retries;           // Hardware retries reported by ACKs
+        uint64_t urgentPackets;     // Packets sent while the producer was urgent
+        uint64_t yields;            // Transmit opportunities declined
+        uint64_t frames;            // Paint triggers flushed to the cube
+        uint64_t frameLatency;      // Total ticks from paint trigger to VRAM flush
+        uint64_t maxFrameLatency;
+    };
+
+    static const ProducerStats &getStats(unsigned id) {
+        ASSERT(id < NUM_STATS);
+        return stats[id];
+    }
+
+    static uint64_t getDummyPackets() {
+        return dummyPackets;
+    }
+
+    static void resetStats();
+    static void recordFrameLatency(_SYSCubeID id, SysTime::Ticks latency);
+#endif
+
  private:
 
     /*
@@ -296,9 +334,27 @@ class RadioManager {
     // Priority queues for each PID value
     static uint32_t schedule[PID_COUNT];
     static uint32_t nextSchedule[PID_COUNT];
-    
+
+    /*
+     * Weighted scheduling. Each round, producers are given a quantum of
+     * transmit opportunities. Latency-sensitive producers get several,
+     * and bulk producers may sit out alternate rounds while anyone else
+     * is urgent. 'credits' is the unused remainder of each quantum.
+     */
+    static const unsigned URGENT_QUANTUM = 4;
+    static uint32_t urgentMask;
+    static uint8_t roundCounter;
+    static uint8_t credits[NUM_PRODUCERS];
+
+    static void beginRound(uint32_t activeMask);
+
     // Dispatch to a paritcular producer, by ID
     static ALWAYS_INLINE bool dispatchProduce(unsigned id, PacketTransmission &tx, SysTime::Ticks now);
+
+#ifdef SIFTEO_SIMULATOR
+    static ProducerStats stats[NUM_STATS];
+    static uint64_t dummyPackets;
+#endif
 };
 
 #endif
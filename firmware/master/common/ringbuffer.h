@@ -28,20 +28,45 @@
 
 #include <stdint.h>
 #include "macros.h"
+#include "machine.h"
+
+/*
+ * On the simulator, the producer and consumer may be on different host
+ * threads, so keep the two indices on separate cache lines. The Cortex-M3
+ * has no data cache, and there the padding would only waste RAM.
+ */
+#ifdef SIFTEO_SIMULATOR
+#   define RINGBUFFER_CACHE_ALIGN  __attribute__((aligned(64)))
+#else
+#   define RINGBUFFER_CACHE_ALIGN
+#endif
 
 
 /**
  * Template for a statically-sized ring buffer.
  *
+ * This is a lock-free single-producer / single-consumer queue. Exactly
+ * one context may call the producer side (enqueue(), writeAvailable(),
+ * pull() into this buffer), and exactly one context may call the consumer
+ * side (dequeue(), dequeueWithDMACount()). Each side only ever writes its
+ * own index: the producer owns mTail, the consumer owns mHead. The two
+ * sides may run concurrently, for example the main thread and an ISR,
+ * or two host threads on the simulator.
+ *
+ * A slot is written before the tail that publishes it, and read before
+ * the head that releases it, with a barrier in between. Both ends may
+ * call empty(), full() and readAvailable(); the answer is exact for the
+ * caller's own side and conservative for the other side.
+ *
  * NOT suitable for use across the userspace/system boundary, as we
  * treat the head/tail pointers as trusted values.
  */
 template <unsigned tSize, typename tItemType = uint8_t, typename tIndexType = uint16_t>
 class RingBuffer
 {
-    tIndexType mHead;      /// Index of the next item to read
-    tIndexType mTail;      /// Index of the next empty slot to write into
-    tItemType mBuf[tSize];
+    volatile tIndexType mHead RINGBUFFER_CACHE_ALIGN;  /// Index of the next item to read
+    volatile tIndexType mTail RINGBUFFER_CACHE_ALIGN;  /// Index of the next empty slot to write into
+    tItemType mBuf[tSize] RINGBUFFER_CACHE_ALIGN;
 
 public:
     RingBuffer()
@@ -62,6 +87,7 @@ public:
         ASSERT(!full());
         unsigned tail = mTail;
         mBuf[tail] = c;
+        Atomic::Barrier();
         mTail = capacity() & (tail + 1);
     }
 
@@ -70,6 +96,7 @@ public:
         ASSERT(!empty());
         unsigned head = mHead;
         tItemType c = mBuf[head];
+        Atomic::Barrier();
         mHead = capacity() & (head + 1);
         return c;
     }
@@ -92,10 +119,18 @@ public:
         return (uintptr_t) &mBuf[0];
     }
 
-    void ALWAYS_INLINE dequeueWithDMACount(unsigned count) {
-        // Update the 'head' pointer, given an updated DMA count.
+    /*
+     * Update the 'head' pointer, given an updated DMA count. Returns the
+     * number of items the DMA engine has consumed since the last update.
+     * If that's more than readAvailable() was, the DMA has overtaken the
+     * producer and played stale data.
+     */
+    unsigned ALWAYS_INLINE dequeueWithDMACount(unsigned count) {
         ASSERT(count < getDMACount());
-        mHead = capacity() & (tSize - count);
+        unsigned head = capacity() & (tSize - count);
+        unsigned consumed = capacity() & (head - mHead);
+        mHead = head;
+        return consumed;
     }
 
     /*
@@ -38,8 +38,10 @@
 
 /**
  * This is a small inlined utility class for safely and quickly reading a
- * byte stream from flash. Uses a tiny buffer to amortize costs (checking
- * boundary conditions, address translation) over many bytes.
+ * byte stream from flash. We read straight out of the cache block, which
+ * stays pinned by our FlashBlockRef, so the costs of checking boundary
+ * conditions and translating addresses are paid once per block instead
+ * of once per byte, and nothing is copied twice.
  */
 class LZByteReader {
 public:
@@ -77,36 +79,61 @@ private:
     FlashBlockRef ref;
     SvmMemory::VirtAddr src;
     unsigned srcLen;            // Bytes remaining at 'src'
-    unsigned bufLen;            // Bytes remaining in buffer
-    uint8_t *bufPtr;            // Current read location in buffer
-    uint8_t buffer[32];
+    unsigned bufLen;            // Bytes remaining in mapped buffer
+    uint8_t *bufPtr;            // Current read location in mapped buffer
 
     void fillBuffer();
 };
 
 
+/**
+ * Byte reader with the same interface as LZByteReader, for compressed
+ * data that's already in RAM.
+ */
+class LZMemReader {
+public:
+
+    ALWAYS_INLINE LZMemReader(const uint8_t *src, uint32_t srcLen)
+        : ptr(src), end(src + srcLen)
+    {}
+
+    ALWAYS_INLINE bool eof() const {
+        return ptr == end;
+    }
+
+    ALWAYS_INLINE uint8_t read() {
+        return LIKELY(ptr != end) ? *(ptr++) : 0;
+    }
+
+private:
+    const uint8_t *ptr;
+    const uint8_t *end;
+};
+
+
 void LZByteReader::fillBuffer()
 {
     ASSERT(bufLen == 0);
-    unsigned chunk = MIN(srcLen, sizeof buffer);
+    uint32_t chunk = srcLen;
     if (!chunk)
         return;
 
-    if (!SvmMemory::copyROData(ref, &buffer[0], src, chunk))
+    // Map as much as we can, up to the end of the current flash block
+    SvmMemory::PhysAddr pa;
+    if (!SvmMemory::mapROData(ref, src, chunk, pa))
         return;
+    ASSERT(chunk >= 1 && chunk <= srcLen);
 
     bufLen = chunk;
-    bufPtr = &buffer[0];
+    bufPtr = pa;
     src += chunk;
     srcLen -= chunk;
 }
 
 
-bool SvmFastLZ::decompressL1(FlashBlockRef &ref, SvmMemory::PhysAddr dest,
-    uint32_t &destLen, SvmMemory::VirtAddr src, uint32_t srcLen)
+template <class Reader>
+static ALWAYS_INLINE bool decodeL1(Reader &br, uint8_t *dest, uint32_t &destLen)
 {
-    LZByteReader br(ref, src, srcLen);
-
     uint8_t *op = dest;
     uint8_t *op_limit = op + destLen;
 
@@ -173,3 +200,17 @@ bool SvmFastLZ::decompressL1(FlashBlockRef &ref, SvmMemory::PhysAddr dest,
     destLen = op - dest;
     return true;
 }
+
+bool SvmFastLZ::decompressL1(FlashBlockRef &ref, SvmMemory::PhysAddr dest,
+    uint32_t &destLen, SvmMemory::VirtAddr src, uint32_t srcLen)
+{
+    LZByteReader br(ref, src, srcLen);
+    return decodeL1(br, dest, destLen);
+}
+
+bool SvmFastLZ::decompressL1(uint8_t *dest, uint32_t &destLen,
+    const uint8_t *src, uint32_t srcLen)
+{
+    LZMemReader br(src, srcLen);
+    return decodeL1(br, dest, destLen);
+}
@@ -52,6 +52,13 @@ public:
     static bool decompressL1(FlashBlockRef &ref, SvmMemory::PhysAddr dest,
         uint32_t &destLen, SvmMemory::VirtAddr src, uint32_t srcLen);
 
+    /**
+     * Same as above, but decodes from a buffer already in RAM. Used for
+     * compressed data that arrives over USB rather than from flash.
+     */
+    static bool decompressL1(uint8_t *dest, uint32_t &destLen,
+        const uint8_t *src, uint32_t srcLen);
+
 private:
     SvmFastLZ();    // Do not implement
 };
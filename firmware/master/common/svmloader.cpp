@@ -166,6 +166,15 @@ bool SvmLoader::prepareToExec(const Elf::Program &program, SvmRuntime::StackInfo
     // Set up default flash segment
     SvmMemory::setFlashSegment(0, program.getRODataSpan());
 
+    // Code prefetch hints, if the linker gave us any
+    {
+        FlashBlockRef ref;
+        uint32_t actualSize;
+        const _SYSMetadataPrefetchHint *hints = reinterpret_cast<const _SYSMetadataPrefetchHint*>(
+            program.getMeta(ref, _SYS_METADATA_PREFETCH_HINTS, sizeof *hints, actualSize));
+        SvmRuntime::setPrefetchHints(hints, hints ? actualSize / sizeof *hints : 0);
+    }
+
     // Init stack
     stack.limit = program.getTopOfRAM();
     stack.top = SvmMemory::VIRTUAL_RAM_TOP;
@@ -50,6 +50,13 @@ typedef uint64_t (*SvmSyscall)(reg_t p0, reg_t p1, reg_t p2, reg_t p3,
 
 #include "syscall-table.def"
 
+#ifdef SIFTEO_SIMULATOR
+const char *SvmRuntime::getSyscallName(unsigned num)
+{
+    return num < arraysize(SyscallNames) ? SyscallNames[num] : 0;
+}
+#endif
+
 using namespace Svm;
 
 FlashBlockRef SvmRuntime::codeBlock;
@@ -58,6 +65,9 @@ SvmMemory::PhysAddr SvmRuntime::stackLimit;
 reg_t SvmRuntime::eventFrame;
 bool SvmRuntime::eventDispatchFlag;
 bool SvmRuntime::pendingExitFlag;
+_SYSMetadataPrefetchHint SvmRuntime::prefetchHints[_SYS_MAX_PREFETCH_HINTS];
+unsigned SvmRuntime::numPrefetchHints;
+unsigned SvmRuntime::prefetchLastBlock;
 
 
 void SvmRuntime::run(uint32_t entryFunc, const StackInfo &stack)
@@ -156,6 +166,7 @@ void SvmRuntime::call(reg_t addr)
             fp, fp->pc, fp->fp, fp->r2, fp->r3, fp->r4, fp->r5, fp->r6, fp->r7));
     });
 
+    countCall(addr);
     enterFunction(addr);
 }
 
@@ -180,6 +191,7 @@ ALWAYS_INLINE void SvmRuntime::tailcall(reg_t addr)
             reinterpret_cast<void*>(fp)));
     });
 
+    countCall(addr);
     enterFunction(addr);
 }
 
@@ -448,11 +460,18 @@ void SvmRuntime::syscall(unsigned num)
             reinterpret_cast<void*>(SvmCpu::reg(7))));
     });
 
+    SYSCALL_STATS_ONLY(STATIC_ASSERT(arraysize(SyscallTable) <= MAX_SYSCALL_STATS);)
+    SYSCALL_STATS_ONLY(SyscallTimestamp timestamp = syscallTimestamp();)
+    SYSCALL_STATS_ONLY(uint32_t profileState = profileEnterSyscall(num);)
+
     uint64_t result = fn(SvmCpu::reg(0), SvmCpu::reg(1),
                          SvmCpu::reg(2), SvmCpu::reg(3),
                          SvmCpu::reg(4), SvmCpu::reg(5),
                          SvmCpu::reg(6), SvmCpu::reg(7));
 
+    SYSCALL_STATS_ONLY(profileLeaveSyscall(profileState);)
+    SYSCALL_STATS_ONLY(countSyscall(num, timestamp);)
+
     uint32_t result0 = result;
     uint32_t result1 = result >> 32;
 
@@ -506,7 +525,9 @@ ALWAYS_INLINE void SvmRuntime::postSyscallWork()
      */
 
     // Poll for pending userspace tasks on our way up. This is akin to a
-    // deferred procedure call (DPC) in Win32.
+    // deferred procedure call (DPC) in Win32. With nothing pending, this
+    // is one store and one load, so it isn't worth skipping for syscalls
+    // that can't generate work of their own.
     Tasks::work();
     
     // Event dispatch is requested by certain syscalls, but must wait
@@ -547,13 +568,54 @@ reg_t SvmRuntime::mapSP(reg_t addr)
     return reinterpret_cast<reg_t>(pa);
 }
 
+ALWAYS_INLINE void SvmRuntime::prefetchSuccessors(reg_t addr)
+{
+    /*
+     * When a branch lands in a different code block, queue up the blocks
+     * that the linker predicted we'll enter next. The table is sorted by
+     * 'block', so a binary search finds the first hint for this block.
+     * If the table wasn't sorted, we just miss some hints.
+     */
+
+    unsigned block = ((uint32_t)addr & 0xfffffc) >> FlashBlock::BLOCK_SIZE_LOG2;
+    if (block == prefetchLastBlock || !numPrefetchHints)
+        return;
+    prefetchLastBlock = block;
+
+    unsigned lo = 0, hi = numPrefetchHints;
+    while (lo < hi) {
+        unsigned mid = (lo + hi) >> 1;
+        if (prefetchHints[mid].block < block)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    for (; lo < numPrefetchHints && prefetchHints[lo].block == block; ++lo)
+        SvmMemory::preload(SvmMemory::SEGMENT_0_VA +
+            (prefetchHints[lo].successor << FlashBlock::BLOCK_SIZE_LOG2));
+}
+
 void SvmRuntime::branch(reg_t addr)
 {
     SvmMemory::PhysAddr pa;
-    if (SvmMemory::mapROCode(codeBlock, addr, pa))
+    if (SvmMemory::mapROCode(codeBlock, addr, pa)) {
         SvmCpu::setReg(REG_PC, reinterpret_cast<reg_t>(pa));
-    else
+        prefetchSuccessors(addr);
+    } else {
         SvmRuntime::fault(F_BAD_CODE_ADDRESS);
+    }
+}
+
+void SvmRuntime::setPrefetchHints(const _SYSMetadataPrefetchHint *hints, unsigned count)
+{
+    numPrefetchHints = 0;
+    prefetchLastBlock = (unsigned) -1;
+
+    // The linker never emits more than _SYS_MAX_PREFETCH_HINTS
+    count = MIN(count, arraysize(prefetchHints));
+    while (numPrefetchHints < count && hints->block != hints->successor)
+        prefetchHints[numPrefetchHints++] = *(hints++);
 }
 
 ALWAYS_INLINE void SvmRuntime::longLDRSP(unsigned reg, unsigned offset)
@@ -32,6 +32,12 @@
 #include "svmmemory.h"
 #include "flash_blockcache.h"
 
+#ifdef SIFTEO_SIMULATOR
+#  define SYSCALL_STATS_ONLY(x)  x
+#else
+#  define SYSCALL_STATS_ONLY(x)
+#endif
+
 using namespace Svm;
 class UIPanic;
 
@@ -65,6 +71,13 @@ public:
     // Modify the program counter
     static void branch(reg_t addr);
 
+    /**
+     * Install the linker's code prefetch hints for the program we're about
+     * to run. Entries are copied up to the first terminating hint, and
+     * 'count' may be zero to disable prefetching.
+     */
+    static void setPrefetchHints(const _SYSMetadataPrefetchHint *hints, unsigned count);
+
     /**
      * Call Event::Dispatch() on our way out of the next syscall(). Events can't
      * be dispatched while we're in syscalls, since the internal call() we
@@ -148,6 +161,42 @@ public:
         SvmCpu::setReg(7, r7);
     }
 
+#ifdef SIFTEO_SIMULATOR
+    /**
+     * Per-syscall statistics, collected only in simulation.
+     *
+     * Syscall handlers run natively, so simulated master CPU cycles only
+     * advance inside a handler when it hits a modeled cost, like a flash
+     * cache miss, and most calls cost zero simulated cycles. To tell those
+     * apart, we also time each handler on the host's monotonic clock, and bin
+     * that into a log2 histogram. Bucket 0 counts calls under 1 ns, bucket N
+     * counts calls taking [2^(N-1), 2^N) nanoseconds.
+     */
+    static const unsigned MAX_SYSCALL_STATS = 256;
+    static const unsigned NUM_SYSCALL_HISTOGRAM_BUCKETS = 24;
+
+    struct SyscallStats {
+        uint64_t calls;
+        uint64_t cycles;
+        uint64_t hostNanoseconds;
+        uint32_t histogram[NUM_SYSCALL_HISTOGRAM_BUCKETS];
+    };
+
+    struct SyscallTimestamp {
+        uint64_t cycles;
+        double hostSeconds;
+    };
+
+    static const SyscallStats &getSyscallStats(unsigned num) {
+        ASSERT(num < MAX_SYSCALL_STATS);
+        return syscallStats[num];
+    }
+
+    static const char *getSyscallName(unsigned num);
+    static void resetSyscallStats();
+    static void dumpSyscallStats();
+#endif
+
 private:
     enum ReturnActions {
         RET_BRANCH          = 1 << 0,
@@ -165,6 +214,12 @@ private:
     static bool eventDispatchFlag;
     static bool pendingExitFlag;
 
+    // Copied out of flash so branch() never touches the block cache;
+    // this costs 4 bytes of RAM per hint, 256 bytes in total.
+    static _SYSMetadataPrefetchHint prefetchHints[_SYS_MAX_PREFETCH_HINTS];
+    static unsigned numPrefetchHints;
+    static unsigned prefetchLastBlock;
+
     static void initStack(const StackInfo &stack);
 
     static void call(reg_t addr);
@@ -180,6 +235,7 @@ private:
     static void longSTRSP(unsigned reg, unsigned offset);
 
     static void enterFunction(reg_t addr);
+    static void prefetchSuccessors(reg_t addr);
 
     static unsigned getSPAdjustWords(reg_t addr) {
         // High bit is reserved
@@ -203,8 +259,16 @@ private:
     static SvmMemory::PhysAddr topOfStackPA;
     static SvmMemory::PhysAddr stackLowWaterMark;
     static void onStackModification(SvmMemory::PhysAddr sp);
+
+    static SyscallStats syscallStats[MAX_SYSCALL_STATS];
+    static SyscallTimestamp syscallTimestamp();
+    static void countSyscall(unsigned num, const SyscallTimestamp &start);
+    static void countCall(reg_t addr);
+    static uint32_t profileEnterSyscall(unsigned num);
+    static void profileLeaveSyscall(uint32_t state);
 #else
     static void onStackModification(SvmMemory::PhysAddr sp) {}
+    static void countCall(reg_t addr) {}
 #endif
 };
 
@@ -28,6 +28,7 @@
  */
 
 #include <sifteo/abi.h>
+#include <string.h>
 #include "audiomixer.h"
 #include "svmmemory.h"
 #include "svmruntime.h"
@@ -95,6 +96,22 @@ void _SYS_audio_setSpeed(_SYSAudioChannelID ch, uint32_t hz)
     AudioMixer::instance.setSpeed(ch, hz);
 }
 
+uint32_t _SYS_audio_counters(_SYSAudioCounters *buffer, uint32_t bufferSize)
+{
+    if (!SvmMemory::mapRAM(buffer, bufferSize)) {
+        SvmRuntime::fault(F_SYSCALL_ADDRESS);
+        return 0;
+    }
+
+    const _SYSAudioCounters *counters = AudioMixer::instance.getCounters();
+
+    unsigned actualSize = MIN(sizeof *counters, bufferSize);
+    memset(buffer, 0, bufferSize);
+    memcpy(buffer, counters, actualSize);
+
+    return actualSize;
+}
+
 uint32_t _SYS_audio_pos(_SYSAudioChannelID ch)
 {
     return AudioMixer::instance.pos(ch);
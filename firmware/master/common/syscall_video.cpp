@@ -32,6 +32,57 @@
 #include "svmruntime.h"
 #include "vram.h"
 
+
+/**
+ * Sequential reader for a userspace array of 16-bit words, which may be
+ * located anywhere in RAM or flash. Returns false at the end of the array,
+ * or on a bad address. Use isValid() to distinguish the two.
+ */
+
+class VRAMCommandReader {
+public:
+    VRAMCommandReader(const uint16_t *words, uint16_t count)
+        : va(reinterpret_cast<SvmMemory::VirtAddr>(words)),
+          remaining(mulsat16x16(sizeof *words, count)),
+          chunk(0), valid(true) {}
+
+    ALWAYS_INLINE bool next(uint16_t &word) {
+        if (UNLIKELY(!chunk) && !map())
+            return false;
+        word = *reinterpret_cast<uint16_t*>(pa);
+        pa += sizeof(uint16_t);
+        chunk -= sizeof(uint16_t);
+        return true;
+    }
+
+    bool isValid() const {
+        return valid;
+    }
+
+private:
+    FlashBlockRef ref;
+    SvmMemory::VirtAddr va;
+    SvmMemory::PhysAddr pa;
+    uint32_t remaining;
+    uint32_t chunk;
+    bool valid;
+
+    bool map() {
+        if (!remaining || !valid)
+            return false;
+        chunk = remaining;
+        if (!SvmMemory::mapROData(ref, va, chunk, pa)) {
+            valid = false;
+            chunk = 0;
+            return false;
+        }
+        ASSERT((chunk & 1) == 0);
+        va += chunk;
+        remaining -= chunk;
+        return true;
+    }
+};
+
 extern "C" {
 
 void _SYS_vbuf_init(_SYSVideoBuffer *vbuf)
@@ -306,4 +357,112 @@ void _SYS_vbuf_spr_move(struct _SYSVideoBuffer *vbuf, unsigned id, int x, int y)
     _SYS_vbuf_poke(vbuf, addr, word);
 }
 
+void _SYS_vbuf_cmdlist(struct _SYSVideoBuffer *vbuf, const uint16_t *cmds, uint16_t count)
+{
+    /*
+     * Apply a whole list of VRAM commands in one pass. See abi/vram.h
+     * for the command list format. The list may live in either RAM or
+     * flash, and it's read incrementally through the block cache.
+     */
+
+    if (!isAligned(vbuf) || !isAligned(cmds, 2))
+        return SvmRuntime::fault(F_SYSCALL_ADDR_ALIGN);
+
+    if (!SvmMemory::mapRAM(vbuf)) {
+        SvmRuntime::fault(F_SYSCALL_ADDRESS);
+        return;
+    }
+
+    VRAMCommandReader reader(cmds, count);
+    VRAMBatchWriter writer(*vbuf);
+    uint16_t header;
+
+    while (reader.next(header)) {
+        unsigned arg = header & _SYS_VBUF_CMD_ARG_MASK;
+        uint16_t addr, word;
+
+        switch (header >> _SYS_VBUF_CMD_SHIFT) {
+
+        case _SYS_VBUF_CMD_POKE:
+            while (arg--) {
+                if (!reader.next(addr) || !reader.next(word))
+                    goto fault;
+                writer.poke(addr, word);
+            }
+            break;
+
+        case _SYS_VBUF_CMD_FILL:
+            if (!reader.next(addr) || !reader.next(word))
+                goto fault;
+            while (arg--)
+                writer.poke(addr++, word);
+            break;
+
+        case _SYS_VBUF_CMD_WRITE:
+            if (!reader.next(addr))
+                goto fault;
+            while (arg--) {
+                if (!reader.next(word))
+                    goto fault;
+                writer.poke(addr++, word);
+            }
+            break;
+
+        case _SYS_VBUF_CMD_WRECT: {
+            uint16_t lines, addrStride, offset;
+            if (!reader.next(addr) || !reader.next(lines) ||
+                !reader.next(addrStride) || !reader.next(offset))
+                goto fault;
+            while (lines--) {
+                uint16_t lineAddr = addr;
+                for (unsigned x = 0; x < arg; ++x) {
+                    if (!reader.next(word))
+                        goto fault;
+                    writer.poke(lineAddr++, _SYS_TILE77(offset + word));
+                }
+                addr += addrStride;
+            }
+            break;
+        }
+
+        case _SYS_VBUF_CMD_SPR_MOVE: {
+            // Same encoding as _SYS_vbuf_spr_move()
+            if (!reader.next(word) || arg >= _SYS_VRAM_SPRITES)
+                goto fault;
+            uint8_t xb = -(int8_t)word;
+            uint8_t yb = -(int8_t)(word >> 8);
+            writer.poke(offsetof(_SYSVideoRAM, spr[0].pos_y)/2 +
+                        sizeof(_SYSSpriteInfo)/2 * arg,
+                        ((uint16_t)xb << 8) | yb);
+            break;
+        }
+
+        case _SYS_VBUF_CMD_BG1_SET:
+        case _SYS_VBUF_CMD_BG1_CLEAR: {
+            if (!reader.next(word) || arg >= _SYS_VRAM_BG1_WIDTH)
+                goto fault;
+            addr = _SYS_VA_BG1_BITMAP/2 + arg;
+            uint16_t row = writer.peek(addr);
+            if ((header >> _SYS_VBUF_CMD_SHIFT) == _SYS_VBUF_CMD_BG1_SET)
+                row |= word;
+            else
+                row &= ~word;
+            writer.poke(addr, row);
+            break;
+        }
+
+        default:
+            goto fault;
+        }
+    }
+
+    if (!reader.isValid())
+        goto fault;
+
+    return;
+
+fault:
+    SvmRuntime::fault(reader.isValid() ? F_SYSCALL_PARAM : F_SYSCALL_ADDRESS);
+}
+
 }  // extern "C"
@@ -37,9 +37,12 @@
 #include "batterylevel.h"
 #include "volume.h"
 #include "btprotocol.h"
+#include "usbprotocol.h"
+#include "flash_blockcache.h"
 
 #ifdef SIFTEO_SIMULATOR
 #   include "mc_timing.h"
+#   include "mc_usbdevice.h"
 #   include "system_mc.h"
 #   include "system.h"
 #   include "batterylevel.h"
@@ -63,14 +66,14 @@ ALWAYS_INLINE void Tasks::taskInvoke(unsigned id)
 {
     switch (id) {
 
+        case Tasks::UsbOUT:             return UsbDevice::handleOUTData();
+        case Tasks::UsbIN:              return USBProtocol::inTask();
+
     #ifndef SIFTEO_SIMULATOR
         #if BOARD != BOARD_TEST_JIG
         case Tasks::PowerManager:       return PowerManager::vbusDebounce();
         #endif
 
-        case Tasks::UsbOUT:             return UsbDevice::handleOUTData();
-        case Tasks::UsbIN:              return USBProtocol::inTask();
-
         #if (BOARD == BOARD_TEST_JIG && !defined(BOOTLOADER))
         case Tasks::TestJig:            return TestJig::task();
         #endif
@@ -216,10 +219,21 @@ void Tasks::idle(uint32_t exclude)
      * This is the correct way to block the main thread of execution while
      * waiting for a condition, as it avoids unnecessary WFIs when the
      * caller is waiting on something which requires Tasks to execute.
+     *
+     * With no tasks pending, we'd rather spend the time servicing a
+     * queued flash preload than sleeping. Each pass does at most one
+     * block read, so the caller re-checks its condition promptly.
      */
 
-    if (!work(exclude))
-        waitForInterrupt();
+    if (work(exclude))
+        return;
+
+#if !defined(BOOTLOADER) && !BOARD_EQUALS(BOARD_TEST_JIG)
+    if (FlashBlock::servicePreload())
+        return;
+#endif
+
+    waitForInterrupt();
 }
 
 void Tasks::heartbeatISR()
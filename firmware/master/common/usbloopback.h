@@ -0,0 +1,65 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Thundercracker firmware
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef USBLOOPBACK_H
+#define USBLOOPBACK_H
+
+#include <stdint.h>
+
+/*
+ * Framing for the loopback USB transport between swiss and Siftulator.
+ *
+ * Instead of a physical bulk endpoint pair, the two sides exchange
+ * packets over a local TCP stream. Each packet is preceded by a two-byte
+ * header: a frame type and a payload length of at most MAX_PACKET bytes.
+ *
+ * USB flow control is emulated with explicit acknowledgments. The device
+ * sends an OutAck frame each time the firmware consumes an OUT packet,
+ * which is what lets the host keep a window of outstanding transfers in
+ * flight just like it would with libusb.
+ */
+
+namespace UsbLoopback {
+
+    static const unsigned DEFAULT_PORT = 2406;
+    static const unsigned MAX_PACKET = 64;
+
+    enum FrameType {
+        OutData     = 1,    // Host to device, one OUT packet
+        InData      = 2,    // Device to host, one IN packet
+        OutAck      = 3,    // Device to host, OUT packets consumed (payload: count)
+    };
+
+    struct FrameHeader {
+        uint8_t type;
+        uint8_t len;
+    };
+
+    static const unsigned HEADER_BYTES = sizeof(FrameHeader);
+    static const unsigned MAX_FRAME = HEADER_BYTES + MAX_PACKET;
+
+} // namespace UsbLoopback
+
+#endif
@@ -29,7 +29,9 @@
 #include "macros.h"
 #include "event.h"
 
-#ifndef SIFTEO_SIMULATOR
+#ifdef SIFTEO_SIMULATOR
+#include "mc_usbdevice.h"
+#else
 #include "usb/usbdevice.h"
 #include "hardware.h"
 #include "factorytest.h"
@@ -117,9 +119,7 @@ void USBProtocol::requestUserINPacket()
 
         // timeout here should leave some headroom for system watchdog,
         // which is currently 3 seconds.
-#ifndef SIFTEO_SIMULATOR
         UsbDevice::write(buf, pkt->length + sizeof pkt->type, 1000);
-#endif
         return Event::setBasePending(Event::PID_BASE_USB_WRITE_AVAILABLE);
     }
 }
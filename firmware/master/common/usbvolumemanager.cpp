@@ -30,13 +30,19 @@
 #include "flash_volumeheader.h"
 #include "flash_syslfs.h"
 #include "flash_stack.h"
+#include "svmfastlz.h"
 
-#ifndef SIFTEO_SIMULATOR
+#ifdef SIFTEO_SIMULATOR
+#include "mc_usbdevice.h"
+#else
 #include "usb/usbdevice.h"
 #endif
 
 FlashVolumeWriter UsbVolumeManager::writer;
 UsbVolumeManager::LFSObjectWriteStatus UsbVolumeManager::lfsWriter;
+UsbVolumeManager::PayloadChunkStatus UsbVolumeManager::chunkStatus;
+FlashVolume UsbVolumeManager::deltaBase;
+uint8_t UsbVolumeManager::chunkBuffer[PAYLOAD_CHUNK_BYTES + PAYLOAD_CHUNK_SLACK];
 
 void UsbVolumeManager::onUsbData(const USBProtocolMsg &m)
 {
@@ -56,8 +62,9 @@ void UsbVolumeManager::onUsbData(const USBProtocolMsg &m)
         if (!memchr(packageStr, 0, m.payloadLen() - 4))
             break;
 
+        deltaBase = FlashMapBlock::invalid();
         if (writer.beginGame(numBytes, packageStr)) {
-            reply.header |= WroteHeaderOK;
+            beginPayloadChunks(reply);
         } else {
             reply.header |= WroteHeaderFail;
         }
@@ -73,8 +80,9 @@ void UsbVolumeManager::onUsbData(const USBProtocolMsg &m)
             break;
 
         const uint32_t numBytes = *reinterpret_cast<const uint32_t*>(m.payload);
+        deltaBase = FlashMapBlock::invalid();
         if (writer.beginLauncher(numBytes)) {
-            reply.header |= WroteHeaderOK;
+            beginPayloadChunks(reply);
         } else {
             reply.header |= WroteHeaderFail;
         }
@@ -86,9 +94,27 @@ void UsbVolumeManager::onUsbData(const USBProtocolMsg &m)
         // NOTE: we don't respond to these to avoid the traffic overhead, so just return
         return;
 
+    case WritePayloadChunk:
+        // Replies are sent per-chunk, not per-packet
+        payloadChunkWrite(m);
+        return;
+
+    case WriteGameDeltaHeader:
+        beginGameDelta(m, reply);
+        break;
+
+    case PayloadHashes:
+        payloadHashes(m, reply);
+        break;
+
     case WriteCommit:
         if (writer.isPayloadComplete()) {
             writer.commit();
+            if (deltaBase.isValid()) {
+                // The new volume replaces the one it was built from
+                deltaBase.deleteTree();
+                deltaBase = FlashMapBlock::invalid();
+            }
             reply.header |= WriteCommitOK;
             reply.append(&writer.volume.block.code, 1);
         } else {
@@ -202,9 +228,216 @@ void UsbVolumeManager::onUsbData(const USBProtocolMsg &m)
         return;
     }
 
-#ifndef SIFTEO_SIMULATOR
     UsbDevice::write(reply.bytes, reply.len);
-#endif
+}
+
+void UsbVolumeManager::beginPayloadChunks(USBProtocolMsg &reply)
+{
+    /*
+     * A new volume header was accepted. Reset the chunk decoder, and let
+     * the host know it may send us compressed payload data.
+     */
+
+    memset(&chunkStatus, 0, sizeof chunkStatus);
+
+    reply.header |= WroteHeaderOK;
+    reply.append(FeatureCompressedPayload);
+}
+
+void UsbVolumeManager::payloadChunkWrite(const USBProtocolMsg &m)
+{
+    /*
+     * Reassemble chunks from the WritePayloadChunk stream. Each completed
+     * chunk is decoded and written to the volume, then acknowledged.
+     *
+     * After any error we stop accepting data; the host will see
+     * WritePayloadChunkFail, and the commit will fail since the payload
+     * is incomplete.
+     */
+
+    const uint8_t *src = m.payload;
+    unsigned len = m.payloadLen();
+    uint8_t *hdr = reinterpret_cast<uint8_t*>(&chunkStatus.header);
+
+    while (len && !chunkStatus.failed) {
+
+        if (chunkStatus.fill < sizeof chunkStatus.header) {
+            // Still collecting the chunk header
+            unsigned part = MIN(len, sizeof chunkStatus.header - chunkStatus.fill);
+            memcpy(hdr + chunkStatus.fill, src, part);
+            chunkStatus.fill += part;
+            src += part;
+            len -= part;
+
+            if (chunkStatus.fill == sizeof chunkStatus.header) {
+                const PayloadChunkHeader &h = chunkStatus.header;
+                if (h.rawLen == 0 || h.rawLen > PAYLOAD_CHUNK_BYTES ||
+                    h.codedLen > h.rawLen ||
+                    (h.codedLen == 0 && !deltaBase.isValid()))
+                    chunkStatus.failed = true;
+            }
+            continue;
+        }
+
+        // Copy chunks carry only a source offset
+        unsigned bodyLen = chunkStatus.header.codedLen ?
+            chunkStatus.header.codedLen : sizeof(uint32_t);
+
+        // Bodies are stored at the end of the buffer, for in-place decoding
+        uint8_t *body = chunkBuffer + sizeof chunkBuffer - bodyLen;
+        unsigned offset = chunkStatus.fill - sizeof chunkStatus.header;
+        unsigned part = MIN(len, bodyLen - offset);
+        memcpy(body + offset, src, part);
+        chunkStatus.fill += part;
+        src += part;
+        len -= part;
+
+        if (offset + part == bodyLen) {
+            if (finishPayloadChunk())
+                chunkStatus.fill = 0;
+            else
+                chunkStatus.failed = true;
+        }
+    }
+
+    if (chunkStatus.failed) {
+        USBProtocolMsg reply(USBProtocol::Installer);
+        reply.header |= WritePayloadChunkFail;
+        UsbDevice::write(reply.bytes, reply.len);
+    }
+}
+
+bool UsbVolumeManager::finishPayloadChunk()
+{
+    const PayloadChunkHeader &h = chunkStatus.header;
+    const uint8_t *body = chunkBuffer + sizeof chunkBuffer - h.codedLen;
+    const uint8_t *data = body;
+
+    if (h.codedLen == 0) {
+        // Copy from the base volume's payload
+        uint32_t srcOffset;
+        memcpy(&srcOffset, chunkBuffer + sizeof chunkBuffer - sizeof srcOffset,
+            sizeof srcOffset);
+
+        FlashBlockRef ref;
+        FlashMapSpan span = deltaBase.getPayload(ref);
+        if (srcOffset > span.sizeInBytes() || h.rawLen > span.sizeInBytes() - srcOffset ||
+            !span.copyBytes(srcOffset, chunkBuffer, h.rawLen))
+            return false;
+        data = chunkBuffer;
+
+    } else if (h.codedLen != h.rawLen) {
+        uint32_t rawLen = h.rawLen;
+        if (!SvmFastLZ::decompressL1(chunkBuffer, rawLen, body, h.codedLen)
+            || rawLen != h.rawLen)
+            return false;
+        data = chunkBuffer;
+    }
+
+    writer.appendPayload(data, h.rawLen);
+    chunkStatus.count++;
+
+    USBProtocolMsg reply(USBProtocol::Installer);
+    reply.header |= WritePayloadChunkAck;
+    reply.append((const uint8_t*) &chunkStatus.count, sizeof chunkStatus.count);
+    UsbDevice::write(reply.bytes, reply.len);
+
+    return true;
+}
+
+bool UsbVolumeManager::isGameWithPackage(FlashVolume vol, const char *package)
+{
+    if (!vol.isValid() || vol.getType() != FlashVolume::T_GAME)
+        return false;
+
+    FlashBlockRef ref;
+    Elf::Program program;
+    if (!program.init(vol.getPayload(ref)))
+        return false;
+
+    const char *str = program.getMetaString(ref, _SYS_METADATA_PACKAGE_STR);
+    return str && !strcmp(str, package);
+}
+
+void UsbVolumeManager::beginGameDelta(const USBProtocolMsg &m, USBProtocolMsg &reply)
+{
+    /*
+     * Like WriteGameHeader, but the existing volume for this package is
+     * kept around until commit so that chunks can be copied out of it.
+     * This needs room for both volumes at once; on failure, the host
+     * can fall back on a normal install.
+     */
+
+    deltaBase = FlashMapBlock::invalid();
+
+    // Size and base volume, then a NUL-terminated package string
+    if (m.payloadLen() < 9 || !memchr(m.payload + 8, 0, m.payloadLen() - 8)) {
+        reply.header |= WroteHeaderFail;
+        return;
+    }
+
+    const uint32_t numBytes = *reinterpret_cast<const uint32_t*>(m.payload);
+    const uint32_t baseCode = *reinterpret_cast<const uint32_t*>(m.payload + 4);
+    const char* packageStr = reinterpret_cast<const char*>(m.payload + 8);
+    FlashVolume base = FlashMapBlock::fromCode(baseCode);
+
+    if (!isGameWithPackage(base, packageStr) ||
+        !writer.beginGame(numBytes, packageStr, base)) {
+        reply.header |= WroteHeaderFail;
+        return;
+    }
+
+    beginPayloadChunks(reply);
+    deltaBase = base;
+}
+
+void UsbVolumeManager::payloadHashes(const USBProtocolMsg &m, USBProtocolMsg &reply)
+{
+    /*
+     * Hash a run of PAYLOAD_CHUNK_BYTES-sized blocks from a game's payload.
+     * The final block is hashed only up to the end of the payload span.
+     */
+
+    reply.header |= PayloadHashes;
+
+    if (m.payloadLen() < sizeof(PayloadHashRequest))
+        return;
+
+    const PayloadHashRequest *req = m.castPayload<PayloadHashRequest>();
+    FlashVolume vol = FlashMapBlock::fromCode(req->volume);
+    if (!vol.isValid() || vol.getType() != FlashVolume::T_GAME)
+        return;
+
+    FlashBlockRef spanRef;
+    FlashMapSpan span = vol.getPayload(spanRef);
+    uint32_t size = span.sizeInBytes();
+
+    PayloadHashReply *r = reply.zeroCopyAppend<PayloadHashReply>();
+    r->firstChunk = req->firstChunk;
+    r->numChunks = (size + PAYLOAD_CHUNK_BYTES - 1) / PAYLOAD_CHUNK_BYTES;
+
+    for (unsigned i = 0; i < PAYLOAD_HASHES_PER_REPLY; ++i) {
+        uint32_t chunk = req->firstChunk + i;
+        uint64_t hash = PAYLOAD_HASH_INIT;
+
+        if (chunk < r->numChunks) {
+            uint32_t offset = chunk * PAYLOAD_CHUNK_BYTES;
+            uint32_t remaining = MIN(size - offset, PAYLOAD_CHUNK_BYTES);
+
+            while (remaining) {
+                FlashBlockRef dataRef;
+                FlashMapSpan::PhysAddr pa;
+                uint32_t part = remaining;
+                if (!span.getBytes(dataRef, offset, pa, part))
+                    break;
+                hash = payloadHash(hash, pa, part);
+                offset += part;
+                remaining -= part;
+            }
+        }
+
+        r->hashes[i] = hash;
+    }
 }
 
 void UsbVolumeManager::volumeOverview(USBProtocolMsg &reply)
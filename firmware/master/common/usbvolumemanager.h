@@ -58,9 +58,86 @@ public:
         WriteLFSObjectHeader,
         WriteLFSObjectHeaderFail,
         WriteLFSObjectPayload,
-        DeleteLFSChildren
+        DeleteLFSChildren,
+        WritePayloadChunk,
+        WritePayloadChunkAck,
+        WritePayloadChunkFail,
+        PayloadHashes,
+        WriteGameDeltaHeader
     };
 
+    /*
+     * Optional features, reported as a single byte of payload in the
+     * WroteHeaderOK reply. Older firmware sends no payload at all.
+     */
+    enum InstallFeatures {
+        FeatureCompressedPayload    = 1 << 0,
+    };
+
+    /*
+     * Compressed payloads are sent as a stream of chunks, each preceded
+     * by a PayloadChunkHeader. WritePayloadChunk packets carry this stream
+     * with no other framing; a chunk header or body may be split across
+     * packets. Each chunk decodes to at most PAYLOAD_CHUNK_BYTES. If
+     * codedLen == rawLen, the chunk is stored uncompressed, otherwise it's
+     * FastLZ level 1.
+     *
+     * After each chunk is programmed, the device replies with
+     * WritePayloadChunkAck and a 32-bit count of chunks written so far.
+     * The host keeps at most PAYLOAD_CHUNK_WINDOW chunks unacknowledged.
+     *
+     * For a volume started with WriteGameDeltaHeader, a chunk with
+     * codedLen == 0 is a copy: its body is a 32-bit byte offset into the
+     * base volume's payload, and rawLen bytes are copied from there.
+     */
+    static const unsigned PAYLOAD_CHUNK_BYTES = 1024;
+    static const unsigned PAYLOAD_CHUNK_WINDOW = 4;
+
+    /*
+     * Chunks are decompressed in place: the coded body is received at the
+     * end of chunkBuffer, and decoded toward the beginning. FastLZ level 1
+     * never expands a run of input by more than one control byte per 32
+     * literals, so with this much slack the decoder can't overwrite any
+     * compressed bytes it hasn't read yet.
+     */
+    static const unsigned PAYLOAD_CHUNK_SLACK = PAYLOAD_CHUNK_BYTES / 32 + 2;
+
+    struct PayloadChunkHeader {
+        uint16_t rawLen;
+        uint16_t codedLen;
+    };
+
+    /*
+     * Delta installs. The host asks for hashes of each PAYLOAD_CHUNK_BYTES
+     * block of an existing volume's payload, compares them with the new
+     * file, then sends WriteGameDeltaHeader (payload size, base volume,
+     * package string) followed by a chunk stream that copies unchanged
+     * blocks out of the base volume. The base volume is deleted on commit.
+     */
+    static const unsigned PAYLOAD_HASHES_PER_REPLY = 6;
+
+    struct PayloadHashRequest {
+        uint32_t volume;
+        uint32_t firstChunk;
+    };
+
+    struct PayloadHashReply {
+        uint32_t firstChunk;
+        uint32_t numChunks;     // Total in the volume's payload
+        uint64_t hashes[PAYLOAD_HASHES_PER_REPLY];
+    };
+
+    /// 64-bit FNV-1a, used for comparing payload blocks
+    static const uint64_t PAYLOAD_HASH_INIT = 0xcbf29ce484222325ULL;
+
+    static uint64_t payloadHash(uint64_t hash, const uint8_t *bytes, unsigned len) {
+        while (len--) {
+            hash ^= *(bytes++);
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
     struct VolumeOverviewReply {
         unsigned systemBytes;
         unsigned freeBytes;
@@ -131,8 +208,18 @@ private:
         uint32_t endAddr;
     };
 
+    struct PayloadChunkStatus {
+        PayloadChunkHeader header;
+        uint16_t fill;          // Bytes of header + body received so far
+        bool failed;
+        uint32_t count;         // Chunks written
+    };
+
     static FlashVolumeWriter writer;
     static LFSObjectWriteStatus lfsWriter;
+    static PayloadChunkStatus chunkStatus;
+    static FlashVolume deltaBase;
+    static uint8_t chunkBuffer[PAYLOAD_CHUNK_BYTES + PAYLOAD_CHUNK_SLACK];
 
     // handlers
     static ALWAYS_INLINE void volumeOverview(USBProtocolMsg &reply);
@@ -145,6 +232,12 @@ private:
     static ALWAYS_INLINE void baseSysInfo(const USBProtocolMsg &m, USBProtocolMsg &reply);
     static ALWAYS_INLINE void beginLFSObjectWrite(const USBProtocolMsg &m, USBProtocolMsg &reply);
     static ALWAYS_INLINE void lfsPayloadWrite(const USBProtocolMsg &m);
+    static ALWAYS_INLINE void beginPayloadChunks(USBProtocolMsg &reply);
+    static ALWAYS_INLINE void beginGameDelta(const USBProtocolMsg &m, USBProtocolMsg &reply);
+    static ALWAYS_INLINE void payloadHashes(const USBProtocolMsg &m, USBProtocolMsg &reply);
+    static bool isGameWithPackage(FlashVolume vol, const char *package);
+    static void payloadChunkWrite(const USBProtocolMsg &m);
+    static bool finishPayloadChunk();
 };
 
 #endif // _USB_VOLUME_MANAGER_H
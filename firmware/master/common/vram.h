@@ -155,6 +155,42 @@ struct VRAM {
 };
 
 
+/**
+ * Batched equivalent of a long sequence of VRAM::poke() calls.
+ *
+ * We skip the lock (and its barrier) for any chunk that's already locked.
+ * That has to be decided from the live lock word, not from what we've
+ * locked so far: the radio ISR may acknowledge a frame and unlock our
+ * chunks at any point during the batch, after which the next write to
+ * that chunk must lock it again. The cm1 bit for every word is set as
+ * soon as that word is written, so the codec finds every change we've made.
+ */
+
+class VRAMBatchWriter {
+public:
+    VRAMBatchWriter(_SYSVideoBuffer &vbuf)
+        : vbuf(vbuf) {}
+
+    void poke(uint16_t addr, uint16_t word) {
+        VRAM::truncateWordAddr(addr);
+        if (vbuf.vram.words[addr] != word) {
+            if (!(vbuf.lock & VRAM::maskCM16(addr)))
+                VRAM::lock(vbuf, addr);
+            vbuf.vram.words[addr] = word;
+            Atomic::SetLZ(VRAM::selectCM1(vbuf, addr), VRAM::indexCM1(addr));
+        }
+    }
+
+    ALWAYS_INLINE uint16_t peek(uint16_t addr) const {
+        VRAM::truncateWordAddr(addr);
+        return VRAM::peek(vbuf, addr);
+    }
+
+private:
+    _SYSVideoBuffer &vbuf;
+};
+
+
 /**
  * An iterator for walking the BG1 mask bitmap.
  *
@@ -39,6 +39,7 @@ XmTrackerPattern *XmTrackerPattern::init(_SYSXMSong *pSong)
     }
 
     memset(&pattern, 0, sizeof(pattern));
+    cachedRow = kNoRow;
 
     return this;
 }
@@ -73,6 +74,8 @@ bool XmTrackerPattern::loadPattern(uint16_t i)
 
     noteOffset = 0;
     offset = 0;
+    bufferPos = bufferLen = 0;
+    cachedRow = kNoRow;
     return true;
 }
 
@@ -98,37 +101,99 @@ void XmTrackerPattern::getNote(uint16_t row, uint8_t channel, struct XmTrackerNo
         resetNote(note);
         return;
     }
+
+    if (row != cachedRow && !prefetchRow(row)) {
+        resetNote(note);
+        return;
+    }
+
+    note = rowNotes[channel];
+}
+
+bool XmTrackerPattern::prefetchRow(uint16_t row)
+{
+    if (row == cachedRow)
+        return true;
+
+    if (!song || row >= pattern.nRows)
+        return false;
+
     /* This is not an error condition, but can happen on an empty pattern.
      * Indicated by 64 rows, but no pData/dataSize.
      */
     if (!pattern.dataSize || !pattern.pData) {
         // TODO: test empty patterns
-        LOG((LGPFX"Notice: Emitting empty note\n"));
-        resetNote(note);
-        return;
+        LOG((LGPFX"Notice: Emitting empty row\n"));
+        for (unsigned i = 0; i < song->nChannels; i++)
+            resetNote(rowNotes[i]);
+        cachedRow = row;
+        return true;
     }
 
-    uint32_t noteIndex = row * song->nChannels + channel;
+    uint32_t noteIndex = row * song->nChannels;
 
     if (noteIndex < noteOffset) {
         /* This happens on fxLoopPattern, but isn't terribly efficient.
          * Composers should avoid if reasonable (Workaround: more patterns).
          */
-        if (row * song->nChannels + channel > 0)
-            LOG((LGPFX"Notice: Had to seek(0) to get to note %u\n", row * song->nChannels + channel));
+        if (noteIndex > 0)
+            LOG((LGPFX"Notice: Had to seek(0) to get to note %u\n", noteIndex));
         offset = 0;
         noteOffset = 0;
+        bufferPos = bufferLen = 0;
     } else if (noteIndex > noteOffset) {
         /* This happens on fxPatternBreak, but isn't very efficient.
          * Composers should avoid if reasonable (Workaround: more patterns).
          */
-        LOG((LGPFX"Notice: Reading past %u notes to get to target\n", row * song->nChannels + channel - noteOffset));
+        LOG((LGPFX"Notice: Reading past %u notes to get to target\n", noteIndex - noteOffset));
+    }
+
+    // Invalidate first, in case we fail partway through the row
+    cachedRow = kNoRow;
+
+    struct XmTrackerNote skipped;
+    while (noteOffset < noteIndex)
+        if (!nextNote(skipped))
+            return false;
+
+    for (unsigned i = 0; i < song->nChannels; i++)
+        if (!nextNote(rowNotes[i]))
+            return false;
+
+    cachedRow = row;
+    return true;
+}
+
+bool XmTrackerPattern::fillBuffer()
+{
+    /*
+     * Refill the read-ahead buffer starting at 'offset'. Reading up to a
+     * full row of notes at once saves a trip through the block cache for
+     * every note. We never read past the end of the pattern data.
+     */
+
+    if (offset >= pattern.dataSize) {
+        LOG((LGPFX"Error: Read past end of pattern data (%u bytes)\n",
+             pattern.dataSize));
+        ASSERT(false);
+        return false;
+    }
+
+    uint32_t length = MIN(sizeof buffer, pattern.dataSize - offset);
+    SvmMemory::VirtAddr va = pattern.pData + offset;
+    if (!SvmMemory::copyROData(ref, reinterpret_cast<SvmMemory::PhysAddr>(buffer), va, length)) {
+        LOG((LGPFX"Error: Could not copy %p (length %lu)!\n",
+                 (void *)va, (long unsigned)length));
+        ASSERT(false);
+        return false;
     }
 
-    while(noteIndex >= noteOffset) nextNote(note);
+    bufferPos = 0;
+    bufferLen = length;
+    return true;
 }
 
-void XmTrackerPattern::nextNote(struct XmTrackerNote &note)
+bool XmTrackerPattern::nextNote(struct XmTrackerNote &note)
 {
     /* The maximum amount of space a note can take up is 6 bytes, if the note
      * is encoded and still conatains all  the members of XmTrackerNote.
@@ -136,17 +201,26 @@ void XmTrackerPattern::nextNote(struct XmTrackerNote &note)
      * the space an uncompressed note occupies, and stir verifies that patterns
      * are encoded as efficiently as possible.
      */
-    uint8_t noteData[6];
-    SvmMemory::VirtAddr va = pattern.pData + offset;
-    if(!SvmMemory::copyROData(ref, noteData, va, sizeof(noteData))) {
-        LOG((LGPFX"Error: Could not copy %p (length %lu)!\n",
-                 (void *)va, (long unsigned)sizeof(noteData)));
+    unsigned available = bufferLen - bufferPos;
+    if (available < kMaxNoteSize && offset + available < pattern.dataSize) {
+        if (!fillBuffer()) {
+            resetNote(note);
+            return false;
+        }
+        available = bufferLen;
+    }
+
+    // An empty buffer here means we've run off the end of the pattern
+    const uint8_t *buf = buffer + bufferPos;
+    unsigned size = !available ? 1 : (*buf & 0x80) ? Intrinsic::POPCOUNT(*buf & 0x9F) : 5;
+
+    if (size > available) {
+        LOG((LGPFX"Error: Truncated note at offset %u\n", (unsigned)offset));
         ASSERT(false);
         resetNote(note);
-        return;
+        return false;
     }
 
-    uint8_t *buf = noteData;
     if (*buf & 0x80) {
         uint8_t enc = *(buf++);
         // encoded note
@@ -156,7 +230,6 @@ void XmTrackerPattern::nextNote(struct XmTrackerNote &note)
         note.effectType =       enc & (1 << 3) ? *(buf++) : kNoEffect;
         note.effectParam =      enc & (1 << 4) ? *(buf++) : kNoParam;
         // If enc & 0x60 > 0 the pattern is likely corrupt, but follow Postel's Law.
-        offset += Intrinsic::POPCOUNT(enc & 0x9F);
     } else {
         // unencoded note
         note.note =             *(buf++);
@@ -164,8 +237,9 @@ void XmTrackerPattern::nextNote(struct XmTrackerNote &note)
         note.volumeColumnByte = *(buf++);
         note.effectType =       *(buf++);
         note.effectParam =      *(buf++);
-        offset += 5;
     }
+    bufferPos += size;
+    offset += size;
     noteOffset++;
 
     // If the effect parameter is set but the effect was not, it was intended to be an arpeggio (effect 0)
@@ -206,4 +280,6 @@ void XmTrackerPattern::nextNote(struct XmTrackerNote &note)
         ASSERT(note.note);
         note.note = kNoNote;
     }
+
+    return true;
 }
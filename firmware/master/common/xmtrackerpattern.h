@@ -38,15 +38,24 @@ struct XmTrackerNote {
     uint8_t effectParam;
 };
 
+/*
+ * Notes are decoded one whole row at a time, into a small row cache.
+ * Packed note data is read from flash in chunks, rather than one note
+ * at a time. The player calls prefetchRow() on ticks between rows, so
+ * that by the time it needs the next row, the row is usually decoded
+ * and waiting.
+ */
+
 class XmTrackerPattern {
 public:
-    XmTrackerPattern() : song(0) { memset(&pattern, 0, sizeof(pattern)); }
+    XmTrackerPattern() : song(0), cachedRow(kNoRow) { memset(&pattern, 0, sizeof(pattern)); }
     uint16_t nRows() { return pattern.nRows; }
     void releaseRef() { ref.release(); }
 
     XmTrackerPattern *init(_SYSXMSong *pSong);
     bool loadPattern(uint16_t i);
     void getNote(uint16_t row, uint8_t channel, struct XmTrackerNote &note);
+    bool prefetchRow(uint16_t row);
 
     static void resetNote(struct XmTrackerNote &note) {
         note.note = kNoteOff;
@@ -63,8 +72,13 @@ public:
     static const uint8_t kNoEffect = 0xFF;
     static const uint8_t kNoParam = 0xFF;
     static const uint8_t kNoVolume = 0x55;
+    static const uint16_t kNoRow = 0xFFFF;
 private:
-    void nextNote(struct XmTrackerNote &note); // Pattern iterator
+    // Largest possible encoded note, see nextNote()
+    static const unsigned kMaxNoteSize = 6;
+
+    bool nextNote(struct XmTrackerNote &note); // Pattern iterator
+    bool fillBuffer();
 
     _SYSXMSong *song;
 
@@ -73,6 +87,15 @@ private:
 
     uint32_t noteOffset; // Index of next note within pattern
     uintptr_t offset;    // Offset of next note within pattern
+
+    // Packed note data, read ahead from 'offset'
+    uint8_t buffer[_SYS_AUDIO_MAX_CHANNELS * kMaxNoteSize];
+    uint8_t bufferPos;
+    uint8_t bufferLen;
+
+    // Decoded notes for one row
+    XmTrackerNote rowNotes[_SYS_AUDIO_MAX_CHANNELS];
+    uint16_t cachedRow;
 };
 
 #endif // XMTRACKERPATTERN_H_
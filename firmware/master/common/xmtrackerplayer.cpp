@@ -119,6 +119,7 @@ bool XmTrackerPlayer::play(const struct _SYSXMSong *pSong)
         memset(&ch, 0, sizeof ch);
 
         XmTrackerPattern::resetNote(ch.note);
+        ch.envelope.reset();
         ch.userVolume = usrVol;
         ch.state = STATE_STOPPED;
     }
@@ -301,6 +302,7 @@ inline void XmTrackerPlayer::loadNextNotes()
                 stop();
                 return;
             }
+            channel.envelope.cachedPoint = XmTrackerEnvelopeMemory::kNoPoint;
         } else if (note.instrument >= song.nInstruments) {
             // Invalid instrument--play nothing.
             channel.instrument.sample.pData = 0;
@@ -314,7 +316,7 @@ inline void XmTrackerPlayer::loadNextNotes()
         if (!recNote) {
             if (channel.realNote(note.note)) {
                 if ((channel.instrument.volumeType & (kEnvelopeSustain | kEnvelopeLoop)) == 0 || channel.envelope.done) {
-                    memset(&channel.envelope, 0, sizeof(channel.envelope));
+                    channel.envelope.reset();
                     channel.envelope.done = !channel.instrument.nVolumeEnvelopePoints;
                 }
 
@@ -1041,43 +1043,41 @@ void XmTrackerPlayer::processEnvelope(XmTrackerChannel &channel)
     }
 
     int16_t pointLength = 0;
-    uint16_t envPt0 , envPt1 = 0;
     if (envelope.point == instrument.nVolumeEnvelopePoints) {
         // End of envelope
         channel.state = STATE_STOP;
         return;
-    } else if (envelope.point == instrument.nVolumeEnvelopePoints - 1) {
-        envelope.done = true;
+    } else if (envelope.point > instrument.nVolumeEnvelopePoints) {
+        ASSERT(envelope.point < instrument.nVolumeEnvelopePoints);
+        envelope.point = instrument.nVolumeEnvelopePoints - 1;
+        processEnvelope(channel);
+        return;
+    }
 
-        // Load the last envelope point from flash.
-        SvmMemory::VirtAddr va = instrument.volumeEnvelopePoints + envelope.point * sizeof(uint16_t);
-        if (!SvmMemory::copyROData(envPt0, va)) {
-            LOG((LGPFX"Error: Could not copy %p (length %lu)!\n",
-                 (void *)va, (long unsigned)sizeof(envPt0)));
-            ASSERT(false); stop(); return;
-        }
-    } else {
-        if (envelope.point >= instrument.nVolumeEnvelopePoints) {
-            ASSERT(envelope.point < instrument.nVolumeEnvelopePoints);
-            envelope.point = instrument.nVolumeEnvelopePoints - 1;
-            processEnvelope(channel);
-            return;
-        }
+    bool lastPoint = envelope.point == instrument.nVolumeEnvelopePoints - 1;
 
-        // Load current and next envelope points from flash.
-        FlashBlockRef ref;
+    /*
+     * Load the current envelope segment from flash, only when we move on
+     * to a new point. The last point has no following segment, so it's
+     * loaded on its own.
+     */
+    if (envelope.cachedPoint != envelope.point) {
         SvmMemory::VirtAddr va = instrument.volumeEnvelopePoints + envelope.point * sizeof(uint16_t);
-        if (!SvmMemory::copyROData(ref, envPt0, va)) {
-            LOG((LGPFX"Error: Could not copy %p (length %lu)!\n",
-                 (void *)va, (long unsigned)sizeof(envPt0)));
-            ASSERT(false); stop(); return;
-        }
-        if (!SvmMemory::copyROData(ref, envPt1, va + sizeof(uint16_t))) {
+        uint32_t length = lastPoint ? sizeof(uint16_t) : sizeof(envelope.segment);
+        FlashBlockRef ref;
+        if (!SvmMemory::copyROData(ref, reinterpret_cast<SvmMemory::PhysAddr>(envelope.segment), va, length)) {
             LOG((LGPFX"Error: Could not copy %p (length %lu)!\n",
-                 (void *)(va + sizeof(uint16_t)), (long unsigned)sizeof(envPt1)));
+                 (void *)va, (long unsigned)length));
             ASSERT(false); stop(); return;
         }
+        envelope.cachedPoint = envelope.point;
+    }
 
+    uint16_t envPt0 = envelope.segment[0];
+    uint16_t envPt1 = envelope.segment[1];
+    if (lastPoint) {
+        envelope.done = true;
+    } else {
         pointLength = envelopeOffset(envPt1) - envelopeOffset(envPt0);
     }
 
@@ -1272,6 +1272,10 @@ void XmTrackerPlayer::tick()
         // load next notes into the process channels
         loadNextNotes();
         if (isStopped()) return;
+    } else if (!next.force && next.row < pattern.nRows()) {
+        // Between rows, decode the next row ahead of time
+        pattern.prefetchRow(next.row);
+        pattern.releaseRef();
     }
 
     // process effects and envelopes
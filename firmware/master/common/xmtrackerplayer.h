@@ -33,10 +33,21 @@
 #include "macros.h"
 
 struct XmTrackerEnvelopeMemory {
+    static const uint8_t kNoPoint = 0xFF;
+
     int16_t tick;
     uint8_t point;
     uint8_t value;
     bool done;
+
+    // Envelope points at 'cachedPoint' and the one after, from flash
+    uint8_t cachedPoint;
+    uint16_t segment[2];
+
+    void reset() {
+        memset(this, 0, sizeof *this);
+        cachedPoint = kNoPoint;
+    }
 };
 
 struct XmTrackerChannel {
@@ -56,9 +56,14 @@ namespace DacAudioOut {
          * DMA half-complete or complete IRQ.
          * Poke the mixer, asynchronously ask it to fill the buffer some more.
          * Update our ring buffer's pointers.
+         *
+         * The DMA doesn't stop when the ring runs dry; if it consumed
+         * more than the mixer had written, it replayed stale samples.
          */
 
-        AudioMixer::output.dequeueWithDMACount(dmaChannel->CNDTR);
+        unsigned available = AudioMixer::output.readAvailable();
+        if (AudioMixer::output.dequeueWithDMACount(dmaChannel->CNDTR) > available)
+            AudioMixer::instance.outputStarved();
         Tasks::trigger(Tasks::AudioPull);
     }
 }
@@ -159,6 +159,10 @@ int main()
     // This is the earliest point at which it's safe to use Usart::Dbg.
     Usart::Dbg.init(UART_RX_GPIO, UART_TX_GPIO, 115200);
 
+#ifdef AUDIO_BENCHMARK
+    AudioResampler::benchmark();
+#endif
+
 #ifdef REV2_GDB_REWORK
     DBGMCU_CR |= (1 << 30) |        // TIM14 stopped when core is halted
                  (1 << 29) |        // TIM13 ""
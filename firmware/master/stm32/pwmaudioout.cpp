@@ -157,6 +157,9 @@ IRQ_HANDLER ISR_FN(AUDIO_SAMPLE_TIM)()
     GPIOPin::Control ctrlA = GPIOPin::OUT_2MHZ;
     GPIOPin::Control ctrlB = GPIOPin::OUT_2MHZ;
 
+    if (UNLIKELY(AudioMixer::output.empty()))
+        AudioMixer::instance.outputStarved();
+
     while (!AudioMixer::output.empty()) {
         int sample = AudioMixer::output.dequeue();
 
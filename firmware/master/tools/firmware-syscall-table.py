@@ -147,4 +147,19 @@ for i in range(highestNum+1):
 
     print "    /* %4d */ %s %s," % (i, typedef, name)
 
+print "};\n"
+
+#
+# Syscall names, for statistics and debugging in the simulator.
+#
+
+print "#ifdef SIFTEO_SIMULATOR"
+print "static const char * const SyscallNames[] = {"
+for i in range(highestNum+1):
+    name = callMap.get(i)
+    if name:
+        print '    /* %4d */ "%s",' % (i, name)
+    else:
+        print "    /* %4d */ 0," % i
 print "};"
+print "#endif"
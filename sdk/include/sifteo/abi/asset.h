@@ -43,7 +43,7 @@ extern "C" {
 
 
 struct _SYSAssetGroupHeader {
-    uint8_t reserved;                       /// OUT     Reserved, must be zero
+    uint8_t flags;                          /// OUT     _SYS_AGF_* bits
     uint8_t ordinal;                        /// OUT     Small integer, unique within an ELF
     uint16_t numTiles;                      /// OUT     Uncompressed size, in tiles
     uint32_t dataSize;                      /// OUT     Size of compressed data, in bytes
@@ -51,6 +51,31 @@ struct _SYSAssetGroupHeader {
     // Followed by compressed data
 };
 
+#define _SYS_AGF_TILE_REFS      (1 << 0)    /// A _SYSAssetGroupTileRefs table follows the data
+
+/*
+ * Optional table of tile runs that were also found in other AssetGroups from
+ * the same ELF. It starts at the first 4-byte aligned address after the
+ * compressed data. When the other group is already installed, the loader
+ * can ask the cube to copy those tiles instead of sending this group's
+ * encoding of them.
+ */
+
+struct _SYSAssetGroupTileRefs {
+    uint16_t numRefs;           /// OUT     Number of _SYSAssetGroupTileRef entries
+    uint16_t reserved;          /// OUT     Reserved, must be zero
+    // Followed by a _SYSAssetGroupTileRef array, sorted by offset
+};
+
+struct _SYSAssetGroupTileRef {
+    uint32_t offset;            /// OUT     Loadstream offset of a run of tiles
+    uint16_t length;            /// OUT     Length of the run's encoding, in bytes
+    uint16_t tile;              /// OUT     First tile in the run, relative to this group
+    uint16_t srcTile;           /// OUT     Matching first tile, relative to the source group
+    uint8_t srcOrdinal;         /// OUT     Ordinal of the source group
+    uint8_t numTiles;           /// OUT     Length of the run, in tiles
+};
+
 struct _SYSAssetGroupCube {
     uint16_t baseAddr;          /// IN     Installed base address, in tiles
 };
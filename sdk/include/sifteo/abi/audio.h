@@ -111,6 +111,18 @@ struct _SYSXMSong {
     uint16_t bpm;                   /// Default beats per minute (notes)
 };
 
+/*
+ * Mixer output statistics, for tuning audio buffering.
+ * All sample counts are at the mixer's output rate (16 kHz).
+ */
+struct _SYSAudioCounters {
+    uint32_t mixedSamples;          /// Total samples produced by the mixer
+    uint32_t underruns;             /// Times the output device ran dry while audio was playing
+    uint32_t fillTarget;            /// Samples the mixer currently tries to keep buffered
+    uint32_t minFill;               /// Fewest samples left in the buffer when the mixer ran (this game)
+    uint32_t maxLatency;            /// Most samples buffered ahead of the output device (this game)
+};
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif
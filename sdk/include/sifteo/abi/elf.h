@@ -80,6 +80,7 @@ struct _SYSMetadataKey {
 #define _SYS_METADATA_CUBE_RANGE        0x0008  // _SYSMetadataCubeRange
 #define _SYS_METADATA_MIN_OS_VERSION    0x0009  // uint32_t minimum OS version required
 #define _SYS_METADATA_IS_DEMO_OF_STR    0x000a  // DNS-style string of the full version of this demo app
+#define _SYS_METADATA_PREFETCH_HINTS    0x000b  // Array of _SYSMetadataPrefetchHint, sorted by 'block'
 
 struct _SYSMetadataBootAsset {
     uint32_t        pHdr;           // Virtual address for _SYSAssetGroupHeader
@@ -101,6 +102,21 @@ struct _SYSMetadataImage {
     uint32_t  pData;            /// Format-specific data or data pointer
 };
 
+/*
+ * Code prefetch hints, generated by the linker. Each hint names a flash
+ * block in the RO segment and a block that execution is likely to enter
+ * soon after it. Block indices are byte offsets into the RO segment divided
+ * by the flash block size. A hint whose block and successor are equal ends
+ * the table, so any unused tail of the array is ignored.
+ */
+
+#define _SYS_MAX_PREFETCH_HINTS     64
+
+struct _SYSMetadataPrefetchHint {
+    uint16_t    block;          // Block that was entered
+    uint16_t    successor;      // Block to preload
+};
+
 /*
  * Entry point. Our standard entry point is main(), with no arguments
  * or return values, declared using C linkage.
@@ -212,6 +212,7 @@ int32_t _SYS_audio_volume(_SYSAudioChannelID ch) _SC(135);
 void _SYS_audio_setVolume(_SYSAudioChannelID ch, int32_t volume) _SC(136);
 void _SYS_audio_setSpeed(_SYSAudioChannelID ch, uint32_t sampleRate) _SC(137);
 uint32_t _SYS_audio_pos(_SYSAudioChannelID ch) _SC(138);
+uint32_t _SYS_audio_counters(struct _SYSAudioCounters *buffer, uint32_t bufferSize) _SC(200);
 uint32_t _SYS_tracker_play(const struct _SYSXMSong *song) _SC(51);
 uint32_t _SYS_tracker_isStopped() _SC(139);
 void _SYS_tracker_stop() _SC(63);
@@ -247,6 +248,7 @@ void _SYS_vbuf_writei(struct _SYSVideoBuffer *vbuf, uint16_t addr, const uint16_
 void _SYS_vbuf_wrect(struct _SYSVideoBuffer *vbuf, uint16_t addr, const uint16_t *src, uint16_t offset, uint16_t count, uint16_t lines, uint16_t src_stride, uint16_t addr_stride) _SC(154);
 void _SYS_vbuf_spr_resize(struct _SYSVideoBuffer *vbuf, unsigned id, unsigned width, unsigned height) _SC(155);
 void _SYS_vbuf_spr_move(struct _SYSVideoBuffer *vbuf, unsigned id, int x, int y) _SC(156);
+void _SYS_vbuf_cmdlist(struct _SYSVideoBuffer *vbuf, const uint16_t *cmds, uint16_t count) _SC(199);
 
 // Motion buffers
 void _SYS_motion_integrate(const struct _SYSMotionBuffer *mbuf, unsigned duration, struct _SYSInt3 *result) _SC(176);
@@ -190,7 +190,10 @@ struct _SYSPseudoRandomState {
 
 #define _SYS_FEATURE_SYS_VERSION    (1 << 0)
 #define _SYS_FEATURE_BLUETOOTH      (1 << 1)
-#define _SYS_FEATURE_ALL            (_SYS_FEATURE_SYS_VERSION | _SYS_FEATURE_BLUETOOTH)
+#define _SYS_FEATURE_VBUF_CMDLIST   (1 << 2)
+#define _SYS_FEATURE_AUDIO_COUNTERS (1 << 3)
+#define _SYS_FEATURE_ALL            (_SYS_FEATURE_SYS_VERSION | _SYS_FEATURE_BLUETOOTH | \
+                                     _SYS_FEATURE_VBUF_CMDLIST | _SYS_FEATURE_AUDIO_COUNTERS)
 
 /*
  * Hardware IDs are 64-bit numbers that uniquely identify a
@@ -297,6 +297,43 @@ struct _SYSAttachedVideoBuffer {
 #define _SYS_INVERSE_TILE77(_t77)   ((((_t77) & 0xFE00) >> 2) | \
                                      (((_t77) & 0x00FE) >> 1))
 
+/*
+ * VRAM command lists, for _SYS_vbuf_cmdlist().
+ *
+ * A command list is an array of 16-bit words, applied to a _SYSVideoBuffer
+ * in a single system call. Each command begins with a header word that has
+ * an opcode in the top 4 bits and a 12-bit argument in the bottom bits.
+ * Operand words follow the header. All addresses are VRAM word addresses,
+ * truncated to _SYS_VRAM_WORD_MASK just like _SYS_vbuf_poke().
+ *
+ *   POKE      arg=N       N pairs of (addr, word)
+ *   FILL      arg=count   addr, word
+ *   WRITE     arg=count   addr, followed by 'count' words
+ *   WRECT     arg=width   addr, lines, addrStride, tileOffset, followed by
+ *                         width*lines tile indices. Each index has tileOffset
+ *                         added to it, and is stored in 7:7 format.
+ *   SPR_MOVE  arg=id      one word: x in the low byte, y in the high byte,
+ *                         both signed. Equivalent to _SYS_vbuf_spr_move().
+ *   BG1_SET   arg=row     one word, ORed with that row of the BG1 bitmap
+ *   BG1_CLEAR arg=row     one word, cleared from that row of the BG1 bitmap
+ *
+ * Any other opcode, or a command which runs past the end of the list,
+ * is a fault.
+ */
+
+#define _SYS_VBUF_CMD_SHIFT         12
+#define _SYS_VBUF_CMD_ARG_MASK      0x0FFF
+#define _SYS_VBUF_CMD(_op, _arg)    (((_op) << _SYS_VBUF_CMD_SHIFT) | \
+                                     ((_arg) & _SYS_VBUF_CMD_ARG_MASK))
+
+#define _SYS_VBUF_CMD_POKE          0x1
+#define _SYS_VBUF_CMD_FILL          0x2
+#define _SYS_VBUF_CMD_WRITE         0x3
+#define _SYS_VBUF_CMD_WRECT         0x4
+#define _SYS_VBUF_CMD_SPR_MOVE      0x5
+#define _SYS_VBUF_CMD_BG1_SET       0x6
+#define _SYS_VBUF_CMD_BG1_CLEAR     0x7
+
 #ifdef __cplusplus
 }  // extern "C"
 #endif
@@ -278,6 +278,71 @@ struct AudioTracker {
     }
 };
 
+
+/**
+ * @brief Diagnostic counters for the audio mixer
+ *
+ * These describe how well the mixer is keeping up with the audio
+ * hardware. An underrun means the output ran out of data while sound
+ * was playing, which is heard as a click or dropout. The mixer adjusts
+ * how far ahead it works (fillTarget()) to stay just clear of underruns,
+ * so audio latency stays as low as the game's frame timing allows.
+ *
+ * The default constructor leaves AudioCounters uninitialized.
+ * Call reset() once before the event you want to measure, and call
+ * capture() to grab the latest counter values. Accessors for totals
+ * compare the latest counters with the reference values read by reset().
+ * All sample counts are at AudioChannel's 16 kHz output rate.
+ */
+
+struct AudioCounters
+{
+    _SYSAudioCounters current;
+    _SYSAudioCounters base;
+
+    /**
+     * @brief Reset all counters back to zero
+     *
+     * This captures a baseline value for all counters. This must be
+     * called once before using the counters to measure changes.
+     */
+    void reset() {
+        _SYS_audio_counters(&base, sizeof base);
+    }
+
+    /**
+     * @brief Update the state of all counters
+     */
+    void capture() {
+        _SYS_audio_counters(&current, sizeof current);
+    }
+
+    /// Total samples produced by the mixer
+    uint32_t mixedSamples() {
+        return current.mixedSamples - base.mixedSamples;
+    }
+
+    /// Total number of times the output ran dry while audio was playing
+    uint32_t underruns() {
+        return current.underruns - base.underruns;
+    }
+
+    /// Number of samples the mixer is currently trying to keep buffered
+    uint32_t fillTarget() {
+        return current.fillTarget;
+    }
+
+    /// Fewest samples that were left to play when the mixer ran, in this game
+    uint32_t minFill() {
+        return current.minFill;
+    }
+
+    /// Most samples ever buffered ahead of the output, in this game
+    uint32_t maxLatency() {
+        return current.maxLatency;
+    }
+};
+
 /**
  * @} endgroup Audio
  */
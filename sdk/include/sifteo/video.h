@@ -39,6 +39,7 @@
 #include <sifteo/video/bg1.h>
 #include <sifteo/video/bg2.h>
 #include <sifteo/video/tilebuffer.h>
+#include <sifteo/video/commandlist.h>
 
 namespace Sifteo {
 
@@ -643,6 +644,18 @@ struct VideoBuffer {
     uint8_t peekb(uint16_t addr) const {
         return _SYS_vbuf_peekb(*this, addr);
     }
+
+    /**
+     * @brief Apply a VideoCommandList to this buffer.
+     *
+     * All of the list's modifications happen in a single system call,
+     * with the same locking and change tracking as the equivalent
+     * sequence of individual poke(), fill(), or sprite calls.
+     */
+    template <unsigned tCapacity>
+    void apply(const VideoCommandList<tCapacity> &list) {
+        list.apply(*this);
+    }
 };
 
 /**
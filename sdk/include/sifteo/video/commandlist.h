@@ -0,0 +1,237 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo SDK
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#pragma once
+#ifdef NOT_USERSPACE
+#   error This is a userspace-only header, not allowed by the current build.
+#endif
+
+#include <sifteo/abi.h>
+#include <sifteo/macros.h>
+#include <sifteo/math.h>
+
+namespace Sifteo {
+
+/**
+ * @addtogroup video
+ * @{
+ */
+
+/**
+ * @brief A list of VRAM modifications, applied to a VideoBuffer in one
+ * system call.
+ *
+ * Every VideoBuffer method that modifies VRAM is a separate system call.
+ * That's usually fine, but games which update many small pieces of VRAM
+ * every frame (moving lots of sprites, plotting scattered tiles) can end
+ * up spending much of their frame time just entering and leaving the
+ * system. A VideoCommandList lets you record those same modifications
+ * into a buffer in RAM, then apply them all at once with
+ * VideoBuffer::apply().
+ *
+ * The template parameter is the capacity of the list, in 16-bit words.
+ * Each command takes a small header plus its operands; for example, a
+ * single poke() takes three words, and a sprite move() takes two.
+ * If a command doesn't fit, it's dropped and overflowed() returns true.
+ *
+ * A VideoCommandList can be applied any number of times, to any number
+ * of VideoBuffers. Use clear() to start recording a new list.
+ *
+ * @code
+ *     VideoCommandList<64> cmds;
+ *     for (unsigned i = 0; i < 8; ++i)
+ *         cmds.moveSprite(i, positions[i]);
+ *     cmds.pokei(addr, tile);
+ *     vid.apply(cmds);
+ * @endcode
+ */
+
+template <unsigned tCapacity>
+struct VideoCommandList {
+    uint16_t words[tCapacity];
+    uint16_t count;
+    uint16_t lastPoke;
+    uint16_t lastPokeHeader;
+    bool overflow;
+
+    VideoCommandList() {
+        clear();
+    }
+
+    /// Remove all commands from the list
+    void clear() {
+        count = 0;
+        overflow = false;
+        lastPoke = 0;
+    }
+
+    /// Number of 16-bit words currently used by the list
+    unsigned size() const {
+        return count;
+    }
+
+    /// Maximum number of 16-bit words this list can hold
+    static unsigned capacity() {
+        return tCapacity;
+    }
+
+    /// Did we run out of space while recording commands?
+    bool overflowed() const {
+        return overflow;
+    }
+
+    /// Equivalent to VideoBuffer::poke()
+    void poke(uint16_t addr, uint16_t word) {
+        /*
+         * Consecutive pokes are merged into a single command, saving one
+         * header word each. This makes lists of scattered pokes nearly
+         * as compact as the equivalent array of (addr, word) pairs.
+         */
+        if (lastPoke && lastPoke == count && reserve(2)) {
+            uint16_t &header = words[lastPokeHeader];
+            if ((header & _SYS_VBUF_CMD_ARG_MASK) != _SYS_VBUF_CMD_ARG_MASK) {
+                header++;
+                words[count++] = addr;
+                words[count++] = word;
+                lastPoke = count;
+                return;
+            }
+        }
+        if (reserve(3)) {
+            lastPokeHeader = count;
+            words[count++] = _SYS_VBUF_CMD(_SYS_VBUF_CMD_POKE, 1);
+            words[count++] = addr;
+            words[count++] = word;
+            lastPoke = count;
+        }
+    }
+
+    /// Equivalent to VideoBuffer::pokei()
+    void pokei(uint16_t addr, uint16_t index) {
+        poke(addr, _SYS_TILE77(index));
+    }
+
+    /// Fill 'count' consecutive words of VRAM with the same value
+    void fill(uint16_t addr, uint16_t word, unsigned n) {
+        ASSERT(n <= _SYS_VBUF_CMD_ARG_MASK);
+        if (reserve(3)) {
+            words[count++] = _SYS_VBUF_CMD(_SYS_VBUF_CMD_FILL, n);
+            words[count++] = addr;
+            words[count++] = word;
+        }
+    }
+
+    /// Copy 'n' words from 'src' into consecutive words of VRAM
+    void write(uint16_t addr, const uint16_t *src, unsigned n) {
+        ASSERT(n <= _SYS_VBUF_CMD_ARG_MASK);
+        if (reserve(2 + n)) {
+            words[count++] = _SYS_VBUF_CMD(_SYS_VBUF_CMD_WRITE, n);
+            words[count++] = addr;
+            while (n--)
+                words[count++] = *(src++);
+        }
+    }
+
+    /**
+     * @brief Write a rectangle of tile indices.
+     *
+     * 'src' is an array of width*height tile indices, with 'srcStride'
+     * indices between rows. Each index has 'offset' added to it.
+     * In VRAM, consecutive rows are 'addrStride' words apart.
+     */
+    void writeRect(uint16_t addr, const uint16_t *src, uint16_t offset,
+        unsigned width, unsigned height, unsigned srcStride, unsigned addrStride)
+    {
+        ASSERT(width <= _SYS_VBUF_CMD_ARG_MASK);
+        if (reserve(5 + width * height)) {
+            words[count++] = _SYS_VBUF_CMD(_SYS_VBUF_CMD_WRECT, width);
+            words[count++] = addr;
+            words[count++] = height;
+            words[count++] = addrStride;
+            words[count++] = offset;
+            for (unsigned y = 0; y < height; ++y, src += srcStride)
+                for (unsigned x = 0; x < width; ++x)
+                    words[count++] = src[x];
+        }
+    }
+
+    /// Equivalent to SpriteRef::move(). Coordinates are truncated to 8 bits.
+    void moveSprite(unsigned id, int x, int y) {
+        ASSERT(id < _SYS_VRAM_SPRITES);
+        if (reserve(2)) {
+            words[count++] = _SYS_VBUF_CMD(_SYS_VBUF_CMD_SPR_MOVE, id);
+            words[count++] = (x & 0xFF) | ((y & 0xFF) << 8);
+        }
+    }
+
+    /// Equivalent to SpriteRef::move(), with a vector position.
+    void moveSprite(unsigned id, Int2 pos) {
+        moveSprite(id, pos.x, pos.y);
+    }
+
+    /**
+     * @brief Set bits in one row of the BG1 allocation mask.
+     *
+     * Like BG1Drawable::setMask(), this changes how existing BG1 tiles are
+     * interpreted. Unlike setMask(), this does not implicitly wait for
+     * rendering to finish; call System::finish() first if you need to.
+     */
+    void setMaskBits(unsigned row, uint16_t bits) {
+        ASSERT(row < _SYS_VRAM_BG1_WIDTH);
+        if (reserve(2)) {
+            words[count++] = _SYS_VBUF_CMD(_SYS_VBUF_CMD_BG1_SET, row);
+            words[count++] = bits;
+        }
+    }
+
+    /// Clear bits in one row of the BG1 allocation mask. See setMaskBits().
+    void clearMaskBits(unsigned row, uint16_t bits) {
+        ASSERT(row < _SYS_VRAM_BG1_WIDTH);
+        if (reserve(2)) {
+            words[count++] = _SYS_VBUF_CMD(_SYS_VBUF_CMD_BG1_CLEAR, row);
+            words[count++] = bits;
+        }
+    }
+
+    /// Apply this command list directly to a low-level _SYSVideoBuffer
+    void apply(_SYSVideoBuffer *vbuf) const {
+        _SYS_vbuf_cmdlist(vbuf, words, count);
+    }
+
+private:
+    bool reserve(unsigned n) {
+        if (count + n > tCapacity) {
+            overflow = true;
+            return false;
+        }
+        return true;
+    }
+};
+
+/**
+ * @} endgroup video
+*/
+
+};  // namespace Sifteo
@@ -112,6 +112,19 @@ void CPPWriter::writeArray(const std::vector<uint8_t> &data)
     mStream << "\n";
 }
 
+void CPPWriter::writeTileRefs(const std::vector<_SYSAssetGroupTileRef> &refs)
+{
+    // One {offset, length, tile, srcTile, srcOrdinal, numTiles} per line
+    char buf[80];
+    for (unsigned i = 0; i < refs.size(); i++) {
+        const _SYSAssetGroupTileRef &r = refs[i];
+        sprintf(buf, "{ %u, %u, %u, %u, %u, %u },",
+            unsigned(r.offset), unsigned(r.length), unsigned(r.tile),
+            unsigned(r.srcTile), unsigned(r.srcOrdinal), unsigned(r.numTiles));
+        mStream << indent << buf << "\n";
+    }
+}
+
 void CPPWriter::writeArray(const std::vector<uint16_t> &data)
 {
     char buf[8];
@@ -126,7 +139,7 @@ void CPPWriter::writeArray(const std::vector<uint16_t> &data)
 }
 
 CPPSourceWriter::CPPSourceWriter(Logger &log, const char *filename)
-    : CPPWriter(log, filename), nextGroupOrdinal(0) {}
+    : CPPWriter(log, filename) {}
 
 bool CPPSourceWriter::writeGroup(const Group &group)
 {
@@ -140,21 +153,28 @@ bool CPPSourceWriter::writeGroup(const Group &group)
         std::vector<uint8_t> crc;
         group.getPool().calculateCRC(crc);
 
-        /*
-         * XXX: This method of generating the group Ordinal only works within
-         *      a single Stir run. Ideally we'd be able to use _SYS_lti_counter
-         *      or equivalent, but there's no efficient way to stick that in
-         *      read-only data yet.
-         */
+        const std::vector<_SYSAssetGroupTileRef> &refs = group.getTileRefs();
+        unsigned flags = refs.empty() ? 0 : _SYS_AGF_TILE_REFS;
 
         mStream <<
             "\n"
             "static const struct {\n" <<
             indent << "struct _SYSAssetGroupHeader hdr;\n" <<
-            indent << "uint8_t data[" << group.getLoadstream().size() << "];\n"
+            indent << "uint8_t data[" << group.getLoadstream().size() << "];\n";
+
+        if (!refs.empty()) {
+            // Nested, so the table is 4-byte aligned like the firmware expects
+            mStream <<
+                indent << "struct {\n" <<
+                indent << indent << "struct _SYSAssetGroupTileRefs hdr;\n" <<
+                indent << indent << "struct _SYSAssetGroupTileRef ref[" << refs.size() << "];\n" <<
+                indent << "} refs;\n";
+        }
+
+        mStream <<
             "} " << group.getName() << "_data = {{\n" <<
-            indent << "/* reserved  */ 0,\n" <<
-            indent << "/* ordinal   */ " << nextGroupOrdinal++ << ",\n" <<
+            indent << "/* flags     */ " << flags << ",\n" <<
+            indent << "/* ordinal   */ " << group.getOrdinal() << ",\n" <<
             indent << "/* numTiles  */ " << group.getPool().size() << ",\n" <<
             indent << "/* dataSize  */ " << group.getLoadstream().size() << ",\n" <<
             indent << "/* crc       */ {\n" <<
@@ -166,8 +186,16 @@ bool CPPSourceWriter::writeGroup(const Group &group)
 
         writeArray(group.getLoadstream());
 
+        if (!refs.empty()) {
+            mStream <<
+                "}, {{\n" <<
+                indent << "/* numRefs   */ " << refs.size() << ",\n" <<
+                "}, {\n";
+            writeTileRefs(refs);
+        }
+
         mStream <<
-            "}};\n\n"
+            (refs.empty() ? "}};\n\n" : "}}};\n\n") <<
             "Sifteo::AssetGroup " << group.getName() << " = {{\n" <<
             indent << "/* pHdr      */ reinterpret_cast<uintptr_t>(&" << group.getName() << "_data.hdr),\n" <<
             "}};\n\n";
@@ -59,6 +59,7 @@ class CPPWriter {
 
     void writeArray(const std::vector<uint8_t> &data);
     void writeArray(const std::vector<uint16_t> &data);
+    void writeTileRefs(const std::vector<_SYSAssetGroupTileRef> &refs);
     void writeString(const std::vector<uint8_t> &data);
 };
 
@@ -81,8 +82,6 @@ class CPPSourceWriter : public CPPWriter {
 
  private:
     void writeImage(const Image &image, bool writeDecl=true, bool writeAsset=true, bool writeData=true);
-
-    unsigned nextGroupOrdinal;
 };
 
 
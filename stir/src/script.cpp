@@ -31,6 +31,7 @@
 #include <sstream>
 
 #include "script.h"
+#include "tilecodec.h"
 #include "proof.h"
 #include "cppwriter.h"
 #include "audioencoder.h"
@@ -106,6 +107,9 @@ bool Script::run(const char *filename)
     CPPHeaderWriter header(log, outputHeader);
     CPPSourceWriter source(log, outputSource);
 
+    TileDictionary dictionary;
+    unsigned nextGroupOrdinal = 0;
+
     for (std::set<Group*>::iterator i = groups.begin(); i != groups.end(); i++) {
         Group *group = *i;
         TilePool &pool = group->getPool();
@@ -121,7 +125,19 @@ bool Script::run(const char *filename)
                 return false;
             }
 
-            pool.encode(group->getLoadstream(), &log);
+            /*
+             * XXX: This method of generating the group Ordinal only works within
+             *      a single Stir run. Ideally we'd be able to use _SYS_lti_counter
+             *      or equivalent, but there's no efficient way to stick that in
+             *      read-only data yet.
+             *
+             * Since ordinals follow encoding order, tiles we find in the
+             * dictionary always come from a group with a lower ordinal.
+             */
+
+            group->setOrdinal(nextGroupOrdinal++);
+            pool.encode(group->getLoadstream(), &log, &dictionary, &group->getTileRefs());
+            dictionary.add(pool, group->getOrdinal());
         }
 
         proof.writeGroup(*group);
@@ -163,6 +163,22 @@ public:
         return mLoadstream;
     }
 
+    std::vector<_SYSAssetGroupTileRef> &getTileRefs() {
+        return mTileRefs;
+    }
+
+    const std::vector<_SYSAssetGroupTileRef> &getTileRefs() const {
+        return mTileRefs;
+    }
+
+    void setOrdinal(unsigned o) {
+        mOrdinal = o;
+    }
+
+    unsigned getOrdinal() const {
+        return mOrdinal;
+    }
+
     void setDefault(lua_State *L);
     static Group *getDefault(lua_State *L);
 
@@ -173,6 +189,8 @@ private:
     std::string mName;
     std::set<Image*> mImages;
     std::vector<uint8_t> mLoadstream;
+    std::vector<_SYSAssetGroupTileRef> mTileRefs;
+    unsigned mOrdinal;
 
     static const uint8_t gf84[];
 };
@@ -918,9 +918,10 @@ void TilePool::optimizeOrder(Logger &log)
     log.taskEnd();
 }
 
-void TilePool::encode(std::vector<uint8_t>& out, Logger *log)
+void TilePool::encode(std::vector<uint8_t>& out, Logger *log,
+    const TileDictionary *dict, std::vector<_SYSAssetGroupTileRef> *refs)
 {
-    TileCodec codec(out);
+    TileCodec codec(out, dict, refs);
 
     if (log) {
         log->taskBegin("Encoding tiles");
@@ -33,7 +33,9 @@
 #include <tr1/memory>
 #include <tr1/unordered_set>
 #include <tr1/unordered_map>
+#include <vector>
 
+#include "sifteo/abi.h"
 #include "color.h"
 #include "logger.h"
 
@@ -41,6 +43,7 @@ namespace Stir {
 
 class Tile;
 class TileStack;
+class TileDictionary;
 typedef std::tr1::shared_ptr<Tile> TileRef;
 
 
@@ -288,7 +291,8 @@ class TilePool {
 
     // Normal optimization flow
     void optimize(Logger &log);
-    void encode(std::vector<uint8_t>& out, Logger *log = NULL);
+    void encode(std::vector<uint8_t>& out, Logger *log = NULL,
+        const TileDictionary *dict = NULL, std::vector<_SYSAssetGroupTileRef> *refs = NULL);
 
     // All previous tiles are set in stone, no new tiles can be added
     void makeFixed() {
@@ -182,18 +182,77 @@ void RLECodec4::encodeRun(std::vector<uint8_t>& out, bool terminal)
     runCount = 0;
 }
 
-TileCodec::TileCodec(std::vector<uint8_t>& buffer)
+void TileDictionary::add(const TilePool &pool, unsigned ordinal)
+{
+    for (unsigned i = 0; i < pool.size(); i++) {
+        Item item;
+        item.tile = pool.tile(i);
+        item.entry.ordinal = ordinal;
+        item.entry.index = i;
+        items.insert(std::make_pair(hash(item.tile), item));
+    }
+}
+
+bool TileDictionary::find(const TileRef tile, Entry &entry) const
+{
+    /*
+     * Look for a tile with exactly the same pixels. If there are several,
+     * the first one we added wins, so that runs of consecutive tiles in
+     * one source group tend to stay together.
+     */
+
+    std::pair<map_t::const_iterator, map_t::const_iterator> range = items.equal_range(hash(tile));
+
+    for (map_t::const_iterator i = range.first; i != range.second; i++) {
+        const TileRef other = i->second.tile;
+        unsigned p = 0;
+        while (p < Tile::PIXELS && other->pixel(p) == tile->pixel(p))
+            p++;
+        if (p == Tile::PIXELS) {
+            entry = i->second.entry;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+uint32_t TileDictionary::hash(const TileRef tile)
+{
+    // 32-bit FNV-1 hash over the tile's pixels only, not its options
+    uint32_t h = 2166136261UL;
+    for (unsigned p = 0; p < Tile::PIXELS; p++) {
+        h ^= tile->pixel(p).value;
+        h *= 16777619UL;
+    }
+    return h;
+}
+
+TileCodec::TileCodec(std::vector<uint8_t>& buffer, const TileDictionary *dict,
+    std::vector<_SYSAssetGroupTileRef> *refs)
     : out(buffer), opIsBuffered(false), 
       tileCount(0),
       paddedOutputMin(0), currentAddress(0),
+      dict(dict), refs(refs), tileIndex(0), opIsRef(false),
       statBucket(TilePalette::CM_INVALID)
 {
     memset(&stats, 0, sizeof stats);
+    memset(&refStats, 0, sizeof refStats);
 }
 
 void TileCodec::encode(const TileRef tile)
 {
     currentAddress.linear += FlashAddress::TILE_SIZE;
+    unsigned index = tileIndex++;
+
+    /*
+     * If the buffered opcode is a run of P16 tiles that the loader may
+     * replace with a copy, the cube might never decode it. So we can't
+     * know what the P16 decoder left behind in LUT entry 15.
+     */
+
+    if (opIsRef && (opcodeBuf & FLS_OP_MASK) == FLS_OP_TILE_P16)
+        lut.invalidateEntry(15);
 
     /*
      * First off, encode LUT changes.
@@ -229,6 +288,15 @@ void TileCodec::encode(const TileRef tile)
     default:                    tileOpcode = FLS_OP_TILE_P16;   break;
     }
 
+    /*
+     * Is this tile also in an AssetGroup we've already encoded? Tiles
+     * that can be copied get opcodes of their own, so the loader can
+     * swap the whole opcode for a copy without touching other tiles.
+     */
+
+    TileDictionary::Entry match;
+    bool isMatch = dict && dict->find(tile, match);
+
     /*
      * Emit a new opcode only if we have to break this run. Otherwise,
      * extend our existing tile run.
@@ -236,10 +304,24 @@ void TileCodec::encode(const TileRef tile)
 
     if (!opIsBuffered
         || tileOpcode != (opcodeBuf & FLS_OP_MASK)
-        || (opcodeBuf & FLS_ARG_MASK) == FLS_ARG_MASK)
+        || (opcodeBuf & FLS_ARG_MASK) == FLS_ARG_MASK
+        || !extendsRef(isMatch, match)) {
+
         encodeOp(tileOpcode);
-    else
+
+        if (isMatch) {
+            opIsRef = true;
+            memset(&opRef, 0, sizeof opRef);
+            opRef.tile = index;
+            opRef.srcTile = match.index;
+            opRef.srcOrdinal = match.ordinal;
+            opRef.numTiles = 1;
+        }
+    } else {
         opcodeBuf++;
+        if (opIsRef)
+            opRef.numTiles++;
+    }
 
     /*
      * Format-specific tile encoders
@@ -284,13 +366,45 @@ void TileCodec::flushOp()
 
         rle.flush(dataBuf);
 
+        unsigned offset = out.size();
         out.push_back(opcodeBuf);
         out.insert(out.end(), dataBuf.begin(), dataBuf.end());
         dataBuf.clear();
         opIsBuffered = false;
+
+        if (opIsRef) {
+            // Only worth recording if the copy is smaller than the encoding
+            const unsigned copySize = 4;
+            opRef.offset = offset;
+            opRef.length = out.size() - offset;
+            if (refs && opRef.length > copySize) {
+                refs->push_back(opRef);
+                refStats.runs++;
+                refStats.tiles += opRef.numTiles;
+                refStats.dataBytes += opRef.length;
+            }
+            opIsRef = false;
+        }
     }
 }
 
+bool TileCodec::extendsRef(bool isMatch, const TileDictionary::Entry &match) const
+{
+    /*
+     * Can a tile with this dictionary match extend the buffered opcode?
+     * Copyable runs must come from consecutive tiles in one source group,
+     * and they can't be mixed with tiles we have to send.
+     */
+
+    if (!opIsRef)
+        return !isMatch;
+
+    return isMatch
+        && match.ordinal == opRef.srcOrdinal
+        && match.index == unsigned(opRef.srcTile + opRef.numTiles)
+        && opRef.numTiles < FLS_MAX_COPY_TILES;
+}
+
 void TileCodec::encodeOp(uint8_t op)
 {
     flushOp();
@@ -441,6 +555,13 @@ void TileCodec::dumpStatistics(Logger &log)
                      ratio);
     }
 
+    if (refStats.runs)
+        log.infoLine("%10s: % 4u runs, % 4u tiles, % 5u bytes also found in other groups",
+                     "Copyable",
+                     refStats.runs,
+                     refStats.tiles,
+                     refStats.dataBytes);
+
     log.infoEnd();
 }
 
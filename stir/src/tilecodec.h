@@ -27,6 +27,8 @@
 #ifndef _TILECODEC_H
 #define _TILECODEC_H
 
+#include <vector>
+#include <map>
 #include "tile.h"
 #include "logger.h"
 
@@ -70,6 +72,10 @@ struct TileCodecLUT {
         valid |= 1 << index;
     }
 
+    void invalidateEntry(unsigned index) {
+        valid &= ~(1 << index);
+    }
+
 private:
     void bumpMRU(unsigned mruIndex, unsigned lutIndex) {
         for (;mruIndex < LUT_MAX - 1; mruIndex++)
@@ -156,6 +162,38 @@ struct FlashAddress {
 };
 
 
+/*
+ * TileDictionary --
+ *
+ *    Per-tile hashes for every tile in the AssetGroups we've encoded
+ *    so far. TileCodec looks up each new tile here, to find runs of
+ *    tiles that the cube may already have in flash as part of another
+ *    AssetGroup from the same ELF.
+ */
+
+class TileDictionary {
+ public:
+    struct Entry {
+        unsigned ordinal;
+        unsigned index;
+    };
+
+    void add(const TilePool &pool, unsigned ordinal);
+    bool find(const TileRef tile, Entry &entry) const;
+
+ private:
+    struct Item {
+        TileRef tile;
+        Entry entry;
+    };
+
+    typedef std::multimap<uint32_t, Item> map_t;
+    map_t items;
+
+    static uint32_t hash(const TileRef tile);
+};
+
+
 /*
  * TileCodec --
  *
@@ -167,7 +205,8 @@ struct FlashAddress {
 
 class TileCodec {
  public:
-    TileCodec(std::vector<uint8_t>& buffer);
+    TileCodec(std::vector<uint8_t>& buffer, const TileDictionary *dict = 0,
+        std::vector<_SYSAssetGroupTileRef> *refs = 0);
 
     void encode(const TileRef tile);
     void flush();
@@ -186,12 +225,24 @@ class TileCodec {
     unsigned paddedOutputMin;
     FlashAddress currentAddress;
 
+    // Copyable tile runs
+    const TileDictionary *dict;
+    std::vector<_SYSAssetGroupTileRef> *refs;
+    unsigned tileIndex;
+    bool opIsRef;
+    _SYSAssetGroupTileRef opRef;
+
     // Stats
     struct {
         unsigned opcodes;
         unsigned tiles;
         unsigned dataBytes;
     } stats[TilePalette::CM_COUNT];
+    struct {
+        unsigned runs;
+        unsigned tiles;
+        unsigned dataBytes;
+    } refStats;
     int statBucket;
     
     void newStatsTile(unsigned bucket);
@@ -200,6 +251,7 @@ class TileCodec {
 
     void encodeOp(uint8_t op);
     void flushOp();
+    bool extendsRef(bool isMatch, const TileDictionary::Entry &match) const;
 
     void encodeLUT(uint16_t newColors);
     void encodeWord(uint16_t w);
@@ -123,6 +123,34 @@ UsbVolumeManager::VolumeOverviewReply *BaseDevice::getVolumeOverview(USBProtocol
 }
 
 
+UsbVolumeManager::PayloadHashReply *BaseDevice::getPayloadHashes(USBProtocolMsg &msg, unsigned volBlockCode, unsigned firstChunk)
+{
+    /*
+     * Retrieve hashes for a run of payload blocks in an installed game.
+     * Returns a pointer to the reply, which is captured in the passed in
+     * buffer, or NULL on failure. Bases that don't support delta installs
+     * will fail here.
+     */
+
+    msg.init(USBProtocol::Installer);
+    msg.header |= UsbVolumeManager::PayloadHashes;
+
+    UsbVolumeManager::PayloadHashRequest *req = msg.zeroCopyAppend<UsbVolumeManager::PayloadHashRequest>();
+    req->volume = volBlockCode;
+    req->firstChunk = firstChunk;
+
+    if (!writeAndWaitForReply(msg)) {
+        return 0;
+    }
+
+    if (msg.payloadLen() >= sizeof(UsbVolumeManager::PayloadHashReply)) {
+        return msg.castPayload<UsbVolumeManager::PayloadHashReply>();
+    }
+
+    return 0;
+}
+
+
 UsbVolumeManager::VolumeDetailReply *BaseDevice::getVolumeDetail(USBProtocolMsg &msg, unsigned volBlockCode)
 {
     /*
@@ -51,6 +51,7 @@ public:
     UsbVolumeManager::VolumeDetailReply *getVolumeDetail(USBProtocolMsg &msg, unsigned volBlockCode);
     bool volumeCodeForPackage(const std::string & pkg, unsigned &volBlockCode);
     UsbVolumeManager::LFSDetailReply *getLFSDetail(USBProtocolMsg &buffer, unsigned volBlockCode);
+    UsbVolumeManager::PayloadHashReply *getPayloadHashes(USBProtocolMsg &msg, unsigned volBlockCode, unsigned firstChunk);
 
     bool pairCube(USBProtocolMsg &msg, uint64_t hwid, unsigned slot);
     UsbVolumeManager::PairingSlotDetailReply *pairingSlotDetail(USBProtocolMsg &msg, unsigned pairingSlot);
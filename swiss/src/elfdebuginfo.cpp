@@ -24,7 +24,6 @@
  */
 
 #include "elfdebuginfo.h"
-#include <cxxabi.h>
 #include "macros.h"
 
 #include <sifteo/abi/elf.h>
@@ -46,6 +45,22 @@ void ELFDebugInfo::clear()
     mappedFile.unmap();
     sections.clear();
     sectionMap.clear();
+    symbols.clear();
+    symbolsBuilt = false;
+}
+
+/*
+ * Point directly at a range of bytes in the mapped ELF, if the whole
+ * range is present in the file. Valid until clear() or init().
+ */
+const uint8_t *ELFDebugInfo::programBytes(uint32_t byteOffset, uint32_t length) const
+{
+    unsigned avail;
+    const uint8_t *p = mappedFile.getData(byteOffset, avail);
+    if (!p || length > avail)
+        return 0;
+
+    return p;
 }
 
 bool ELFDebugInfo::copyProgramBytes(uint32_t byteOffset, uint8_t *dest, uint32_t length) const
@@ -53,12 +68,8 @@ bool ELFDebugInfo::copyProgramBytes(uint32_t byteOffset, uint8_t *dest, uint32_t
     /*
      * Copy data out of the program's ELF
      */
-    if (!mappedFile.isMapped())
-        return false;
-
-    unsigned avail;
-    uint8_t *p = mappedFile.getData(byteOffset, avail);
-    if (!p || length > avail)
+    const uint8_t *p = programBytes(byteOffset, length);
+    if (!p)
         return false;
 
     memcpy(dest, p, length);
@@ -106,12 +117,16 @@ bool ELFDebugInfo::init(const char *elfPath)
  */
 const Elf::FileHeader *ELFDebugInfo::getFileHeader() const
 {
-    unsigned avail;
-    uint8_t *fh = mappedFile.getData(0, avail);
-    if (!fh || avail < sizeof(Elf::FileHeader))
+    const uint8_t *fh = programBytes(0, sizeof(Elf::FileHeader));
+    if (!fh)
+        return 0;
+
+    const Elf::FileHeader *header = reinterpret_cast<const Elf::FileHeader*>(fh);
+    if (header->e_ident[0] != Elf::Magic0 || header->e_ident[1] != Elf::Magic1 ||
+        header->e_ident[2] != Elf::Magic2 || header->e_ident[3] != Elf::Magic3)
         return 0;
 
-    return reinterpret_cast<Elf::FileHeader*>(fh);
+    return header;
 }
 
 /*
@@ -133,14 +148,38 @@ const Elf::SectionHeader *ELFDebugInfo::findSection(const std::string &name) con
 const Elf::ProgramHeader *ELFDebugInfo::getProgramHeader(const Elf::FileHeader *fh, unsigned index) const
 {
     ASSERT(index < fh->e_phnum);
-    unsigned offset = fh->e_phoff + index * sizeof(Elf::ProgramHeader);
+    unsigned offset = fh->e_phoff + index * fh->e_phentsize;
 
-    unsigned avail;
-    uint8_t *p = mappedFile.getData(offset, avail);
-    if (!p || offset + sizeof(Elf::ProgramHeader) > avail)
+    const uint8_t *p = programBytes(offset, sizeof(Elf::ProgramHeader));
+    if (!p)
         return 0;
 
-    return reinterpret_cast<Elf::ProgramHeader*>((uint8_t*)fh + offset);
+    return reinterpret_cast<const Elf::ProgramHeader*>(p);
+}
+
+/*
+ * Return the size, in bytes, of the installable portion of this ELF.
+ * This excludes any debug sections, if any. If the file is not valid,
+ * returns zero.
+ *
+ * This works by looking for the end of the last program segment.
+ */
+unsigned ELFDebugInfo::installableSize() const
+{
+    const Elf::FileHeader *fh = getFileHeader();
+    if (!fh)
+        return 0;
+
+    unsigned size = 0;
+    for (unsigned i = 0; i < fh->e_phnum; ++i) {
+        const Elf::ProgramHeader *ph = getProgramHeader(fh, i);
+        if (!ph)
+            return 0;
+        size = std::max<unsigned>(size, ph->p_offset + ph->p_filesz);
+    }
+
+    // Segments must lie entirely within the file
+    return programBytes(0, size) ? size : 0;
 }
 
 const Elf::ProgramHeader *ELFDebugInfo::getMetadataSegment() const
@@ -179,6 +218,34 @@ std::string ELFDebugInfo::readString(const std::string &section, uint32_t offset
         return "";
 }
 
+/*
+ * The symbol and string tables are parsed in place, straight from the
+ * mapped file, into a sorted lookup index.
+ */
+const ELFSymbolIndex &ELFDebugInfo::symbolIndex() const
+{
+    if (symbolsBuilt)
+        return symbols;
+    symbolsBuilt = true;
+
+    const Elf::SectionHeader *symtab = findSection(".symtab");
+    const Elf::SectionHeader *strtab = findSection(".strtab");
+    if (!symtab)
+        return symbols;
+
+    unsigned numSyms = symtab->sh_size / sizeof(Elf::Symbol);
+    const uint8_t *syms = programBytes(symtab->sh_offset, numSyms * sizeof(Elf::Symbol));
+    if (!syms)
+        return symbols;
+
+    // Symbols without names are still worth finding
+    const uint8_t *strs = strtab ? programBytes(strtab->sh_offset, strtab->sh_size) : 0;
+
+    symbols.build(reinterpret_cast<const Elf::Symbol*>(syms), numSyms,
+        reinterpret_cast<const char*>(strs), strs ? strtab->sh_size : 0);
+    return symbols;
+}
+
 bool ELFDebugInfo::findNearestSymbol(uint32_t address,
     Elf::Symbol &symbol, std::string &name) const
 {
@@ -189,36 +256,10 @@ bool ELFDebugInfo::findNearestSymbol(uint32_t address,
     // If nothing is found, we still fill in the output buffer and name
     // with "(unknown)" and zeroes, but 'false' is returned.
 
-    const Elf::SectionHeader *SI = findSection(".symtab");
-    if (SI) {
-        Elf::Symbol currentSym;
-        const uint32_t worstOffset = (uint32_t) -1;
-        uint32_t bestOffset = worstOffset;
-
-        for (unsigned index = 0;; index++) {
-            uint32_t tableOffset = index * sizeof currentSym;
-
-            if (tableOffset + sizeof currentSym > SI->sh_size ||
-                !copyProgramBytes(
-                    SI->sh_offset + tableOffset,
-                    (uint8_t*) &currentSym, sizeof currentSym))
-                break;
-
-            // Strip the Thumb bit from function symbols.
-            if ((currentSym.st_info & 0xF) == Elf::STT_FUNC)
-                currentSym.st_value &= ~1;
-
-            uint32_t addrOffset = address - currentSym.st_value;
-            if (addrOffset < currentSym.st_size && addrOffset < bestOffset) {
-                symbol = currentSym;
-                bestOffset = addrOffset;
-            }
-        }
-
-        if (bestOffset != worstOffset) {
-            name = readString(".strtab", symbol.st_name);
-            return true;
-        }
+    const std::string *mangledName, *demangledName;
+    if (symbolIndex().find(address, symbol, mangledName, demangledName)) {
+        name = *mangledName;
+        return true;
     }
 
     memset(&symbol, 0, sizeof symbol);
@@ -230,7 +271,7 @@ bool ELFDebugInfo::findNearestSymbol(uint32_t address,
 bool ELFDebugInfo::metadataString(uint16_t key, std::string &s)
 {
     uint32_t actualSize;
-    uint8_t *m = metadata(key, actualSize);
+    const uint8_t *m = metadata(key, actualSize);
     if (!m)
         return false;
 
@@ -238,10 +279,10 @@ bool ELFDebugInfo::metadataString(uint16_t key, std::string &s)
     return true;
 }
 
-uint8_t* ELFDebugInfo::metadata(uint16_t key, uint32_t &actualSize)
+const uint8_t *ELFDebugInfo::metadata(uint16_t key, uint32_t &actualSize)
 {
     const Elf::ProgramHeader *ph = getMetadataSegment();
-    if (!ph)
+    if (!ph || ph->p_filesz < sizeof(_SYSMetadataKey))
         return 0;
 
     const uint32_t keySize = sizeof(_SYSMetadataKey);
@@ -251,11 +292,10 @@ uint8_t* ELFDebugInfo::metadata(uint16_t key, uint32_t &actualSize)
 
     bool foundKey = false;
     uint32_t valueOffset = 0;
-    unsigned avail;
 
     while (I <= E) {
 
-        uint8_t *p = mappedFile.getData(I, avail);
+        const uint8_t *p = programBytes(I, keySize);
         if (!p)
             return 0;
 
@@ -278,7 +318,7 @@ uint8_t* ELFDebugInfo::metadata(uint16_t key, uint32_t &actualSize)
                 return 0;
 
             // Now we can calculate the address of the value, yay.
-            return mappedFile.getData(valueOffset + I, avail);
+            return programBytes(valueOffset + I, actualSize);
         }
     }
 
@@ -289,10 +329,16 @@ uint8_t* ELFDebugInfo::metadata(uint16_t key, uint32_t &actualSize)
 std::string ELFDebugInfo::formatAddress(uint32_t address) const
 {
     Elf::Symbol symbol;
+    const std::string *mangledName, *demangledName;
     std::string name;
 
-    findNearestSymbol(address, symbol, name);
-    demangle(name);
+    if (symbolIndex().find(address, symbol, mangledName, demangledName)) {
+        name = *demangledName;
+    } else {
+        symbol.st_value = 0;
+        name = "(unknown)";
+    }
+
     uint32_t offset = address - symbol.st_value;
 
     if (offset != 0) {
@@ -304,19 +350,6 @@ std::string ELFDebugInfo::formatAddress(uint32_t address) const
     return name;
 }
 
-void ELFDebugInfo::demangle(std::string &name)
-{
-    // This uses the demangler built into GCC's libstdc++.
-    // It uses the same name mangling style as clang.
-
-    int status;
-    char *result = abi::__cxa_demangle(name.c_str(), 0, 0, &status);
-    if (status == 0) {
-        name = result;
-        free(result);
-    }
-}
-
 bool ELFDebugInfo::readROM(uint32_t address, uint8_t *buffer, uint32_t bytes) const
 {
     /*
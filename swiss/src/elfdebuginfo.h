@@ -28,6 +28,7 @@
 
 #include "elfdefs.h"
 #include "mappedfile.h"
+#include "elfsymbolindex.h"
 
 #include <vector>
 #include <map>
@@ -35,16 +36,26 @@
 
 class ELFDebugInfo {
 public:
+    ELFDebugInfo() : symbolsBuilt(false) {}
+
     void clear();
     bool init(const char *elfPath);
 
+    // After a failed init(), tells an unreadable file from a non-ELF one
+    bool isMapped() const {
+        return mappedFile.isMapped();
+    }
+
     std::string readString(const std::string &section, uint32_t offset) const;
     bool findNearestSymbol(uint32_t address, Elf::Symbol &symbol, std::string &name) const;
     std::string formatAddress(uint32_t address) const;
     bool readROM(uint32_t address, uint8_t *buffer, uint32_t bytes) const;
 
     bool metadataString(uint16_t key, std::string &s);
-    uint8_t* metadata(uint16_t key, uint32_t &actualSize);
+    const uint8_t *metadata(uint16_t key, uint32_t &actualSize);
+
+    unsigned installableSize() const;
+    const uint8_t *programBytes(uint32_t byteOffset, uint32_t length) const;
 
 private:
     typedef std::vector<Elf::SectionHeader> sections_t;
@@ -55,7 +66,12 @@ private:
     sections_t sections;
     sectionMap_t sectionMap;
 
-    static void demangle(std::string &name);
+    // Built on first lookup; installing and inspecting never need it.
+    // An ELF without symbols leaves the index empty but still built.
+    mutable ELFSymbolIndex symbols;
+    mutable bool symbolsBuilt;
+
+    const ELFSymbolIndex &symbolIndex() const;
     std::string readString(const Elf::SectionHeader *SI, uint32_t offset) const;
 
     const Elf::FileHeader *getFileHeader() const;
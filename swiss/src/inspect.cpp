@@ -24,7 +24,6 @@
  */
 
 #include "inspect.h"
-#include "installer.h"
 #include "sifteo/abi/elf.h"
 
 #include <errno.h>
@@ -60,15 +59,15 @@ bool Inspect::inspect(const char *path)
 
     // UUID
     uint32_t uuidLen;
-    uint8_t *uuid = dbgInfo.metadata(_SYS_METADATA_UUID, uuidLen);
+    const uint8_t *uuid = dbgInfo.metadata(_SYS_METADATA_UUID, uuidLen);
     table.cell() << "uuid:";
-    table.cell() << (uuid ? uuidStr(*(_SYSUUID*)uuid) : "none");
+    table.cell() << (uuid ? uuidStr(*(const _SYSUUID*)uuid) : "none");
     table.endRow();
 
 
     // Bootstrap Assets - included or not?
     uint32_t bootAssetLen;
-    uint8_t *bootasset = dbgInfo.metadata(_SYS_METADATA_BOOT_ASSET, bootAssetLen);
+    const uint8_t *bootasset = dbgInfo.metadata(_SYS_METADATA_BOOT_ASSET, bootAssetLen);
     table.cell() << "boot asset:";
     table.cell() << (bootasset ? "included" : "none");
     table.endRow();
@@ -90,7 +89,7 @@ bool Inspect::inspect(const char *path)
 
     // Icon - is it included?
     uint32_t iconLen;
-    uint8_t *icon = dbgInfo.metadata(_SYS_METADATA_ICON_96x96, iconLen);
+    const uint8_t *icon = dbgInfo.metadata(_SYS_METADATA_ICON_96x96, iconLen);
     table.cell() << "icon:";
     table.cell() << (icon ? "included" : "none");
     table.endRow();
@@ -98,7 +97,7 @@ bool Inspect::inspect(const char *path)
 
     // Number of assets slots used
     uint32_t aslotsLen;
-    uint8_t *aslots = dbgInfo.metadata(_SYS_METADATA_NUM_ASLOTS, aslotsLen);
+    const uint8_t *aslots = dbgInfo.metadata(_SYS_METADATA_NUM_ASLOTS, aslotsLen);
     unsigned numslots = (aslots && aslotsLen >= 1) ? *aslots : 0;
     table.cell() << "asset slots:";
     table.cell() << numslots;
@@ -107,11 +106,11 @@ bool Inspect::inspect(const char *path)
 
     // Advertised cube range
     uint32_t cuberangeLen;
-    uint8_t *cuberange = dbgInfo.metadata(_SYS_METADATA_CUBE_RANGE, cuberangeLen);
+    const uint8_t *cuberange = dbgInfo.metadata(_SYS_METADATA_CUBE_RANGE, cuberangeLen);
 
     table.cell() << "cube range:";
     if (cuberange) {
-        _SYSMetadataCubeRange *cr = reinterpret_cast<_SYSMetadataCubeRange*>(cuberange);
+        const _SYSMetadataCubeRange *cr = reinterpret_cast<const _SYSMetadataCubeRange*>(cuberange);
         table.cell() << int(cr->minCubes) << "-" << int(cr->maxCubes);
     } else {
         table.cell() << "none";
@@ -121,10 +120,10 @@ bool Inspect::inspect(const char *path)
 
     // Minimum OS version required
     uint32_t minOSLen;
-    uint8_t *mos = dbgInfo.metadata(_SYS_METADATA_MIN_OS_VERSION, minOSLen);
+    const uint8_t *mos = dbgInfo.metadata(_SYS_METADATA_MIN_OS_VERSION, minOSLen);
     table.cell() << "min OS version:";
     if (mos) {
-        uint32_t minimumOS = *reinterpret_cast<uint32_t*>(mos);
+        uint32_t minimumOS = *reinterpret_cast<const uint32_t*>(mos);
         table.cell() << "0x" << setiosflags(ios::hex) << setw(6) << setfill('0') << minimumOS;
     } else {
         table.cell() << "none";
@@ -132,11 +131,9 @@ bool Inspect::inspect(const char *path)
     table.endRow();
 
     table.cell() << "installable size:";
-    FILE *f = fopen(path, "rb");
-    if (f) {
-        unsigned sz = Installer::getInstallableElfSize(f);
+    unsigned sz = dbgInfo.installableSize();
+    if (sz) {
         table.cell() << int(sz) << " bytes";
-        fclose(f);
     } else {
         table.cell() << "unknown";
     }
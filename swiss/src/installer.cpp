@@ -33,6 +33,7 @@
 #include "swisserror.h"
 
 #include <sifteo/abi/elf.h>
+#include "fastlz.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -42,6 +43,8 @@ int Installer::run(int argc, char **argv, IODevice &_dev)
     bool launcher = false;
     bool forceLauncher = false;
     bool rpc = false;
+    bool compress = true;
+    bool delta = true;
     const char *path = NULL;
 
     for (int i = 1; i < argc; i++) {
@@ -51,6 +54,10 @@ int Installer::run(int argc, char **argv, IODevice &_dev)
             rpc = true;
         } else if (!strcmp(argv[i], "-f")) {
             forceLauncher = true;
+        } else if (!strcmp(argv[i], "--no-compress")) {
+            compress = false;
+        } else if (!strcmp(argv[i], "--full")) {
+            delta = false;
         } else if (!path) {
             path = argv[i];
         } else {
@@ -65,7 +72,9 @@ int Installer::run(int argc, char **argv, IODevice &_dev)
                              IODevice::BASE_PID,
                              launcher,
                              forceLauncher,
-                             rpc);
+                             rpc,
+                             compress,
+                             delta);
 }
 
 Installer::Installer(IODevice &_dev) :
@@ -81,11 +90,25 @@ Installer::Installer(IODevice &_dev) :
  * - Send the content of the application.
  * - Commit the transaction.
  */
-int Installer::install(const char *path, int vid, int pid, bool launcher, bool forceLauncher, bool rpc)
+int Installer::install(const char *path, int vid, int pid, bool launcher, bool forceLauncher,
+                       bool rpc, bool compress, bool delta)
 {
     isRPC = rpc;
     isLauncher = launcher;
-    if (!launcher && !getPackageMetadata(path)) {
+    installFeatures = 0;
+    baseHashes.clear();
+    baseHashIndex.clear();
+
+    if (!elf.init(path)) {
+        if (elf.isMapped()) {
+            fprintf(stderr, "not a valid ELF file\n");
+            return EINVAL;
+        }
+        fprintf(stderr, "could not open %s: %s\n", path, strerror(errno));
+        return ENOENT;
+    }
+
+    if (!launcher && !getPackageMetadata()) {
         return EINVAL;
     }
 
@@ -103,17 +126,11 @@ int Installer::install(const char *path, int vid, int pid, bool launcher, bool f
         }
     }
 
-    FILE *f = fopen(path, "rb");
-    if (!f) {
-        fprintf(stderr, "could not open %s: %s\n", path, strerror(errno));
-        return ENOENT;
-    }
-
     if (!dev.open(vid, pid)) {
         return ENODEV;
     }
 
-    unsigned fileSize = getInstallableElfSize(f);
+    unsigned fileSize = elf.installableSize();
     if (!fileSize) {
         fprintf(stderr, "not a valid ELF file\n");
         return EINVAL;
@@ -125,12 +142,36 @@ int Installer::install(const char *path, int vid, int pid, bool launcher, bool f
         printf("installing %s, version %s (%d bytes)\n",
             package.c_str(), version.c_str(), fileSize);
 
-    int rv = sendHeader(fileSize);
+    /*
+     * If an older build of this game is installed, try to reuse its
+     * unchanged blocks. This needs room for both versions until commit,
+     * so fall back on a normal install if the base is short on space.
+     */
+    int rv = ENOENT;
+    if (!launcher && compress && delta && getBaseHashes()) {
+        rv = sendDeltaHeader(fileSize);
+        if (rv == ENOSPC) {
+            printf("not enough room for a delta install, reinstalling in full\n");
+            baseHashes.clear();
+            baseHashIndex.clear();
+        } else if (rv != 0) {
+            return rv;
+        }
+    }
+
     if (rv != 0) {
-        return rv;
+        rv = sendHeader(fileSize);
+        if (rv != 0) {
+            return rv;
+        }
     }
 
-    bool success = sendFileContents(f, fileSize) && commit();
+    if (!compress)
+        installFeatures &= ~UsbVolumeManager::FeatureCompressedPayload;
+
+    bool success = (installFeatures & UsbVolumeManager::FeatureCompressedPayload)
+        ? sendCompressedFileContents(fileSize) : sendFileContents(fileSize);
+    success = success && commit();
     if (!success) {
         return EIO;
     }
@@ -138,55 +179,18 @@ int Installer::install(const char *path, int vid, int pid, bool launcher, bool f
     return EOK;
 }
 
-/*
- * Return the size, in bytes, of the installable portion of this ELF.
- * This excludes any debug sections, if any. If the file is not valid,
- * returns zero.
- *
- * This works by looking for the end of the last program segment.
- */
-unsigned Installer::getInstallableElfSize(FILE *f)
-{
-    Elf::FileHeader fh;
-    Elf::ProgramHeader ph;
-    unsigned size = 0;
-
-    rewind(f);
-    if (fread(&fh, sizeof fh, 1, f) < 1)
-        return 0;
-
-    if (fh.e_ident[0] != Elf::Magic0 || fh.e_ident[1] != Elf::Magic1 ||
-        fh.e_ident[2] != Elf::Magic2 || fh.e_ident[3] != Elf::Magic3)
-        return 0;
-
-    for (unsigned i = 0; i < fh.e_phnum; ++i) {
-        fseek(f, fh.e_phoff + i * fh.e_phentsize, SEEK_SET);
-        if (fread(&ph, sizeof ph, 1, f) < 1)
-            return 0;
-        size = std::max<unsigned>(size, ph.p_offset + ph.p_filesz);
-    }
-
-    return size;
-}
-
 /*
  * Read package metadata from the elf for this application.
  * For now, must include package and version strings.
  */
-bool Installer::getPackageMetadata(const char *path)
+bool Installer::getPackageMetadata()
 {
-    ELFDebugInfo dbgInfo;
-    if (!dbgInfo.init(path)) {
-        fprintf(stderr, "couldn't open %s: %s\n", path, strerror(errno));
-        return false;
-    }
-
-    if (!dbgInfo.metadataString(_SYS_METADATA_PACKAGE_STR, package)) {
+    if (!elf.metadataString(_SYS_METADATA_PACKAGE_STR, package)) {
         fprintf(stderr, "couldn't find package string - ensure you've included a call to Metadata::package() in your application\n");
         return false;
     }
 
-    if (!dbgInfo.metadataString(_SYS_METADATA_VERSION_STR, version)) {
+    if (!elf.metadataString(_SYS_METADATA_VERSION_STR, version)) {
         fprintf(stderr, "couldn't find version - ensure you've included a call to Metadata::package() in your application\n");
         return false;
     }
@@ -226,6 +230,97 @@ int Installer::sendHeader(uint32_t filesz)
         }
     }
 
+    // Older firmware doesn't report any optional features
+    if (m.payloadLen() >= 1)
+        installFeatures = m.payload[0];
+
+    return EOK;
+}
+
+/*
+ * Fetch hashes for every payload block of the installed copy of this
+ * package, if there is one. Returns false if there's nothing to reuse,
+ * or if the base doesn't support delta installs.
+ */
+bool Installer::getBaseHashes()
+{
+    BaseDevice base(dev);
+    if (!base.volumeCodeForPackage(package, baseVolume))
+        return false;
+
+    unsigned total = 1;
+    for (unsigned first = 0; first < total;
+         first += UsbVolumeManager::PAYLOAD_HASHES_PER_REPLY) {
+
+        USBProtocolMsg m;
+        UsbVolumeManager::PayloadHashReply *r = base.getPayloadHashes(m, baseVolume, first);
+        if (!r || r->firstChunk != first) {
+            baseHashes.clear();
+            return false;
+        }
+
+        total = r->numChunks;
+        unsigned count = std::min(total - first, UsbVolumeManager::PAYLOAD_HASHES_PER_REPLY);
+        baseHashes.insert(baseHashes.end(), r->hashes, r->hashes + count);
+    }
+
+    for (unsigned i = 0; i < baseHashes.size(); ++i)
+        baseHashIndex.insert(std::make_pair(baseHashes[i], i));
+
+    return !baseHashes.empty();
+}
+
+/*
+ * Look for a block in the base volume identical to this one. Prefer the
+ * same position, since that's by far the most common match.
+ */
+bool Installer::findBaseChunk(unsigned index, const uint8_t *raw, unsigned rawLen, uint32_t &srcOffset)
+{
+    if (baseHashes.empty() || rawLen != UsbVolumeManager::PAYLOAD_CHUNK_BYTES)
+        return false;
+
+    uint64_t hash = UsbVolumeManager::payloadHash(UsbVolumeManager::PAYLOAD_HASH_INIT, raw, rawLen);
+
+    if (index < baseHashes.size() && baseHashes[index] == hash) {
+        srcOffset = index * UsbVolumeManager::PAYLOAD_CHUNK_BYTES;
+        return true;
+    }
+
+    std::map<uint64_t, unsigned>::const_iterator i = baseHashIndex.find(hash);
+    if (i != baseHashIndex.end()) {
+        srcOffset = i->second * UsbVolumeManager::PAYLOAD_CHUNK_BYTES;
+        return true;
+    }
+
+    return false;
+}
+
+int Installer::sendDeltaHeader(uint32_t filesz)
+{
+    USBProtocolMsg m(USBProtocol::Installer);
+    m.header |= UsbVolumeManager::WriteGameDeltaHeader;
+    m.append((uint8_t*)&filesz, sizeof filesz);
+    m.append((uint8_t*)&baseVolume, sizeof baseVolume);
+    if (package.size() + 1 > m.bytesFree()) {
+        fprintf(stderr, "package name too long\n");
+        return EINVAL;
+    }
+    m.append((uint8_t*)package.c_str(), package.size() + 1);
+
+    if (dev.writePacket(m.bytes, m.len) < 0) {
+        return EIO;
+    }
+
+    if (!BaseDevice(dev).waitForReply(UsbVolumeManager::WroteHeaderOK, m)) {
+        if (m.header == UsbVolumeManager::WroteHeaderFail)
+            return ENOSPC;
+        fprintf(stderr, "error: unexpected response (0x%x)\n", m.header);
+        return EIO;
+    }
+
+    if (m.payloadLen() >= 1)
+        installFeatures = m.payload[0];
+
     return EOK;
 }
 
@@ -235,10 +330,14 @@ int Installer::sendHeader(uint32_t filesz)
  * There are no restrictions on the format of the payload - just fit as much
  * into each packet as we can.
  */
-bool Installer::sendFileContents(FILE *f, uint32_t filesz)
+bool Installer::sendFileContents(uint32_t filesz)
 {
-    rewind(f);
- 
+    const uint8_t *src = elf.programBytes(0, filesz);
+    if (!src) {
+        fprintf(stderr, "read error\n");
+        return false;
+    }
+
     unsigned progress = 0;
     ScopedProgressBar pb(filesz);
 
@@ -247,6 +346,7 @@ bool Installer::sendFileContents(FILE *f, uint32_t filesz)
         m.header |= UsbVolumeManager::WritePayload;
 
         unsigned chunk = std::min(filesz - progress, m.bytesFree());
+        memcpy(m.payload, src + progress, chunk);
         m.len += chunk;
         progress += chunk;
         if (isRPC) {
@@ -255,11 +355,6 @@ bool Installer::sendFileContents(FILE *f, uint32_t filesz)
         if (!chunk)
             return true;
 
-        if (fread(m.payload, chunk, 1, f) != 1) {
-            fprintf(stderr, "read error\n");
-            return false;
-        }
-
         if (dev.writePacket(m.bytes, m.len) < 0) {
             return false;
         }
@@ -275,6 +370,187 @@ bool Installer::sendFileContents(FILE *f, uint32_t filesz)
     return false;
 }
 
+/*
+ * Write the body of this file as a stream of FastLZ-compressed chunks.
+ *
+ * Chunks are packed back-to-back into WritePayloadChunk packets. The device
+ * acknowledges each chunk once it's been written to flash, and we keep a
+ * small window of chunks in flight so the link stays busy while the device
+ * is decompressing and programming.
+ */
+bool Installer::sendCompressedFileContents(uint32_t filesz)
+{
+    static const unsigned CHUNK = UsbVolumeManager::PAYLOAD_CHUNK_BYTES;
+
+    const uint8_t *src = elf.programBytes(0, filesz);
+    if (!src) {
+        fprintf(stderr, "read error\n");
+        return false;
+    }
+
+    unsigned progress = 0;
+    unsigned codedTotal = 0;
+    unsigned copiedTotal = 0;
+    unsigned chunksSent = 0;
+    unsigned chunksAcked = 0;
+    ScopedProgressBar pb(filesz);
+
+    USBProtocolMsg m(USBProtocol::Installer);
+    m.header |= UsbVolumeManager::WritePayloadChunk;
+
+    while (progress < filesz) {
+        // FastLZ needs 5% headroom, and at least 66 bytes of output space
+        uint8_t coded[CHUNK + CHUNK / 20 + 66];
+
+        const uint8_t *raw = src + progress;
+        unsigned rawLen = std::min(filesz - progress, CHUNK);
+
+        int codedLen;
+        const uint8_t *body = coded;
+        uint32_t srcOffset;
+
+        if (findBaseChunk(chunksSent, raw, rawLen, srcOffset)) {
+            // Unchanged block, copy it from the installed volume
+            memcpy(coded, &srcOffset, sizeof srcOffset);
+            codedLen = 0;
+            copiedTotal += rawLen;
+        } else {
+            // Store incompressible chunks as-is
+            codedLen = fastlz_compress_level(1, raw, rawLen, coded);
+            if (codedLen <= 0 || unsigned(codedLen) >= rawLen) {
+                codedLen = rawLen;
+                body = raw;
+            }
+        }
+
+        UsbVolumeManager::PayloadChunkHeader hdr;
+        hdr.rawLen = rawLen;
+        hdr.codedLen = codedLen;
+
+        if (!sendChunkStream(m, (const uint8_t*) &hdr, sizeof hdr) ||
+            !sendChunkStream(m, body, codedLen ? codedLen : sizeof srcOffset))
+            return false;
+
+        chunksSent++;
+        progress += rawLen;
+        codedTotal += codedLen;
+
+        // Copy chunks are only 8 bytes, so a whole window of them can sit
+        // in a partly-filled packet. Send it before waiting on their acks.
+        if (chunksSent - chunksAcked > UsbVolumeManager::PAYLOAD_CHUNK_WINDOW) {
+            if (!flushChunkStream(m) ||
+                !waitForChunkAcks(chunksAcked, chunksSent - UsbVolumeManager::PAYLOAD_CHUNK_WINDOW))
+                return false;
+        }
+
+        if (isRPC) {
+            fprintf(stdout, "::progress:%u:%u\n", progress, filesz); fflush(stdout);
+        }
+        pb.update(progress);
+    }
+
+    if (!flushChunkStream(m))
+        return false;
+
+    if (!waitForChunkAcks(chunksAcked, chunksSent))
+        return false;
+
+    if (!isRPC && filesz) {
+        printf("sent %u compressed bytes (%.1f%%)", codedTotal, codedTotal * 100.0 / filesz);
+        if (copiedTotal)
+            printf(", reused %u unchanged bytes", copiedTotal);
+        printf("\n");
+    }
+
+    return true;
+}
+
+/*
+ * Append bytes to the chunk stream, sending each packet as it fills.
+ */
+bool Installer::sendChunkStream(USBProtocolMsg &m, const uint8_t *bytes, unsigned len)
+{
+    while (len) {
+        unsigned part = std::min(len, m.bytesFree());
+        m.append(bytes, part);
+        bytes += part;
+        len -= part;
+
+        if (!m.bytesFree() && !flushChunkStream(m))
+            return false;
+    }
+
+    return true;
+}
+
+bool Installer::flushChunkStream(USBProtocolMsg &m)
+{
+    if (!m.payloadLen())
+        return true;
+
+    if (dev.writePacket(m.bytes, m.len) < 0)
+        return false;
+
+    while (dev.numPendingOUTPackets() > IODevice::MAX_OUTSTANDING_OUT_TRANSFERS) {
+        if (dev.processEvents(1) < 0)
+            return false;
+    }
+
+    m.init(USBProtocol::Installer);
+    m.header |= UsbVolumeManager::WritePayloadChunk;
+    return true;
+}
+
+/*
+ * Wait until the device has acknowledged at least 'target' chunks.
+ * The timeout restarts each time an ack arrives.
+ */
+bool Installer::waitForChunkAcks(unsigned &acked, unsigned target)
+{
+    time_t deadline = time(0) + CHUNK_ACK_TIMEOUT_SECS;
+
+    while (acked < target) {
+        unsigned prev = acked;
+        if (!pollChunkAcks(acked, deadline))
+            return false;
+        if (acked != prev)
+            deadline = time(0) + CHUNK_ACK_TIMEOUT_SECS;
+    }
+
+    return true;
+}
+
+/*
+ * Handle at most one reply from the device, updating our count of
+ * acknowledged chunks. Returns false if the device rejected our data,
+ * or if nothing has arrived by the deadline.
+ */
+bool Installer::pollChunkAcks(unsigned &acked, time_t deadline)
+{
+    if (dev.numPendingINPackets() == 0) {
+        if (time(0) > deadline) {
+            fprintf(stderr, "error: timed out waiting for device to acknowledge payload data\n");
+            return false;
+        }
+        return dev.processEvents(1) >= 0;
+    }
+
+    USBProtocolMsg m;
+    if (dev.readPacket(m.bytes, m.MAX_LEN, m.len) < 0)
+        return false;
+
+    if (m.subsystem() != USBProtocol::Installer)
+        return true;
+
+    if (m.header == UsbVolumeManager::WritePayloadChunkAck && m.payloadLen() >= sizeof(uint32_t)) {
+        acked = *m.castPayload<uint32_t>();
+        return true;
+    }
+
+    fprintf(stderr, "error: device rejected payload data (0x%x)\n", m.header);
+    return false;
+}
+
 /*
  * We're done sending payload data - tell the master to commit this app.
  */
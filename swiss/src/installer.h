@@ -28,8 +28,12 @@
 
 #include "iodevice.h"
 #include "usbvolumemanager.h"
+#include "elfdebuginfo.h"
 
 #include <string>
+#include <vector>
+#include <map>
+#include <time.h>
 
 class Installer
 {
@@ -38,20 +42,37 @@ public:
 
     static int run(int argc, char **argv, IODevice &_dev);
 
-    int install(const char *path, int vid, int pid, bool launcher, bool forceLauncher, bool rpc);
-
-    static unsigned getInstallableElfSize(FILE *f);
+    int install(const char *path, int vid, int pid, bool launcher, bool forceLauncher,
+                bool rpc, bool compress = true, bool delta = true);
 
 private:
+    // Give up if the device acknowledges no payload chunks for this long
+    static const unsigned CHUNK_ACK_TIMEOUT_SECS = 10;
+
     int sendHeader(uint32_t filesz);
-    bool getPackageMetadata(const char *path);
-    bool sendFileContents(FILE *f, uint32_t filesz);
+    int sendDeltaHeader(uint32_t filesz);
+    bool getBaseHashes();
+    bool findBaseChunk(unsigned index, const uint8_t *raw, unsigned rawLen, uint32_t &srcOffset);
+    bool getPackageMetadata();
+    bool sendFileContents(uint32_t filesz);
+    bool sendCompressedFileContents(uint32_t filesz);
+    bool sendChunkStream(USBProtocolMsg &m, const uint8_t *bytes, unsigned len);
+    bool flushChunkStream(USBProtocolMsg &m);
+    bool waitForChunkAcks(unsigned &acked, unsigned target);
+    bool pollChunkAcks(unsigned &acked, time_t deadline);
     bool commit();
 
     IODevice &dev;
+    ELFDebugInfo elf;   // Mapped read-only; payload is sent straight from the mapping
     std::string package, version;
     bool isLauncher;
     bool isRPC;
+    uint8_t installFeatures;
+
+    // Delta installs: hashes of the existing volume's payload blocks
+    unsigned baseVolume;
+    std::vector<uint64_t> baseHashes;
+    std::map<uint64_t, unsigned> baseHashIndex;
 };
 
 #endif // INSTALLER_H
@@ -32,6 +32,7 @@
 #include "delete.h"
 #include "paircube.h"
 #include "usbdevice.h"
+#include "tcpdevice.h"
 #include "reboot.h"
 #include "macros.h"
 #include "backup.h"
@@ -39,8 +40,12 @@
 #include "listen.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+// Nonzero if we're talking to Siftulator instead of real hardware
+static unsigned siftulatorPort;
+
 static const Command commands[] = {
     // Keeping this list in alphabetical order, for lack of a better ordering...
 
@@ -128,6 +133,9 @@ static void usage()
         unsigned pad = maxUsageLen - strlen(commands[i].usage);
         fprintf(stderr, "  %s:%*s%s\n", commands[i].usage, pad, " ", commands[i].description);
     }
+
+    fprintf(stderr, "\nglobal options, before the command:\n"
+                    "  --siftulator [port]  talk to Siftulator's simulated USB port instead of hardware\n");
 }
 
 static void version()
@@ -140,7 +148,7 @@ static void version()
 #endif
 }
 
-static int run(int argc, char **argv, UsbDevice &usbdev)
+static int run(int argc, char **argv, IODevice &usbdev)
 {
     const unsigned numCommands = sizeof(commands) / sizeof(commands[0]);
 
@@ -180,6 +188,23 @@ static unsigned handleGlobalArgs(int argc, char **argv)
             continue;
         }
 
+        if (!strcmp(argv[i], "--siftulator")) {
+
+            siftulatorPort = UsbLoopback::DEFAULT_PORT;
+            consumed++;
+
+            char *end;
+            if (i + 1 < argc) {
+                unsigned long port = strtoul(argv[i + 1], &end, 0);
+                if (*end == '\0' && port) {
+                    siftulatorPort = port;
+                    consumed++;
+                    i++;
+                }
+            }
+            continue;
+        }
+
     }
 
     return consumed;
@@ -197,9 +222,6 @@ int main(int argc, char **argv)
         return 0;
     }
 
-    /*
-     * TODO: add support for specifying a TCP connection to siftulator.
-     */
     Usb::init();
 
     unsigned consumed = handleGlobalArgs(argc, argv);
@@ -212,12 +234,15 @@ int main(int argc, char **argv)
     }
 
     UsbDevice usbdev;
-    int rv = run(argc, argv, usbdev);
+    TcpDevice tcpdev(siftulatorPort);
+    IODevice &dev = siftulatorPort ? static_cast<IODevice&>(tcpdev) : usbdev;
+
+    int rv = run(argc, argv, dev);
 
-    if (usbdev.isOpen()) {
-        usbdev.close();
-        while (usbdev.isOpen()) {
-            usbdev.processEvents(1);
+    if (dev.isOpen()) {
+        dev.close();
+        while (dev.isOpen()) {
+            dev.processEvents(1);
         }
     }
 
@@ -0,0 +1,257 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * swiss - your Sifteo utility knife
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifdef _WIN32
+#   define WIN32_LEAN_AND_MEAN
+#   include <windows.h>
+#   include <winsock2.h>
+#   include <ws2tcpip.h>
+#else
+#   include <sys/types.h>
+#   include <sys/socket.h>
+#   include <sys/select.h>
+#   include <netinet/tcp.h>
+#   include <netinet/in.h>
+#   include <unistd.h>
+#   define closesocket(_s) ::close(_s)
+#endif
+
+// Linux reports a closed peer with SIGPIPE unless we ask it not to
+#ifndef MSG_NOSIGNAL
+#   define MSG_NOSIGNAL 0
+#endif
+
+#include "tcpdevice.h"
+#include "macros.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#if 0
+#define TCP_TRACE(_x)   printf _x
+#else
+#define TCP_TRACE(_x)
+#endif
+
+
+TcpDevice::TcpDevice(unsigned port) :
+    mFD(-1),
+    mPort(port),
+    mPendingOUTPackets(0),
+    mRxFill(0)
+{
+}
+
+bool TcpDevice::open(uint16_t vendorId, uint16_t productId, uint8_t interface)
+{
+    /*
+     * Siftulator only simulates a Base running the normal firmware,
+     * so there's nothing to connect to for any other vid/pid.
+     */
+
+    if (vendorId != SIFTEO_VID || productId != BASE_PID) {
+        fprintf(stderr, "siftulator does not emulate device %04x:%04x\n", vendorId, productId);
+        return false;
+    }
+
+    #ifdef _WIN32
+        WSADATA wsaData;
+        WSAStartup(MAKEWORD(2, 2), &wsaData);
+    #endif
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(mPort);
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        return false;
+
+    if (connect(fd, (struct sockaddr *)&addr, sizeof addr) < 0) {
+        fprintf(stderr, "can't connect to siftulator on port %d. "
+            "Is it running with \"-U %d\"?\n", mPort, mPort);
+        closesocket(fd);
+        return false;
+    }
+
+    unsigned long arg = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, (const char *)&arg, sizeof arg);
+    #ifdef SO_NOSIGPIPE
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, (const char *)&arg, sizeof arg);
+    #endif
+
+    mFD = fd;
+    mRxFill = 0;
+    mPendingOUTPackets = 0;
+    mBufferedINPackets.clear();
+
+    TCP_TRACE(("TCP: Connected on port %d\n", mPort));
+    return true;
+}
+
+void TcpDevice::close()
+{
+    if (!isOpen())
+        return;
+
+    closesocket(mFD);
+    mFD = -1;
+}
+
+bool TcpDevice::isOpen() const
+{
+    return mFD >= 0;
+}
+
+int TcpDevice::processEvents(unsigned timeoutMillis)
+{
+    /*
+     * Wait up to timeoutMillis for data from Siftulator, and sort any
+     * complete frames into IN packets and OUT acknowledgments.
+     */
+
+    if (!isOpen())
+        return -1;
+
+    fd_set rfds;
+    struct timeval tv = {
+        timeoutMillis / 1000,           // tv_sec
+        (timeoutMillis % 1000) * 1000   // tv_usec
+    };
+
+    FD_ZERO(&rfds);
+    FD_SET(mFD, &rfds);
+    if (select(mFD + 1, &rfds, NULL, NULL, &tv) < 1)
+        return 0;
+
+    int ret = recv(mFD, (char*) mRxBuffer + mRxFill, sizeof mRxBuffer - mRxFill, 0);
+    if (ret <= 0) {
+        fprintf(stderr, "siftulator disconnected\n");
+        close();
+        return -1;
+    }
+
+    mRxFill += ret;
+    if (!rxFrames()) {
+        close();
+        return -1;
+    }
+
+    return 0;
+}
+
+bool TcpDevice::rxFrames()
+{
+    using namespace UsbLoopback;
+    unsigned offset = 0;
+
+    while (mRxFill - offset >= HEADER_BYTES) {
+        const FrameHeader *hdr = reinterpret_cast<const FrameHeader*>(mRxBuffer + offset);
+        const uint8_t *payload = mRxBuffer + offset + HEADER_BYTES;
+
+        if (hdr->len > MAX_PACKET) {
+            fprintf(stderr, "bad frame from siftulator (len %d)\n", hdr->len);
+            return false;
+        }
+        if (mRxFill - offset < HEADER_BYTES + hdr->len)
+            break;
+
+        switch (hdr->type) {
+
+        case InData: {
+            RxPacket pkt;
+            pkt.len = hdr->len;
+            memcpy(pkt.buf, payload, hdr->len);
+            mBufferedINPackets.push_back(pkt);
+            break;
+        }
+
+        case OutAck:
+            if (hdr->len >= 1)
+                mPendingOUTPackets -= MIN(mPendingOUTPackets, payload[0]);
+            break;
+
+        default:
+            fprintf(stderr, "bad frame from siftulator (type %d)\n", hdr->type);
+            return false;
+        }
+
+        offset += HEADER_BYTES + hdr->len;
+    }
+
+    if (offset) {
+        mRxFill -= offset;
+        memmove(mRxBuffer, mRxBuffer + offset, mRxFill);
+    }
+
+    return true;
+}
+
+int TcpDevice::readPacket(uint8_t *buf, unsigned maxlen, unsigned &rxlen)
+{
+    /*
+     * Dequeue a packet that has already been received.
+     */
+
+    assert(!mBufferedINPackets.empty());
+
+    const RxPacket &pkt = mBufferedINPackets.front();
+    rxlen = MIN(maxlen, pkt.len);
+    memcpy(buf, pkt.buf, rxlen);
+    mBufferedINPackets.pop_front();
+
+    return 0;
+}
+
+int TcpDevice::writePacket(const uint8_t *buf, unsigned len)
+{
+    using namespace UsbLoopback;
+
+    if (!isOpen())
+        return -1;
+
+    uint8_t frame[MAX_FRAME];
+    FrameHeader *hdr = reinterpret_cast<FrameHeader*>(frame);
+
+    len = MIN(len, MAX_PACKET);
+    hdr->type = OutData;
+    hdr->len = len;
+    memcpy(frame + HEADER_BYTES, buf, len);
+
+    unsigned sent = 0;
+    while (sent < HEADER_BYTES + len) {
+        int ret = send(mFD, (const char*) frame + sent, HEADER_BYTES + len - sent,
+            MSG_NOSIGNAL);
+        if (ret <= 0)
+            return -1;
+        sent += ret;
+    }
+
+    mPendingOUTPackets++;
+    return len;
+}
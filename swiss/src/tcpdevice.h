@@ -0,0 +1,87 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * swiss - your Sifteo utility knife
+ *
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef _TCP_DEVICE_H_
+#define _TCP_DEVICE_H_
+
+#include "iodevice.h"
+#include "usbloopback.h"
+
+#include <list>
+#include <stdint.h>
+
+/*
+ * IODevice backed by a TCP connection to Siftulator's simulated USB port.
+ *
+ * Packets are framed as described in usbloopback.h. Each OUT packet
+ * stays pending until Siftulator acknowledges that the firmware has
+ * consumed it, so numPendingOUTPackets() gives callers the same flow
+ * control they get from outstanding libusb transfers.
+ */
+class TcpDevice : public IODevice {
+public:
+    TcpDevice(unsigned port = UsbLoopback::DEFAULT_PORT);
+
+    bool open(uint16_t vendorId, uint16_t productId, uint8_t interface = 0);
+    void close();
+    bool isOpen() const;
+    int processEvents(unsigned timeoutMillis = 0);
+
+    unsigned maxINPacketSize() const {
+        return UsbLoopback::MAX_PACKET;
+    }
+
+    unsigned maxOUTPacketSize() const {
+        return UsbLoopback::MAX_PACKET;
+    }
+
+    unsigned numPendingINPackets() const {
+        return mBufferedINPackets.size();
+    }
+    int readPacket(uint8_t *buf, unsigned maxlen, unsigned &rxlen);
+
+    unsigned numPendingOUTPackets() const {
+        return mPendingOUTPackets;
+    }
+    int writePacket(const uint8_t *buf, unsigned len);
+
+private:
+    int mFD;
+    unsigned mPort;
+    unsigned mPendingOUTPackets;
+
+    unsigned mRxFill;
+    uint8_t mRxBuffer[4096];
+
+    struct RxPacket {
+        unsigned len;
+        uint8_t buf[UsbLoopback::MAX_PACKET];
+    };
+    std::list<RxPacket> mBufferedINPackets;
+
+    bool rxFrames();
+};
+
+#endif // _TCP_DEVICE_H_
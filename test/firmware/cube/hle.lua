@@ -0,0 +1,82 @@
+--[[
+    Sifteo Thundercracker firmware unit tests
+
+    Copyright <c> 2012 Sifteo, Inc.
+   
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+]]--
+
+--[[
+    Run the graphics tests again with high-level cube emulation.
+
+    The reference screenshots were all captured from the real cube
+    firmware, so this checks that the HLE renderer draws every mode
+    exactly the same way. BG0_ROM is left out: its tile set only exists
+    in the firmware, and HLE renders it as black.
+]]--
+
+package.path = package.path .. ";../../lib/?.lua"
+
+require('luaunit')
+require('siftulator')
+require('vram')
+require('radio')
+require('test-graphics')
+
+gx.hle = true
+
+tests = {}
+for k,v in string.gmatch(os.getenv("TEST") or "", "[^%s]+") do
+    tests[1+#tests] = k
+end
+
+if #tests == 0 then
+    tests = {
+        "TestGraphics:test_solid",
+        "TestGraphics:test_fb32",
+        "TestGraphics:test_fb64",
+        "TestGraphics:test_fb128",
+        "TestGraphics:test_bg0",
+        "TestGraphics:test_bg2",
+        "TestGraphics:test_bg1_no_bits",
+        "TestGraphics:test_bg1_clear",
+        "TestGraphics:test_bg1_bits",
+        "TestGraphics:test_bg1_chroma",
+        "TestGraphics:test_bg1_spr_no_bits",
+        "TestGraphics:test_bg1_spr_clear",
+        "TestGraphics:test_bg1_spr_chroma",
+        "TestGraphics:test_mrpink",
+        "TestGraphics:test_spr0",
+        "TestGraphics:test_spr0_size",
+        "TestGraphics:test_spr0_pos",
+        "TestGraphics:test_spr0_overlap",
+        "TestGraphics:test_spr0_pan1",
+        "TestGraphics:test_stamp",
+    }
+end
+
+gx:init(os.getenv("USE_FRONTEND"))
+LuaUnit.result.clock = function() return gx.sys:clock() end
+failures = LuaUnit:run(tests)
+gx:exit()
+
+if failures > 0 then
+    -- Exit with an error code
+    error("Some of the HLE tests failed!")
+end
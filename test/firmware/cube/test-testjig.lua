@@ -154,6 +154,45 @@ TestTestjig = {}
         end
     end
 
+    function TestTestjig:test_flash_copy_tiles()
+        -- Source tiles: one solid, one fully erased, one with 1bpp pixels
+        jig:flashReset()
+        jig:programFlashAndWait(
+            'e10000' ..     -- Address 00:00
+            '00abcd' ..     -- LUT1    [0] = 0xabcd
+            '01ffff' ..     -- LUT1    [1] = 0xffff
+            '40' ..         -- TILE_P0 [0]
+            '41' ..         -- TILE_P0 [1]
+            '60' ..         -- TILE_P1_R4 (count=1)
+            '01234567' ..   -- 16 nybbles of pixel data
+            '89abcdef' ..
+            ('e0'):rep(10)  -- 10 pad bytes
+        )
+
+        -- Copy all three, then keep decoding at the address after the copy.
+        -- This catches a clobbered source address, count, or destination.
+        jig:programFlashAndWait(
+            'e14000' ..     -- Address 00:40 (tile 32)
+            'e4000003' ..   -- COPY_TILES from 00:00, three tiles
+            '40'            -- TILE_P0 [0]
+        )
+
+        for i = 0, 3*64 - 1 do
+            assertEquals(gx.cube:fwPeek(0x20 * 64 + i), gx.cube:fwPeek(i))
+        end
+        for i = 0x23 * 64, 0x24 * 64 - 1 do
+            assertEquals(gx.cube:fwPeek(i), 0xabcd)
+        end
+
+        -- The decoder must still be in sync afterwards
+        jig:programFlashAndWait(
+            'e14000' ..     -- Address 00:40
+            'e23301'        -- CRC, one block
+        )
+        assertEquals(unpackHex(radio:expectQuery(0x33)),
+                     unpackHex(flashCRC(gx.cube, 0x20 * 0x80, 1)))
+    end
+
     function TestTestjig:test_flash_crc()
 
         -- Write some simple tiles, plus erase the first block
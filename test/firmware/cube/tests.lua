@@ -61,6 +61,14 @@ require('test-testjig')
     "TestClass:test_name", just like the strings that luainit
     will print as the tests run. It can also be a space-separated
     list of such strings.
+
+    These are used by tools/run-lua-tests.py to shard the suite:
+
+      TEST_LIST      Write the name of every selected test to this
+                     file, one per line, and exit without running them.
+
+      TEST_RESULTS   After running, write per-test results and wall
+                     times to this file as JSON.
 ]]--
 
 tests = {}
@@ -68,10 +76,24 @@ for k,v in string.gmatch(os.getenv("TEST") or "", "[^%s]+") do
     tests[1+#tests] = k
 end
 
+if os.getenv("TEST_LIST") then
+    local f = assert(io.open(os.getenv("TEST_LIST"), "w"))
+    for i, name in ipairs(LuaUnit:listTests(tests)) do
+        f:write(name .. "\n")
+    end
+    f:close()
+    return
+end
+
 gx:init(os.getenv("USE_FRONTEND"))
+LuaUnit.result.clock = function() return gx.sys:clock() end
 failures = LuaUnit:run(tests)
 gx:exit()
 
+if os.getenv("TEST_RESULTS") then
+    LuaUnit.result:writeJSON(os.getenv("TEST_RESULTS"))
+end
+
 if failures > 0 then
     -- Exit with an error code
     error("Some of the tests failed!")
@@ -99,10 +99,12 @@ gx = {}
 
     function gx:init(useFrontend)
         -- Use one cube, and let the firmware boot.
+        -- If gx.hle is set, the cube uses high-level emulation instead.
         
         gx.sys = System()
         gx.cube = Cube(0)               
-        gx.sys:setOptions{numCubes=1, turbo=true, noCubeReconnect=true}
+        gx.sys:setOptions{numCubes=1, turbo=true, noCubeReconnect=true,
+                          hleCubes=(gx.hle == true)}
         gx.sys:init()
 
         gx.lastExceptionCount = 0
@@ -119,6 +121,27 @@ gx = {}
     function gx:setUp()
         -- Setup to be done before each test.
 
+        if gx.hle then
+            -- No firmware to boot, and no idle frame to wait for
+            gx.cube:reset()
+        else
+            gx:bootFirmware()
+        end
+
+        -- Seed the PRNG, and wipe VRAM. Reset the exception counter.
+        
+        gx:wipe()
+        gx:setWindow(0, LCD_HEIGHT)
+        gx:setRotation(0)
+        gx.cube:xbPoke(VA_MODE, VM_BG0_ROM)
+        gx.cube:xbPoke(VA_FLAGS, 0)
+
+        -- Make sure we can draw a frame successfully
+
+        gx:drawFrame()
+    end
+
+    function gx:bootFirmware()
         -- Enable the testjig to put the cube into "connected" mode
         -- Must be enough time for the cube to boot, worst-case
 
@@ -135,18 +158,6 @@ gx = {}
         assertEquals(pixelCount >= LCD_PIXELS, true)
         gx.sys:vsleep(0.2)
         assertEquals(gx.cube:lcdPixelCount(), pixelCount)
-
-        -- Seed the PRNG, and wipe VRAM. Reset the exception counter.
-        
-        gx:wipe()
-        gx:setWindow(0, LCD_HEIGHT)
-        gx:setRotation(0)
-        gx.cube:xbPoke(VA_MODE, VM_BG0_ROM)
-        gx.cube:xbPoke(VA_FLAGS, 0)
-
-        -- Make sure we can draw a frame successfully
-
-        gx:drawFrame()
     end
     
     function gx:yield()
@@ -229,10 +240,11 @@ gx = {}
     end
     
     function gx:hexDumpVRAM()
+        local vram = gx.cube:xRead(0, VRAM_BYTES)
         for addr = 0, 0x3F0, 0x10 do
             line = string.format("VRAM %04x:", addr)
             for i = addr, addr + 0xF, 1 do
-                line = line .. string.format(" %02x", gx.cube:xbPeek(i))
+                line = line .. string.format(" %02x", string.byte(vram, i + 1))
             end
             print(line)
         end
@@ -240,25 +252,14 @@ gx = {}
     
     function gx:loadVRAM(name)
         local data = io.open(string.format(BINARY_PATH_FMT, name), "rb"):read("*a")
-        local addr = 0
-        for b in string.gfind(data, ".") do
-            gx.cube:xbPoke(addr, string.byte(b))
-            addr = addr + 1
-            
-            if addr == VA_FLAGS then
-                -- Quit now; we don't want to inadvertently trigger a render
-                return
-            end
-        end
+
+        -- Stop short of VA_FLAGS; we don't want to inadvertently trigger a render
+        gx.cube:xWrite(0, string.sub(data, 1, VA_FLAGS))
     end
 
     function gx:loadFlash(name)
         local data = io.open(string.format(BINARY_PATH_FMT, name), "rb"):read("*a")
-        local addr = 0
-        for b in string.gfind(data, ".") do
-            gx.cube:fbPoke(addr, string.byte(b))
-            addr = addr + 1
-        end
+        gx.cube:fWrite(0, data)
     end
    
     function gx:setMode(m)
@@ -338,9 +339,7 @@ gx = {}
     end
         
     function gx:xbFill(addr, len, value)
-        for i = addr, addr+len-1, 1 do
-            gx.cube:xbPoke(i, value)
-        end
+        gx.cube:xWrite(addr, string.rep(string.char(value), len))
     end
 
     function gx:xwFill(addr, len, value)
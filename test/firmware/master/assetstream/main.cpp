@@ -0,0 +1,245 @@
+#include "assetstream.h"
+#include "macros.h"
+
+#include "string.h"
+
+/*
+ * Tests for AssetStreamBuffer, the shared window of AssetGroup data that
+ * the AssetLoader streams to several cubes at once.
+ *
+ * This models the AssetLoader's use of it: a task which refills the
+ * window and hands out data, and a radio ISR which sends each cube up to
+ * its own per-packet budget. Cubes that can't join the stream load from
+ * "flash" directly, like AssetFIFO::fetchFromGroup(). We check that every
+ * cube receives the exact group data, and count how many bytes we read
+ * from flash to get it there.
+ */
+
+static const unsigned kDataSize = 9000;
+static const unsigned kMaxCubes = 12;
+
+static uint8_t groupData[kDataSize];
+static unsigned flashBytesRead;
+
+static AssetStreamBuffer stream;
+static unsigned streamCubes;
+
+struct ModelCube {
+    unsigned rate;          // Bytes per radio packet
+    unsigned startTick;     // When this cube reaches S_CONFIG_DATA
+    unsigned offset;        // Next byte to hand out (config.offset)
+    unsigned sent;          // Next stream byte to send (cubeStreamOffset)
+    bool streaming;
+    uint8_t received[kDataSize];
+};
+
+static ModelCube cubes[kMaxCubes];
+static unsigned numCubes;
+
+static void flashRead(unsigned offset, uint8_t *dest, unsigned count)
+{
+    ASSERT(offset + count <= kDataSize);
+    memcpy(dest, groupData + offset, count);
+    flashBytesRead += count;
+}
+
+static void reset(unsigned n)
+{
+    for (unsigned i = 0; i < kDataSize; ++i)
+        groupData[i] = i * 7 + (i >> 8);
+
+    memset(cubes, 0, sizeof cubes);
+    numCubes = n;
+    streamCubes = 0;
+    flashBytesRead = 0;
+}
+
+static void refillStream()
+{
+    // Same policy as AssetLoader::refillStream()
+
+    if (!streamCubes)
+        return;
+
+    unsigned slowest = ~0U;
+    unsigned fastest = 0;
+    for (unsigned i = 0; i < numCubes; ++i)
+        if (cubes[i].streaming) {
+            slowest = MIN(slowest, cubes[i].sent);
+            fastest = MAX(fastest, cubes[i].sent);
+        }
+
+    while (unsigned count = stream.prepareWrite(slowest, fastest, kDataSize)) {
+        flashRead(stream.getEnd(), stream.writePointer(), count);
+        stream.commitWrite(count);
+    }
+}
+
+static void task(unsigned tick)
+{
+    for (unsigned i = 0; i < numCubes; ++i) {
+        ModelCube &c = cubes[i];
+        if (tick < c.startTick || c.offset == kDataSize)
+            continue;
+
+        if (!c.streaming) {
+            // AssetLoader::joinStream()
+            if (!streamCubes) {
+                stream.reset(c.offset);
+                c.streaming = true;
+            } else if (stream.contains(c.offset)) {
+                c.streaming = true;
+            }
+            if (c.streaming) {
+                c.sent = c.offset;
+                streamCubes++;
+            }
+        }
+
+        if (c.streaming) {
+            refillStream();
+            c.offset = MAX(c.offset, MIN(kDataSize, stream.getEnd()));
+        } else {
+            // Private FIFO: read straight into the cube
+            unsigned count = MIN(c.rate, kDataSize - c.offset);
+            flashRead(c.offset, c.received + c.offset, count);
+            c.offset += count;
+        }
+    }
+}
+
+static void radioISR()
+{
+    for (unsigned i = 0; i < numCubes; ++i) {
+        ModelCube &c = cubes[i];
+        if (!c.streaming)
+            continue;
+
+        unsigned end = MIN(c.offset, stream.getEnd());
+        unsigned count = MIN(c.rate, end - c.sent);
+        while (count--) {
+            c.received[c.sent] = stream.at(c.sent);
+            c.sent++;
+        }
+
+        if (c.sent == kDataSize) {
+            // AssetLoader::leaveStream(), from S_CONFIG_FINISH
+            c.streaming = false;
+            streamCubes--;
+        }
+    }
+}
+
+static void run()
+{
+    for (unsigned tick = 0;; ++tick) {
+        ASSERT(tick < 100000);
+        task(tick);
+        radioISR();
+
+        bool done = true;
+        for (unsigned i = 0; i < numCubes; ++i)
+            if (cubes[i].offset != kDataSize || cubes[i].streaming)
+                done = false;
+        if (done)
+            break;
+    }
+
+    for (unsigned i = 0; i < numCubes; ++i)
+        ASSERT(memcmp(cubes[i].received, groupData, kDataSize) == 0);
+}
+
+static void bufferBasics()
+{
+    // Writes stop at the wrap point, at the limit, and when the window is full
+
+    stream.reset(250);
+    ASSERT(stream.writeAvailable(kDataSize) == 6);
+    ASSERT(stream.writeAvailable(252) == 2);
+    ASSERT(stream.writeAvailable(250) == 0);
+
+    memset(stream.writePointer(), 0xAA, 6);
+    stream.commitWrite(6);
+    ASSERT(stream.writeAvailable(kDataSize) == stream.SIZE - 6);
+    memset(stream.writePointer(), 0xBB, stream.SIZE - 6);
+    stream.commitWrite(stream.SIZE - 6);
+
+    ASSERT(stream.writeAvailable(kDataSize) == 0);
+    ASSERT(stream.at(255) == 0xAA);
+    ASSERT(stream.at(256) == 0xBB);
+    ASSERT(stream.contains(250) && stream.contains(250 + stream.SIZE));
+    ASSERT(!stream.contains(249) && !stream.contains(251 + stream.SIZE));
+
+    // Discarding frees space for the next write, again split at the wrap
+    stream.discard(260);
+    ASSERT(stream.getBegin() == 260);
+    ASSERT(stream.writeAvailable(kDataSize) == 6);
+    stream.commitWrite(6);
+    ASSERT(stream.writeAvailable(kDataSize) == 4);
+
+    // Readers can skip past everything we've read
+    stream.discard(1000);
+    ASSERT(stream.getBegin() == 1000 && stream.getEnd() == 1000);
+}
+
+static void lockstep()
+{
+    // Same group on every cube, all starting together
+
+    reset(kMaxCubes);
+    for (unsigned i = 0; i < numCubes; ++i)
+        cubes[i].rate = 20;
+    run();
+
+    LOG(("assetstream: %u cubes in lockstep, %u bytes each: "
+        "%u bytes read from flash, %u without sharing\n",
+        numCubes, kDataSize, flashBytesRead, numCubes * kDataSize));
+    ASSERT(flashBytesRead == kDataSize);
+}
+
+static void mixedRates()
+{
+    // Different radio rates and slightly staggered starts
+
+    reset(kMaxCubes);
+    for (unsigned i = 0; i < numCubes; ++i) {
+        cubes[i].rate = 5 + (i * 7) % 23;
+        cubes[i].startTick = i % 3;
+    }
+    run();
+
+    LOG(("assetstream: %u cubes at mixed rates, %u bytes each: "
+        "%u bytes read from flash, %u without sharing\n",
+        numCubes, kDataSize, flashBytesRead, numCubes * kDataSize));
+    ASSERT(flashBytesRead == kDataSize);
+}
+
+static void lateJoiner()
+{
+    // A cube a few packets behind still joins; one that arrives after the
+    // stream has moved on loads on its own
+
+    reset(3);
+    cubes[0].rate = 20;
+    cubes[1].rate = 20;
+    cubes[1].startTick = 5;
+    cubes[2].rate = 20;
+    cubes[2].startTick = 100;
+    run();
+
+    LOG(("assetstream: 2 cubes plus 1 late cube, %u bytes each: "
+        "%u bytes read from flash, %u without sharing\n",
+        kDataSize, flashBytesRead, numCubes * kDataSize));
+    ASSERT(flashBytesRead == 2 * kDataSize);
+}
+
+int main()
+{
+    bufferBasics();
+    lockstep();
+    mixedRates();
+    lateJoiner();
+
+    LOG(("assetstream: Success.\n"));
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include "vram.h"
+#include "macros.h"
+
+#include "string.h"
+
+/*
+ * Tests for VRAMBatchWriter, the per-chunk locking used by
+ * _SYS_vbuf_cmdlist(). The radio ISR can acknowledge a frame and unlock
+ * VRAM at any point during a batch; here we force that to happen between
+ * individual writes, and check that a model of the codec still ends up
+ * with every word the batch wrote.
+ */
+
+static _SYSVideoBuffer vbuf;
+static uint16_t cubeVRAM[_SYS_VRAM_WORDS];
+
+static void codecDrain()
+{
+    /*
+     * Like the radio codec: send every changed word in each unlocked
+     * chunk, then consider that chunk clean.
+     */
+
+    uint32_t chunks = vbuf.cm16 & ~vbuf.lock;
+
+    for (unsigned chunk = 0; chunk < 32; ++chunk) {
+        if (!(chunks & Intrinsic::LZ(chunk)))
+            continue;
+
+        for (unsigned addr = chunk * 16; addr < chunk * 16 + 16; ++addr) {
+            uint32_t &cm1 = VRAM::selectCM1(vbuf, addr);
+            uint32_t mask = VRAM::maskCM1(addr);
+            if (cm1 & mask) {
+                cubeVRAM[addr] = vbuf.vram.words[addr];
+                cm1 &= ~mask;
+            }
+        }
+
+        vbuf.cm16 &= ~Intrinsic::LZ(chunk);
+    }
+}
+
+static void radioISR()
+{
+    // Frame acknowledged: PaintControl unlocks, then the codec runs.
+    VRAM::unlock(vbuf);
+    codecDrain();
+}
+
+static void reset()
+{
+    memset(&vbuf, 0, sizeof vbuf);
+    VRAM::init(vbuf);
+    radioISR();
+    ASSERT(memcmp(cubeVRAM, vbuf.vram.words, sizeof cubeVRAM) == 0);
+}
+
+static void checkCube()
+{
+    radioISR();
+    ASSERT(vbuf.cm16 == 0);
+    ASSERT(memcmp(cubeVRAM, vbuf.vram.words, sizeof cubeVRAM) == 0);
+}
+
+static void unlockBetweenWrites()
+{
+    // Two writes to the same chunk, with an unlock in between
+
+    reset();
+    VRAMBatchWriter writer(vbuf);
+
+    writer.poke(0x010, 0x1111);
+    ASSERT(vbuf.lock & VRAM::maskCM16(0x010));
+    radioISR();
+    ASSERT(cubeVRAM[0x010] == 0x1111);
+
+    writer.poke(0x011, 0x2222);
+    ASSERT(vbuf.lock & VRAM::maskCM16(0x011));
+    checkCube();
+}
+
+static void unlockDuringLongBatch()
+{
+    // Scattered writes across all of VRAM, unlocking at varying intervals
+
+    reset();
+    VRAMBatchWriter writer(vbuf);
+
+    for (unsigned pass = 1; pass < 8; ++pass) {
+        unsigned n = 0;
+        for (unsigned addr = pass; addr < _SYS_VRAM_WORDS; addr += 3) {
+            writer.poke(addr, pass * 0x101 + addr);
+            if (++n % (pass * 5) == 0)
+                radioISR();
+        }
+    }
+
+    checkCube();
+}
+
+static void unchangedWordsStayUnlocked()
+{
+    // Writing a word's existing value must not lock its chunk
+
+    reset();
+    VRAMBatchWriter writer(vbuf);
+
+    writer.poke(0x100, 0);
+    ASSERT(vbuf.lock == 0);
+    ASSERT(vbuf.cm16 == 0);
+
+    writer.poke(0x100, 0x7777);
+    ASSERT(vbuf.lock == VRAM::maskCM16(0x100));
+    checkCube();
+}
+
+int main()
+{
+    unlockBetweenWrites();
+    unlockDuringLongBatch();
+    unchangedWordsStayUnlocked();
+
+    LOG(("vrambatch: Success.\n"));
+    return 0;
+}
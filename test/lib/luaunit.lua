@@ -159,7 +159,13 @@ UnitResult = { -- class
     currentClassName = "",
     currentTestName = "",
     testHasFailure = false,
-    verbosity = 1
+    verbosity = 1,
+
+    -- Per-test name, wall time, and error message (if any), in run order.
+    -- The clock can be replaced with a higher resolution timer.
+    testResults = {},
+    clock = os.clock,
+    testStartTime = 0
 }
     function UnitResult:displayClassName()
         print( '>>>>>>>>> '.. self.currentClassName )
@@ -227,6 +233,7 @@ UnitResult = { -- class
         self:displayTestName()
         self.testCount = self.testCount + 1
         self.testHasFailure = false
+        self.testStartTime = self.clock()
     end
 
     function UnitResult:addFailure( errorMsg )
@@ -237,9 +244,36 @@ UnitResult = { -- class
     end
 
     function UnitResult:endTest()
-        if not self.testHasFailure then
+        local errorMsg
+        if self.testHasFailure then
+            errorMsg = self.errorList[table.getn(self.errorList)][2]
+        else
             self:displaySuccess()
         end
+        table.insert( self.testResults, {
+            name = self.currentTestName,
+            time = self.clock() - self.testStartTime,
+            error = errorMsg
+        })
+    end
+
+    function UnitResult:writeJSON( filename )
+        -- Write testResults as a JSON array, for external test runners
+        local function quote( s )
+            return '"' .. string.gsub(s, '[%c"\\]', function(c)
+                return string.format("\\u%04x", string.byte(c))
+            end) .. '"'
+        end
+
+        local f = assert(io.open(filename, "w"))
+        f:write("[\n")
+        for i, r in ipairs(self.testResults) do
+            f:write(string.format('{"name": %s, "time": %.6f, "error": %s}%s\n',
+                quote(r.name), r.time, r.error and quote(r.error) or "null",
+                i < table.getn(self.testResults) and "," or ""))
+        end
+        f:write("]\n")
+        f:close()
     end
 
 -- class UnitResult end
@@ -358,6 +392,39 @@ LuaUnit = {
         print()
     end
 
+    function LuaUnit:listTests(args)
+        -- Expand a list of class names (or all 'Test' classes, if the list
+        -- is empty) into the full 'Class:method' name of every test that
+        -- LuaUnit:run() would execute.
+
+        local classList = {}
+        local testList = {}
+
+        if args and #args > 0 then
+            classList = args
+        else
+            for key, val in pairs(_G) do
+                if string.sub(key,1,4) == 'Test' then
+                    table.insert( classList, key )
+                end
+            end
+            table.sort( classList )
+        end
+
+        for i, aClassName in ipairs(classList) do
+            if string.find(aClassName, ':') then
+                table.insert( testList, aClassName )
+            else
+                for methodName, method in orderedPairs(_G[aClassName] or {}) do
+                    if LuaUnit.isFunction(method) and string.sub(methodName, 1, 4) == "test" then
+                        table.insert( testList, aClassName..':'..methodName )
+                    end
+                end
+            end
+        end
+        return testList
+    end
+
     function LuaUnit:run(args)
         -- Run some specific test classes.
         -- If no arguments are passed, run the class names specified on the
@@ -0,0 +1,89 @@
+/*
+ * Exercise the compiler's packing of small functions into shared flash
+ * blocks, especially functions that only just fit in what's left of a
+ * block.
+ *
+ * Each function below is a straight-line run of steps, and every step
+ * loads two unique 32-bit constants from the block's constant pool. A
+ * step is around 16 bytes of code and constants, so functions range
+ * from tiny to nearly a whole 256-byte block. Packed in module order,
+ * they fill blocks to every possible level.
+ *
+ * If a packed block overflowed, constant pool references would land in
+ * the wrong place and the results wouldn't match the reference loop.
+ */
+
+#include <sifteo.h>
+using namespace Sifteo;
+
+#define STEP(i)         x = (x * (0x9E3779B1u + (i) * 0x01000193u)) ^ (0x7F4A7C15u - (i) * 0x0100F0F1u);
+#define STEPS_2(i)      STEP(i) STEP((i) + 1)
+#define STEPS_4(i)      STEPS_2(i) STEPS_2((i) + 2)
+#define STEPS_8(i)      STEPS_4(i) STEPS_4((i) + 4)
+
+#define FUNC(name, body) \
+    NOINLINE uint32_t name(uint32_t x) { body return x; }
+
+FUNC(f1,  STEP(0))
+FUNC(f13, STEPS_8(1) STEPS_4(9) STEP(13))
+FUNC(f2,  STEPS_2(14))
+FUNC(f12, STEPS_8(16) STEPS_4(24))
+FUNC(f3,  STEPS_2(28) STEP(30))
+FUNC(f11, STEPS_8(31) STEPS_2(39) STEP(41))
+FUNC(f4,  STEPS_4(42))
+FUNC(f10, STEPS_8(46) STEPS_2(54))
+FUNC(f5,  STEPS_4(56) STEP(60))
+FUNC(f9,  STEPS_8(61) STEP(69))
+FUNC(f6,  STEPS_4(70) STEPS_2(74))
+FUNC(f8,  STEPS_8(76))
+FUNC(f7,  STEPS_4(84) STEPS_2(88) STEP(90))
+FUNC(f14, STEPS_8(91) STEPS_4(99) STEPS_2(103))
+FUNC(f15, STEPS_8(105) STEPS_4(113) STEPS_2(117) STEP(119))
+
+struct Test {
+    uint32_t (*func)(uint32_t);
+    unsigned first, count;
+};
+
+static const Test tests[] = {
+    { f1,    0,  1 },
+    { f13,   1, 13 },
+    { f2,   14,  2 },
+    { f12,  16, 12 },
+    { f3,   28,  3 },
+    { f11,  31, 11 },
+    { f4,   42,  4 },
+    { f10,  46, 10 },
+    { f5,   56,  5 },
+    { f9,   61,  9 },
+    { f6,   70,  6 },
+    { f8,   76,  8 },
+    { f7,   84,  7 },
+    { f14,  91, 14 },
+    { f15, 105, 15 },
+};
+
+static uint32_t reference(uint32_t x, unsigned first, unsigned count)
+{
+    for (unsigned i = first; i != first + count; ++i)
+        STEP(i)
+    return x;
+}
+
+void main()
+{
+    for (unsigned t = 0; t != arraysize(tests); ++t) {
+        const Test &test = tests[t];
+        for (uint32_t seed = 1; seed < 1000; seed += 97) {
+            uint32_t result = test.func(seed);
+            uint32_t expected = reference(seed, test.first, test.count);
+            if (result != expected) {
+                LOG("Mismatch in test %d, seed %d: got %08x, expected %08x\n",
+                    t, seed, result, expected);
+                _SYS_abort();
+            }
+        }
+    }
+
+    LOG("Success.\n");
+}
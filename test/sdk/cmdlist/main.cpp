@@ -0,0 +1,176 @@
+#include <sifteo.h>
+using namespace Sifteo;
+
+static CubeID cube = 0;
+static VideoBuffer vid;
+static VideoBuffer ref;
+
+static Metadata M = Metadata()
+    .title("VideoCommandList test")
+    .cubeRange(1);
+
+// Size of the BG0 tile grid, in bytes
+static const unsigned kBG0Bytes = _SYS_VRAM_BG0_WIDTH * _SYS_VRAM_BG0_WIDTH * 2;
+
+// Tiles, BG1 mask, and sprites: everything a command list can reach
+static const unsigned kCheckedBytes = _SYS_VA_BG1_XY;
+
+
+static void assertCubeMatchesBuffer(unsigned bytes = kBG0Bytes)
+{
+    System::finish();
+
+    SCRIPT_FMT(LUA, "assert(Cube(0):xCRC(0, %d) == Runtime():crc(%p, %d))",
+        bytes, &vid.sys.vbuf.vram, bytes);
+}
+
+static void assertMatchesReference()
+{
+    ASSERT(0 == memcmp8(vid.sys.vbuf.vram.bytes,
+        ref.sys.vbuf.vram.bytes, kCheckedBytes));
+}
+
+static void refMaskBits(unsigned row, uint16_t set, uint16_t clear)
+{
+    uint16_t addr = _SYS_VA_BG1_BITMAP/2 + row;
+    uint16_t bits = _SYS_vbuf_peek(&ref.sys, addr);
+    _SYS_vbuf_poke(&ref.sys, addr, (bits | set) & ~clear);
+}
+
+static void testEquivalence()
+{
+    /*
+     * The WRECT, SPR_MOVE, and BG1_SET/CLEAR commands must have exactly
+     * the same effect as the individual syscalls they replace.
+     */
+
+    static const uint16_t src[6 * 5] = {
+        0,  1,  2,  3,  4,  5,
+        6,  7,  8,  9,  10, 11,
+        12, 13, 14, 15, 16, 17,
+        18, 19, 20, 21, 22, 23,
+        24, 25, 26, 27, 28, 29,
+    };
+
+    VideoCommandList<256> cmds;
+
+    vid.initMode(BG0_SPR_BG1);
+    ref.initMode(BG0_SPR_BG1);
+    vid.attach(cube);
+    assertMatchesReference();
+
+    // BG0 rectangle, with a source stride wider than the rect
+    cmds.writeRect(2 + 18*3, src, 100, 5, 4, 6, 18);
+    _SYS_vbuf_wrect(&ref.sys, 2 + 18*3, src, 100, 5, 4, 6, 18);
+
+    // BG1 tile rectangle, with a large index offset
+    cmds.writeRect(_SYS_VA_BG1_TILES/2, src + 1, 0x4000, 4, 5, 6, 4);
+    _SYS_vbuf_wrect(&ref.sys, _SYS_VA_BG1_TILES/2, src + 1, 0x4000, 4, 5, 6, 4);
+
+    // Sprites, including negative and out-of-range coordinates
+    for (unsigned id = 0; id < _SYS_VRAM_SPRITES; ++id) {
+        int x = id * 37 - 100;
+        int y = 300 - id * 53;
+        cmds.moveSprite(id, x, y);
+        _SYS_vbuf_spr_move(&ref.sys, id, x, y);
+    }
+
+    // Mask bits, set and cleared on the same rows
+    for (unsigned row = 0; row < _SYS_VRAM_BG1_WIDTH; ++row) {
+        uint16_t bits = 0x9249 << (row % 3);
+        cmds.setMaskBits(row, bits);
+        refMaskBits(row, bits, 0);
+        if (row & 1) {
+            cmds.clearMaskBits(row, 0x00F0);
+            refMaskBits(row, 0, 0x00F0);
+        }
+    }
+
+    ASSERT(!cmds.overflowed());
+    vid.apply(cmds);
+
+    assertMatchesReference();
+    assertCubeMatchesBuffer(kCheckedBytes);
+}
+
+static void testPendingPaint()
+{
+    /*
+     * Apply each command list right after a paint(), without waiting
+     * for it to finish. The radio acknowledges that frame while the
+     * list is being applied, unlocking chunks the list has already
+     * locked. Every change must still reach the cube.
+     */
+
+    VideoCommandList<1024> cmds;
+
+    vid.initMode(BG0);
+    vid.attach(cube);
+    vid.bg0.erase(0);
+    assertCubeMatchesBuffer();
+
+    for (unsigned frame = 1; frame < 64; ++frame) {
+        cmds.clear();
+
+        // Scattered pokes touch nearly every chunk in BG0
+        for (unsigned addr = frame % 7; addr < kBG0Bytes / 2; addr += 7)
+            cmds.poke(addr, frame * 13 + addr);
+
+        cmds.fill(frame * 3, frame, 20);
+        ASSERT(!cmds.overflowed());
+
+        System::paint();
+        vid.apply(cmds);
+    }
+
+    assertCubeMatchesBuffer();
+}
+
+static void testPendingPaintAllOps()
+{
+    /*
+     * Like testPendingPaint(), but with every command type. Each list
+     * revisits the same chunks, so a chunk unlocked by the radio partway
+     * through must be locked again by the next write to it.
+     */
+
+    uint16_t src[6 * 4];
+    VideoCommandList<512> cmds;
+
+    vid.initMode(BG0_SPR_BG1);
+    vid.attach(cube);
+    assertCubeMatchesBuffer(kCheckedBytes);
+
+    for (unsigned frame = 1; frame < 64; ++frame) {
+        cmds.clear();
+
+        for (unsigned i = 0; i < arraysize(src); ++i)
+            src[i] = frame * 7 + i;
+
+        for (unsigned i = 0; i < 4; ++i) {
+            cmds.writeRect((frame + i * 5) % 12 + 18 * i * 4, src, i, 6, 4, 6, 18);
+            cmds.writeRect(_SYS_VA_BG1_TILES/2 + i * 8, src, frame, 4, 2, 6, 4);
+            cmds.moveSprite((frame + i) % _SYS_VRAM_SPRITES, frame * 3 + i, frame - i * 9);
+            cmds.setMaskBits((frame + i) % _SYS_VRAM_BG1_WIDTH, 1 << ((frame + i) % 16));
+            cmds.clearMaskBits((frame + i * 3) % _SYS_VRAM_BG1_WIDTH, 1 << ((frame * 5) % 16));
+        }
+        ASSERT(!cmds.overflowed());
+
+        System::paint();
+        vid.apply(cmds);
+    }
+
+    assertCubeMatchesBuffer(kCheckedBytes);
+}
+
+void main()
+{
+    while (!CubeSet::connected().test(cube))
+        System::yield();
+
+    testPendingPaint();
+    testEquivalence();
+    testPendingPaintAllOps();
+
+    LOG("Success.\n");
+}
@@ -24,7 +24,8 @@ void testFeatureBits()
     // is returning the appropriate value in the event that the feature flags
     // have been updated
 
-    uint32_t expectedFeatures = _SYS_FEATURE_SYS_VERSION | _SYS_FEATURE_BLUETOOTH;
+    uint32_t expectedFeatures = _SYS_FEATURE_SYS_VERSION | _SYS_FEATURE_BLUETOOTH |
+                                _SYS_FEATURE_VBUF_CMDLIST | _SYS_FEATURE_AUDIO_COUNTERS;
     ASSERT(_SYS_FEATURE_ALL == expectedFeatures);
     ASSERT(_SYS_getFeatures() == expectedFeatures);
 
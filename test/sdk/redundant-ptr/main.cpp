@@ -0,0 +1,148 @@
+/*
+ * Exercise slinky's redundant pointer validation elimination.
+ *
+ * Each test below does a short run of loads and stores where BP could
+ * plausibly be reused, and some where it must not be. The Makefile links
+ * this program twice, once with -disable-redundant-ptr, and requires both
+ * to print the same RESULT line. It also checks that the pass actually
+ * removed some validations, so this test keeps covering it.
+ *
+ * If a PTR was removed when it shouldn't have been, the access following
+ * it would go through whatever address BP held last, and the results
+ * would differ.
+ */
+
+#include <sifteo.h>
+using namespace Sifteo;
+
+struct Pair {
+    int x, y;
+};
+
+static Pair pairs[4];
+static int words[16];
+static int *volatile otherWord = &words[15];
+
+static const int table[8] = { 3, 1, 4, 1, 5, 9, 2, 6 };
+
+static uint32_t hash(uint32_t h, uint32_t value)
+{
+    return (h ^ value) * 0x01000193;
+}
+
+NOINLINE void clobberOther(int value)
+{
+    // A call validates some other address, leaving BP pointing there
+    *otherWord = value;
+    pairs[3].x = value * 3;
+}
+
+NOINLINE int readModifyWrite(Pair *p, int a)
+{
+    // Same address, several accesses in a row: BP can be reused
+    p->x += a;
+    p->y += p->x;
+    p->x ^= p->y;
+    return p->x + p->y;
+}
+
+NOINLINE Pair *copiedPointer(int a, Pair *p)
+{
+    // Returning 'p' needs a register copy of it in r0, and the accesses
+    // below may go through either register.
+    p->x = a;
+    p->y = p->x + 1;
+    p->x += p->y;
+    return p;
+}
+
+NOINLINE int acrossCall(Pair *p, int a)
+{
+    // BP must be revalidated after a call
+    p->x = a;
+    clobberOther(a + 1);
+    p->x += 2;
+    clobberOther(a + 5);
+    return p->x + pairs[3].x;
+}
+
+NOINLINE int acrossInlineAsm(Pair *p, int a)
+{
+    // Inline asm could do anything to BP
+    p->x = a;
+    asm volatile ("" ::: "memory");
+    p->y = p->x + 7;
+    return p->y;
+}
+
+NOINLINE int alternating(int *a, int *b, int n)
+{
+    // Each PTR redefines BP in the middle of the block
+    *a = n;
+    *b = *a + 1;
+    *a = *b * 3;
+    *b = *a - *b;
+    return *a + *b;
+}
+
+NOINLINE int advancing(int *p, int n)
+{
+    // The validated register itself is redefined
+    *p = n;
+    p++;
+    *p = n + 1;
+    p += 2;
+    *p = p[-3] + p[-2];
+    return *p;
+}
+
+NOINLINE int acrossBlocks(Pair *p, int *other, int n)
+{
+    // Only one side of the branch moves BP elsewhere
+    p->x = n;
+    if (n & 1)
+        *other = n * 5;
+    p->x += 3;
+    if (n & 2)
+        p->y = *other;
+    else
+        p->y = n;
+    p->x += p->y;
+    return p->x;
+}
+
+NOINLINE int flashAcrossSyscall(unsigned i)
+{
+    // Reads from flash, with a syscall in between that may evict the block
+    int a = table[i & 7];
+    int b = table[(i + 3) & 7];
+    SystemTime::now();
+    int c = table[i & 7];
+    return a * 100 + b * 10 + c;
+}
+
+void main()
+{
+    uint32_t h = 0x811c9dc5;
+
+    for (int n = 0; n < 16; ++n) {
+        h = hash(h, readModifyWrite(&pairs[n & 1], n));
+        h = hash(h, copiedPointer(n, &pairs[2])->x);
+        h = hash(h, acrossCall(&pairs[n & 1], n));
+        h = hash(h, acrossInlineAsm(&pairs[2], n));
+        h = hash(h, alternating(&words[n & 7], &words[8 + (n & 3)], n));
+        h = hash(h, alternating(&words[n & 7], &words[n & 7], n));
+        h = hash(h, advancing(&words[n & 3], n));
+        h = hash(h, acrossBlocks(&pairs[n & 1], &words[12], n));
+        h = hash(h, flashAcrossSyscall(n));
+    }
+
+    for (unsigned i = 0; i < arraysize(pairs); ++i) {
+        h = hash(h, pairs[i].x);
+        h = hash(h, pairs[i].y);
+    }
+    for (unsigned i = 0; i < arraysize(words); ++i)
+        h = hash(h, words[i]);
+
+    LOG("RESULT %08x\n", h);
+}
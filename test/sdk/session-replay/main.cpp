@@ -0,0 +1,66 @@
+#include <sifteo.h>
+using namespace Sifteo;
+
+/*
+ * Record a session with --record, replay it with --replay, and check
+ * that the game sees exactly the same inputs at exactly the same times.
+ *
+ * Inputs are injected through Lua, so they take the same path through
+ * the session log as input from the UI. On replay, the log supplies them
+ * instead. The Makefile compares the STATE line from both runs.
+ */
+
+static const unsigned kNumCubes = 2;
+static const unsigned kNumFrames = 240;
+
+static Metadata M = Metadata()
+    .title("Session replay test")
+    .cubeRange(kNumCubes);
+
+static unsigned touchEvents;
+
+static void onTouch(void *, unsigned id)
+{
+    touchEvents = touchEvents * 7 + id + 1;
+}
+
+static uint32_t hash(uint32_t h, uint32_t value)
+{
+    return (h ^ value) * 0x01000193;
+}
+
+void main()
+{
+    while (CubeSet::connected().count() < kNumCubes)
+        System::yield();
+
+    Events::cubeTouch.set(onTouch);
+
+    uint32_t state = 0x811c9dc5;
+    SystemTime start = SystemTime::now();
+
+    for (unsigned frame = 0; frame < kNumFrames; ++frame) {
+        unsigned id = frame % kNumCubes;
+
+        if (frame % 9 == 0)
+            SCRIPT_FMT(LUA, "Cube(%d):setTouch(%d)", id, (frame / 9) & 1);
+
+        if (frame % 13 == 0)
+            SCRIPT_FMT(LUA, "Cube(%d):setAcceleration(%d / 8, %d / 8, 1)",
+                id, int(frame % 7) - 3, int(frame % 5) - 2);
+
+        System::paint();
+
+        for (unsigned i = 0; i < kNumCubes; ++i) {
+            CubeID cube(i);
+            Byte3 accel = cube.accel();
+            state = hash(state, cube.isTouching());
+            state = hash(state, accel.x);
+            state = hash(state, accel.y);
+            state = hash(state, accel.z);
+        }
+        state = hash(state, (SystemTime::now() - start).milliseconds());
+    }
+
+    LOG("STATE %08x %08x\n", state, touchEvents);
+}
@@ -0,0 +1,96 @@
+#!/usr/bin/env python
+
+#
+# Generate the fixed-point interpolation tables used by the firmware's
+# audio resampler. The output is included by audioresampler.cpp.
+#
+# Each table has one row per fractional phase. A row holds the filter
+# coefficients to apply to the input samples around the current
+# position, in Q14 fixed point. Every row is normalized to a DC gain of
+# exactly 1.0, so that a constant input produces the same constant output
+# at any phase.
+#
+# usage: firmware-resampler-table.py > firmware/master/common/resampler-table.def
+#
+
+import math
+
+PHASE_BITS = 6
+PHASES = 1 << PHASE_BITS
+COEFF_BITS = 14
+ONE = 1 << COEFF_BITS
+
+# Windowed-sinc design. The cutoff is a fraction of the input Nyquist rate,
+# a little below 1.0 so the transition band is mostly above the passband.
+SINC_TAPS = 8
+SINC_CUTOFF = 0.85
+KAISER_BETA = 6.0
+
+
+def besselI0(x):
+    # Power series for the zeroth-order modified Bessel function
+    total, term, k = 1.0, 1.0, 1
+    while term > 1e-12 * total:
+        term *= (x / (2.0 * k)) ** 2
+        total += term
+        k += 1
+    return total
+
+
+def kaiser(t, halfWidth):
+    r = t / halfWidth
+    if abs(r) >= 1.0:
+        return 0.0
+    return besselI0(KAISER_BETA * math.sqrt(1.0 - r * r)) / besselI0(KAISER_BETA)
+
+
+def sinc(t):
+    if t == 0:
+        return 1.0
+    return math.sin(math.pi * t) / (math.pi * t)
+
+
+def catmullRom(x):
+    x2, x3 = x * x, x * x * x
+    return [
+        (-x3 + 2 * x2 - x) / 2.0,
+        (3 * x3 - 5 * x2 + 2) / 2.0,
+        (-3 * x3 + 4 * x2 + x) / 2.0,
+        (x3 - x2) / 2.0,
+    ]
+
+
+def windowedSinc(x):
+    # Taps are at offsets -3 .. +4 from the current sample
+    center = SINC_TAPS // 2 - 1
+    halfWidth = SINC_TAPS / 2.0
+    return [SINC_CUTOFF * sinc(SINC_CUTOFF * (k - center - x)) * kaiser(k - center - x, halfWidth)
+            for k in range(SINC_TAPS)]
+
+
+def quantize(row):
+    # Scale to unity DC gain, round, then put any rounding error on the
+    # largest tap so the row still sums to exactly ONE.
+    total = sum(row)
+    q = [int(round(c * ONE / total)) for c in row]
+    biggest = max(range(len(q)), key=lambda i: abs(q[i]))
+    q[biggest] += ONE - sum(q)
+    return q
+
+
+def writeTable(name, taps, fn):
+    print("const int16_t AudioResampler::%s[%d][%d] = {" % (name, PHASES, taps))
+    for phase in range(PHASES):
+        x = phase / float(PHASES)
+        print("    /* Phase 0x%02x, x = %.4f */ { %s }," % (
+            phase, x, ", ".join("%6d" % c for c in quantize(fn(x)))))
+    print("};")
+
+
+if __name__ == '__main__':
+    print("// Generated by tools/firmware-resampler-table.py")
+    print("// %d phases, Q%d coefficients" % (PHASES, COEFF_BITS))
+    print("")
+    writeTable("cubicTable", 4, catmullRom)
+    print("")
+    writeTable("sincTable", SINC_TAPS, windowedSinc)
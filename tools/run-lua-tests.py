@@ -0,0 +1,220 @@
+#!/usr/bin/env python
+
+#
+# Run a Siftulator luaunit suite across several headless Siftulator
+# instances at once.
+#
+# The suite is asked for its list of tests (via TEST_LIST), the tests
+# are split into shards, and each shard runs in its own Siftulator
+# process with TEST set to its share of the test names. Each shard
+# reports per-test results and wall times via TEST_RESULTS, and these
+# are merged into a single report.
+#
+# Shards are balanced using the times from an earlier --json report
+# if one is given with --timings; otherwise tests are dealt out in
+# order. If --flash-image is given, each shard starts from a private
+# copy of that prebuilt flash image, so the image only has to be
+# built once and instances never share a writable flash file.
+#
+# usage: run-lua-tests.py [options] -- SIFTULATOR_ARGS...
+#
+# Example, from test/firmware/cube:
+#   run-lua-tests.py -j 8 --junit results.xml -- --headless -e tests.lua -l mc-stub.elf
+#
+
+import sys, os, json, shutil, tempfile, threading, subprocess, time
+from optparse import OptionParser
+from xml.sax.saxutils import quoteattr, escape
+
+
+def listTests(options, args):
+    tmp = tempfile.mkdtemp(prefix='luatests-')
+    try:
+        listFile = os.path.join(tmp, 'tests.txt')
+        env = dict(os.environ, TEST_LIST=listFile)
+        subprocess.check_call([options.siftulator] + args, env=env)
+        with open(listFile) as f:
+            return [line.strip() for line in f if line.strip()]
+    finally:
+        shutil.rmtree(tmp)
+
+
+def makeShards(tests, numShards, timings):
+    shards = [[] for i in range(min(numShards, len(tests)))]
+
+    if not timings:
+        for i, name in enumerate(tests):
+            shards[i % len(shards)].append(name)
+        return shards
+
+    # Longest tests first, each onto the least loaded shard. Tests we
+    # have no timing for are assumed to take an average amount of time.
+    default = sum(timings.values()) / len(timings)
+    loads = [0.0] * len(shards)
+    for name in sorted(tests, key=lambda n: -timings.get(n, default)):
+        i = loads.index(min(loads))
+        shards[i].append(name)
+        loads[i] += timings.get(name, default)
+
+    # Keep each shard in suite order, same as a serial run
+    order = dict((name, i) for i, name in enumerate(tests))
+    for shard in shards:
+        shard.sort(key=lambda n: order[n])
+    return shards
+
+
+class Shard(threading.Thread):
+    def __init__(self, index, tests, options, args):
+        threading.Thread.__init__(self)
+        self.index = index
+        self.tests = tests
+        self.options = options
+        self.args = args
+        self.results = []
+        self.status = None
+        self.log = ''
+        self.wallTime = 0
+
+    def run(self):
+        tmp = tempfile.mkdtemp(prefix='luatests-%d-' % self.index)
+        try:
+            resultFile = os.path.join(tmp, 'results.json')
+            args = list(self.args)
+
+            if self.options.flashImage:
+                flashFile = os.path.join(tmp, 'flash.bin')
+                shutil.copyfile(self.options.flashImage, flashFile)
+                args = ['-F', flashFile] + args
+
+            env = dict(os.environ, TEST=' '.join(self.tests), TEST_RESULTS=resultFile)
+
+            start = time.time()
+            proc = subprocess.Popen([self.options.siftulator] + args, env=env,
+                stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+            self.log = proc.communicate()[0].decode('utf-8', 'replace')
+            self.status = proc.returncode
+            self.wallTime = time.time() - start
+
+            if os.path.exists(resultFile):
+                with open(resultFile) as f:
+                    self.results = json.load(f)
+        finally:
+            shutil.rmtree(tmp)
+
+
+def collectResults(tests, shards):
+    results = []
+    for shard in shards:
+        reported = set(r['name'] for r in shard.results)
+        results.extend(shard.results)
+
+        # A crash or a Lua error outside of a test leaves some tests unreported
+        for name in shard.tests:
+            if name not in reported:
+                results.append({'name': name, 'time': 0, 'error':
+                    'No result reported; shard %d exited with status %s'
+                    % (shard.index, shard.status)})
+
+    order = dict((name, i) for i, name in enumerate(tests))
+    return sorted(results, key=lambda r: order.get(r['name'], len(order)))
+
+
+def writeJSON(filename, results):
+    with open(filename, 'w') as f:
+        json.dump(results, f, indent=1, sort_keys=True)
+        f.write('\n')
+
+
+def writeJUnit(filename, results, wallTime):
+    failures = [r for r in results if r['error'] is not None]
+    with open(filename, 'w') as f:
+        f.write('<?xml version="1.0" encoding="UTF-8"?>\n')
+        f.write('<testsuite name="siftulator" tests="%d" failures="%d" time="%.3f">\n'
+            % (len(results), len(failures), wallTime))
+        for r in results:
+            className, _, testName = r['name'].partition(':')
+            f.write('  <testcase classname=%s name=%s time="%.3f"'
+                % (quoteattr(className), quoteattr(testName), r['time']))
+            if r['error'] is None:
+                f.write('/>\n')
+            else:
+                f.write('>\n    <failure message=%s>%s</failure>\n  </testcase>\n'
+                    % (quoteattr(r['error'].split('\n')[0]), escape(r['error'])))
+        f.write('</testsuite>\n')
+
+
+def main():
+    parser = OptionParser(usage='%prog [options] -- SIFTULATOR_ARGS...')
+    parser.add_option('-j', '--jobs', type='int', default=4,
+        help='number of Siftulator instances to run at once')
+    parser.add_option('--siftulator', default='siftulator',
+        help='path to the Siftulator binary')
+    parser.add_option('--flash-image', dest='flashImage', metavar='FILE',
+        help='prebuilt flash image; each instance gets a private copy')
+    parser.add_option('--timings', metavar='FILE',
+        help='JSON report from an earlier run, used to balance shards')
+    parser.add_option('--json', metavar='FILE',
+        help='write merged per-test results as JSON')
+    parser.add_option('--junit', metavar='FILE',
+        help='write merged per-test results as JUnit XML')
+    parser.add_option('--slowest', type='int', default=10, metavar='N',
+        help='list the N slowest tests when finished')
+    options, args = parser.parse_args()
+
+    if not args or options.jobs < 1:
+        parser.error('need Siftulator arguments and at least one job')
+
+    tests = listTests(options, args)
+    if not tests:
+        sys.stderr.write('No tests found\n')
+        return 1
+
+    timings = {}
+    if options.timings and os.path.exists(options.timings):
+        with open(options.timings) as f:
+            timings = dict((r['name'], r['time']) for r in json.load(f))
+
+    start = time.time()
+    shards = [Shard(i, t, options, args) for i, t in
+        enumerate(makeShards(tests, options.jobs, timings))]
+    for shard in shards:
+        shard.start()
+    for shard in shards:
+        shard.join()
+    wallTime = time.time() - start
+
+    results = collectResults(tests, shards)
+    failures = [r for r in results if r['error'] is not None]
+
+    for shard in shards:
+        if shard.status != 0:
+            sys.stdout.write('\n======== Shard %d (status %s) ========\n%s'
+                % (shard.index, shard.status, shard.log))
+
+    if failures:
+        print('\nFailed tests:')
+        for r in failures:
+            print('>>> %s failed\n%s' % (r['name'], r['error']))
+
+    if options.slowest > 0:
+        print('\nSlowest tests:')
+        for r in sorted(results, key=lambda r: -r['time'])[:options.slowest]:
+            print('%9.3f s  %s' % (r['time'], r['name']))
+
+    print('\nShards:')
+    for shard in shards:
+        print('%9.3f s  shard %d, %d tests' % (shard.wallTime, shard.index, len(shard.tests)))
+
+    print('\n%d / %d passed, %d instances, %.3f s wall time'
+        % (len(results) - len(failures), len(results), len(shards), wallTime))
+
+    if options.json:
+        writeJSON(options.json, results)
+    if options.junit:
+        writeJUnit(options.junit, results, wallTime)
+
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
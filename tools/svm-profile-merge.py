@@ -0,0 +1,65 @@
+#!/usr/bin/env python
+
+#
+# Merge flash profiles written by `siftulator --svm-flash-profile FILE`.
+#
+# Miss counts and call counts are summed across all input files, so the
+# result represents every run at once. The output uses the same one
+# record per line layout as Siftulator, which slinky's -profile option
+# can read directly.
+#
+# usage: svm-profile-merge.py OUTPUT.json INPUT.json [INPUT.json ...]
+#
+
+import sys, json
+
+PROFILE_VERSION = 1
+
+def mergeInto(totals, records, keys, count):
+    for r in records:
+        key = tuple(r[k] for k in keys)
+        totals[key] = totals.get(key, 0) + r[count]
+
+def sortedRecords(totals, keys, count):
+    # Descending count, ties broken by key, same as Siftulator
+    items = sorted(totals.items(), key=lambda i: (-i[1], i[0]))
+    return [dict(list(zip(keys, k)) + [(count, n)]) for k, n in items]
+
+def writeRecords(f, name, records, fields, last=False):
+    f.write('"%s": [\n' % name)
+    for i, r in enumerate(records):
+        f.write('{%s}%s\n' % (
+            ', '.join('"%s": %s' % (k, json.dumps(r[k])) for k in fields),
+            ',' if i + 1 < len(records) else ''))
+    f.write(']%s\n' % ('' if last else ','))
+
+def main(output, inputs):
+    functions, blocks, edges = {}, {}, {}
+
+    for filename in inputs:
+        with open(filename) as f:
+            profile = json.load(f)
+
+        if profile.get('version') != PROFILE_VERSION:
+            raise ValueError("%s: unsupported profile version %r"
+                % (filename, profile.get('version')))
+
+        mergeInto(functions, profile['functions'], ('name',), 'misses')
+        mergeInto(blocks, profile['blocks'], ('va', 'name'), 'misses')
+        mergeInto(edges, profile['edges'], ('caller', 'callee'), 'count')
+
+    with open(output, 'w') as f:
+        f.write('{\n"version": %d,\n' % PROFILE_VERSION)
+        writeRecords(f, 'functions', sortedRecords(functions, ('name',), 'misses'),
+            ('name', 'misses'))
+        writeRecords(f, 'blocks', sortedRecords(blocks, ('va', 'name'), 'misses'),
+            ('va', 'misses', 'name'))
+        writeRecords(f, 'edges', sortedRecords(edges, ('caller', 'callee'), 'count'),
+            ('caller', 'callee', 'count'), last=True)
+        f.write('}\n')
+
+if __name__ == '__main__':
+    if len(sys.argv) < 3:
+        sys.stderr.write("usage: %s OUTPUT.json INPUT.json [INPUT.json ...]\n" % sys.argv[0])
+        sys.exit(1)
+    main(sys.argv[1], sys.argv[2:])
@@ -37,6 +37,7 @@ namespace llvm {
     
     MCObjectWriter *createSVMELFProgramWriter(raw_ostream &OS);
     FunctionPass *createSVMISelDag(SVMTargetMachine &TM);
+    FunctionPass *createSVMRedundantPtrPass(SVMTargetMachine &TM);
     FunctionPass *createSVMAlignPass(SVMTargetMachine &TM);
     FunctionPass *createSVMLateFunctionSplitPass(SVMTargetMachine &TM);
 
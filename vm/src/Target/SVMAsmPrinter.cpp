@@ -32,6 +32,7 @@
  *
  *  1. Replace 'split' pseudo-instructions with actual block alignment.
  *  2. Split LLVM constpools into per-block constant pools.
+ *  3. Pack small functions into the block left open by the previous one.
  *
  * There are some substantial similarities between this and the ARM target's
  * ARMConstantIslandPass, but we divide the work between LateFunctionSplitPass
@@ -53,6 +54,7 @@
 #include "SVMAsmPrinter.h"
 #include "SVMConstantPoolValue.h"
 #include "SVMSymbolDecoration.h"
+#include "SVMMachineFunctionInfo.h"
 #include "llvm/MC/MCAsmInfo.h"
 #include "llvm/MC/MCStreamer.h"
 #include "llvm/MC/MCSymbol.h"
@@ -60,8 +62,12 @@
 #include "llvm/MC/MCInst.h"
 #include "llvm/CodeGen/MachineConstantPool.h"
 #include "llvm/Support/TargetRegistry.h"
+#include "llvm/Support/CommandLine.h"
 using namespace llvm;
 
+static cl::opt<bool> DisableBlockPacking("disable-block-packing", cl::Hidden,
+    cl::desc("Start every function in a new flash block"));
+
 extern "C" void LLVMInitializeSVMAsmPrinter() { 
     RegisterAsmPrinter<SVMAsmPrinter> X(TheSVMTarget);
 }
@@ -108,8 +114,19 @@ void SVMAsmPrinter::EmitFunctionEntryLabel()
 {
     OutStreamer.ForceCodeRegion();
 
-    // XXX: For now, all functions start in new blocks
-    emitBlockBegin();
+    /*
+     * If this function fits in what's left of the previous function's
+     * block, share that block and its constant pool. Otherwise, finish
+     * the open block and start a new one. Module order decides which
+     * functions are neighbours; see ProfileLayoutPass.
+     */
+    if (canPackFunction()) {
+        BSA.beginFunction();
+        BSA.InstrAlign(SVMTargetMachine::getBundleSize());
+    } else {
+        emitOpenBlockEnd();
+        emitBlockBegin();
+    }
 
     emitFunctionLabelImpl(CurrentFnSym);
 }
@@ -125,8 +142,78 @@ void SVMAsmPrinter::EmitConstantPool()
 
 void SVMAsmPrinter::EmitFunctionBodyEnd()
 {
-    // XXX: For now, all functions end a block
+    /*
+     * Leave the block open, in case the next function can be packed
+     * after this one. Functions must stay bundle-aligned. The block's
+     * constant pool is emitted by emitOpenBlockEnd() once it's full.
+     */
+    OutStreamer.EmitValueToAlignment(SVMTargetMachine::getBundleSize(),
+        SVMTargetMachine::getPaddingByte());
+    OpenBlockSection = OutStreamer.getCurrentSection();
+}
+
+bool SVMAsmPrinter::doFinalization(Module &M)
+{
+    emitOpenBlockEnd();
+    return AsmPrinter::doFinalization(M);
+}
+
+bool SVMAsmPrinter::canPackFunction() const
+{
+    /*
+     * Can the current function join the open block? It must not have been
+     * split, and it must fit alongside everything already in the block.
+     *
+     * The function's packed size was measured as if it started a new
+     * block, which doesn't account for alignment between the two pools.
+     * So we replay the whole function into a copy of the open block's
+     * accumulator, exactly as EmitInstruction() would, and only pack it
+     * if that copy still fits.
+     */
+
+    if (DisableBlockPacking || !OpenBlockSection)
+        return false;
+    if (OutStreamer.getCurrentSection() != OpenBlockSection)
+        return false;
+
+    const SVMMachineFunctionInfo *MFI = MF->getInfo<SVMMachineFunctionInfo>();
+    if (!MFI->getPackedSize())
+        return false;
+
+    SVMBlockSizeAccumulator Packed = BSA;
+    Packed.beginFunction();
+    Packed.InstrAlign(SVMTargetMachine::getBundleSize());
+
+    for (MachineFunction::const_iterator MBB = MF->begin(), E = MF->end();
+        MBB != E; ++MBB) {
+        Packed.InstrAlign(MBB->getAlignment());
+        for (MachineBasicBlock::const_iterator I = MBB->begin(), IE = MBB->end();
+            I != IE; ++I)
+            Packed.AddInstr(&*I);
+    }
+
+    return Packed.getByteCount() <= SVMTargetMachine::getBlockSize();
+}
+
+void SVMAsmPrinter::emitOpenBlockEnd()
+{
+    /*
+     * Finish the block left open by the last function, if any. This may
+     * happen after the streamer has already moved on to another section.
+     */
+
+    const MCSection *Current = OutStreamer.getCurrentSection();
+    const MCSection *Open = OpenBlockSection;
+    if (!Open)
+        return;
+
+    if (Current != Open)
+        OutStreamer.SwitchSection(Open);
     emitBlockEnd();
+    if (Current != Open)
+        OutStreamer.SwitchSection(Current);
+
+    OpenBlockSection = 0;
 }
 
 void SVMAsmPrinter::emitFunctionLabelImpl(MCSymbol *Sym)
@@ -156,6 +243,13 @@ void SVMAsmPrinter::emitBlockEnd()
         SVMTargetMachine::getPaddingByte());    
 
     emitBlockConstPool();
+
+    // Constant pool references are block-relative, so an overflowing
+    // block would silently miscompile. This should never happen.
+    unsigned byteCount = BSA.getByteCount();
+    if (byteCount > SVMTargetMachine::getBlockSize())
+        report_fatal_error("Block overflow (" + Twine(byteCount) + " bytes) "
+            "at end of block");
 }
 
 void SVMAsmPrinter::emitBlockSplit(const MachineInstr *MI)
@@ -167,6 +261,11 @@ void SVMAsmPrinter::emitBlockSplit(const MachineInstr *MI)
 void SVMAsmPrinter::EmitMachineConstantPoolValue(MachineConstantPoolValue *MCPV)
 {
     int Size = TM.getTargetData()->getTypeAllocSize(MCPV->getType());
+    OutStreamer.EmitValue(lowerMachineConstantPoolValue(MCPV), Size);
+}
+
+const MCExpr *SVMAsmPrinter::lowerMachineConstantPoolValue(MachineConstantPoolValue *MCPV)
+{
     const SVMConstantPoolValue *SCPV = static_cast<SVMConstantPoolValue*>(MCPV);
     MCSymbol *MCSym;
 
@@ -197,8 +296,7 @@ void SVMAsmPrinter::EmitMachineConstantPoolValue(MachineConstantPoolValue *MCPV)
         break;
     }
     
-    const MCExpr *Expr = MCSymbolRefExpr::Create(MCDecoratedSym, OutContext);
-    OutStreamer.EmitValue(Expr, Size);  
+    return MCSymbolRefExpr::Create(MCDecoratedSym, OutContext);
 }
 
 void SVMAsmPrinter::emitConstRefComment(const MachineOperand &MO)
@@ -267,8 +365,18 @@ void SVMAsmPrinter::rewriteConstForCurrentBlock(const MachineOperand &MO, MCOper
     BlockConstPoolTy::iterator I = BlockConstPool.find(Key);
     if (I == BlockConstPool.end()) {
         // Add a new constant to this block's pool
-        CPEInfo Info(OutContext.CreateTempSymbol(), &CP[MO.getIndex()]);
-        I = BlockConstPool.insert(std::make_pair(Key, Info)).first;
+        const MachineConstantPoolEntry &CPE = CP[MO.getIndex()];
+        MCSymbol *Symbol = OutContext.CreateTempSymbol();
+
+        if (CPE.isMachineConstantPoolEntry()) {
+            MachineConstantPoolValue *MCPV = CPE.Val.MachineCPVal;
+            unsigned Size = TM.getTargetData()->getTypeAllocSize(MCPV->getType());
+            CPEInfo Info(Symbol, 0, lowerMachineConstantPoolValue(MCPV), Size);
+            I = BlockConstPool.insert(std::make_pair(Key, Info)).first;
+        } else {
+            CPEInfo Info(Symbol, CPE.Val.ConstVal, 0, 0);
+            I = BlockConstPool.insert(std::make_pair(Key, Info)).first;
+        }
     }
 
     MCO.setExpr(MCSymbolRefExpr::Create(I->second.Symbol, OutContext));
@@ -288,9 +396,9 @@ void SVMAsmPrinter::emitBlockConstPool()
 
         OutStreamer.EmitLabel(Info.Symbol);
 
-        if (Info.MCPE->isMachineConstantPoolEntry())
-            EmitMachineConstantPoolValue(Info.MCPE->Val.MachineCPVal);
+        if (Info.Expr)
+            OutStreamer.EmitValue(Info.Expr, Info.Size);
         else
-            EmitGlobalConstant(Info.MCPE->Val.ConstVal);
+            EmitGlobalConstant(Info.ConstVal);
     }
 }
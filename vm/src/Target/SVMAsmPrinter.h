@@ -38,7 +38,7 @@ namespace llvm {
     class SVMAsmPrinter : public AsmPrinter {
     public:
         explicit SVMAsmPrinter(TargetMachine &TM, MCStreamer &Streamer)
-            : AsmPrinter(TM, Streamer), CurrentMBB(0) {}
+            : AsmPrinter(TM, Streamer), CurrentMBB(0), OpenBlockSection(0) {}
 
         const char *getPassName() const {
             return "SVM Assembly Printer";
@@ -49,14 +49,23 @@ namespace llvm {
         void EmitConstantPool();
         void EmitFunctionBodyEnd();
         void EmitMachineConstantPoolValue(MachineConstantPoolValue *MCPV);
+        bool doFinalization(Module &M);
 
     private:
+        /*
+         * A pending per-block constant. This may outlive the MachineFunction
+         * that created it, if the next function is packed into the same
+         * block, so MachineConstantPoolValues are lowered right away.
+         */
         struct CPEInfo {
-            CPEInfo(MCSymbol *Symbol, const MachineConstantPoolEntry *MCPE)
-                : Symbol(Symbol), MCPE(MCPE) {}
+            CPEInfo(MCSymbol *Symbol, const Constant *ConstVal,
+                const MCExpr *Expr, unsigned Size)
+                : Symbol(Symbol), ConstVal(ConstVal), Expr(Expr), Size(Size) {}
 
             MCSymbol *Symbol;
-            const MachineConstantPoolEntry *MCPE;
+            const Constant *ConstVal;
+            const MCExpr *Expr;
+            unsigned Size;
         };
 
         typedef DenseMap<const MCSymbol*, CPEInfo> BlockConstPoolTy;
@@ -64,14 +73,18 @@ namespace llvm {
 
         SVMBlockSizeAccumulator BSA;
         const MachineBasicBlock *CurrentMBB;
+        const MCSection *OpenBlockSection;
 
         void emitBlockBegin();
         void emitBlockEnd();
+        void emitOpenBlockEnd();
+        bool canPackFunction() const;
         void emitBlockSplit(const MachineInstr *MI);
         void emitFunctionLabelImpl(MCSymbol *Sym);
         void emitBlockOffsetComment();
 
         void emitBlockConstPool();
+        const MCExpr *lowerMachineConstantPoolValue(MachineConstantPoolValue *MCPV);
         void emitConstRefComment(const MachineOperand &MO);
         void rewriteConstForCurrentBlock(const MachineOperand &MO, MCOperand &MCO);
     };
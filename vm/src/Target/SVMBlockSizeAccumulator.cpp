@@ -46,6 +46,13 @@ void SVMBlockSizeAccumulator::clear()
     UsedCPI.clear();
 }
 
+void SVMBlockSizeAccumulator::beginFunction()
+{
+    // Constant pool indices are per-function. When another function
+    // joins this block, forget them, but keep our running totals.
+    UsedCPI.clear();
+}
+
 unsigned SVMBlockSizeAccumulator::getByteCount() const
 {
     uint32_t Size = 0;
@@ -48,6 +48,7 @@ namespace llvm {
     class SVMBlockSizeAccumulator {
     public:
         void clear();
+        void beginFunction();
         unsigned getByteCount() const;
         
         void describe(raw_ostream &OS);
@@ -29,6 +29,8 @@
 #include "SVMTargetMachine.h"
 #include "llvm/Support/CommandLine.h"
 #include "fastlz.h"
+#include <algorithm>
+#include <sifteo/abi.h>
 using namespace llvm;
 
 cl::opt<bool> ELFDebug("g",
@@ -48,6 +50,9 @@ void SVMELFProgramWriter::WriteObject(MCAssembler &Asm,
     // Apply fixups that were stored in RecordRelocation
     ML.ApplyLateFixups(Asm, Layout);
 
+    // Code addresses are final. Fill in the metadata's prefetch hints.
+    fillPrefetchHints(Asm, Layout, ML);
+
     // Now we can know the final binary image of the RWDATA segments. Compress them.
     rwCompress(Asm, Layout, ML);
     ML.AllocateSections(Asm, Layout);
@@ -320,6 +325,11 @@ void SVMELFProgramWriter::rwCompress(MCAssembler &Asm, const MCAsmLayout &Layout
         }
     }
 
+    // The loader erases all of RAM before unpacking RWDATA, so trailing
+    // zeroes never need to be stored or decompressed.
+    while (!plaintext.empty() && plaintext.back() == 0)
+        plaintext.pop_back();
+
     // FastLZ requires a minimum of 16 bytes to compress. Pad our section data.
     while (plaintext.size() < 16)
         plaintext.push_back(0);
@@ -344,6 +354,120 @@ void SVMELFProgramWriter::rwCompress(MCAssembler &Asm, const MCAsmLayout &Layout
     F->getContents().append(compressed.begin(), compressed.end());
 }
 
+namespace {
+    struct PrefetchHintEdge {
+        unsigned block, successor, count;
+
+        static bool byCount(const PrefetchHintEdge &a, const PrefetchHintEdge &b) {
+            if (a.count != b.count)
+                return a.count > b.count;
+            if (a.block != b.block)
+                return a.block < b.block;
+            return a.successor < b.successor;
+        }
+
+        static bool byBlock(const PrefetchHintEdge &a, const PrefetchHintEdge &b) {
+            if (a.block != b.block)
+                return a.block < b.block;
+            return byCount(a, b);
+        }
+    };
+}
+
+void SVMELFProgramWriter::fillPrefetchHints(MCAssembler &Asm, const MCAsmLayout &Layout, SVMMemoryLayout &ML)
+{
+    /*
+     * The MetadataCollector reserved a zero-filled _SYS_METADATA_PREFETCH_HINTS
+     * value, since block addresses aren't known until now. Find that value
+     * in the metadata section and fill it with the most frequently referenced
+     * cross-block edges, keeping at most a few successors per block.
+     *
+     * Any entries we don't use stay zero, which the runtime treats as the
+     * end of the table.
+     */
+
+    static const unsigned MAX_SUCCESSORS_PER_BLOCK = 2;
+
+    MCDataFragment *DF = 0;
+    for (MCAssembler::iterator IS = Asm.begin(), ES = Asm.end(); IS != ES && !DF; ++IS) {
+        MCSectionData *SD = &*IS;
+        if (ML.getSectionKind(SD) != SPS_META)
+            continue;
+        for (MCSectionData::iterator IF = SD->begin(), EF = SD->end(); IF != EF; ++IF)
+            if (IF->getKind() == MCFragment::FT_Data && Layout.getFragmentOffset(&*IF) == 0) {
+                DF = cast<MCDataFragment>(&*IF);
+                break;
+            }
+    }
+    if (!DF)
+        return;
+
+    // Walk the key table, looking for the reserved value
+    SmallVectorImpl<char> &Data = DF->getContents();
+    unsigned numKeys = 0;
+    while (true) {
+        if (4 * numKeys + 4 > Data.size())
+            return;
+        uint16_t stride = uint8_t(Data[4*numKeys]) | (uint8_t(Data[4*numKeys + 1]) << 8);
+        numKeys++;
+        if (stride & 0x8000)
+            break;
+    }
+
+    unsigned valueOffset = 4 * numKeys;
+    unsigned valueSize = 0;
+    for (unsigned i = 0; i < numKeys; ++i) {
+        uint16_t stride = uint8_t(Data[4*i]) | (uint8_t(Data[4*i + 1]) << 8);
+        uint16_t key = uint8_t(Data[4*i + 2]) | (uint8_t(Data[4*i + 3]) << 8);
+        if (key == _SYS_METADATA_PREFETCH_HINTS) {
+            valueSize = stride & 0x7FFF;
+            break;
+        }
+        valueOffset += stride & 0x7FFF;
+    }
+
+    valueSize = std::min<unsigned>(valueSize, Data.size() - std::min<unsigned>(valueOffset, Data.size()));
+    unsigned capacity = std::min<unsigned>(valueSize / sizeof(_SYSMetadataPrefetchHint),
+        _SYS_MAX_PREFETCH_HINTS);
+    if (!capacity)
+        return;
+
+    // Rank all edges, then pick the best ones
+    const SVMMemoryLayout::BlockEdgeMap_t &Edges = ML.getBlockEdges();
+    std::vector<PrefetchHintEdge> ranked, chosen;
+    std::map<unsigned, unsigned> perBlock;
+
+    for (SVMMemoryLayout::BlockEdgeMap_t::const_iterator I = Edges.begin(), E = Edges.end(); I != E; ++I) {
+        if (I->first.first > 0xFFFF || I->first.second > 0xFFFF)
+            continue;
+        PrefetchHintEdge edge = { I->first.first, I->first.second, I->second };
+        ranked.push_back(edge);
+    }
+    std::sort(ranked.begin(), ranked.end(), PrefetchHintEdge::byCount);
+
+    unsigned wanted = 0;
+    for (unsigned i = 0; i < ranked.size() && wanted < _SYS_MAX_PREFETCH_HINTS; ++i)
+        if (perBlock[ranked[i].block]++ < MAX_SUCCESSORS_PER_BLOCK) {
+            wanted++;
+            if (chosen.size() < capacity)
+                chosen.push_back(ranked[i]);
+        }
+
+    // The reservation is an upper bound; only the ABI limit may truncate
+    assert(chosen.size() == wanted && "Prefetch hint table reserved too small");
+
+    // The runtime does a binary search by block
+    std::sort(chosen.begin(), chosen.end(), PrefetchHintEdge::byBlock);
+
+    for (unsigned i = 0; i < chosen.size(); ++i) {
+        char *p = &Data[valueOffset + i * sizeof(_SYSMetadataPrefetchHint)];
+        p[0] = chosen[i].block;
+        p[1] = chosen[i].block >> 8;
+        p[2] = chosen[i].successor;
+        p[3] = chosen[i].successor >> 8;
+    }
+}
+
 MCObjectWriter *llvm::createSVMELFProgramWriter(raw_ostream &OS)
 {
     return new SVMELFProgramWriter(OS);
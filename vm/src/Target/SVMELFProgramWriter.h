@@ -98,6 +98,7 @@ namespace llvm {
         void writeDebugMessage();
 
         void rwCompress(MCAssembler &Asm, const MCAsmLayout &Layout, SVMMemoryLayout &ML);
+        void fillPrefetchHints(MCAssembler &Asm, const MCAsmLayout &Layout, SVMMemoryLayout &ML);
     };
 
 }  // end namespace
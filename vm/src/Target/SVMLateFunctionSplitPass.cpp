@@ -51,6 +51,7 @@
 #include "SVMConstantPoolValue.h"
 #include "SVMBlockSizeAccumulator.h"
 #include "SVMInstrInfo.h"
+#include "SVMMachineFunctionInfo.h"
 #include "llvm/Module.h"
 #include "llvm/MC/MCSymbol.h"
 #include "llvm/MC/MCExpr.h"
@@ -153,6 +154,12 @@ bool SVMLateFunctionSplitPass::runOnMachineFunction(MachineFunction &MF)
     // Rewrite branches in the last block, if necessary.
     rewriteBranchesInRange(&MF, FirstLocalBB, MF.getNumBlockIDs(), MF.end());
 
+    // Single-block functions are candidates for block packing. The size
+    // still includes the space we reserved for a long branch, which gives
+    // the AsmPrinter some headroom for alignment between functions.
+    SVMMachineFunctionInfo *MFI = MF.getInfo<SVMMachineFunctionInfo>();
+    MFI->setPackedSize(FirstLocalBB == 0 ? BSA.getByteCount() : 0);
+
     return Changed;
 }
 
@@ -33,9 +33,20 @@ namespace llvm {
 
     class SVMMachineFunctionInfo : public MachineFunctionInfo {
     public:
-        SVMMachineFunctionInfo() {}
-        explicit SVMMachineFunctionInfo(MachineFunction &MF) {}
+        SVMMachineFunctionInfo() : PackedSize(0) {}
+        explicit SVMMachineFunctionInfo(MachineFunction &MF) : PackedSize(0) {}
 
+        /*
+         * Size of this function, including its constants, if it fits in a
+         * single flash block. Zero if the function was split. Measured by
+         * SVMLateFunctionSplitPass, and used by SVMAsmPrinter to decide
+         * whether this function can share a block with its predecessor.
+         */
+        unsigned getPackedSize() const { return PackedSize; }
+        void setPackedSize(unsigned Size) { PackedSize = Size; }
+
+    private:
+        unsigned PackedSize;
     };
 
 }
@@ -214,10 +214,26 @@ void SVMMemoryLayout::ApplyLateFixups(const MCAssembler &Asm,
          * performing a fixup that is located in a debug section.
          */
         bool useCodeAddresses = getSectionKind(SD) != SPS_DEBUG;
+        SVMSymbolInfo SI = getSymbol(Asm, Layout, F.Target, useCodeAddresses);
 
         SVMAsmBackend::ApplyStaticFixup(F.Kind,
-            &DF->getContents().data()[F.Offset],
-            getSymbol(Asm, Layout, F.Target, useCodeAddresses).Value);
+            &DF->getContents().data()[F.Offset], SI.Value);
+
+        /*
+         * Calls and long branches in the text segment are the only static
+         * control flow that can leave a flash block. Remember which block
+         * referenced which, for the prefetch hints in our metadata.
+         */
+        if (getSectionKind(SD) == SPS_RO &&
+            (SI.Kind == SVMSymbolInfo::CALL || SI.Kind == SVMSymbolInfo::LB)) {
+            uint32_t blockSize = SVMTargetMachine::getBlockSize();
+            uint32_t from = getSectionMemAddress(SD) - getSectionMemAddress(SPS_RO)
+                + Layout.getFragmentOffset(DF) + F.Offset;
+            uint32_t to = SI.Value & 0xfffffc;
+
+            if (from / blockSize != to / blockSize)
+                BlockEdges[std::make_pair(from / blockSize, to / blockSize)]++;
+        }
     }
 }
 
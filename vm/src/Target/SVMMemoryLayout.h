@@ -134,6 +134,13 @@ namespace llvm {
         SVMProgramSection getSectionKind(const MCSectionData *SD) const;
         void setSectionKind(const MCSectionData *SD, SVMProgramSection kind);
 
+        // Static control flow between RO blocks, collected by ApplyLateFixups.
+        // Maps (block, successor) block indices to a count of references.
+        typedef std::map<std::pair<unsigned, unsigned>, unsigned> BlockEdgeMap_t;
+        const BlockEdgeMap_t &getBlockEdges() const {
+            return BlockEdges;
+        }
+
     private:
         uint32_t spsMemSize[SPS_NUM_SECTIONS];
         uint32_t spsDiskSize[SPS_NUM_SECTIONS];
@@ -161,6 +168,7 @@ namespace llvm {
         SectionOffsetMap_t SectionOffsetMap;
         SectionKindOverrides_t SectionKindOverrides;
         SectionMemSizeOverrides_t SectionMemSizeOverrides;
+        BlockEdgeMap_t BlockEdges;
     };
 
 }  // end namespace
@@ -0,0 +1,201 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo VM (SVM) Target for LLVM
+ *
+ * Micah Elizabeth Scott <micah@misc.name>
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Every load or store from untrusted code goes through the base pointer
+ * register, BP, which can only be set by a PTR instruction. That's an SVC,
+ * and a fairly expensive one. Instruction selection emits a PTR for every
+ * memory access, and the register allocator rematerializes them freely,
+ * so code like "p->x += 1" validates the same address twice in a row.
+ *
+ * This pass removes a PTR when BP is already known to hold the validated
+ * form of the same address. The security model doesn't change: BP is still
+ * only ever written by the runtime, and we're just reusing a translation
+ * we already asked for.
+ *
+ * That translation stays valid for as long as BP does. The runtime keeps a
+ * reference to the flash block behind BP (SvmRuntime::dataBlock) until the
+ * next PTR, so no SVC can evict it from the cache underneath us. BP itself
+ * is only changed by:
+ *
+ *   - PTR, which sets it.
+ *
+ *   - Syscalls, which don't have to preserve it. The T17 format lists BP
+ *     in its Defs.
+ *
+ *   - Calls, since the callee may run its own PTRs. CALL, CALLr and the
+ *     other isCall instructions replace T17's Defs with [R0, R1], so BP
+ *     isn't among them; we rely on isCall() instead.
+ *
+ *   - Inline assembly, which could do anything.
+ *
+ * Other SVCs, like SPADJ and the long SP-relative loads and stores, leave
+ * BP alone. SPADJ's Defs = [SP] doesn't mention BP, and doesn't need to.
+ *
+ * We track, within a single basic block:
+ *
+ *   - The set of GPRs currently holding the address that was last passed
+ *     to PTR. A register leaves the set when it's redefined, and joins it
+ *     when it's a plain register copy of a member.
+ *
+ *   - Whether BP is still intact. Calls, inline assembly, and any other
+ *     instruction that defines BP empty the set.
+ *
+ * Loops that walk through an array validate a different address on every
+ * iteration, so nothing here helps with those.
+ */
+
+#include "SVM.h"
+#include "SVMTargetMachine.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/CodeGen/MachineInstr.h"
+#include "llvm/CodeGen/MachineBasicBlock.h"
+#include "llvm/CodeGen/MachineFunction.h"
+#include "llvm/CodeGen/MachineFunctionPass.h"
+#include "llvm/Support/CommandLine.h"
+#include <algorithm>
+using namespace llvm;
+
+static cl::opt<bool> DisableRedundantPtr("disable-redundant-ptr", cl::Hidden,
+    cl::desc("Keep every pointer validation, even when BP is already valid"));
+
+namespace {
+
+    class SVMRedundantPtrPass : public MachineFunctionPass {
+        SVMTargetMachine& TM;
+
+    public:
+        static char ID;
+        explicit SVMRedundantPtrPass(SVMTargetMachine &tm)
+            : MachineFunctionPass(ID), TM(tm) {}
+
+        bool runOnMachineFunction(MachineFunction &MF);
+
+        const char *getPassName() const {
+            return "SVM redundant pointer validation elimination";
+        }
+
+    private:
+        typedef SmallVector<unsigned, 8> RegList_t;
+
+        bool runOnMachineBasicBlock(MachineBasicBlock &MBB);
+        void removeDefs(const MachineInstr &MI, RegList_t &Regs);
+
+        static bool contains(const RegList_t &Regs, unsigned Reg) {
+            return std::find(Regs.begin(), Regs.end(), Reg) != Regs.end();
+        }
+    };
+
+    char SVMRedundantPtrPass::ID = 0;
+}
+
+FunctionPass *llvm::createSVMRedundantPtrPass(SVMTargetMachine &TM)
+{
+    return new SVMRedundantPtrPass(TM);
+}
+
+bool SVMRedundantPtrPass::runOnMachineFunction(MachineFunction &MF)
+{
+    if (DisableRedundantPtr)
+        return false;
+
+    bool Changed = false;
+
+    for (MachineFunction::iterator I = MF.begin(), E = MF.end(); I != E; ++I)
+        if (runOnMachineBasicBlock(*I))
+            Changed = true;
+
+    return Changed;
+}
+
+void SVMRedundantPtrPass::removeDefs(const MachineInstr &MI, RegList_t &Regs)
+{
+    const TargetRegisterInfo *TRI = TM.getRegisterInfo();
+
+    for (unsigned i = 0; i < Regs.size();)
+        if (MI.modifiesRegister(Regs[i], TRI))
+            Regs.erase(Regs.begin() + i);
+        else
+            ++i;
+}
+
+bool SVMRedundantPtrPass::runOnMachineBasicBlock(MachineBasicBlock &MBB)
+{
+    const TargetRegisterInfo *TRI = TM.getRegisterInfo();
+    bool Changed = false;
+
+    // Registers whose value is the address BP was validated from
+    RegList_t Validated;
+
+    // The PTR that set BP, if BP is still intact
+    MachineInstr *LastPtr = 0;
+
+    MachineBasicBlock::iterator I = MBB.begin();
+    while (I != MBB.end()) {
+        MachineInstr *MI = I++;
+
+        if (MI->getOpcode() == SVM::PTR) {
+            unsigned Src = MI->getOperand(1).getReg();
+
+            if (LastPtr && contains(Validated, Src)) {
+                // BP already holds this exact translation. Later uses of
+                // BP now depend on the earlier PTR, so it isn't dead.
+                LastPtr->getOperand(0).setIsDead(false);
+                MI->eraseFromParent();
+                Changed = true;
+                continue;
+            }
+
+            Validated.clear();
+            Validated.push_back(Src);
+            LastPtr = MI;
+            continue;
+        }
+
+        if (MI->isCall() || MI->isInlineAsm() || MI->modifiesRegister(SVM::BP, TRI)) {
+            Validated.clear();
+            LastPtr = 0;
+            continue;
+        }
+
+        if (!LastPtr)
+            continue;
+
+        if (MI->getOpcode() == SVM::MOVr && contains(Validated, MI->getOperand(1).getReg())) {
+            // Copies of the validated address are just as good
+            unsigned Dest = MI->getOperand(0).getReg();
+            if (!contains(Validated, Dest))
+                Validated.push_back(Dest);
+            continue;
+        }
+
+        removeDefs(*MI, Validated);
+        if (Validated.empty())
+            LastPtr = 0;
+    }
+
+    return Changed;
+}
@@ -52,6 +52,10 @@ bool SVMTargetMachine::addInstSelector(PassManagerBase &PM, CodeGenOpt::Level Op
 
 bool SVMTargetMachine::addPreEmitPass(PassManagerBase &PM, CodeGenOpt::Level OptLevel)
 {
+    // Runs after register allocation, so it sees rematerialized PTRs too.
+    // Removing instructions changes sizes, so this goes before alignment.
+    PM.add(createSVMRedundantPtrPass(*this));
+
     // The Alignment pass may change the size of functions by inserting no-ops,
     // so it must come before the LateFunctionSplitPass.
     PM.add(createSVMAlignPass(*this));
@@ -34,6 +34,9 @@
  * both the key array and the subsequent values. We need to both respect
  * the alignment of individual values, and arrange them to prevent crossing
  * flash block boundaries.
+ *
+ * We also reserve space for the code prefetch hints. Those depend on the
+ * final code layout, so the ELF writer fills them in long after we run.
  */
 
 // For metadata key definitions
@@ -53,8 +56,14 @@
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Target/TargetData.h"
+#include "llvm/Support/CommandLine.h"
+#include <algorithm>
+
 using namespace llvm;
 
+static cl::opt<bool> DisablePrefetchHints("disable-prefetch-hints",
+    cl::Hidden, cl::desc("Do not emit code prefetch hints in the metadata"));
+
 namespace llvm {
     ModulePass *createMetadataCollectorPass();
 }
@@ -130,6 +139,7 @@ namespace {
         Layout_t Layout;
 
         void collectValues(Module &M);
+        void reservePrefetchHints(Module &M);
         void checkValues(Module &M);
         void finalizeAll(Module &M, const TargetData *TD);
         void createLayout();
@@ -148,6 +158,7 @@ bool MetadataCollectorPass::runOnModule(Module &M)
     assert(Layout.empty());
 
     collectValues(M);
+    reservePrefetchHints(M);
     checkValues(M);
     finalizeAll(M, TD);
     createLayout();
@@ -196,6 +207,48 @@ void MetadataCollectorPass::collectValues(Module &M)
     }
 }
 
+void MetadataCollectorPass::reservePrefetchHints(Module &M)
+{
+    /*
+     * Reserve a zeroed _SYS_METADATA_PREFETCH_HINTS value. Code addresses
+     * aren't known yet, so size it by an upper bound on the edges that
+     * SVMMemoryLayout can record: one per direct call, plus one per branch
+     * successor, since any branch may turn into a long branch once its
+     * function spans more than one flash block. This usually reaches the
+     * _SYS_MAX_PREFETCH_HINTS limit for all but the smallest programs.
+     */
+
+    if (DisablePrefetchHints || Dict.count(_SYS_METADATA_PREFETCH_HINTS))
+        return;
+
+    unsigned numHints = 0;
+    for (Module::iterator F = M.begin(), FE = M.end();
+        F != FE && numHints < _SYS_MAX_PREFETCH_HINTS; ++F)
+        for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB) {
+            numHints += BB->getTerminator()->getNumSuccessors();
+
+            for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I) {
+                CallInst *CI = dyn_cast<CallInst>(I);
+                if (!CI)
+                    continue;
+
+                Function *Callee = CI->getCalledFunction();
+                if (Callee && !Callee->isDeclaration())
+                    numHints++;
+            }
+        }
+
+    numHints = std::min<unsigned>(numHints, _SYS_MAX_PREFETCH_HINTS);
+
+    if (!numHints)
+        return;
+
+    // Two uint16_t members per _SYSMetadataPrefetchHint
+    Type *i16 = Type::getInt16Ty(M.getContext());
+    Dict[_SYS_METADATA_PREFETCH_HINTS].append(
+        ConstantAggregateZero::get(ArrayType::get(i16, numHints * 2)));
+}
+
 void MetadataCollectorPass::checkValues(Module &M)
 {
     if (!Dict.count(_SYS_METADATA_TITLE_STR))
@@ -0,0 +1,400 @@
+/* -*- mode: C; c-basic-offset: 4; intent-tabs-mode: nil -*-
+ *
+ * Sifteo VM (SVM) Target for LLVM
+ *
+ * Micah Elizabeth Scott <micah@misc.name>
+ * Copyright <c> 2012 Sifteo, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Profile-guided function ordering.
+ *
+ * SVMAsmPrinter packs small functions into the flash block left open by
+ * the previous function, so the order of functions in the Module decides
+ * which functions end up sharing a block (and a constant pool). By default
+ * that's source order. Given a profile from Siftulator, we can do better:
+ * put hot callers right next to their hot callees, and move everything
+ * that never missed in the cache out of the way.
+ *
+ * The best profile is the JSON written by Siftulator's --svm-flash-profile
+ * option (or tools/svm-profile-merge.py). It has misses per function and
+ * real call counts between functions, one record per line:
+ *
+ *   {"name": "Foo::bar(int)", "misses": 123},
+ *   {"caller": "main", "callee": "Foo::bar(int)", "count": 4567},
+ *
+ * We also accept Siftulator's log output with --svm-flash-stats, and look
+ * at its hot block lines, which look like:
+ *
+ *   FLASH: [  123 miss] @ addr=0x012300 va=80012300  Foo::bar(int)+0x40
+ *
+ * Each block's misses are charged to the function it belongs to. The log
+ * has no calls, so in that case call graph edges come from the IR itself,
+ * each weighted by the colder of its two endpoints. Either way, we chain
+ * functions together greedily by edge weight, like Pettis and Hansen's
+ * algorithm.
+ */
+
+#include "Support/ErrorReporter.h"
+#include "llvm/Pass.h"
+#include "llvm/Module.h"
+#include "llvm/Function.h"
+#include "llvm/Instructions.h"
+#include "llvm/Support/CallSite.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/system_error.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/DenseMap.h"
+#include <cxxabi.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+using namespace llvm;
+
+static cl::opt<std::string> ProfileFilename("profile",
+    cl::desc("Order functions using a Siftulator flash block profile"),
+    cl::value_desc("filename"));
+
+namespace llvm {
+    ModulePass *createProfileLayoutPass();
+}
+
+namespace {
+    class ProfileLayoutPass : public ModulePass {
+    public:
+        static char ID;
+        ProfileLayoutPass()
+            : ModulePass(ID) {}
+
+        virtual bool runOnModule(Module &M);
+
+        virtual const char *getPassName() const {
+            return "Profile-guided function layout";
+        }
+
+    private:
+        struct Edge {
+            Function *Caller;
+            Function *Callee;
+            uint64_t Weight;
+
+            bool operator< (const Edge &other) const {
+                return Weight > other.Weight;
+            }
+        };
+
+        typedef DenseMap<Function*, uint64_t> HeatMap_t;
+        typedef DenseMap<Function*, unsigned> ChainMap_t;
+        typedef std::vector<Function*> Chain_t;
+
+        HeatMap_t Heat;
+        std::vector<Edge> ProfileEdges;
+
+        bool readProfile(Module &M);
+        bool readJSONLine(StringRef Line, const StringMap<Function*> &Names);
+        bool readLogLine(StringRef Line, const StringMap<Function*> &Names);
+        void collectEdges(Module &M, std::vector<Edge> &Edges);
+        static std::string demangle(StringRef Name);
+        static bool getJSONString(StringRef Line, StringRef Key, std::string &Value);
+        static bool getJSONInteger(StringRef Line, StringRef Key, uint64_t &Value);
+        static Function *lookup(const StringMap<Function*> &Names, StringRef Name);
+    };
+}
+
+char ProfileLayoutPass::ID = 0;
+
+ModulePass *llvm::createProfileLayoutPass()
+{
+    return new ProfileLayoutPass();
+}
+
+std::string ProfileLayoutPass::demangle(StringRef Name)
+{
+    // Siftulator logs demangled names. Match them the same way.
+
+    std::string Result = Name.str();
+    int status;
+    char *Demangled = abi::__cxa_demangle(Result.c_str(), 0, 0, &status);
+    if (status == 0) {
+        Result = Demangled;
+        free(Demangled);
+    }
+    return Result;
+}
+
+Function *ProfileLayoutPass::lookup(const StringMap<Function*> &Names, StringRef Name)
+{
+    StringMap<Function*>::const_iterator I = Names.find(Name);
+    return I == Names.end() ? 0 : I->second;
+}
+
+bool ProfileLayoutPass::getJSONString(StringRef Line, StringRef Key, std::string &Value)
+{
+    // Siftulator only escapes quotes, backslashes, and control characters
+
+    size_t I = Line.find(("\"" + Key + "\": \"").str());
+    if (I == StringRef::npos)
+        return false;
+    I += Key.size() + 5;
+
+    Value.clear();
+    for (; I < Line.size(); ++I) {
+        char C = Line[I];
+        if (C == '"')
+            return true;
+        if (C == '\\' && I + 1 < Line.size()) {
+            C = Line[++I];
+            if (C == 'u' && I + 4 < Line.size()) {
+                unsigned Code;
+                if (Line.substr(I + 1, 4).getAsInteger(16, Code))
+                    return false;
+                C = (char) Code;
+                I += 4;
+            }
+        }
+        Value += C;
+    }
+    return false;
+}
+
+bool ProfileLayoutPass::getJSONInteger(StringRef Line, StringRef Key, uint64_t &Value)
+{
+    size_t I = Line.find(("\"" + Key + "\": ").str());
+    if (I == StringRef::npos)
+        return false;
+
+    StringRef Digits = Line.substr(I + Key.size() + 4);
+    Digits = Digits.substr(0, Digits.find_first_not_of("0123456789"));
+    return !Digits.getAsInteger(10, Value);
+}
+
+bool ProfileLayoutPass::readJSONLine(StringRef Line, const StringMap<Function*> &Names)
+{
+    // {"name": "Foo::bar(int)", "misses": 123},
+    // {"caller": "main", "callee": "Foo::bar(int)", "count": 4567},
+    // (Per-block records are only there for humans; functions cover them.)
+
+    std::string Name, Caller, Callee;
+    uint64_t Count;
+
+    if (Line.startswith("{\"name\": ") && getJSONString(Line, "name", Name)
+        && getJSONInteger(Line, "misses", Count)) {
+        Function *F = lookup(Names, Name);
+        if (!F)
+            return false;
+        Heat[F] += Count;
+        return true;
+    }
+
+    if (getJSONString(Line, "caller", Caller) && getJSONString(Line, "callee", Callee)
+        && getJSONInteger(Line, "count", Count)) {
+        Function *A = lookup(Names, Caller);
+        Function *B = lookup(Names, Callee);
+        if (!A || !B || A == B)
+            return false;
+
+        // Functions that were called but never missed can still be chained
+        Heat.FindAndConstruct(A);
+        Heat.FindAndConstruct(B);
+        Edge E = { A, B, Count };
+        ProfileEdges.push_back(E);
+        return true;
+    }
+
+    return false;
+}
+
+bool ProfileLayoutPass::readLogLine(StringRef Line, const StringMap<Function*> &Names)
+{
+    // FLASH: [  123 miss] @ addr=0x012300 va=80012300  name+0x40
+    if (!Line.startswith("FLASH: ["))
+        return false;
+    size_t MissEnd = Line.find(" miss]");
+    size_t VA = Line.find(" va=");
+    if (MissEnd == StringRef::npos || VA == StringRef::npos)
+        return false;
+
+    unsigned Misses;
+    if (Line.slice(8, MissEnd).trim().getAsInteger(10, Misses))
+        return false;
+
+    StringRef Name = Line.substr(VA + 4);
+    size_t NameBegin = Name.find(' ');
+    if (NameBegin == StringRef::npos)
+        return false;
+    Name = Name.substr(NameBegin).trim();
+    Name = Name.substr(0, Name.rfind("+0x"));
+
+    Function *F = lookup(Names, Name);
+    if (!F)
+        return false;
+
+    Heat[F] += Misses;
+    return true;
+}
+
+bool ProfileLayoutPass::readProfile(Module &M)
+{
+    OwningPtr<MemoryBuffer> Buffer;
+    if (error_code ec = MemoryBuffer::getFile(ProfileFilename, Buffer)) {
+        report_warning("Can't read profile '" + Twine(ProfileFilename)
+            + "': " + ec.message());
+        return false;
+    }
+
+    StringMap<Function*> Names;
+    for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F)
+        if (!F->isDeclaration())
+            Names[demangle(F->getName())] = F;
+
+    StringRef Text = Buffer->getBuffer();
+    bool isJSON = Text.ltrim().startswith("{");
+    unsigned Matched = 0;
+
+    while (!Text.empty()) {
+        std::pair<StringRef, StringRef> Split = Text.split('\n');
+        StringRef Line = Split.first.trim();
+        Text = Split.second;
+
+        if (isJSON ? readJSONLine(Line, Names) : readLogLine(Line, Names))
+            Matched++;
+    }
+
+    if (!Matched)
+        report_warning("Profile '" + Twine(ProfileFilename)
+            + "' has no hot blocks matching this program");
+
+    return Matched != 0;
+}
+
+void ProfileLayoutPass::collectEdges(Module &M, std::vector<Edge> &Edges)
+{
+    // Measured call counts are always better than guessing from the IR
+    if (!ProfileEdges.empty()) {
+        Edges = ProfileEdges;
+        return;
+    }
+
+    // Every static call between two profiled functions is a candidate edge
+
+    DenseMap<std::pair<Function*, Function*>, unsigned> Index;
+
+    for (Module::iterator F = M.begin(), FE = M.end(); F != FE; ++F) {
+        HeatMap_t::iterator CallerHeat = Heat.find(F);
+        if (CallerHeat == Heat.end())
+            continue;
+
+        for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB)
+            for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I) {
+                CallSite CS(I);
+                if (!CS)
+                    continue;
+
+                Function *Callee = CS.getCalledFunction();
+                if (!Callee || Callee == F || Callee->isDeclaration())
+                    continue;
+                HeatMap_t::iterator CalleeHeat = Heat.find(Callee);
+                if (CalleeHeat == Heat.end())
+                    continue;
+
+                uint64_t Weight = std::min(CallerHeat->second, CalleeHeat->second);
+                std::pair<Function*, Function*> Key(F, Callee);
+                DenseMap<std::pair<Function*, Function*>, unsigned>::iterator
+                    Existing = Index.find(Key);
+
+                if (Existing == Index.end()) {
+                    Edge E = { F, Callee, Weight };
+                    Index[Key] = Edges.size();
+                    Edges.push_back(E);
+                } else {
+                    // Several call sites, still one pair of functions
+                    Edges[Existing->second].Weight += Weight;
+                }
+            }
+    }
+}
+
+bool ProfileLayoutPass::runOnModule(Module &M)
+{
+    if (ProfileFilename.empty() || !readProfile(M))
+        return false;
+
+    // Every hot function starts out as its own chain
+    std::vector<Chain_t> Chains;
+    ChainMap_t ChainOf;
+    for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F)
+        if (Heat.count(F)) {
+            ChainOf[F] = Chains.size();
+            Chains.push_back(Chain_t(1, F));
+        }
+
+    /*
+     * Heaviest edges first, join the caller's chain to the callee's chain
+     * whenever the caller is at the tail of one and the callee is at the
+     * head of another. The two functions then end up adjacent.
+     */
+
+    std::vector<Edge> Edges;
+    collectEdges(M, Edges);
+    std::stable_sort(Edges.begin(), Edges.end());
+
+    for (std::vector<Edge>::iterator I = Edges.begin(), E = Edges.end(); I != E; ++I) {
+        unsigned A = ChainOf[I->Caller];
+        unsigned B = ChainOf[I->Callee];
+        if (A == B || Chains[A].back() != I->Caller || Chains[B].front() != I->Callee)
+            continue;
+
+        for (Chain_t::iterator F = Chains[B].begin(), FE = Chains[B].end(); F != FE; ++F)
+            ChainOf[*F] = A;
+        Chains[A].insert(Chains[A].end(), Chains[B].begin(), Chains[B].end());
+        Chains[B].clear();
+    }
+
+    // Hottest chains go first, in front of every function that was never profiled
+    std::vector<std::pair<uint64_t, unsigned> > Order;
+    for (unsigned i = 0; i < Chains.size(); ++i) {
+        uint64_t Total = 0;
+        for (Chain_t::iterator F = Chains[i].begin(), FE = Chains[i].end(); F != FE; ++F)
+            Total += Heat[*F];
+        if (Total)
+            Order.push_back(std::make_pair(~Total, i));     // Descending heat
+    }
+    std::sort(Order.begin(), Order.end());
+
+    Module::FunctionListType &List = M.getFunctionList();
+    Module::iterator InsertPt = List.begin();
+
+    for (unsigned i = 0; i < Order.size(); ++i) {
+        Chain_t &C = Chains[Order[i].second];
+        for (Chain_t::iterator F = C.begin(), FE = C.end(); F != FE; ++F) {
+            Module::iterator FI = *F;
+            if (FI == InsertPt) {
+                ++InsertPt;
+                continue;
+            }
+            List.splice(InsertPt, List, FI);
+        }
+    }
+
+    return true;
+}
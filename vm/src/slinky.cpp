@@ -76,6 +76,7 @@ extern "C" void LLVMInitializeSVMTargetInfo();
 namespace llvm {
     ModulePass *createInlineGlobalCtorsPass();
     ModulePass *createMetadataCollectorPass();
+    ModulePass *createProfileLayoutPass();
     BasicBlockPass *createEarlyLTIPass();
     BasicBlockPass *createLateLTIPass();
     BasicBlockPass *createMisalignStackPass();
@@ -336,6 +337,10 @@ static void AddPasses(PassManagerBase &PM,
 
     // Just before code generation, make all stack allocations static.
     PM.add(createStaticAllocaPass());
+
+    // Function order decides which functions share flash blocks. With a
+    // profile, reorder them so hot callers and callees end up together.
+    PM.add(createProfileLayoutPass());
 }
 
 int main(int argc, char **argv)